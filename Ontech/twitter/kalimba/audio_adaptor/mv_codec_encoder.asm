@@ -172,6 +172,17 @@
 
    .CONST  $CODEC_OUT_PORT    ($cbuffer.WRITE_PORT_MASK + 2);
    .CONST  $CODEC_OUT_PORT_TWO ($cbuffer.WRITE_PORT_MASK + 3);
+   .CONST  $CODEC_OUT_PORT_THREE ($cbuffer.WRITE_PORT_MASK + 4);
+   .CONST  $CODEC_OUT_PORT_FOUR ($cbuffer.WRITE_PORT_MASK + 5);
+
+   // one codec output port per A2DP sink, the VM connects an RTP transform
+   // to each; parts with 8 Kalimba ports can build with CODEC_OUT_PORTS_4,
+   // which the VM must be built with too to stream to more than 2 sinks
+.ifdef CODEC_OUT_PORTS_4
+   .CONST  $CODEC_OUT_PORTS   4;
+.else
+   .CONST  $CODEC_OUT_PORTS   2;
+.endif
 
 
    // ** allocate memory for cbuffers and structures **
@@ -474,35 +485,43 @@
                1;                         // Output index
    .ENDBLOCK;
 
-
-// *** Dual Stream ***
-   .VAR $ds_codec_out_copy_one_struc[] =
-            &$ds_codec_out_copy_one_op,                // first operator block
+   .VAR $codec_out_copy_three_struc[] =
+            &$codec_out_copy_three_op,          // first operator block
             1,                                  // number of inputs
             &$codec_out_cbuffer_struc,          // input
             1,                                  // number of outputs
-            $CODEC_OUT_PORT;                    // output
-   .BLOCK $ds_codec_out_copy_one_op;
-      .VAR $ds_codec_out_copy_one_op.next = $cbops.NO_MORE_OPERATORS;
-      .VAR $ds_codec_out_copy_one_op.func = &$cbops.copy_op;
-      .VAR $ds_codec_out_copy_one_op.param[$cbops.copy_op.STRUC_SIZE] =
-            0,                         // Input index
-            1;                         // Output index
+            $CODEC_OUT_PORT_THREE;              // output
+   .BLOCK $codec_out_copy_three_op;
+      .VAR $codec_out_copy_three_op.next = $cbops.NO_MORE_OPERATORS;
+      .VAR $codec_out_copy_three_op.func = &$cbops.copy_op;
+      .VAR $codec_out_copy_three_op.param[$cbops.copy_op.STRUC_SIZE] =
+               0,                         // Input index
+               1;                         // Output index
    .ENDBLOCK;
-   
-   .VAR $ds_codec_out_copy_two_struc[] =
-            &$ds_codec_out_copy_two_op,                // first operator block
+
+   .VAR $codec_out_copy_four_struc[] =
+            &$codec_out_copy_four_op,           // first operator block
             1,                                  // number of inputs
             &$codec_out_cbuffer_struc,          // input
             1,                                  // number of outputs
-            $CODEC_OUT_PORT_TWO;                    // output
-   .BLOCK $ds_codec_out_copy_two_op;
-      .VAR $ds_codec_out_copy_two_op.next = $cbops.NO_MORE_OPERATORS;
-      .VAR $ds_codec_out_copy_two_op.func = &$cbops.copy_op;
-      .VAR $ds_codec_out_copy_two_op.param[$cbops.copy_op.STRUC_SIZE] =
-            0,                         // Input index
-            1;                         // Output index
+            $CODEC_OUT_PORT_FOUR;               // output
+   .BLOCK $codec_out_copy_four_op;
+      .VAR $codec_out_copy_four_op.next = $cbops.NO_MORE_OPERATORS;
+      .VAR $codec_out_copy_four_op.func = &$cbops.copy_op;
+      .VAR $codec_out_copy_four_op.param[$cbops.copy_op.STRUC_SIZE] =
+               0,                         // Input index
+               1;                         // Output index
    .ENDBLOCK;
+
+
+// *** Multi Stream ***
+   // the codec output ports in the order the VM connects the media sinks
+   .VAR $codec_out_port_table[] =
+            $CODEC_OUT_PORT, $CODEC_OUT_PORT_TWO, $CODEC_OUT_PORT_THREE, $CODEC_OUT_PORT_FOUR;
+   .VAR $codec_out_copy_table[] =
+            &$codec_out_copy_struc, &$codec_out_copy_two_struc, &$codec_out_copy_three_struc, &$codec_out_copy_four_struc;
+   .VAR $codec_out_port_bit[] =
+            1, 2, 4, 8;
 // *** *** *** ***
 
 
@@ -1197,148 +1216,130 @@ set_downsample:
  
      
      
-      .define SINGLE_STREAM_MODE    0
-      .define DUAL_STREAM_MODE      1
-      .VAR last_stream_state = -1;
-     
-     
-      r2 = 1;
-      r0 = $CODEC_OUT_PORT;
-      call $cbuffer.is_it_enabled;
-      // NULL = r0;
-      if Z r2 = r2 - r2;
-      r0 = $CODEC_OUT_PORT_TWO;
+      // ************* Multi Stream ****************
+      // The encoded stream is copied to every enabled codec output port. Each
+      // port keeps its own read pointer into the codec output buffer so a slow
+      // link doesn't hold back the others, and the buffer's read pointer is
+      // left at the slowest port so none loses data it hasn't taken yet.
+      // A port that falls more than the gap threshold behind the fastest is
+      // moved up to it, dropping audio on that link rather than all of them.
+
+      .VAR codec_out_read_ptr[$CODEC_OUT_PORTS];
+      .VAR codec_out_enabled = 0;         // ports copied to last time, a bit each
+      .VAR codec_out_now_enabled;
+      .VAR codec_out_index;
+      .VAR codec_out_shared_read_ptr;
+      .VAR $codec_out_gap_threshold = 500;
+
+      r0 = &$codec_out_cbuffer_struc;
+      call $cbuffer.get_read_address_and_size;
+      M[&codec_out_shared_read_ptr] = r0;
+      M[&codec_out_now_enabled] = Null;
+      M[&codec_out_index] = Null;
+
+   codec_out_copy_loop:
+      r5 = M[&codec_out_index];
+      r0 = M[r5 + $codec_out_port_table];
       call $cbuffer.is_it_enabled;
-      // NULL = r0;
-      if NZ r2 = r2 + r2;
-      NULL = r2 - 2;
-      if EQ jump dual_stream_codec_copy;  
-      
-      // Single stream copy, this single stream can be the first one or second one.
-
-         r1 = M[&last_stream_state];
-         NULL = r1 - DUAL_STREAM_MODE;
-         if NZ jump not_from_ds_mode;
-
-         // Need to handle the transition from two streams to one stream.
-         r1 = M[ds_codec_out_one_read_prt];
-         r2 = M[ds_codec_out_two_read_prt];
-         // r0 == second port enable
-         NULL = r0;
-         if NZ r1 = r2;
+      Null = r0;
+      if Z jump codec_out_copy_next;
+
+         r5 = M[&codec_out_index];
+         r1 = M[r5 + $codec_out_port_bit];
+         r2 = M[&codec_out_now_enabled];
+         r2 = r2 OR r1;
+         M[&codec_out_now_enabled] = r2;
+
+         // a port that has just been connected starts where the others are
+         r2 = M[&codec_out_enabled];
+         Null = r2 AND r1;
+         if NZ jump codec_out_port_running;
+            r1 = M[&codec_out_shared_read_ptr];
+            M[r5 + codec_out_read_ptr] = r1;
+         codec_out_port_running:
+
+         r1 = M[r5 + codec_out_read_ptr];
          r0 = &$codec_out_cbuffer_struc;
-         call $cbuffer.set_read_address;  // update the read pointer
-         
-                 
-      not_from_ds_mode:
-         r8 = &$codec_out_copy_struc;
-         r7 = &$codec_out_copy_two_struc;
-         r0 = $CODEC_OUT_PORT_TWO;
-         call $cbuffer.is_it_enabled;
-         if NZ r8 = r7;
+         call $cbuffer.set_read_address;
+         r5 = M[&codec_out_index];
+         r8 = M[r5 + $codec_out_copy_table];
          call $cbops.copy;
-
-         r0 = SINGLE_STREAM_MODE;
-         M[&last_stream_state] = r0;
-         jump no_codec_copy_with_bitpool_control;
-
-
-     // ************* Dual Stream ****************
-     // Copy codec out data, handle dual stream special case
-      
-      dual_stream_codec_copy:
-      
-       .VAR ds_codec_out_one_read_prt = 0;
-       .VAR ds_codec_out_two_read_prt = 0;
-       
-       .VAR $ds_codec_out_gap_threshold = 500;
-       
-       
-
-       r1 = M[&last_stream_state];
-       r0 = DUAL_STREAM_MODE;
-       M[&last_stream_state] = r0;
-       
-       // *** if first time enter dual stream mode, setup read pointer first
-       NULL = r1 - DUAL_STREAM_MODE;
-       if Z jump already_in_dual_stream;
-       
-       // First time into dual stream mode
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.get_read_address_and_size;
-       M[&ds_codec_out_two_read_prt] = r0;
-       M[&ds_codec_out_one_read_prt] = r0;
-       
-       
-    already_in_dual_stream:
-
-
-   // Daul Stream free run, read points can drift away. 
-   dual_free_run_mode:
-
-       
-       r8 = &$ds_codec_out_copy_one_struc;
-       r1 = M[&ds_codec_out_one_read_prt];
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.set_read_address;
-       call $cbops.copy;
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.get_read_address_and_size;
-       M[&ds_codec_out_one_read_prt] = r0;
-
-       r8 = &$ds_codec_out_copy_two_struc;
-       r1 = M[&ds_codec_out_two_read_prt];
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.set_read_address;
-       call $cbops.copy;
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.get_read_address_and_size;
-       M[&ds_codec_out_two_read_prt] = r0;
-       
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.get_write_address_and_size;
-       // r0 = write address
-       // r1 = buffer size
-       r4 = M[&ds_codec_out_one_read_prt];
-       r5 = M[&ds_codec_out_two_read_prt];
-       
-       r2 = r0 - r4;
-       if NEG r2 = r2 + r1;  // r2 == stream one copy amount
-       r3 = r0 - r5;
-       if NEG r3 = r3 + r1;  // r3 == stream two copy amount
-       r1 = r2 - r3;
-       if NEG r4 = r5;
-       // r4 = tail read pointer address
-       // r1 = the gap between two read pointers
-       
-       
-//.VAR $current_read_pointer_gap = 0;   // debug use
-//M[$current_read_pointer_gap] = r1;    // debug use
-       
-       
-       // *** force the slow read pointer to keep up if the gap becomes too large
-       r2 = M[&$ds_codec_out_gap_threshold];
-       NULL = r1;
-       if NEG jump output_one_faster;
-          // codec out two is faster (read pointer is closer to write pointer)
-          NULL = r1 - r2;
-          if LT jump update_combined_read_pointer;
-          r4 = M[&ds_codec_out_two_read_prt];
-          M[&ds_codec_out_one_read_prt] = r4;
-          jump update_combined_read_pointer;
-       
-       output_one_faster:
-          // codec out one is faster
-          NULL = r2 + r1;
-          if POS jump update_combined_read_pointer;
-          r4 = M[&ds_codec_out_one_read_prt];
-          M[&ds_codec_out_two_read_prt] = r4;
-       
-       
-    update_combined_read_pointer:
-       r1 = r4;
-       r0 = &$codec_out_cbuffer_struc;
-       call $cbuffer.set_read_address;
+         r0 = &$codec_out_cbuffer_struc;
+         call $cbuffer.get_read_address_and_size;
+         r5 = M[&codec_out_index];
+         M[r5 + codec_out_read_ptr] = r0;
+
+   codec_out_copy_next:
+      r5 = M[&codec_out_index];
+      r5 = r5 + 1;
+      M[&codec_out_index] = r5;
+      Null = r5 - $CODEC_OUT_PORTS;
+      if LT jump codec_out_copy_loop;
+
+      r9 = M[&codec_out_now_enabled];
+      M[&codec_out_enabled] = r9;
+      Null = r9;
+      if Z jump no_codec_copy_with_bitpool_control;
+
+      r0 = &$codec_out_cbuffer_struc;
+      call $cbuffer.get_write_address_and_size;
+      // r0 = write address
+      // r1 = buffer size
+
+      // *** find the fastest port, the one with least data left to take
+      r3 = r1;                   // least data left
+      r7 = M[&codec_out_shared_read_ptr];
+      r5 = 0;
+   codec_out_fastest_loop:
+      r6 = M[r5 + $codec_out_port_bit];
+      Null = r9 AND r6;
+      if Z jump codec_out_fastest_next;
+         r8 = M[r5 + codec_out_read_ptr];
+         r6 = r0 - r8;
+         if NEG r6 = r6 + r1;    // r6 == data this port has left to take
+         Null = r6 - r3;
+         if GT jump codec_out_fastest_next;
+         r3 = r6;
+         r7 = r8;
+   codec_out_fastest_next:
+      r5 = r5 + 1;
+      Null = r5 - $CODEC_OUT_PORTS;
+      if LT jump codec_out_fastest_loop;
+
+      // *** force the slow ports to keep up if they fall too far behind,
+      //     and find the read pointer of the slowest that is left
+      r2 = M[&$codec_out_gap_threshold];
+      r10 = r3;                  // data left for the fastest port
+      r3 = r3 + r2;              // most data any port may have left
+      r2 = -1;                   // most data left
+      r4 = r7;                   // tail read pointer address
+      r5 = 0;
+   codec_out_slowest_loop:
+      r6 = M[r5 + $codec_out_port_bit];
+      Null = r9 AND r6;
+      if Z jump codec_out_slowest_next;
+         r8 = M[r5 + codec_out_read_ptr];
+         r6 = r0 - r8;
+         if NEG r6 = r6 + r1;
+         Null = r6 - r3;
+         if LE jump codec_out_within_gap;
+            r8 = r7;
+            r6 = r10;
+            M[r5 + codec_out_read_ptr] = r8;
+         codec_out_within_gap:
+         Null = r6 - r2;
+         if LE jump codec_out_slowest_next;
+         r2 = r6;
+         r4 = r8;
+   codec_out_slowest_next:
+      r5 = r5 + 1;
+      Null = r5 - $CODEC_OUT_PORTS;
+      if LT jump codec_out_slowest_loop;
+
+      // r4 = tail read pointer address
+      r1 = r4;
+      r0 = &$codec_out_cbuffer_struc;
+      call $cbuffer.set_read_address;
        
 
        // Adaptive SBC bitpool for handling poor connection
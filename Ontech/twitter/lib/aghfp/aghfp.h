@@ -534,6 +534,7 @@ typedef struct
 	AGHFP					*aghfp;	 /*!< Pointer to aghfp profile instance that is handling the Service Level Connection. */
 	aghfp_connect_status	status;  /*!< Indicates whether or not the connection was successfully established. */
     Sink                    rfcomm_sink; /*!< The RFCOMM sink. */
+	uint8					rfc_channel; /*!< The HF's RFCOMM server channel if the AG connected to it, zero otherwise. */
 } AGHFP_SLC_CONNECT_CFM_T;
 
 
@@ -1140,6 +1141,23 @@ void AghfpInit(Task theAppTask, aghfp_profile aghfp_supported_profile, uint16 su
 void AghfpSlcConnect(AGHFP *aghfp, const bdaddr *bd_addr);
 
 
+/*!	@brief Initiate the creation of a Service Level Connection to a known server channel.
+
+	@param aghfp The profile instance which will be used to create the connection.
+	@param bd_addr The address of the remote device (HF) to which the connection will be created.
+	@param rfc_channel The RFCOMM server channel of the HF service, as reported in the
+	AGHFP_SLC_CONNECT_CFM of an earlier connection. Zero if it is not known.
+
+	As AghfpSlcConnect but the service search for the server channel is skipped,
+	the RFCOMM connection is made to rfc_channel straight away. If the HF refuses
+	it, for example because its service record has changed, the library falls back
+	to the service search and connects to the channel found.
+
+	The application will receive an AGHFP_SLC_CONNECT_CFM message from the library
+	to indicate the success or otherwise of the connection attempt. */
+void AghfpSlcConnectUsingChannel(AGHFP *aghfp, const bdaddr *bd_addr, uint8 rfc_channel);
+
+
 /*!	@brief Respond to an AGHFP_SLC_CONNECT_IND message from the HF.
 
 	@param aghfp The profile instance which will be used to create the connection.
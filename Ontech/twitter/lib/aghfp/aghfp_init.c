@@ -108,8 +108,10 @@ void AghfpInit(Task theAppTask, aghfp_profile aghfp_supported_profile, uint16 su
 	/* Connection related state updated in separate function */
 	aghfpResetConnectionRelatedState(aghfp);
 
-	/* Init the local server channel */
+	/* Init the local server channel, and the remote one until an SLC is made */
 	aghfp->local_rfc_server_channel = 0;
+	aghfp->remote_rfc_server_channel = 0;
+	aghfp->remote_rfc_channel_cached = FALSE;
 
 	/* Init the service record handle */
 	aghfp->sdp_record_handle = 0;
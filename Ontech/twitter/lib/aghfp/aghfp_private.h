@@ -160,6 +160,7 @@ typedef struct
 typedef struct
 {
 	bdaddr		addr;
+	uint8		rfc_channel;	/* Zero to search for it */
 } AGHFP_INTERNAL_SLC_CONNECT_REQ_T;
 
 
@@ -643,6 +644,8 @@ struct __AGHFP
 	aghfp_hf_supported_features	hf_supported_features;	/* A record of what the HF sent in its AT+BRSF */
 	aghfp_features_status		features_status;		/* The current status of features that can be enabled/disabled at run time */
 	uint8						local_rfc_server_channel;
+	uint8						remote_rfc_server_channel;	/* The channel of an outgoing SLC, zero if the HF connected */
+	bdaddr						connect_addr;				/* The HF an outgoing SLC is being made to */
 	unsigned int				wbs_lm_sco_handle:8;
 	uint32						sdp_record_handle;
 	uint32						rx_bandwidth;
@@ -666,6 +669,7 @@ struct __AGHFP
 	unsigned int				codec_to_negotiate:3;
 	unsigned int				negotiation_type:3;
 	unsigned int				app_pending_codec_negotiation:1;
+	unsigned int				remote_rfc_channel_cached:1;	/* The channel was given by the app, not searched for */
 	
 	
 	aghfp_call_progress			call_progress;
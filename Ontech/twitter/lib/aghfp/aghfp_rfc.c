@@ -8,6 +8,7 @@ Part of Audio-Adaptor-SDK 2009.R1
 #include "aghfp_private.h"
 #include "aghfp_common.h"
 #include "aghfp_rfc.h"
+#include "aghfp_sdp.h"
 #include "aghfp_init.h"
 #include "aghfp_receive_data.h"
 #include "aghfp_slc_handler.h"
@@ -152,6 +153,18 @@ void aghfpHandleRfcommConnectCfm(AGHFP *aghfp, const CL_RFCOMM_CONNECT_CFM_T *cf
   		/* Check for data in the buffer */
   		aghfpHandleReceivedData(aghfp, StreamSourceFromSink(cfm->sink));
     }
+    else if (aghfp->remote_rfc_channel_cached &&
+             (cfm->status == rfcomm_server_channel_not_registered ||
+              cfm->status == rfcomm_connect_rejected))
+    {
+        /* The HF answered but refused the channel the app remembered, its
+           service record may have moved. Search for the channel as for a new
+           device. Other failures, such as a page timeout, go to the app as
+           another page would only fail again. */
+        aghfp->remote_rfc_channel_cached = FALSE;
+        aghfp->remote_rfc_server_channel = 0;
+        aghfpGetProfileServerChannel(aghfp, &aghfp->connect_addr);
+    }
     else
     {
         /* RFCOMM connect failed - Tell the app. */
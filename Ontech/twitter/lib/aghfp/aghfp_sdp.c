@@ -367,6 +367,7 @@ void aghfpHandleServiceSearchAttributeCfm(AGHFP *aghfp, const CL_SDP_SERVICE_SEA
 		{
 			/* We have an rfcomm channel we can proceed with the connection establishment */
 			MAKE_AGHFP_MESSAGE(AGHFP_INTERNAL_RFCOMM_CONNECT_REQ);
+			aghfp->remote_rfc_server_channel = (uint8) sdp_data;
 			message->addr = cfm->bd_addr;
 			message->rfc_channel = sdp_data;
 			MessageSend(&aghfp->task, AGHFP_INTERNAL_RFCOMM_CONNECT_REQ, message);
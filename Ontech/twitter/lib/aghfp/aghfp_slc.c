@@ -23,6 +23,25 @@ void AghfpSlcConnect(AGHFP *aghfp, const bdaddr *bd_addr)
 	AGHFP_DEBUG_ASSERT(aghfp != NULL, ("Null aghfp task ptr passed in.\n"));
 
 	message->addr = *bd_addr;
+	message->rfc_channel = 0;
+
+	MessageSend(&aghfp->task, AGHFP_INTERNAL_SLC_CONNECT_REQ, message);
+}
+
+
+/****************************************************************************
+	See comment in aghfp.h
+*/
+void AghfpSlcConnectUsingChannel(AGHFP *aghfp, const bdaddr *bd_addr, uint8 rfc_channel)
+{
+	/* Send an internal message to kick off SLC creation */
+	MAKE_AGHFP_MESSAGE(AGHFP_INTERNAL_SLC_CONNECT_REQ);
+
+	AGHFP_DEBUG_ASSERT(bd_addr != NULL, ("Null address ptr passed in.\n"));
+	AGHFP_DEBUG_ASSERT(aghfp != NULL, ("Null aghfp task ptr passed in.\n"));
+
+	message->addr = *bd_addr;
+	message->rfc_channel = rfc_channel;
 
 	MessageSend(&aghfp->task, AGHFP_INTERNAL_SLC_CONNECT_REQ, message);
 }
@@ -37,6 +37,7 @@ void aghfpSendSlcConnectCfmToApp(aghfp_connect_status status, AGHFP *aghfp)
 	message->status = status;
 	message->aghfp = aghfp;
     message->rfcomm_sink = aghfp->rfcomm_sink;
+	message->rfc_channel = (status == aghfp_connect_success) ? aghfp->remote_rfc_server_channel : 0;
 	MessageSend(aghfp->client_task, AGHFP_SLC_CONNECT_CFM, message);
 
 	/* If the connect succeeded need to tidy up a few things */
@@ -75,8 +76,23 @@ void aghfpHandleSlcConnectRequest(AGHFP *aghfp, const AGHFP_INTERNAL_SLC_CONNECT
     /* Update the local state to indicate we're in the middle of connecting. */
 	aghfpSetState(aghfp, aghfp_slc_connecting);
 
-	/* Perform a service attribute search to get the rfcomm channel of the remote service */
-	aghfpGetProfileServerChannel(aghfp, &req->addr);
+	aghfp->connect_addr = req->addr;
+	aghfp->remote_rfc_server_channel = req->rfc_channel;
+	aghfp->remote_rfc_channel_cached = req->rfc_channel ? TRUE : FALSE;
+
+	if (req->rfc_channel)
+	{
+		/* The app knows the channel from an earlier connection, go straight to RFCOMM */
+		MAKE_AGHFP_MESSAGE(AGHFP_INTERNAL_RFCOMM_CONNECT_REQ);
+		message->addr = req->addr;
+		message->rfc_channel = req->rfc_channel;
+		MessageSend(&aghfp->task, AGHFP_INTERNAL_RFCOMM_CONNECT_REQ, message);
+	}
+	else
+	{
+		/* Perform a service attribute search to get the rfcomm channel of the remote service */
+		aghfpGetProfileServerChannel(aghfp, &req->addr);
+	}
 }
 
 
@@ -89,6 +105,10 @@ void aghfpHandleSlcConnectResponse(AGHFP *aghfp, const AGHFP_INTERNAL_SLC_CONNEC
 	if (!res->response)
 		aghfpSetState(aghfp, aghfp_ready);
 
+	/* The HF is connecting to us, its own server channel is not learnt */
+	aghfp->remote_rfc_server_channel = 0;
+	aghfp->remote_rfc_channel_cached = FALSE;
+
 	/* Send response to the connection lib */
 	aghfpHandleRfcommConnectResponse(aghfp, res->response, &res->addr, aghfp->local_rfc_server_channel, 0);
 }
@@ -11,6 +11,7 @@ NOTES
 #include <codec.h>
 #include <pcm.h>
 #include <stdlib.h>
+#include <string.h>
 #include <panic.h>
 #include <print.h>
 #include <file.h>
@@ -33,7 +34,7 @@ typedef enum
 
 #define KALIMBA_ENCODER_SELECT			0x7300
 
-#define MAX_AUDIO_SINKS	2
+#define MAX_AUDIO_SINKS	4
 
 typedef struct sync_Tag
 {
@@ -66,6 +67,7 @@ void CsrFaststreamSourcePluginConnect( Sink audio_sink , Task codec_task , uint1
 
 	
     FASTSTREAM = (FASTSTREAM_t*)PanicUnlessMalloc (sizeof (FASTSTREAM_t) ) ;
+    memset(FASTSTREAM, 0, sizeof(FASTSTREAM_t));
     
     FASTSTREAM->media_sink[0] = audio_sink ;
     FASTSTREAM->codec_task = codec_task ;
@@ -222,7 +224,7 @@ void CsrFaststreamSourcePluginSetMode ( AUDIO_MODE_T mode , const void * params
 	
 	if (faststream_mode->connect_sink)
 	{
-		/* A second audio sink has been connected */
+		/* Another audio sink has been connected */
 		for (i = 0; i < MAX_AUDIO_SINKS; i++)
 		{
 			if (FASTSTREAM->media_sink[i] == 0)
@@ -233,6 +235,7 @@ void CsrFaststreamSourcePluginSetMode ( AUDIO_MODE_T mode , const void * params
 				(void) StreamConnect(StreamKalimbaSource(i+2), FASTSTREAM->media_sink[i]);
                 
                 PRINT(("Audio Plugin: New connection i:%d sink:0x%x\n",i,(uint16)FASTSTREAM->media_sink[i]));
+				break;
 			}
 		}
 	}
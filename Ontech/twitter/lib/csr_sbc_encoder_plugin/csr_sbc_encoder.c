@@ -11,6 +11,7 @@ NOTES
 #include <codec.h>
 #include <pcm.h>
 #include <stdlib.h>
+#include <string.h>
 #include <panic.h>
 #include <print.h>
 #include <file.h>
@@ -27,7 +28,9 @@ NOTES
 
 #define   KALIMBA_ENCODER_SELECT			         0x7300
 
-#define MAX_AUDIO_SINKS	2
+/* Kalimba codec output ports 2 to 5, the kap copies the encoded stream to
+   each one that is connected. Sinks after the 2nd are added by SetMode. */
+#define MAX_AUDIO_SINKS	4
 
 typedef enum
 {
@@ -40,7 +43,7 @@ typedef struct sync_Tag
     Sink media_sink[MAX_AUDIO_SINKS];    
 	Transform t[MAX_AUDIO_SINKS];
     Task codec_task;    
-	uint16 packet_size;
+	uint16 packet_size[MAX_AUDIO_SINKS];	/* each sink has its own RTP packetiser */
 }SBC_t ;
 
     /*the synchronous audio data structure*/
@@ -65,6 +68,7 @@ void CsrSbcEncoderPluginConnect( Sink audio_sink , Task codec_task , uint16 volu
 		unsigned format:8;
 		uint16 packet_size;
 		Sink media_sink_b;
+		uint16 packet_size_b;
 	} sbc_codec_data_type;
 
 	sbc_codec_data_type *sbc_codecData = (sbc_codec_data_type *) params;
@@ -73,11 +77,14 @@ void CsrSbcEncoderPluginConnect( Sink audio_sink , Task codec_task , uint16 volu
 		Panic();
 
     SBC = (SBC_t*)PanicUnlessMalloc (sizeof (SBC_t) ) ;
+    memset(SBC, 0, sizeof(SBC_t));
     
     SBC->media_sink[0] = audio_sink ;
     SBC->codec_task = codec_task ;
 	SBC->media_sink[1] = sbc_codecData->media_sink_b;
-	SBC->packet_size = sbc_codecData->packet_size;
+	SBC->packet_size[0] = sbc_codecData->packet_size;
+	/* the 2nd sink may negotiate a different MTU, use the 1st size if it didn't say */
+	SBC->packet_size[1] = sbc_codecData->packet_size_b ? sbc_codecData->packet_size_b : sbc_codecData->packet_size;
     
     StreamDisconnect(StreamKalimbaSource(2), 0);
 
@@ -85,7 +92,7 @@ void CsrSbcEncoderPluginConnect( Sink audio_sink , Task codec_task , uint16 volu
 	SBC->t[0] = TransformRtpSbcEncode(StreamKalimbaSource(2), audio_sink);
 
 	/* Configure the RTP transform to generate the selected packet size */
-	TransformConfigure(SBC->t[0], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, sbc_codecData->packet_size);
+	TransformConfigure(SBC->t[0], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, SBC->packet_size[0]);
 
 	/* Transform should not manage timings. */
 	TransformConfigure(SBC->t[0], VM_TRANSFORM_RTP_SBC_ENCODE_MANAGE_TIMING, FALSE);
@@ -104,7 +111,7 @@ void CsrSbcEncoderPluginConnect( Sink audio_sink , Task codec_task , uint16 volu
 		SBC->t[1] = TransformRtpSbcEncode(StreamKalimbaSource(3), SBC->media_sink[1]);
 
 		/* Configure the RTP transform to generate the selected packet size */
-		TransformConfigure(SBC->t[1], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, sbc_codecData->packet_size);
+		TransformConfigure(SBC->t[1], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, SBC->packet_size[1]);
 
 		/* Transform should not manage timings. */
 		TransformConfigure(SBC->t[1], VM_TRANSFORM_RTP_SBC_ENCODE_MANAGE_TIMING, FALSE);
@@ -250,6 +257,7 @@ void CsrSbcEncoderPluginSetMode ( AUDIO_MODE_T mode , const void * params )
 	{
 		bool connect_sink;
 		Sink media_sink;
+		uint16 packet_size;
 	} sbc_mode_params;
 	
 	sbc_mode_params *sbc_mode = (sbc_mode_params *) params;
@@ -262,19 +270,20 @@ void CsrSbcEncoderPluginSetMode ( AUDIO_MODE_T mode , const void * params )
 	
 	if (sbc_mode->connect_sink)
 	{
-		/* A second audio sink has been connected */
+		/* Another audio sink has been connected */
 		for (i = 0; i < MAX_AUDIO_SINKS; i++)
 		{
 			if (SBC->media_sink[i] == 0)
 			{
 				/* store the audio sink */	
 				SBC->media_sink[i] = sbc_mode->media_sink;	
+				SBC->packet_size[i] = sbc_mode->packet_size ? sbc_mode->packet_size : SBC->packet_size[0];
 						
 				/* Initialise the RTP SBC encoder */
 				SBC->t[i] = TransformRtpSbcEncode(StreamKalimbaSource(i+2), SBC->media_sink[i]);
 
 				/* Configure the RTP transform to generate the selected packet size */
-				TransformConfigure(SBC->t[i], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, SBC->packet_size);
+				TransformConfigure(SBC->t[i], VM_TRANSFORM_RTP_SBC_ENCODE_PACKET_SIZE, SBC->packet_size[i]);
 
 				/* Transform should not manage timings. */
 				TransformConfigure(SBC->t[i], VM_TRANSFORM_RTP_SBC_ENCODE_MANAGE_TIMING, FALSE);
@@ -282,7 +291,8 @@ void CsrSbcEncoderPluginSetMode ( AUDIO_MODE_T mode , const void * params )
 				/* Start the transform */
 				(void) TransformStart(SBC->t[i]);	
                 
-                PRINT(("Audio Plugin: Start new Transform i:%d sink:0x%x\n",i,(uint16)SBC->media_sink[i]));
+                PRINT(("Audio Plugin: Start new Transform i:%d sink:0x%x size:%d\n",i,(uint16)SBC->media_sink[i],SBC->packet_size[i]));
+				break;
 			}
 		}
 	}
@@ -0,0 +1,125 @@
+/*
+ * boot stage of PentascanAP, the first 4K of flash.
+ *
+ * On reset it installs an image left verified in the update slot by ota.c,
+ * copying the body over the app area and erasing the state page once the
+ * copy reads back correctly, then starts the app at OTA_APP_BASE.  A reset
+ * during the copy finds the image still pending and copies it again.  The
+ * flash layout is in Common/Utils/ota_image.h.
+ *
+ * There is a single app area and no fallback image: an image that verifies
+ * but does not run stays installed until a new one is downloaded over it,
+ * or the app is flashed again with the debugger.
+ *
+ * Built by Boot/Boot.uvproj: IROM 0x0 size 0x1000, driverlib-cm3.lib, no
+ * startup file and no C library init, the vector table below is placed
+ * first by the RESET section.  The app of PentascanAP/PentascanAP.uvproj is
+ * linked at 0x1000 and needs this stage in place to run.  To program a new
+ * board build and download Boot.uvproj first, then the app.  Flash Download
+ * in both projects must stay on "Erase Sectors", "Erase Full Chip" would
+ * wipe the other half.
+ */
+
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "hw_nvic.h"
+#include "sysctl.h"
+#include "lmi_flash.h"
+#include "ota_image.h"
+
+/* the top 512 bytes of ram keep the crash record of PentascanAP/health.h
+   across the reset */
+#define BOOT_STACK_TOP      0x2000FE00UL
+#define BOOT_RAM_BASE       0x20000000UL
+#define BOOT_INSTALL_TRIES  3
+
+static void boot_reset(void);
+
+static void boot_fault(void)
+{
+    for(;;);
+}
+
+/* only reset is used, every fault just stops */
+const unsigned long boot_vectors[16] __attribute__((section("RESET"))) =
+{
+    BOOT_STACK_TOP,
+    (unsigned long)boot_reset,
+    (unsigned long)boot_fault,      /* NMI */
+    (unsigned long)boot_fault,      /* hard fault */
+    (unsigned long)boot_fault,      /* memory management */
+    (unsigned long)boot_fault,      /* bus fault */
+    (unsigned long)boot_fault,      /* usage fault */
+    0, 0, 0, 0,
+    (unsigned long)boot_fault,      /* SVCall */
+    (unsigned long)boot_fault,      /* debug monitor */
+    0,
+    (unsigned long)boot_fault,      /* PendSV */
+    (unsigned long)boot_fault       /* SysTick */
+};
+
+/* set the stack of the app and jump to its reset handler */
+static __asm void boot_jump(unsigned long ulVectors)
+{
+    ldr r1, [r0]
+    msr msp, r1
+    ldr r0, [r0, #4]
+    bx r0
+}
+
+/* copy the pending image over the app, 0 when done or nothing pending */
+static int boot_install(void)
+{
+    const xOtaState *state = (const xOtaState *)OTA_STATE_BASE;
+    const xOtaHeader *header = (const xOtaHeader *)OTA_SLOT_BASE;
+    const unsigned long *src = (const unsigned long *)(OTA_SLOT_BASE + OTA_HEADER_SIZE);
+    const unsigned long *dst = (const unsigned long *)OTA_APP_BASE;
+    unsigned long addr, len, i;
+
+    if(state->ulMagic != OTA_STATE_MAGIC || state->ulPending != OTA_STATE_PENDING)
+        return 0;
+
+    /* ota.c checked this already, a broken header is just dropped */
+    if(header->ulMagic != OTA_IMAGE_MAGIC || header->ulLength > OTA_APP_SIZE
+       || header->ulLength % 4 || header->ulLength == 0){
+        FlashErase(OTA_STATE_BASE);
+        return 0;
+    }
+
+    for(addr=0;addr<header->ulLength;addr+=OTA_PAGE_SIZE){
+        len = header->ulLength - addr;
+        if(len > OTA_PAGE_SIZE)
+            len = OTA_PAGE_SIZE;
+        if(FlashErase(OTA_APP_BASE + addr))
+            return -1;
+        if(FlashProgram((unsigned long *)(OTA_SLOT_BASE + OTA_HEADER_SIZE + addr), OTA_APP_BASE + addr, len))
+            return -1;
+    }
+    for(i=0;i<header->ulLength/4;i++)
+        if(dst[i] != src[i])
+            return -1;
+
+    return FlashErase(OTA_STATE_BASE) ? -1 : 0;
+}
+
+static void boot_reset(void)
+{
+    const unsigned long *app = (const unsigned long *)OTA_APP_BASE;
+    int i;
+
+    /* flash timing is set for 50 MHz, as in the app */
+    SysCtlClockSet(SYSCTL_SYSDIV_4 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_8MHZ);
+    FlashUsecSet(50);
+
+    for(i=0;i<BOOT_INSTALL_TRIES;i++)
+        if(boot_install() == 0)
+            break;
+
+    /* nothing to start without a stack in ram and a reset handler in the app */
+    if(app[0] <= BOOT_RAM_BASE || app[0] > BOOT_STACK_TOP
+       || app[1] < OTA_APP_BASE || app[1] >= OTA_APP_BASE + OTA_APP_SIZE)
+        boot_fault();
+
+    HWREG(NVIC_VTABLE) = OTA_APP_BASE;
+    boot_jump(OTA_APP_BASE);
+}
@@ -93,6 +93,9 @@ BYTE CardType;            /* b0:MMC, b1:SDC, b2:Block addressing */
 static
 BYTE PowerFlag = 0;     /* indicates if "power" is on */
 
+static
+DSTATS Stats;            /* Transfer counters, updated under the ssi lock */
+
 /*-----------------------------------------------------------------------*/
 /* Transmit a byte to MMC via SPI  (Platform dependent)                  */
 /*-----------------------------------------------------------------------*/
@@ -532,11 +535,15 @@ DRESULT disk_read (
     BYTE count            /* Sector count (1..255) */
 )
 {
+    BYTE sectors = count;
+    portTickType tick;
+
     if (drv || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
 
     if (!(CardType & 4)) sector *= 512;    /* Convert to byte address if needed */
 
+    tick = xTaskGetTickCount();
     disk_lock();
     
     SELECT();            /* CS = L */
@@ -559,8 +566,11 @@ DRESULT disk_read (
     DESELECT();            /* CS = H */
     rcvr_spi();            /* Idle (Release DO) */
 
+    if (!count) Stats.read_bytes += sectors * 512UL;
+    Stats.busy_ticks += xTaskGetTickCount() - tick;
+
     disk_unlock();
-    
+
     return count ? RES_ERROR : RES_OK;
 }
 
@@ -577,12 +587,16 @@ DRESULT disk_write (
     BYTE count            /* Sector count (1..255) */
 )
 {
+    BYTE sectors = count;
+    portTickType tick;
+
     if (drv || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
     if (Stat & STA_PROTECT) return RES_WRPRT;
 
     if (!(CardType & 4)) sector *= 512;    /* Convert to byte address if needed */
 
+    tick = xTaskGetTickCount();
     disk_lock();
     
     SELECT();            /* CS = L */
@@ -609,14 +623,32 @@ DRESULT disk_write (
     DESELECT();            /* CS = H */
     rcvr_spi();            /* Idle (Release DO) */
 
+    if (!count) Stats.write_bytes += sectors * 512UL;
+    Stats.busy_ticks += xTaskGetTickCount() - tick;
+
     disk_unlock();
-    
+
     return count ? RES_ERROR : RES_OK;
 }
 #endif /* _READONLY */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Get Transfer Counters                                                 */
+/*-----------------------------------------------------------------------*/
+
+void disk_stats (
+    DSTATS *stats    /* Pointer to the counters to fill */
+)
+{
+    taskENTER_CRITICAL();
+    *stats = Stats;
+    taskEXIT_CRITICAL();
+}
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Miscellaneous Functions                                               */
 /*-----------------------------------------------------------------------*/
@@ -22,6 +22,13 @@ typedef enum {
 	RES_PARERR		/* 4: Invalid Parameter */
 } DRESULT;
 
+/* Transfer counters of the drive, see disk_stats() */
+typedef struct {
+	DWORD	read_bytes;		/* Bytes read successfully */
+	DWORD	write_bytes;	/* Bytes written successfully */
+	DWORD	busy_ticks;		/* Kernel ticks spent in disk_read/disk_write */
+} DSTATS;
+
 
 /*---------------------------------------*/
 /* Prototypes for disk control functions */
@@ -34,6 +41,7 @@ DRESULT disk_read (BYTE, BYTE*, DWORD, BYTE);
 DRESULT disk_write (BYTE, const BYTE*, DWORD, BYTE);
 #endif
 DRESULT disk_ioctl (BYTE, BYTE, void*);
+void disk_stats (DSTATS*);
 
 
 
@@ -120,7 +120,7 @@
 
 /* Reentrancy related */
 #if _FS_REENTRANT
-#if _USE_LFN == 1
+#if _USE_LFN == 1 && _VOLUMES > 1	/* A single volume lock serializes the static work area */
 #error Static LFN work area must not be used in re-entrant configuration.
 #endif
 #define	ENTER_FF(fs)		{ if (!lock_fs(fs)) return FR_TIMEOUT; }
@@ -483,6 +483,29 @@ static
 FILESEM	Files[_FS_SHARE];	/* File lock semaphores */
 #endif
 
+#if _FS_DCACHE
+typedef struct {
+	FATFS*	fs;			/* Owner file system object (0:unused) */
+	WORD	id;			/* Owner file system mount ID */
+	WORD	free;		/* Lowest index that can be a blank entry */
+	DWORD	sclust;		/* Directory start cluster */
+	WORD*	slot;		/* Hash table, 0:empty, else tag << 12 | entry group (0:not cached) */
+	UINT	size;		/* Number of slots (0:directory too large to be cached) */
+	UINT	used;		/* Number of slots in use */
+	UINT	built;		/* Number of slots in use after the table was built */
+	WORD	stamp;		/* Last use, for the replacement */
+} DCACHE;
+
+static
+DCACHE DirCache[_FS_DCACHE];	/* Directory caches */
+static
+WORD DcStamp;					/* Use counter of the directory caches */
+static
+WORD DcMark;					/* DcStamp at the last trim by f_dcache() */
+static
+BYTE DcOff;						/* Directory cache disabled by f_dcache() */
+#endif
+
 #if _USE_LFN == 0			/* No LFN feature */
 #define	DEF_NAMEBUF			BYTE sfn[12]
 #define INIT_BUF(dobj)		(dobj).fn = sfn
@@ -1346,12 +1369,13 @@ BYTE sum_sfn (
 
 
 /*-----------------------------------------------------------------------*/
-/* Directory handling - Find an object in the directory                  */
+/* Directory handling - Find an object from the current index            */
 /*-----------------------------------------------------------------------*/
 
 static
-FRESULT dir_find (
-	DIR *dj			/* Pointer to the directory object linked to the file name */
+FRESULT dir_scan (	/* FR_OK:Found, FR_NO_FILE:Not found up to the end index */
+	DIR *dj,		/* Pointer to the directory object linked to the file name */
+	UINT end		/* Index the search stops at */
 )
 {
 	FRESULT res;
@@ -1360,9 +1384,6 @@ FRESULT dir_find (
 	BYTE a, ord, sum;
 #endif
 
-	res = dir_sdi(dj, 0);			/* Rewind directory object */
-	if (res != FR_OK) return res;
-
 #if _USE_LFN
 	ord = sum = 0xFF;
 #endif
@@ -1398,6 +1419,7 @@ FRESULT dir_find (
 			break;
 #endif
 		res = dir_next(dj, 0);		/* Next entry */
+		if (res == FR_OK && dj->index >= end) res = FR_NO_FILE;
 	} while (res == FR_OK);
 
 	return res;
@@ -1406,6 +1428,364 @@ FRESULT dir_find (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Directory cache - Hash table of the names in a large directory        */
+/*-----------------------------------------------------------------------*/
+/* A slot holds the group of 16 entries an entry set starts in, tagged
+/  with 4 more bits of the name hash. Both the SFN and the LFN of an
+/  entry set are hashed, so a lookup by either form reads only the groups
+/  its hash points at. Slots of removed entries stay until the table is
+/  rebuilt, the name is always compared on the disk. */
+#if _FS_DCACHE
+#define	DC_SPAN		(16 + 20)	/* Entries from a group start to cover an entry set */
+#define	DC_TAG(h)	((WORD)(((h) >> 16) % 15 + 1) << 12)
+
+
+static
+DWORD dc_hash_sfn (	/* Hash of an SFN */
+	const BYTE *fn
+)
+{
+	DWORD h = 2166136261UL;
+	UINT n = 11;
+
+	do h = (h ^ *fn++) * 16777619UL; while (--n);
+	return h;
+}
+
+
+#if _USE_LFN
+static
+DWORD dc_mix_lfn (	/* Add an LFN char at any order, LFN entries are stored bottom first */
+	DWORD h,
+	UINT i,			/* Position in the LFN */
+	WCHAR wc
+)
+{
+	DWORD x = ((DWORD)ff_wtoupper(wc) << 8 | (i & 0xFF)) * 0x9E3779B1UL;
+
+	return h + (x ^ (x >> 15));
+}
+
+
+static
+DWORD dc_end_lfn (	/* Hash of an LFN from the mixed chars */
+	DWORD h,
+	UINT n			/* LFN length */
+)
+{
+	h ^= n;
+	h *= 0x85EBCA6BUL;
+	return h ^ (h >> 13);
+}
+
+
+static
+DWORD dc_hash_lfn (	/* Hash of an LFN */
+	const WCHAR *lfn
+)
+{
+	DWORD h = 0;
+	UINT i;
+
+	for (i = 0; lfn[i]; i++) h = dc_mix_lfn(h, i, lfn[i]);
+	return dc_end_lfn(h, i);
+}
+#endif
+
+
+static
+void dc_free (
+	DCACHE *dc
+)
+{
+	if (dc->slot) ff_memfree(dc->slot);
+	dc->slot = 0;
+	dc->fs = 0;
+}
+
+
+static
+void dc_drop (		/* Discard the caches of a volume or of a directory */
+	FATFS *fs,
+	DWORD sclust,	/* Directory start cluster */
+	int all			/* 1: all directories of the volume */
+)
+{
+	UINT i;
+
+	for (i = 0; i < _FS_DCACHE; i++) {
+		if (DirCache[i].fs == fs && (all || DirCache[i].sclust == sclust))
+			dc_free(&DirCache[i]);
+	}
+}
+
+
+static
+DCACHE* dc_get (	/* Cache of the directory, 0:None */
+	DIR *dj
+)
+{
+	DCACHE *dc;
+	UINT i;
+
+	if (DcOff) return 0;
+	for (i = 0; i < _FS_DCACHE; i++) {
+		dc = &DirCache[i];
+		if (dc->fs == dj->fs && dc->id == dj->fs->id && dc->sclust == dj->sclust) {
+			dc->stamp = ++DcStamp;
+			return dc;
+		}
+	}
+	return 0;
+}
+
+
+static
+int dc_insert (		/* 0:Inserted, 1:Table is full */
+	DCACHE *dc,
+	DWORD h,		/* Name hash */
+	UINT idx		/* Index the entry set starts at */
+)
+{
+	UINT i, mask = dc->size - 1;
+	WORD v = DC_TAG(h) | (WORD)(idx / 16);
+
+
+	for (i = h & mask; dc->slot[i]; i = (i + 1) & mask) {
+		if (dc->slot[i] == v) return 0;	/* Already points there */
+	}
+	/* Keep a quarter empty, or an eighth once the table cannot grow */
+	if ((dc->used + 1) * 8 > dc->size * (dc->size < _FS_DCACHE_MAX ? 6 : 7)) return 1;
+	dc->slot[i] = v;
+	dc->used++;
+	return 0;
+}
+
+
+static
+FRESULT dc_fill (	/* FR_OK:Filled, FR_DENIED:Table is too small */
+	DIR *dj,
+	DCACHE *dc
+)
+{
+	FRESULT res;
+	BYTE c, *dir;
+	UINT is = 0;
+#if _USE_LFN
+	BYTE a, lfn = 0;
+	UINT i, s, n = 0;
+	WCHAR wc;
+	DWORD h = 0;
+#endif
+
+
+	dc->free = 0xFFFF;
+	res = dir_sdi(dj, 0);
+	while (res == FR_OK) {
+		res = move_window(dj->fs, dj->sect);
+		if (res != FR_OK) break;
+		dir = dj->dir;
+		c = dir[DIR_Name];
+		if (c == 0 || c == DDE) {	/* A blank entry */
+			if (dc->free == 0xFFFF) dc->free = dj->index;
+			if (c == 0) break;		/* Reached to end of table */
+#if _USE_LFN
+			lfn = 0;
+#endif
+		} else {
+#if _USE_LFN
+			a = dir[DIR_Attr] & AM_MASK;
+			if (a == AM_LFN) {		/* Mix the chars of an LFN entry */
+				if (c & LLE) { is = dj->index; h = 0; lfn = 1; }
+				i = ((c & 0x3F) - 1) * 13;
+				for (s = 0; s < 13; s++, i++) {
+					wc = LD_WORD(dir+LfnOfs[s]);
+					if (!wc || wc == 0xFFFF) break;
+					h = dc_mix_lfn(h, i, wc);
+				}
+				if (c & LLE) n = i;
+			} else if (!(a & AM_VOL)) {	/* An SFN entry, the end of an entry set */
+				if (!lfn || dj->index - is > 20) { is = dj->index; lfn = 0; }
+				if (dc_insert(dc, dc_hash_sfn(dir), is)) return FR_DENIED;
+				if (lfn && dc_insert(dc, dc_end_lfn(h, n), is)) return FR_DENIED;
+				lfn = 0;
+			} else {
+				lfn = 0;
+			}
+#else
+			if (!(dir[DIR_Attr] & AM_VOL)) {
+				is = dj->index;
+				if (dc_insert(dc, dc_hash_sfn(dir), is)) return FR_DENIED;
+			}
+#endif
+		}
+		res = dir_next(dj, 0);
+	}
+	if (res == FR_NO_FILE) res = FR_OK;
+	if (dc->free == 0xFFFF) dc->free = dj->index + 1;	/* No blank entry, the table will be stretched */
+
+	return res;
+}
+
+
+static
+FRESULT dc_build (	/* Create the cache of a directory */
+	DIR *dj,
+	UINT ent		/* Number of entries known to be in the directory */
+)
+{
+	FRESULT res;
+	DCACHE *dc, *v = 0;
+	UINT i, size;
+
+
+	for (i = 0; i < _FS_DCACHE; i++) {	/* Pick a free or the least recently used cache */
+		dc = &DirCache[i];
+		if (!dc->fs || dc->fs->id != dc->id) { v = dc; break; }
+		if (!v || (WORD)(DcStamp - dc->stamp) > (WORD)(DcStamp - v->stamp)) v = dc;
+	}
+	dc_free(v);
+
+	size = 64;
+	while (size < ent * 2 && size < _FS_DCACHE_MAX) size <<= 1;
+	for (;;) {
+		v->fs = dj->fs; v->id = dj->fs->id; v->sclust = dj->sclust;
+		v->stamp = ++DcStamp;
+		if (size > _FS_DCACHE_MAX) {	/* Too large, remember to search it linearly */
+			v->size = 0;
+			return FR_OK;
+		}
+		v->slot = ff_memalloc(size * sizeof(WORD));
+		if (!v->slot) {			/* No memory now, give the heap back the other tables too */
+			dc_drop(dj->fs, 0, 1);
+			return FR_OK;
+		}
+		mem_set(v->slot, 0, size * sizeof(WORD));
+		v->size = size; v->used = 0;
+		res = dc_fill(dj, v);
+		v->built = v->used;
+		if (res != FR_DENIED) break;
+		dc_free(v);				/* More names than guessed */
+		size <<= 1;
+	}
+	if (res != FR_OK) dc_free(v);
+
+	return res;
+}
+
+
+static
+FRESULT dc_find (	/* Find the object through the cache of the directory */
+	DIR *dj,
+	DCACHE *dc
+)
+{
+	FRESULT res;
+	DWORD h[2];
+	UINT k, nk = 0, i, mask = dc->size - 1;
+	WORD tag, idx;
+
+
+	if (!(dj->fn[NS] & NS_LOSS)) h[nk++] = dc_hash_sfn(dj->fn);
+#if _USE_LFN
+	if (dj->lfn) h[nk++] = dc_hash_lfn(dj->lfn);
+#endif
+	for (k = 0; k < nk; k++) {
+		tag = DC_TAG(h[k]);
+		for (i = h[k] & mask; dc->slot[i]; i = (i + 1) & mask) {
+			if ((dc->slot[i] & 0xF000) != tag) continue;
+			idx = (dc->slot[i] & 0x0FFF) * 16;
+			res = dir_sdi(dj, idx);
+			if (res == FR_OK) res = dir_scan(dj, idx + DC_SPAN);
+			if (res == FR_OK) return FR_OK;
+			if (res != FR_NO_FILE && res != FR_INT_ERR) return res;	/* Stale slots can point past the table */
+		}
+	}
+
+	return FR_NO_FILE;
+}
+
+
+static
+void dc_add (		/* Put a new entry set to the cache of the directory */
+	DIR *dj,
+	DCACHE *dc,
+	UINT is			/* Index the entry set starts at */
+)
+{
+	if (dc_insert(dc, dc_hash_sfn(dj->fn), is)
+#if _USE_LFN
+		|| ((dj->fn[NS] & NS_LFN) && dc_insert(dc, dc_hash_lfn(dj->lfn), is))
+#endif
+		) {
+		if (dc->size < _FS_DCACHE_MAX || dc->built * 8 <= dc->size * 6) {
+			dc_free(dc);	/* Rebuilt by the next search, larger or without removed names */
+		} else {
+			ff_memfree(dc->slot);	/* Too large, remember to search it linearly */
+			dc->slot = 0; dc->size = 0;
+		}
+		return;
+	}
+	if (is <= dc->free || is == dj->index)	/* No blank entry is left below */
+		dc->free = dj->index + 1;
+}
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object in the directory                  */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT dir_find (
+	DIR *dj			/* Pointer to the directory object linked to the file name */
+)
+{
+	FRESULT res;
+#if _FS_DCACHE
+	FRESULT rc;
+	DCACHE *dc;
+	WORD i;
+#if _USE_LFN
+	WORD li;
+#endif
+
+	dc = dc_get(dj);
+	if (dc && dc->slot) return dc_find(dj, dc);
+#endif
+
+	res = dir_sdi(dj, 0);			/* Rewind directory object */
+	if (res != FR_OK) return res;
+	res = dir_scan(dj, 0x10000);
+
+#if _FS_DCACHE
+	/* A linear search through a large directory, cache it for the next one */
+	if (!dc && !DcOff && dj->index >= _FS_DCACHE_MIN && (res == FR_OK || res == FR_NO_FILE)) {
+		i = dj->index;
+#if _USE_LFN
+		li = dj->lfn_idx;
+#endif
+		rc = dc_build(dj, i);
+		if (res == FR_OK) {			/* Point at the found entry again */
+			if (rc == FR_OK) rc = dir_sdi(dj, i);
+			if (rc == FR_OK) rc = move_window(dj->fs, dj->sect);
+#if _USE_LFN
+			dj->lfn_idx = li;
+#endif
+		}
+		if (rc != FR_OK) res = rc;
+	}
+#endif
+
+	return res;
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Read an object from the directory                                     */
 /*-----------------------------------------------------------------------*/
@@ -1474,6 +1854,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 {
 	FRESULT res;
 	BYTE c, *dir;
+#if _FS_DCACHE
+	DCACHE *dc;
+#endif
 #if _USE_LFN	/* LFN configuration */
 	WORD n, ne, is;
 	BYTE sn[12], *fn, sum;
@@ -1506,7 +1889,13 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 	}
 
 	/* Reserve contiguous entries */
+#if _FS_DCACHE
+	dc = dc_get(dj);
+	if (dc && !dc->slot) dc = 0;
+	res = dir_sdi(dj, (WORD)((dc && dc->free) ? dc->free - 1 : 0));	/* Skip the entries known to be in use */
+#else
 	res = dir_sdi(dj, 0);
+#endif
 	if (res != FR_OK) return res;
 	n = is = 0;
 	do {
@@ -1538,7 +1927,13 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 	}
 
 #else	/* Non LFN configuration */
+#if _FS_DCACHE
+	dc = dc_get(dj);
+	if (dc && !dc->slot) dc = 0;
+	res = dir_sdi(dj, (WORD)((dc && dc->free) ? dc->free - 1 : 0));	/* Skip the entries known to be in use */
+#else
 	res = dir_sdi(dj, 0);
+#endif
 	if (res == FR_OK) {
 		do {	/* Find a blank entry for the SFN */
 			res = move_window(dj->fs, dj->sect);
@@ -1560,6 +1955,13 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 			dir[DIR_NTres] = *(dj->fn+NS) & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
 			dj->fs->wflag = 1;
+#if _FS_DCACHE
+#if _USE_LFN
+			if (dc) dc_add(dj, dc, is);
+#else
+			if (dc) dc_add(dj, dc, dj->index);
+#endif
+#endif
 		}
 	}
 
@@ -1580,10 +1982,18 @@ FRESULT dir_remove (	/* FR_OK: Successful, FR_DISK_ERR: A disk error */
 )
 {
 	FRESULT res;
+#if _FS_DCACHE
+	DCACHE *dc;
+#endif
 #if _USE_LFN	/* LFN configuration */
 	WORD i;
 
 	i = dj->index;	/* SFN index */
+#if _FS_DCACHE
+	dc = dc_get(dj);	/* The entries become blank, the slots stay until a rebuild */
+	if (dc && dc->slot && dc->free > ((dj->lfn_idx == 0xFFFF) ? i : dj->lfn_idx))
+		dc->free = (dj->lfn_idx == 0xFFFF) ? i : dj->lfn_idx;
+#endif
 	res = dir_sdi(dj, (WORD)((dj->lfn_idx == 0xFFFF) ? i : dj->lfn_idx));	/* Goto the SFN or top of the LFN entries */
 	if (res == FR_OK) {
 		do {
@@ -1598,6 +2008,10 @@ FRESULT dir_remove (	/* FR_OK: Successful, FR_DISK_ERR: A disk error */
 	}
 
 #else			/* Non LFN configuration */
+#if _FS_DCACHE
+	dc = dc_get(dj);
+	if (dc && dc->slot && dc->free > dj->index) dc->free = dj->index;
+#endif
 	res = dir_sdi(dj, dj->index);
 	if (res == FR_OK) {
 		res = move_window(dj->fs, dj->sect);
@@ -2216,6 +2630,9 @@ FRESULT f_mount (
 #if _FS_SHARE
 		clear_lock(rfs);
 #endif
+#if _FS_DCACHE
+		dc_drop(rfs, 0, 1);
+#endif
 #if _FS_REENTRANT				/* Discard sync object of the current volume */
 		if (!ff_del_syncobj(rfs->sobj)) return FR_INT_ERR;
 #endif
@@ -3239,6 +3656,9 @@ FRESULT f_unlink (
 				if (res == FR_OK) {
 					if (dclst)				/* Remove the cluster chain if exist */
 						res = remove_chain(dj.fs, dclst);
+#if _FS_DCACHE
+					if (dclst) dc_drop(dj.fs, dclst, 0);	/* The cache of a removed sub-dir */
+#endif
 					if (res == FR_OK) res = sync(dj.fs);
 				}
 			}
@@ -3279,6 +3699,9 @@ FRESULT f_mkdir (
 			if (dcl == 0) res = FR_DENIED;		/* No space to allocate a new cluster */
 			if (dcl == 1) res = FR_INT_ERR;
 			if (dcl == 0xFFFFFFFF) res = FR_DISK_ERR;
+#if _FS_DCACHE
+			if (res == FR_OK) dc_drop(dj.fs, dcl, 0);	/* A cache left over from a removed dir with the cluster */
+#endif
 			if (res == FR_OK)					/* Flush FAT */
 				res = move_window(dj.fs, 0);
 			if (res == FR_OK) {					/* Initialize the new directory table */
@@ -3545,6 +3968,50 @@ FRESULT f_forward (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Enable/Disable/Trim the Directory Cache                               */
+/*-----------------------------------------------------------------------*/
+#if _FS_DCACHE
+FRESULT f_dcache (
+	BYTE mode	/* 1:Enable, 0:Disable and discard the caches, 2:Discard the caches unused since the last trim */
+)
+{
+	FATFS *fs;
+	BYTE vol;
+	UINT i;
+	WORD age;
+
+
+	if (mode < 2) DcOff = mode ? 0 : 1;
+	if (mode == 1) return FR_OK;
+	for (vol = 0; vol < _VOLUMES; vol++) {
+		fs = FatFs[vol];
+		if (!fs) continue;
+#if _FS_REENTRANT
+		if (!lock_fs(fs)) return FR_TIMEOUT;
+#endif
+		if (mode == 0) {
+			dc_drop(fs, 0, 1);
+		} else {
+			age = DcStamp - DcMark;
+			for (i = 0; i < _FS_DCACHE; i++) {
+				if (DirCache[i].fs == fs && (WORD)(DcStamp - DirCache[i].stamp) >= age)
+					dc_free(&DirCache[i]);
+			}
+		}
+#if _FS_REENTRANT
+		unlock_fs(fs, FR_OK);
+#endif
+	}
+	if (mode == 2) DcMark = DcStamp;
+
+	return FR_OK;
+}
+#endif
+
+
+
+
 #if _USE_MKFS && !_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Create File System on the Drive                                       */
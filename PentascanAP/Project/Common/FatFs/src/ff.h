@@ -227,6 +227,7 @@ FRESULT f_getcwd (TCHAR*, UINT);					/* Get current directory */
 FRESULT f_forward (FIL*, UINT(*)(const BYTE*,UINT), UINT, UINT*);	/* Forward data to the stream */
 FRESULT f_mkfs (BYTE, BYTE, UINT);					/* Create a file system on the drive */
 FRESULT	f_fdisk (BYTE, const DWORD[], void*);		/* Divide a physical drive into some partitions */
+FRESULT f_dcache (BYTE);							/* Enable/Disable/Trim the directory cache */
 int f_putc (TCHAR, FIL*);							/* Put a character to the file */
 int f_puts (const TCHAR*, FIL*);					/* Put a string to the file */
 int f_printf (FIL*, const TCHAR*, ...);				/* Put a formatted string to the file */
@@ -256,11 +257,11 @@ DWORD get_fattime (void);
 #if _USE_LFN						/* Unicode - OEM code conversion */
 WCHAR ff_convert (WCHAR, UINT);		/* OEM-Unicode bidirectional conversion */
 WCHAR ff_wtoupper (WCHAR);			/* Unicode upper-case conversion */
-#if _USE_LFN == 3					/* Memory functions */
+#endif
+#if _USE_LFN == 3 || _FS_DCACHE	/* Memory functions */
 void* ff_memalloc (UINT);			/* Allocate memory block */
 void ff_memfree (void*);			/* Free memory block */
 #endif
-#endif
 
 /* Sync functions */
 #if _FS_REENTRANT
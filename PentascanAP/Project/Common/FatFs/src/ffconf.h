@@ -57,7 +57,7 @@
 / Locale and Namespace Configurations
 /----------------------------------------------------------------------------*/
 
-#define _CODE_PAGE	1
+#define _CODE_PAGE	437
 /* The _CODE_PAGE specifies the OEM code page to be used on the target system.
 /  Incorrect setting of the code page can cause a file open failure.
 /
@@ -90,12 +90,13 @@
 */
 
 
-#define	_USE_LFN	0		/* 0 to 3 */
+#define	_USE_LFN	1		/* 0 to 3 */
 #define	_MAX_LFN	255		/* Maximum LFN length to handle (12 to 255) */
 /* The _USE_LFN option switches the LFN support.
 /
 /   0: Disable LFN feature. _MAX_LFN and _LFN_UNICODE have no effect.
-/   1: Enable LFN with static working buffer on the BSS. Always NOT reentrant.
+/   1: Enable LFN with static working buffer on the BSS. Always NOT reentrant,
+/      except with a single volume where the volume lock guards the buffer.
 /   2: Enable LFN with dynamic working buffer on the STACK.
 /   3: Enable LFN with dynamic working buffer on the HEAP.
 /
@@ -187,4 +188,28 @@
    defines how many files can be opened simultaneously. */
 
 
+/*---------------------------------------------------------------------------/
+/ Directory Cache Configurations
+/----------------------------------------------------------------------------*/
+
+#define	_FS_DCACHE		2		/* 0:Disable or >=1:Enable */
+#define	_FS_DCACHE_MIN	128		/* Directory entries before a directory is cached */
+#define	_FS_DCACHE_MAX	4096	/* Maximum number of slots of a cache (power of 2) */
+/* To find names in large directories without reading the whole table, set
+/  _FS_DCACHE to the number of directories cached at a time. A directory
+/  found to have _FS_DCACHE_MIN entries or more gets a hash table of its
+/  names from ff_memalloc(), 2 bytes a slot with a quarter of the slots
+/  kept empty, and a lookup reads only the sectors its hash points at.
+/  Creating a file starts the search for blank entries after the ones
+/  known to be in use. A directory outgrowing _FS_DCACHE_MAX slots is
+/  searched linearly again, 4096 slots (8K bytes) hold about 3500 names,
+/  an LFN counts twice, which is two days of /response at one report a
+/  minute. A table starts at 64 slots and doubles as the directory grows.
+/  When ff_memalloc() fails the tables of the volume are all freed, and
+/  f_dcache(2) called while the volume is idle frees the ones not used
+/  since its last call.
+/  Memory control functions ff_memalloc() and ff_memfree() must be added
+/  to the project. */
+
+
 #endif /* _FFCONFIG */
@@ -123,7 +123,7 @@ void ff_rel_grant (
 
 
 
-#if _USE_LFN == 3	/* LFN with a working buffer on the heap */
+#if _USE_LFN == 3 || _FS_DCACHE	/* LFN working buffer or directory cache on the heap */
 /*------------------------------------------------------------------------*/
 /* Allocate a memory block                                                */
 /*------------------------------------------------------------------------*/
@@ -61,25 +61,29 @@
 /* Utils includes. */
 #include "CommandInterpreter.h"
 
-typedef struct xCOMMAND_INPUT_LIST
-{
-	const xCommandLineInput *pxCommandLineDefinition;
-	struct xCOMMAND_INPUT_LIST *pxNext;
-} xCommandLineInputListItem;
+#ifndef configCOMMAND_INT_MAX_COMMANDS
+	#define configCOMMAND_INT_MAX_COMMANDS	24
+#endif
 
 /*
  * The callback function that is executed when "help" is entered.  This is the
  * only default command that is always present.
  */
-static portBASE_TYPE prvHelpCommand( signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char *pcCommandString );
+static portBASE_TYPE prvHelpCommand( xCommandLineState *pxState, signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char *pcCommandString );
 
 /*
  * Return the number of parameters that follow the command name.
  */
 static signed char prvGetNumberOfParameters( const signed char * pcCommandString );
 
-/* The definition of the "help" command.  This command is always at the front
-of the list of registered commands. */
+/*
+ * Compare the first word of pcCommandInput, uxLength characters long, with
+ * the name of a registered command.  Returns <0, 0 or >0 like strcmp().
+ */
+static int prvCompareCommand( const signed char *pcCommandInput, size_t uxLength, const xCommandLineInput *pxCommand );
+
+/* The definition of the "help" command.  This command is always present in
+the table of registered commands. */
 static const xCommandLineInput xHelpCommand = 
 {
 	( const signed char * const ) "help",
@@ -88,119 +92,127 @@ static const xCommandLineInput xHelpCommand =
 	0
 };
 
-/* The definition of the list of commands.  Commands that are registered are
-added to this list. */
-static xCommandLineInputListItem xRegisteredCommands =
-{	
-	&xHelpCommand,	/* The first command in the list is always the help command, defined in this file. */
-	NULL			/* The next pointer is initialised to NULL, as there are no other registered commands yet. */
+/* The table of registered commands, sorted by command name.  The help command
+is the only entry until other commands are registered. */
+static const xCommandLineInput *pxRegisteredCommands[ configCOMMAND_INT_MAX_COMMANDS ] =
+{
+	&xHelpCommand
 };
-
-/* A buffer into which command outputs can be written is declared here, rather
-than in the command console implementation, to allow multiple command consoles
-to share the same buffer.  For example, an application may allow access to the
-command interpreter by UART and by Ethernet.  Sharing a buffer is done purely
-to save RAM.  Note, however, that the command console itself is not re-entrant,
-so only one command interpreter interface can be used at any one time.  For that
-reason, no attempt at providing mutual exclusion to the cOutputBuffer array is
-attempted. */
-static signed char cOutputBuffer[ configCOMMAND_INT_MAX_OUTPUT_SIZE ];
+static unsigned portBASE_TYPE uxNumberOfCommands = 1;
 
 /*-----------------------------------------------------------*/
 
 portBASE_TYPE xCmdIntRegisterCommand( const xCommandLineInput * const pxCommandToRegister )
 {
-static xCommandLineInputListItem *pxLastCommandInList = &xRegisteredCommands;
-xCommandLineInputListItem *pxNewListItem;
+unsigned portBASE_TYPE uxIndex;
+size_t uxLength;
 portBASE_TYPE xReturn = pdFAIL;
 
 	/* Check the parameter is not NULL. */
 	configASSERT( pxCommandToRegister );
 
-	/* Create a new list item that will reference the command being registered. */
-	pxNewListItem = ( xCommandLineInputListItem * ) pvPortMalloc( sizeof( xCommandLineInputListItem ) );
-	configASSERT( pxNewListItem );
+	uxLength = strlen( ( const char * ) pxCommandToRegister->pcCommand );
 
-	if( pxNewListItem != NULL )
+	taskENTER_CRITICAL();
 	{
-		taskENTER_CRITICAL();
+		if( uxNumberOfCommands < configCOMMAND_INT_MAX_COMMANDS )
 		{
-			/* Reference the command being registered from the newly created 
-			list item. */
-			pxNewListItem->pxCommandLineDefinition = pxCommandToRegister;
-
-			/* The new list item will get added to the end of the list, so 
-			pxNext has nowhere to point. */
-			pxNewListItem->pxNext = NULL;
-
-			/* Add the newly created list item to the end of the already existing
-			list. */
-			pxLastCommandInList->pxNext = pxNewListItem;
+			/* Insertion sort - move every command that sorts after the new one
+			up by one place to make room for it. */
+			for( uxIndex = uxNumberOfCommands; uxIndex > 0; uxIndex-- )
+			{
+				if( prvCompareCommand( pxCommandToRegister->pcCommand, uxLength, pxRegisteredCommands[ uxIndex - 1 ] ) >= 0 )
+				{
+					break;
+				}
+				pxRegisteredCommands[ uxIndex ] = pxRegisteredCommands[ uxIndex - 1 ];
+			}
 
-			/* Set the end of list marker to the new list item. */
-			pxLastCommandInList = pxNewListItem;
+			pxRegisteredCommands[ uxIndex ] = pxCommandToRegister;
+			uxNumberOfCommands++;
+			xReturn = pdPASS;
 		}
-		taskEXIT_CRITICAL();
-		
-		xReturn = pdPASS;
 	}
+	taskEXIT_CRITICAL();
+
+	configASSERT( xReturn );
 
 	return xReturn;
 }
 /*-----------------------------------------------------------*/
 
-portBASE_TYPE xCmdIntProcessCommand( const signed char * const pcCommandInput, signed char * pcWriteBuffer, size_t xWriteBufferLen  )
+portBASE_TYPE xCmdIntProcessCommand( xCommandLineState *pxState, const signed char * const pcCommandInput, signed char * pcWriteBuffer, size_t xWriteBufferLen  )
 {
-static const xCommandLineInputListItem *pxCommand = NULL;
 portBASE_TYPE xReturn = pdTRUE;
-const signed char *pcRegisteredCommandString;
-
-	/* Note:  This function is not re-entrant.  It must not be called from more
-	thank one task. */
+size_t uxLength;
+unsigned portBASE_TYPE uxLow, uxHigh, uxMiddle;
+int iCompare;
 
-	if( pxCommand == NULL )
+	if( pxState->pxCommand == NULL )
 	{
-		/* Search for the command string in the list of registered commands. */
-		for( pxCommand = &xRegisteredCommands; pxCommand != NULL; pxCommand = pxCommand->pxNext )
+		pxState->uxCallCount = 0;
+
+		/* The command name is the first word of the input. */
+		uxLength = 0;
+		while( ( pcCommandInput[ uxLength ] != 0x00 ) && ( pcCommandInput[ uxLength ] != ' ' ) )
 		{
-			pcRegisteredCommandString = pxCommand->pxCommandLineDefinition->pcCommand;
-			if( strncmp( ( const char * ) pcCommandInput, ( const char * ) pcRegisteredCommandString, strlen( ( const char * ) pcRegisteredCommandString ) ) == 0 )
-			{
-				/* The command has been found.  Check it has the expected
-				number of parameters.  If cExpectedNumberOfParameters is -1,
-				then there could be a variable number of parameters and no
-				check is made. */
-				if( pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters >= 0 )
-				{
-					if( prvGetNumberOfParameters( pcCommandInput ) != pxCommand->pxCommandLineDefinition->cExpectedNumberOfParameters )
-					{
-						xReturn = pdFALSE;
-					}
-				}
+			uxLength++;
+		}
+
+		/* Binary search the sorted table of registered commands. */
+		uxLow = 0;
+		uxHigh = uxNumberOfCommands;
+		while( uxLow < uxHigh )
+		{
+			uxMiddle = ( uxLow + uxHigh ) / 2;
+			iCompare = prvCompareCommand( pcCommandInput, uxLength, pxRegisteredCommands[ uxMiddle ] );
 
+			if( iCompare == 0 )
+			{
+				pxState->pxCommand = pxRegisteredCommands[ uxMiddle ];
 				break;
 			}
+			else if( iCompare < 0 )
+			{
+				uxHigh = uxMiddle;
+			}
+			else
+			{
+				uxLow = uxMiddle + 1;
+			}
+		}
+
+		/* The command has been found.  Check it has the expected number of
+		parameters.  If cExpectedNumberOfParameters is -1, then there could be
+		a variable number of parameters and no check is made. */
+		if( ( pxState->pxCommand != NULL ) && ( pxState->pxCommand->cExpectedNumberOfParameters >= 0 ) )
+		{
+			if( prvGetNumberOfParameters( pcCommandInput ) != pxState->pxCommand->cExpectedNumberOfParameters )
+			{
+				xReturn = pdFALSE;
+			}
 		}
 	}
 
-	if( ( pxCommand != NULL ) && ( xReturn == pdFALSE ) )
+	if( ( pxState->pxCommand != NULL ) && ( xReturn == pdFALSE ) )
 	{
 		/* The command was found, but the number of parameters with the command
 		was incorrect. */
 		strncpy( ( char * ) pcWriteBuffer, "Incorrect command parameter(s).  Enter \"help\" to view a list of available commands.\r\n\r\n", xWriteBufferLen );
-		pxCommand = NULL;
+		pxState->pxCommand = NULL;
 	}
-	else if( pxCommand != NULL )
+	else if( pxState->pxCommand != NULL )
 	{
 		/* Call the callback function that is registered to this command. */
-		xReturn = pxCommand->pxCommandLineDefinition->pxCommandInterpreter( pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		xReturn = pxState->pxCommand->pxCommandInterpreter( pxState, pcWriteBuffer, xWriteBufferLen, pcCommandInput );
+		pxState->uxCallCount++;
 
 		/* If xReturn is pdFALSE, then no further strings will be returned
 		after this one, and	pxCommand can be reset to NULL ready to search 
 		for the next entered command. */
 		if( xReturn == pdFALSE )
 		{
-			pxCommand = NULL;
+			pxState->pxCommand = NULL;
 		}
 	}
 	else
@@ -210,19 +222,10 @@ const signed char *pcRegisteredCommandString;
 		xReturn = pdFALSE;
 	}
 
-	return xReturn;
-}
-/*-----------------------------------------------------------*/
+	/* strncpy() does not terminate a truncated string. */
+	pcWriteBuffer[ xWriteBufferLen - 1 ] = 0x00;
 
-signed char *pcCmdIntGetOutputBuffer( void )
-{
-	return cOutputBuffer;
-}
-/*-----------------------------------------------------------*/
-
-unsigned portBASE_TYPE uxCmdIntGetOutputBufferSizeBytes( void )
-{
-	return configCOMMAND_INT_MAX_OUTPUT_SIZE;
+	return xReturn;
 }
 /*-----------------------------------------------------------*/
 
@@ -277,36 +280,33 @@ const signed char *pcReturn = NULL;
 }
 /*-----------------------------------------------------------*/
 
-static portBASE_TYPE prvHelpCommand( signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char *pcCommandString )
+static portBASE_TYPE prvHelpCommand( xCommandLineState *pxState, signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char *pcCommandString )
 {
-static const xCommandLineInputListItem * pxCommand = NULL;
-signed portBASE_TYPE xReturn;
-
 	( void ) pcCommandString;
 
-	if( pxCommand == NULL )
-	{
-		/* Reset the pxCommand pointer back to the start of the list. */
-		pxCommand = &xRegisteredCommands;
-	}
+	/* Return the next command help string.  The call count of the session
+	is used as the position in the table, so several sessions can list the
+	commands at the same time. */
+	strncpy( ( char * ) pcWriteBuffer, ( const char * ) pxRegisteredCommands[ pxState->uxCallCount ]->pcHelpString, xWriteBufferLen );
 
-	/* Return the next command help string, before moving the pointer on to
-	the next command in the list. */
-	strncpy( ( char * ) pcWriteBuffer, ( const char * ) pxCommand->pxCommandLineDefinition->pcHelpString, xWriteBufferLen );
-	pxCommand = pxCommand->pxNext;
+	/* There are no more strings to return after the last command. */
+	return ( pxState->uxCallCount + 1 < uxNumberOfCommands ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
 
-	if( pxCommand == NULL )
-	{
-		/* There are no more commands in the list, so there will be no more
-		strings to return after this one and pdFALSE should be returned. */
-		xReturn = pdFALSE;
-	}
-	else
+static int prvCompareCommand( const signed char *pcCommandInput, size_t uxLength, const xCommandLineInput *pxCommand )
+{
+int iReturn;
+
+	iReturn = strncmp( ( const char * ) pcCommandInput, ( const char * ) pxCommand->pcCommand, uxLength );
+
+	/* The input is a prefix of the registered command, or the same. */
+	if( ( iReturn == 0 ) && ( pxCommand->pcCommand[ uxLength ] != 0x00 ) )
 	{
-		xReturn = pdTRUE;
+		iReturn = -1;
 	}
 
-	return xReturn;
+	return iReturn;
 }
 /*-----------------------------------------------------------*/
 
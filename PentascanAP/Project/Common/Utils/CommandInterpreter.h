@@ -54,12 +54,29 @@
 #ifndef COMMAND_INTERPRETER_H
 #define COMMAND_INTERPRETER_H
 
+struct xCOMMAND_LINE_INPUT;
+
+/* The state of one command line session.  Each console interface (UART,
+telnet session, background job) owns one of these, which makes the command
+interpreter re-entrant.  pxCommand must be NULL before a new command is
+processed; xCmdIntProcessCommand() sets it back to NULL when the command has
+produced all of its output. */
+typedef struct xCOMMAND_LINE_STATE
+{
+	const struct xCOMMAND_LINE_INPUT *pxCommand;	/* The command currently being executed, or NULL. */
+	void *pvContext;								/* Application defined session context, passed through to the callbacks. */
+	unsigned portBASE_TYPE uxCallCount;				/* Number of times the callback has already been called for the current command. */
+} xCommandLineState;
+
 /* The prototype to which callback functions used to process command line
-commands must comply.  pcWriteBuffer is a buffer into which the output from 
-executing the command can be written, xWriteBufferLen is the length, in bytes of 
-the pcWriteBuffer buffer, and pcCommandString is the entire string as input by
-the user (from which parameters can be extracted.*/
-typedef portBASE_TYPE (*pdCOMMAND_LINE_CALLBACK)( signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char * pcCommandString );
+commands must comply.  pxState is the session the command is executed for,
+pcWriteBuffer is a buffer into which the output from executing the command can
+be written, xWriteBufferLen is the length, in bytes of the pcWriteBuffer
+buffer, and pcCommandString is the entire string as input by the user (from
+which parameters can be extracted.  A command that has more output than fits
+in pcWriteBuffer returns pdTRUE, and is called again with pxState->uxCallCount
+incremented once the previous output has been sent. */
+typedef portBASE_TYPE (*pdCOMMAND_LINE_CALLBACK)( xCommandLineState *pxState, signed char *pcWriteBuffer, size_t xWriteBufferLen, const signed char * pcCommandString );
 
 /* The structure that defines command line commands.  A command line command
 should be defined by declaring a const structure of this type. */
@@ -73,60 +90,33 @@ typedef struct xCOMMAND_LINE_INPUT
 
 /*
  * Register the command passed in using the pxCommandToRegister parameter.
- * Registering a command adds the command to the list of commands that are
+ * Registering a command adds the command to the table of commands that are
  * handled by the command interpreter.  Once a command has been registered it
- * can be executed from the command line.
+ * can be executed from the command line.  The table is kept sorted so that
+ * commands are found with a binary search, and holds at most
+ * configCOMMAND_INT_MAX_COMMANDS entries including "help".
  */
 portBASE_TYPE xCmdIntRegisterCommand( const xCommandLineInput * const pxCommandToRegister );
 
 /*
- * Runs the command interpreter for the command string "pcCommandInput".  Any
- * output generated by running the command will be placed into pcWriteBuffer.
- * xWriteBufferLen must indicate the size, in bytes, of the buffer pointed to
- * by pcWriteBuffer.
+ * Runs the command interpreter for the command string "pcCommandInput" on
+ * behalf of the session pxState.  Any output generated by running the command
+ * will be placed into pcWriteBuffer.  xWriteBufferLen must indicate the size,
+ * in bytes, of the buffer pointed to by pcWriteBuffer.
  *
- * xCmdIntProcessCommand should be called repeatedly until it returns pdFALSE.
+ * xCmdIntProcessCommand should be called repeatedly until it returns pdFALSE,
+ * sending the content of pcWriteBuffer to the user after each call.
  *
- * pcCmdIntProcessCommand is not reentrant.  It must not be called from more
- * than one task - or at least - by more than one task at a time.
+ * Different sessions may call xCmdIntProcessCommand concurrently, provided
+ * each uses its own pxState and pcWriteBuffer.
  */
-portBASE_TYPE xCmdIntProcessCommand( const signed char * const pcCommandInput, signed char * pcWriteBuffer, size_t xWriteBufferLen  );
+portBASE_TYPE xCmdIntProcessCommand( xCommandLineState *pxState, const signed char * const pcCommandInput, signed char * pcWriteBuffer, size_t xWriteBufferLen  );
 
 /*-----------------------------------------------------------*/
 
-/*
- * A buffer into which command outputs can be written is declared in the
- * main command interpreter, rather than in the command console implementation,
- * to allow application that provide access to the command console via multiple
- * interfaces to share a buffer, and therefore save RAM.  Note, however, that
- * the command interpreter itself is not re-entrant, so only one command
- * console interface can be used at any one time.  For that reason, no attempt
- * is made to provide any mutual exclusion mechanism on the output buffer.
- *
- * pcCmdIntGetOutputBuffer() returns the address of the output buffer.
- *
- * uxCmdIntGetOutputBufferSizeBytes() returns the size, in bytes, of the output
- * buffer returned by pcCmdIntGetOutputBuffer();
- */
-signed char *pcCmdIntGetOutputBuffer( void );
-unsigned portBASE_TYPE uxCmdIntGetOutputBufferSizeBytes( void );
-
 /*
  * Return a pointer to the xParameterNumber'th word in pcCommandString.
  */
 const signed char *pcCmdIntGetParameter( const signed char *pcCommandString, unsigned portBASE_TYPE uxWantedParameter, portBASE_TYPE *pxParameterStringLength );
 
 #endif /* COMMAND_INTERPRETER_H */
-
-
-
-
-
-
-
-
-
-
-
-
-
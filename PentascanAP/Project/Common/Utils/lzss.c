@@ -0,0 +1,230 @@
+/*
+    LZSS compression of log archives, see lzss.h.
+*/
+
+#include <string.h>
+
+#include "lzss.h"
+
+#define HASH( p )	( ( ( ( p )[ 0 ] << 6 ) ^ ( ( p )[ 1 ] << 3 ) ^ ( p )[ 2 ] ) & ( LZSS_HASH_SIZE - 1 ) )
+
+void vLzssHeader( unsigned char *pucHeader, unsigned long ulLength )
+{
+	memcpy( pucHeader, LZSS_MAGIC, 4 );
+	pucHeader[ 4 ] = ( unsigned char ) ulLength;
+	pucHeader[ 5 ] = ( unsigned char ) ( ulLength >> 8 );
+	pucHeader[ 6 ] = ( unsigned char ) ( ulLength >> 16 );
+	pucHeader[ 7 ] = ( unsigned char ) ( ulLength >> 24 );
+}
+
+/* Returns the original length, or -1 if this is not a compressed stream. */
+long lLzssHeaderCheck( const unsigned char *pucHeader )
+{
+	if( memcmp( pucHeader, LZSS_MAGIC, 4 ) )
+	{
+		return -1;
+	}
+	return ( long ) ( pucHeader[ 4 ] | ( pucHeader[ 5 ] << 8 ) | ( ( unsigned long ) pucHeader[ 6 ] << 16 ) |
+					  ( ( unsigned long ) pucHeader[ 7 ] << 24 ) );
+}
+
+void vLzssEncodeInit( xLzssEncoder *pxEnc )
+{
+	memset( pxEnc->usHead, 0, sizeof( pxEnc->usHead ) );
+	memset( pxEnc->usPrev, 0, sizeof( pxEnc->usPrev ) );
+	pxEnc->ulBase = 0;
+	pxEnc->ulHistory = 0;
+	pxEnc->ucGroup[ 0 ] = 0;
+	pxEnc->ucGroupLength = 1;
+	pxEnc->ucGroupItems = 0;
+}
+
+static unsigned long prvGroupFlush( xLzssEncoder *pxEnc, unsigned char *pucOut )
+{
+unsigned long ulLength = pxEnc->ucGroupLength;
+
+	/* Unused flags read as literals. */
+	pxEnc->ucGroup[ 0 ] |= ( unsigned char ) ( 0xff << pxEnc->ucGroupItems );
+	memcpy( pucOut, pxEnc->ucGroup, ulLength );
+	pxEnc->ucGroup[ 0 ] = 0;
+	pxEnc->ucGroupLength = 1;
+	pxEnc->ucGroupItems = 0;
+	return ulLength;
+}
+
+/* Remember ucData[ ulIndex ] in the hash chains, it needs 2 more bytes. */
+static void prvInsert( xLzssEncoder *pxEnc, unsigned long ulIndex )
+{
+unsigned long ulPos = pxEnc->ulBase + ulIndex;
+unsigned int uxHash = HASH( pxEnc->ucData + ulIndex );
+
+	pxEnc->usPrev[ ulPos % LZSS_WINDOW ] = pxEnc->usHead[ uxHash ];
+	pxEnc->usHead[ uxHash ] = ( unsigned short ) ulPos;
+}
+
+/* Longest match for ucData[ ulIndex ], the distance is returned in pulDistance. */
+static unsigned long prvMatch( xLzssEncoder *pxEnc, unsigned long ulIndex, unsigned long ulEnd, unsigned long *pulDistance )
+{
+unsigned long ulPos = pxEnc->ulBase + ulIndex, ulMax = ulEnd - ulIndex, ulBest = 0, ulDistance, ulLast = 0, ulLength;
+unsigned short usCandidate = pxEnc->usHead[ HASH( pxEnc->ucData + ulIndex ) ];
+const unsigned char *pucCur = pxEnc->ucData + ulIndex, *pucCandidate;
+int iChain;
+
+	if( ulMax > LZSS_MAX_MATCH )
+	{
+		ulMax = LZSS_MAX_MATCH;
+	}
+
+	for( iChain = 0; iChain < LZSS_MAX_CHAIN; iChain++ )
+	{
+		/* Positions are kept in 16 bits, anything that is not closer than
+		the last one and within the window ends the chain.  Candidates are
+		compared byte by byte so a stale entry costs time, not correctness. */
+		ulDistance = ( unsigned short ) ( ( unsigned short ) ulPos - usCandidate );
+		if( ulDistance == 0 || ulDistance <= ulLast || ulDistance > LZSS_WINDOW || ulDistance > ulIndex )
+		{
+			break;
+		}
+		ulLast = ulDistance;
+
+		pucCandidate = pucCur - ulDistance;
+		for( ulLength = 0; ulLength < ulMax && pucCandidate[ ulLength ] == pucCur[ ulLength ]; ulLength++ );
+		if( ulLength > ulBest )
+		{
+			ulBest = ulLength;
+			*pulDistance = ulDistance;
+			if( ulLength == ulMax )
+			{
+				break;
+			}
+		}
+		usCandidate = pxEnc->usPrev[ ( ulPos - ulDistance ) % LZSS_WINDOW ];
+	}
+	return ulBest;
+}
+
+/* Compress ulLength bytes, at most LZSS_BLOCK, into pucOut.  Returns the bytes written. */
+unsigned long ulLzssEncode( xLzssEncoder *pxEnc, const unsigned char *pucIn, unsigned long ulLength, unsigned char *pucOut )
+{
+unsigned long ulIndex = pxEnc->ulHistory, ulEnd = pxEnc->ulHistory + ulLength, ulOut = 0;
+unsigned long ulMatch, ulDistance = 0, ulKeep;
+
+	memcpy( pxEnc->ucData + ulIndex, pucIn, ulLength );
+
+	while( ulIndex < ulEnd )
+	{
+		ulMatch = 0;
+		if( ulEnd - ulIndex >= LZSS_MIN_MATCH )
+		{
+			ulMatch = prvMatch( pxEnc, ulIndex, ulEnd, &ulDistance );
+		}
+
+		if( ulMatch >= LZSS_MIN_MATCH )
+		{
+			pxEnc->ucGroup[ pxEnc->ucGroupLength++ ] = ( unsigned char ) ( ulDistance - 1 );
+			pxEnc->ucGroup[ pxEnc->ucGroupLength++ ] = ( unsigned char ) ( ( ( ulDistance - 1 ) >> 8 ) << 6 | ( ulMatch - LZSS_MIN_MATCH ) );
+		}
+		else
+		{
+			ulMatch = 1;
+			pxEnc->ucGroup[ 0 ] |= ( unsigned char ) ( 1 << pxEnc->ucGroupItems );
+			pxEnc->ucGroup[ pxEnc->ucGroupLength++ ] = pxEnc->ucData[ ulIndex ];
+		}
+		if( ++pxEnc->ucGroupItems == 8 )
+		{
+			ulOut += prvGroupFlush( pxEnc, pucOut + ulOut );
+		}
+
+		for( ; ulMatch; ulMatch--, ulIndex++ )
+		{
+			if( ulIndex + 2 < ulEnd )
+			{
+				prvInsert( pxEnc, ulIndex );
+			}
+		}
+	}
+
+	/* Keep the window for the next block.  The last 2 bytes were not
+	inserted, they are at the start of nothing that could be matched yet. */
+	if( ulEnd > LZSS_WINDOW )
+	{
+		ulKeep = ulEnd - LZSS_WINDOW;
+		memmove( pxEnc->ucData, pxEnc->ucData + ulKeep, LZSS_WINDOW );
+		pxEnc->ulBase += ulKeep;
+		pxEnc->ulHistory = LZSS_WINDOW;
+	}
+	else
+	{
+		pxEnc->ulHistory = ulEnd;
+	}
+	return ulOut;
+}
+
+/* Write out what is left of the last flag group. */
+unsigned long ulLzssEncodeEnd( xLzssEncoder *pxEnc, unsigned char *pucOut )
+{
+	if( pxEnc->ucGroupItems == 0 )
+	{
+		return 0;
+	}
+	return prvGroupFlush( pxEnc, pucOut );
+}
+
+void vLzssDecodeInit( xLzssDecoder *pxDec )
+{
+	pxDec->usPos = 0;
+	pxDec->usFlags = 1;
+	pxDec->sFirst = -1;
+	pxDec->usLength = 0;
+}
+
+/* Decode from *ppucIn into pucOut, both are advanced.  Returns the bytes written. */
+unsigned long ulLzssDecode( xLzssDecoder *pxDec, const unsigned char **ppucIn, unsigned long *pulInLength,
+							unsigned char *pucOut, unsigned long ulOutLength )
+{
+unsigned long ulOut = 0;
+unsigned char ucByte;
+
+	while( ulOut < ulOutLength )
+	{
+		if( pxDec->usLength )
+		{
+			ucByte = pxDec->ucWindow[ ( pxDec->usPos - pxDec->usDistance ) & ( LZSS_WINDOW - 1 ) ];
+			pxDec->usLength--;
+		}
+		else
+		{
+			if( *pulInLength == 0 )
+			{
+				break;
+			}
+			ucByte = *( *ppucIn )++;
+			( *pulInLength )--;
+
+			if( pxDec->usFlags == 1 )
+			{
+				pxDec->usFlags = ucByte | 0x100;
+				continue;
+			}
+			if( ( pxDec->usFlags & 1 ) == 0 )
+			{
+				if( pxDec->sFirst < 0 )
+				{
+					pxDec->sFirst = ucByte;
+					continue;
+				}
+				pxDec->usDistance = ( unsigned short ) ( ( pxDec->sFirst | ( ( ucByte >> 6 ) << 8 ) ) + 1 );
+				pxDec->usLength = ( unsigned short ) ( ( ucByte & 0x3f ) + LZSS_MIN_MATCH );
+				pxDec->sFirst = -1;
+				pxDec->usFlags >>= 1;
+				continue;
+			}
+			pxDec->usFlags >>= 1;
+		}
+
+		pxDec->ucWindow[ pxDec->usPos ] = ucByte;
+		pxDec->usPos = ( unsigned short ) ( ( pxDec->usPos + 1 ) & ( LZSS_WINDOW - 1 ) );
+		pucOut[ ulOut++ ] = ucByte;
+	}
+	return ulOut;
+}
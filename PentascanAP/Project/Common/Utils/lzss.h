@@ -0,0 +1,69 @@
+/*
+    LZSS compression of log archives.
+
+    A small window variant so both sides fit in a few KB of RAM: the encoder
+    keeps 1K of history plus the block being compressed and hash chains over
+    the history, the decoder only the 1K window.
+
+    Stream format, after an 8 byte header of LZSS_MAGIC and the little
+    endian length of the original data:
+        a flag byte, least significant bit first, for the next 8 items
+        flag 1 : a literal byte
+        flag 0 : a match of 2 bytes, the distance back minus 1 in 10 bits
+                 and the length minus LZSS_MIN_MATCH in 6 bits:
+                 byte 0 = distance bits 0-7
+                 byte 1 = distance bits 8-9 << 6 | length
+    The stream ends after the original length, the last flag byte may
+    have unused bits.
+*/
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#define LZSS_WINDOW			1024
+#define LZSS_MIN_MATCH		3
+#define LZSS_MAX_MATCH		( LZSS_MIN_MATCH + 63 )
+#define LZSS_BLOCK			512
+#define LZSS_HASH_SIZE		512
+#define LZSS_MAX_CHAIN		32
+
+#define LZSS_MAGIC			"LZL1"
+#define LZSS_HEADER_SIZE	8
+
+/* Output of one ulLzssEncode() or ulLzssEncodeEnd() call at most. */
+#define LZSS_BOUND( n )		( ( n ) + ( ( n ) + 7 ) / 8 + 18 )
+
+typedef struct xLZSS_ENCODER
+{
+	unsigned char ucData[ LZSS_WINDOW + LZSS_BLOCK ];	/* history, then the block */
+	unsigned short usHead[ LZSS_HASH_SIZE ];			/* low 16 bits of stream positions */
+	unsigned short usPrev[ LZSS_WINDOW ];
+	unsigned long ulBase;								/* stream position of ucData[ 0 ] */
+	unsigned long ulHistory;							/* bytes of history in ucData */
+	unsigned char ucGroup[ 17 ];						/* flag byte and up to 8 items */
+	unsigned char ucGroupLength;
+	unsigned char ucGroupItems;
+} xLzssEncoder;
+
+typedef struct xLZSS_DECODER
+{
+	unsigned char ucWindow[ LZSS_WINDOW ];
+	unsigned short usPos;								/* next byte of the window */
+	unsigned short usFlags;								/* flags left, above a sentinel bit */
+	short sFirst;										/* first byte of a match, or -1 */
+	unsigned short usDistance;							/* match being copied out */
+	unsigned short usLength;
+} xLzssDecoder;
+
+void vLzssHeader( unsigned char *pucHeader, unsigned long ulLength );
+long lLzssHeaderCheck( const unsigned char *pucHeader );
+
+void vLzssEncodeInit( xLzssEncoder *pxEnc );
+unsigned long ulLzssEncode( xLzssEncoder *pxEnc, const unsigned char *pucIn, unsigned long ulLength, unsigned char *pucOut );
+unsigned long ulLzssEncodeEnd( xLzssEncoder *pxEnc, unsigned char *pucOut );
+
+void vLzssDecodeInit( xLzssDecoder *pxDec );
+unsigned long ulLzssDecode( xLzssDecoder *pxDec, const unsigned char **ppucIn, unsigned long *pulInLength,
+							unsigned char *pucOut, unsigned long ulOutLength );
+
+#endif /* LZSS_H */
@@ -0,0 +1,72 @@
+/*
+    Flash layout and image format of the firmware update.
+
+    The 256K flash of the LM3S6965 is split in 1K pages as:
+
+        0x00000  boot     4K    Boot/boot.c, installs a pending image
+        0x01000  app    124K    the running firmware, linked here
+        0x20000  slot   127K    a downloaded image, header and body
+        0x3fc00  state    1K    xOtaState, progress of the download
+
+    An image is an xOtaHeader followed by the body, the binary of the app
+    padded to a multiple of 4 bytes.  ucMac is the HMAC-SHA256 under the
+    device key of the first OTA_HEADER_MAC_OFFSET bytes of the header and
+    the body.  Tools/otasign.c makes an image out of the app binary.
+
+    The download is streamed into the slot page by page, the state page
+    records each page programmed so an interrupted download resumes.  Once
+    the MAC has been checked ulPending is written and on the next reset the
+    boot stage copies the body into the app area and erases the state page.
+    All words are little endian.
+
+    There is one app area, the running image is overwritten by the copy and
+    not kept.  A reset during the copy only repeats it, but an image that
+    verifies and then fails to run cannot be rolled back to the previous one.
+
+    The boot stage and the app are separate projects, Boot/Boot.uvproj and
+    PentascanAP/PentascanAP.uvproj, see Boot/boot.c for programming both.
+*/
+
+#ifndef OTA_IMAGE_H
+#define OTA_IMAGE_H
+
+#define OTA_PAGE_SIZE			0x400
+
+#define OTA_BOOT_BASE			0x00000000
+#define OTA_BOOT_SIZE			0x1000
+#define OTA_APP_BASE			0x00001000
+#define OTA_APP_SIZE			0x1f000
+#define OTA_SLOT_BASE			0x00020000
+#define OTA_SLOT_SIZE			0x1fc00
+#define OTA_SLOT_PAGES			( OTA_SLOT_SIZE / OTA_PAGE_SIZE )
+#define OTA_STATE_BASE			0x0003fc00
+
+#define OTA_IMAGE_MAGIC			0x41544f50UL	/* "POTA" */
+#define OTA_IMAGE_FORMAT		1
+#define OTA_HEADER_SIZE			64
+#define OTA_HEADER_MAC_OFFSET	16
+
+#define OTA_STATE_MAGIC			0x53544f50UL	/* "POTS" */
+#define OTA_STATE_PENDING		0x444e4550UL	/* "PEND" */
+#define OTA_STATE_ERASED		0xffffffffUL
+
+typedef struct xOTA_HEADER
+{
+	unsigned long ulMagic;
+	unsigned long ulFormat;
+	unsigned long ulLength;					/* bytes of the body */
+	unsigned long ulVersion;				/* of the firmware, informational */
+	unsigned char ucMac[ 32 ];
+	unsigned long ulReserved[ 4 ];
+} xOtaHeader;
+
+/* Each word is written once between erases of the page. */
+typedef struct xOTA_STATE
+{
+	unsigned long ulMagic;					/* written when a download starts */
+	unsigned long ulPending;				/* OTA_STATE_PENDING once verified */
+	unsigned long ulReserved[ 2 ];
+	unsigned long ulPage[ OTA_SLOT_PAGES ];	/* 0 once the slot page is programmed */
+} xOtaState;
+
+#endif /* OTA_IMAGE_H */
@@ -0,0 +1,205 @@
+/*
+    SHA-256 and HMAC-SHA256, see sha256.h.
+*/
+
+#include <string.h>
+
+#include "sha256.h"
+
+#define ROR( x, n )		( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+#define CH( x, y, z )	( ( ( x ) & ( y ) ) ^ ( ~( x ) & ( z ) ) )
+#define MAJ( x, y, z )	( ( ( x ) & ( y ) ) ^ ( ( x ) & ( z ) ) ^ ( ( y ) & ( z ) ) )
+#define EP0( x )		( ROR( x, 2 ) ^ ROR( x, 13 ) ^ ROR( x, 22 ) )
+#define EP1( x )		( ROR( x, 6 ) ^ ROR( x, 11 ) ^ ROR( x, 25 ) )
+#define SIG0( x )		( ROR( x, 7 ) ^ ROR( x, 18 ) ^ ( ( x ) >> 3 ) )
+#define SIG1( x )		( ROR( x, 17 ) ^ ROR( x, 19 ) ^ ( ( x ) >> 10 ) )
+
+static const unsigned long ulK[ 64 ] =
+{
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+static void prvSha256Block( xSha256Context *pxCtx, const unsigned char *pucBlock )
+{
+unsigned long a, b, c, d, e, f, g, h, t1, t2, w[ 64 ];
+int i;
+
+	for( i = 0; i < 16; i++ )
+	{
+		w[ i ] = ( ( unsigned long ) pucBlock[ 4 * i ] << 24 ) | ( ( unsigned long ) pucBlock[ 4 * i + 1 ] << 16 ) |
+				 ( ( unsigned long ) pucBlock[ 4 * i + 2 ] << 8 ) | pucBlock[ 4 * i + 3 ];
+	}
+	for( ; i < 64; i++ )
+	{
+		w[ i ] = ( SIG1( w[ i - 2 ] ) + w[ i - 7 ] + SIG0( w[ i - 15 ] ) + w[ i - 16 ] ) & 0xffffffffUL;
+	}
+
+	a = pxCtx->ulState[ 0 ];
+	b = pxCtx->ulState[ 1 ];
+	c = pxCtx->ulState[ 2 ];
+	d = pxCtx->ulState[ 3 ];
+	e = pxCtx->ulState[ 4 ];
+	f = pxCtx->ulState[ 5 ];
+	g = pxCtx->ulState[ 6 ];
+	h = pxCtx->ulState[ 7 ];
+
+	for( i = 0; i < 64; i++ )
+	{
+		t1 = ( h + EP1( e ) + CH( e, f, g ) + ulK[ i ] + w[ i ] ) & 0xffffffffUL;
+		t2 = ( EP0( a ) + MAJ( a, b, c ) ) & 0xffffffffUL;
+		h = g;
+		g = f;
+		f = e;
+		e = ( d + t1 ) & 0xffffffffUL;
+		d = c;
+		c = b;
+		b = a;
+		a = ( t1 + t2 ) & 0xffffffffUL;
+	}
+
+	pxCtx->ulState[ 0 ] = ( pxCtx->ulState[ 0 ] + a ) & 0xffffffffUL;
+	pxCtx->ulState[ 1 ] = ( pxCtx->ulState[ 1 ] + b ) & 0xffffffffUL;
+	pxCtx->ulState[ 2 ] = ( pxCtx->ulState[ 2 ] + c ) & 0xffffffffUL;
+	pxCtx->ulState[ 3 ] = ( pxCtx->ulState[ 3 ] + d ) & 0xffffffffUL;
+	pxCtx->ulState[ 4 ] = ( pxCtx->ulState[ 4 ] + e ) & 0xffffffffUL;
+	pxCtx->ulState[ 5 ] = ( pxCtx->ulState[ 5 ] + f ) & 0xffffffffUL;
+	pxCtx->ulState[ 6 ] = ( pxCtx->ulState[ 6 ] + g ) & 0xffffffffUL;
+	pxCtx->ulState[ 7 ] = ( pxCtx->ulState[ 7 ] + h ) & 0xffffffffUL;
+}
+
+void vSha256Init( xSha256Context *pxCtx )
+{
+	pxCtx->ulState[ 0 ] = 0x6a09e667UL;
+	pxCtx->ulState[ 1 ] = 0xbb67ae85UL;
+	pxCtx->ulState[ 2 ] = 0x3c6ef372UL;
+	pxCtx->ulState[ 3 ] = 0xa54ff53aUL;
+	pxCtx->ulState[ 4 ] = 0x510e527fUL;
+	pxCtx->ulState[ 5 ] = 0x9b05688cUL;
+	pxCtx->ulState[ 6 ] = 0x1f83d9abUL;
+	pxCtx->ulState[ 7 ] = 0x5be0cd19UL;
+	pxCtx->ulLengthLow = 0;
+	pxCtx->ulLengthHigh = 0;
+}
+
+void vSha256Update( xSha256Context *pxCtx, const void *pvData, unsigned long ulLength )
+{
+const unsigned char *pucData = ( const unsigned char * ) pvData;
+unsigned long ulUsed = pxCtx->ulLengthLow % SHA256_BLOCK_SIZE, ulCount;
+
+	pxCtx->ulLengthLow = ( pxCtx->ulLengthLow + ulLength ) & 0xffffffffUL;
+	if( pxCtx->ulLengthLow < ulLength )
+	{
+		pxCtx->ulLengthHigh++;
+	}
+
+	while( ulLength )
+	{
+		if( ulUsed == 0 && ulLength >= SHA256_BLOCK_SIZE )
+		{
+			/* Whole blocks straight from the caller's data. */
+			prvSha256Block( pxCtx, pucData );
+			pucData += SHA256_BLOCK_SIZE;
+			ulLength -= SHA256_BLOCK_SIZE;
+			continue;
+		}
+
+		ulCount = SHA256_BLOCK_SIZE - ulUsed;
+		if( ulCount > ulLength )
+		{
+			ulCount = ulLength;
+		}
+		memcpy( pxCtx->ucBlock + ulUsed, pucData, ulCount );
+		ulUsed += ulCount;
+		pucData += ulCount;
+		ulLength -= ulCount;
+
+		if( ulUsed == SHA256_BLOCK_SIZE )
+		{
+			prvSha256Block( pxCtx, pxCtx->ucBlock );
+			ulUsed = 0;
+		}
+	}
+}
+
+void vSha256Final( xSha256Context *pxCtx, unsigned char *pucDigest )
+{
+unsigned long ulUsed = pxCtx->ulLengthLow % SHA256_BLOCK_SIZE;
+unsigned long ulBitsLow = ( pxCtx->ulLengthLow << 3 ) & 0xffffffffUL;
+unsigned long ulBitsHigh = ( pxCtx->ulLengthHigh << 3 ) | ( pxCtx->ulLengthLow >> 29 );
+int i;
+
+	pxCtx->ucBlock[ ulUsed++ ] = 0x80;
+	if( ulUsed > SHA256_BLOCK_SIZE - 8 )
+	{
+		memset( pxCtx->ucBlock + ulUsed, 0, SHA256_BLOCK_SIZE - ulUsed );
+		prvSha256Block( pxCtx, pxCtx->ucBlock );
+		ulUsed = 0;
+	}
+	memset( pxCtx->ucBlock + ulUsed, 0, SHA256_BLOCK_SIZE - 8 - ulUsed );
+
+	for( i = 0; i < 4; i++ )
+	{
+		pxCtx->ucBlock[ 56 + i ] = ( unsigned char ) ( ulBitsHigh >> ( 24 - 8 * i ) );
+		pxCtx->ucBlock[ 60 + i ] = ( unsigned char ) ( ulBitsLow >> ( 24 - 8 * i ) );
+	}
+	prvSha256Block( pxCtx, pxCtx->ucBlock );
+
+	for( i = 0; i < SHA256_DIGEST_SIZE; i++ )
+	{
+		pucDigest[ i ] = ( unsigned char ) ( pxCtx->ulState[ i / 4 ] >> ( 24 - 8 * ( i % 4 ) ) );
+	}
+}
+
+void vHmacSha256Init( xHmacSha256Context *pxCtx, const unsigned char *pucKey, unsigned long ulKeyLength )
+{
+unsigned char ucPad[ SHA256_BLOCK_SIZE ];
+unsigned char ucKeyHash[ SHA256_DIGEST_SIZE ];
+unsigned long i;
+
+	/* Keys longer than a block are hashed first. */
+	if( ulKeyLength > SHA256_BLOCK_SIZE )
+	{
+		vSha256Init( &pxCtx->xInner );
+		vSha256Update( &pxCtx->xInner, pucKey, ulKeyLength );
+		vSha256Final( &pxCtx->xInner, ucKeyHash );
+		pucKey = ucKeyHash;
+		ulKeyLength = SHA256_DIGEST_SIZE;
+	}
+
+	memset( ucPad, 0x36, sizeof( ucPad ) );
+	for( i = 0; i < ulKeyLength; i++ )
+	{
+		ucPad[ i ] ^= pucKey[ i ];
+	}
+	vSha256Init( &pxCtx->xInner );
+	vSha256Update( &pxCtx->xInner, ucPad, sizeof( ucPad ) );
+
+	memset( ucPad, 0x5c, sizeof( ucPad ) );
+	for( i = 0; i < ulKeyLength; i++ )
+	{
+		ucPad[ i ] ^= pucKey[ i ];
+	}
+	vSha256Init( &pxCtx->xOuter );
+	vSha256Update( &pxCtx->xOuter, ucPad, sizeof( ucPad ) );
+}
+
+void vHmacSha256Update( xHmacSha256Context *pxCtx, const void *pvData, unsigned long ulLength )
+{
+	vSha256Update( &pxCtx->xInner, pvData, ulLength );
+}
+
+void vHmacSha256Final( xHmacSha256Context *pxCtx, unsigned char *pucMac )
+{
+unsigned char ucInner[ SHA256_DIGEST_SIZE ];
+
+	vSha256Final( &pxCtx->xInner, ucInner );
+	vSha256Update( &pxCtx->xOuter, ucInner, sizeof( ucInner ) );
+	vSha256Final( &pxCtx->xOuter, pucMac );
+}
@@ -0,0 +1,37 @@
+/*
+    SHA-256 and HMAC-SHA256, FIPS 180-4 and RFC 2104.
+
+    Plain C without dependencies so the same file builds for the target and
+    for the host tools.  Data is hashed incrementally, nothing is buffered
+    beyond the 64 byte block.
+*/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#define SHA256_BLOCK_SIZE	64
+#define SHA256_DIGEST_SIZE	32
+
+typedef struct xSHA256_CONTEXT
+{
+	unsigned long ulState[ 8 ];
+	unsigned long ulLengthLow;		/* bytes hashed */
+	unsigned long ulLengthHigh;
+	unsigned char ucBlock[ SHA256_BLOCK_SIZE ];
+} xSha256Context;
+
+typedef struct xHMAC_SHA256_CONTEXT
+{
+	xSha256Context xInner;
+	xSha256Context xOuter;
+} xHmacSha256Context;
+
+void vSha256Init( xSha256Context *pxCtx );
+void vSha256Update( xSha256Context *pxCtx, const void *pvData, unsigned long ulLength );
+void vSha256Final( xSha256Context *pxCtx, unsigned char *pucDigest );
+
+void vHmacSha256Init( xHmacSha256Context *pxCtx, const unsigned char *pucKey, unsigned long ulKeyLength );
+void vHmacSha256Update( xHmacSha256Context *pxCtx, const void *pvData, unsigned long ulLength );
+void vHmacSha256Final( xHmacSha256Context *pxCtx, unsigned char *pucMac );
+
+#endif /* SHA256_H */
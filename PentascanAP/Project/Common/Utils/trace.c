@@ -0,0 +1,243 @@
+/*
+    Kernel event trace recorder, see trace.h.
+*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if ( configUSE_TRACE_RECORDER == 1 )
+
+#if ( configTRACE_RING_SIZE & ( configTRACE_RING_SIZE - 1 ) ) != 0
+	#error configTRACE_RING_SIZE must be a power of 2
+#endif
+
+/* Exception number of the active interrupt, VECTACTIVE in the NVIC ICSR. */
+#define traceNVIC_INT_CTRL			( ( volatile unsigned long * ) 0xe000ed04 )
+#define traceVECTACTIVE_MASK		( 0x1ffUL )
+
+#define traceVERSION				( 1UL )
+
+/* The ring, the header and task table of the last snapshot. */
+static xTraceRecord xTraceRing[ configTRACE_RING_SIZE ];
+static unsigned long ulTraceHead = 0;
+static unsigned long ulTraceRecords = 0;
+static volatile portBASE_TYPE xTraceRunning = pdTRUE;
+
+static xTraceHeader xSnapshotHeader;
+static xTraceTask xSnapshotTasks[ traceMAX_TASKS ];
+/*-----------------------------------------------------------*/
+
+void vTraceRecord( unsigned char ucEvent, unsigned char ucId, unsigned short usParam )
+{
+xTraceRecord *pxRecord;
+int iWasMasked;
+
+	if( xTraceRunning == pdFALSE )
+	{
+		return;
+	}
+
+	/* Records are written from tasks, the scheduler and interrupts of any
+	priority, so mask everything rather than just up to the syscall level.
+	__disable_irq() returns the previous PRIMASK, so this nests. */
+	iWasMasked = __disable_irq();
+	{
+		pxRecord = &xTraceRing[ ulTraceHead ];
+		ulTraceHead = ( ulTraceHead + 1 ) & ( configTRACE_RING_SIZE - 1 );
+		if( ulTraceRecords < configTRACE_RING_SIZE )
+		{
+			ulTraceRecords++;
+		}
+
+		pxRecord->ulTime = configTRACE_TIMESTAMP();
+		pxRecord->ucEvent = ucEvent;
+		pxRecord->ucId = ucId;
+		pxRecord->usParam = usParam;
+	}
+	if( iWasMasked == 0 )
+	{
+		__enable_irq();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vTraceIsr( unsigned char ucEvent )
+{
+	vTraceRecord( ucEvent, ( unsigned char ) ( *( traceNVIC_INT_CTRL ) & traceVECTACTIVE_MASK ), 0 );
+}
+/*-----------------------------------------------------------*/
+
+void vTraceStart( void )
+{
+	xTraceRunning = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vTraceStop( void )
+{
+	xTraceRunning = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vTraceClear( void )
+{
+int iWasMasked;
+
+	iWasMasked = __disable_irq();
+	{
+		ulTraceHead = 0;
+		ulTraceRecords = 0;
+	}
+	if( iWasMasked == 0 )
+	{
+		__enable_irq();
+	}
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulTraceCount( void )
+{
+	return ulTraceRecords;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulTraceLast( xTraceRecord *pxRecords, unsigned long ulCount )
+{
+unsigned long ulFirst, ul;
+int iWasMasked;
+
+	/* Called from fault handlers and the watchdog interrupt as well, so the
+	ring is copied with everything masked rather than through a snapshot. */
+	iWasMasked = __disable_irq();
+	{
+		if( ulCount > ulTraceRecords )
+		{
+			ulCount = ulTraceRecords;
+		}
+
+		ulFirst = ( ulTraceHead - ulCount ) & ( configTRACE_RING_SIZE - 1 );
+		for( ul = 0; ul < ulCount; ul++ )
+		{
+			pxRecords[ ul ] = xTraceRing[ ( ulFirst + ul ) & ( configTRACE_RING_SIZE - 1 ) ];
+		}
+	}
+	if( iWasMasked == 0 )
+	{
+		__enable_irq();
+	}
+
+	return ulCount;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulTraceSnapshot( void )
+{
+signed char *pcList;
+char *pcLine, *pcNext, *pcTab;
+unsigned long ulTasks = 0;
+unsigned int uxNumber;
+char cState;
+unsigned int uxPriority, uxStack;
+
+	/* Freeze the ring, it stays frozen until vTraceStart() is called. */
+	vTraceStop();
+
+	/* Name the task numbers, vTaskList() prints
+	"name\t\tstate\tprio\tstack\tnum\r\n" per task. */
+	pcList = ( signed char * ) pvPortMalloc( traceMAX_TASKS * 40 );
+	if( pcList != NULL )
+	{
+		vTaskList( pcList );
+		for( pcLine = ( char * ) pcList; *pcLine != 0 && ulTasks < traceMAX_TASKS; pcLine = pcNext )
+		{
+			pcNext = strchr( pcLine, '\n' );
+			if( pcNext != NULL )
+			{
+				*pcNext++ = 0;
+			}
+			else
+			{
+				pcNext = pcLine + strlen( pcLine );
+			}
+
+			pcTab = strchr( pcLine, '\t' );
+			if( pcTab == NULL )
+			{
+				continue;
+			}
+			*pcTab++ = 0;
+
+			if( sscanf( pcTab, " %c %u %u %u", &cState, &uxPriority, &uxStack, &uxNumber ) == 4 )
+			{
+				xSnapshotTasks[ ulTasks ].ulNumber = uxNumber;
+				strncpy( xSnapshotTasks[ ulTasks ].cName, pcLine, traceNAME_LEN );
+				ulTasks++;
+			}
+		}
+		vPortFree( pcList );
+	}
+
+	memcpy( xSnapshotHeader.cMagic, "PTRC", 4 );
+	xSnapshotHeader.ulVersion = traceVERSION;
+	xSnapshotHeader.ulClockHz = configTRACE_TIMESTAMP_HZ;
+	xSnapshotHeader.ulTasks = ulTasks;
+	xSnapshotHeader.ulRecords = ulTraceRecords;
+
+	return sizeof( xTraceHeader ) + ( ulTasks * sizeof( xTraceTask ) ) + ( ulTraceRecords * sizeof( xTraceRecord ) );
+}
+/*-----------------------------------------------------------*/
+
+int iTraceRead( unsigned long ulOffset, unsigned char *pucBuffer, int iLength )
+{
+unsigned long ulTaskBytes, ulFirst, ulRecord;
+int iCopied = 0, iChunk;
+const unsigned char *pucSource;
+
+	ulTaskBytes = xSnapshotHeader.ulTasks * sizeof( xTraceTask );
+	ulFirst = ( ulTraceHead - xSnapshotHeader.ulRecords ) & ( configTRACE_RING_SIZE - 1 );
+
+	while( iCopied < iLength )
+	{
+		if( ulOffset < sizeof( xTraceHeader ) )
+		{
+			pucSource = ( const unsigned char * ) &xSnapshotHeader + ulOffset;
+			iChunk = sizeof( xTraceHeader ) - ulOffset;
+		}
+		else if( ulOffset < sizeof( xTraceHeader ) + ulTaskBytes )
+		{
+			pucSource = ( const unsigned char * ) xSnapshotTasks + ( ulOffset - sizeof( xTraceHeader ) );
+			iChunk = sizeof( xTraceHeader ) + ulTaskBytes - ulOffset;
+		}
+		else
+		{
+			/* Records are copied oldest first, one at a time as the ring
+			wraps. */
+			ulRecord = ( ulOffset - sizeof( xTraceHeader ) - ulTaskBytes ) / sizeof( xTraceRecord );
+			if( ulRecord >= xSnapshotHeader.ulRecords )
+			{
+				break;
+			}
+			pucSource = ( const unsigned char * ) &xTraceRing[ ( ulFirst + ulRecord ) & ( configTRACE_RING_SIZE - 1 ) ];
+			iChunk = sizeof( xTraceRecord ) - ( ( ulOffset - sizeof( xTraceHeader ) - ulTaskBytes ) % sizeof( xTraceRecord ) );
+			pucSource += sizeof( xTraceRecord ) - iChunk;
+		}
+
+		if( iChunk > iLength - iCopied )
+		{
+			iChunk = iLength - iCopied;
+		}
+		memcpy( pucBuffer + iCopied, pucSource, iChunk );
+		iCopied += iChunk;
+		ulOffset += iChunk;
+	}
+
+	return iCopied;
+}
+
+#endif /* configUSE_TRACE_RECORDER */
+
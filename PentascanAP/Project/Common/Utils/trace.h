@@ -0,0 +1,125 @@
+/*
+    Kernel event trace recorder.
+
+    Included by FreeRTOS.h when configUSE_TRACE_RECORDER is set to 1, so the
+    kernel trace macros below write a record into a fixed RAM ring instead of
+    doing nothing.  Each record holds a timestamp taken from the free running
+    cycle counter (Timer 1, at the cpu clock), an event code, a task or queue
+    type identifier and a 16 bit parameter.
+
+    The ring is dumped with ulTraceSnapshot() and iTraceRead() as a flat
+    image: an xTraceHeader, xTraceHeader.ulTasks xTraceTask entries naming the
+    task numbers, and xTraceHeader.ulRecords records, oldest first.  The image
+    is little endian, Tools/tracecvt.c converts it into a timeline.
+    ulTraceLast() copies the newest records out of the ring from any
+    context, for crash records.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Number of records kept, must be a power of 2.  8 bytes per record. */
+#ifndef configTRACE_RING_SIZE
+	#define configTRACE_RING_SIZE			256
+#endif
+
+/* Number of tasks named in a dump. */
+#define traceMAX_TASKS						16
+#define traceNAME_LEN						12
+
+/* Event codes. */
+#define traceEVENT_TASK_SWITCHED_IN			1	/* id = task number, param = priority */
+#define traceEVENT_TASK_CREATE				2	/* id = task number, param = priority */
+#define traceEVENT_TASK_DELETE				3	/* id = task number */
+#define traceEVENT_TASK_DELAY				4	/* id = task number, param = ticks */
+#define traceEVENT_TASK_DELAY_UNTIL			5	/* id = task number */
+#define traceEVENT_TASK_SUSPEND				6	/* id = task number */
+#define traceEVENT_TASK_RESUME				7	/* id = task number */
+#define traceEVENT_QUEUE_CREATE				10	/* id = queue type, param = queue id, for all queue events */
+#define traceEVENT_QUEUE_CREATE_FAILED		11
+#define traceEVENT_QUEUE_SEND				12
+#define traceEVENT_QUEUE_SEND_FAILED		13
+#define traceEVENT_QUEUE_BLOCK_SEND			14
+#define traceEVENT_QUEUE_RECEIVE			15
+#define traceEVENT_QUEUE_RECEIVE_FAILED		16
+#define traceEVENT_QUEUE_BLOCK_RECEIVE		17
+#define traceEVENT_QUEUE_PEEK				18
+#define traceEVENT_QUEUE_SEND_FROM_ISR		19
+#define traceEVENT_QUEUE_RECEIVE_FROM_ISR	20
+#define traceEVENT_QUEUE_ISR_FAILED			21
+#define traceEVENT_ISR_ENTER				30	/* id = exception number */
+#define traceEVENT_ISR_EXIT					31	/* id = exception number */
+#define traceEVENT_USER						40	/* application defined */
+
+typedef struct xTRACE_RECORD
+{
+	unsigned long ulTime;					/* cycle counter */
+	unsigned char ucEvent;
+	unsigned char ucId;
+	unsigned short usParam;
+} xTraceRecord;
+
+typedef struct xTRACE_HEADER
+{
+	char cMagic[ 4 ];						/* "PTRC" */
+	unsigned long ulVersion;
+	unsigned long ulClockHz;				/* rate of the cycle counter */
+	unsigned long ulTasks;
+	unsigned long ulRecords;
+} xTraceHeader;
+
+typedef struct xTRACE_TASK
+{
+	unsigned long ulNumber;
+	char cName[ traceNAME_LEN ];
+} xTraceTask;
+
+/* Queues are identified by the low 16 bits of their handle. */
+#define traceQUEUE_ID( pxQueue )			( ( unsigned short ) ( unsigned long ) ( pxQueue ) )
+
+void vTraceRecord( unsigned char ucEvent, unsigned char ucId, unsigned short usParam );
+void vTraceIsr( unsigned char ucEvent );
+void vTraceStart( void );
+void vTraceStop( void );
+void vTraceClear( void );
+unsigned long ulTraceCount( void );
+unsigned long ulTraceLast( xTraceRecord *pxRecords, unsigned long ulCount );
+unsigned long ulTraceSnapshot( void );
+int iTraceRead( unsigned long ulOffset, unsigned char *pucBuffer, int iLength );
+
+/* Kernel trace macros, expanded inside tasks.c and queue.c. */
+#define traceTASK_SWITCHED_IN()				vTraceRecord( traceEVENT_TASK_SWITCHED_IN, ( unsigned char ) pxCurrentTCB->uxTCBNumber, ( unsigned short ) pxCurrentTCB->uxPriority )
+#define traceTASK_CREATE( pxNewTCB )		vTraceRecord( traceEVENT_TASK_CREATE, ( unsigned char ) ( pxNewTCB )->uxTCBNumber, ( unsigned short ) ( pxNewTCB )->uxPriority )
+#define traceTASK_DELETE( pxTCB )			vTraceRecord( traceEVENT_TASK_DELETE, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0 )
+#define traceTASK_DELAY()					vTraceRecord( traceEVENT_TASK_DELAY, ( unsigned char ) pxCurrentTCB->uxTCBNumber, ( unsigned short ) xTicksToDelay )
+#define traceTASK_DELAY_UNTIL()				vTraceRecord( traceEVENT_TASK_DELAY_UNTIL, ( unsigned char ) pxCurrentTCB->uxTCBNumber, 0 )
+#define traceTASK_SUSPEND( pxTCB )			vTraceRecord( traceEVENT_TASK_SUSPEND, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0 )
+#define traceTASK_RESUME( pxTCB )			vTraceRecord( traceEVENT_TASK_RESUME, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0 )
+#define traceTASK_RESUME_FROM_ISR( pxTCB )	vTraceRecord( traceEVENT_TASK_RESUME, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0 )
+
+#define traceQUEUE_EVENT( ucEvent, pxQueue )	vTraceRecord( ( ucEvent ), ( pxQueue )->ucQueueType, traceQUEUE_ID( pxQueue ) )
+#define traceQUEUE_CREATE( pxNewQueue )			traceQUEUE_EVENT( traceEVENT_QUEUE_CREATE, pxNewQueue )
+#define traceQUEUE_CREATE_FAILED( ucQueueType )	vTraceRecord( traceEVENT_QUEUE_CREATE_FAILED, ( ucQueueType ), 0 )
+#define traceCREATE_MUTEX( pxNewQueue )			traceQUEUE_EVENT( traceEVENT_QUEUE_CREATE, pxNewQueue )
+#define traceCREATE_MUTEX_FAILED()				vTraceRecord( traceEVENT_QUEUE_CREATE_FAILED, 1, 0 )
+#define traceGIVE_MUTEX_RECURSIVE( pxMutex )	traceQUEUE_EVENT( traceEVENT_QUEUE_SEND, pxMutex )
+#define traceGIVE_MUTEX_RECURSIVE_FAILED( pxMutex )	traceQUEUE_EVENT( traceEVENT_QUEUE_SEND_FAILED, pxMutex )
+#define traceTAKE_MUTEX_RECURSIVE( pxMutex )	traceQUEUE_EVENT( traceEVENT_QUEUE_RECEIVE, pxMutex )
+#define traceTAKE_MUTEX_RECURSIVE_FAILED( pxMutex )	traceQUEUE_EVENT( traceEVENT_QUEUE_RECEIVE_FAILED, pxMutex )
+#define traceQUEUE_SEND( pxQueue )				traceQUEUE_EVENT( traceEVENT_QUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )		traceQUEUE_EVENT( traceEVENT_QUEUE_SEND_FAILED, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_BLOCK_SEND, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )			traceQUEUE_EVENT( traceEVENT_QUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_RECEIVE_FAILED, pxQueue )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_BLOCK_RECEIVE, pxQueue )
+#define traceQUEUE_PEEK( pxQueue )				traceQUEUE_EVENT( traceEVENT_QUEUE_PEEK, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )		traceQUEUE_EVENT( traceEVENT_QUEUE_SEND_FROM_ISR, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_ISR_FAILED, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_RECEIVE_FROM_ISR, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED( pxQueue )	traceQUEUE_EVENT( traceEVENT_QUEUE_ISR_FAILED, pxQueue )
+
+#define traceISR_ENTER()					vTraceIsr( traceEVENT_ISR_ENTER )
+#define traceISR_EXIT()						vTraceIsr( traceEVENT_ISR_EXIT )
+
+#endif /* TRACE_H */
+
@@ -0,0 +1,562 @@
+/*
+    Time-series storage of the sensor readings, see tsdb.h.
+*/
+
+#include <string.h>
+
+#include "tsdb.h"
+
+#define tsdbCHECK_OFFSET	20
+#define tsdbDIR( pucBlock, x )	( ( pucBlock ) + TSDB_HEADER_SIZE + ( x ) * TSDB_DIR_SIZE )
+#define tsdbBUCKET( pxQuery, ulTime )	\
+	( ( pxQuery )->ulFrom + ( ( ulTime ) - ( pxQuery )->ulFrom ) / ( pxQuery )->ulStep * ( pxQuery )->ulStep )
+
+static unsigned long prvGet16( const unsigned char *puc )
+{
+	return ( unsigned long ) puc[ 0 ] | ( ( unsigned long ) puc[ 1 ] << 8 );
+}
+
+static unsigned long prvGet32( const unsigned char *puc )
+{
+	return prvGet16( puc ) | ( prvGet16( puc + 2 ) << 16 );
+}
+
+static void prvPut16( unsigned char *puc, unsigned long ulValue )
+{
+	puc[ 0 ] = ( unsigned char ) ulValue;
+	puc[ 1 ] = ( unsigned char ) ( ulValue >> 8 );
+}
+
+static void prvPut32( unsigned char *puc, unsigned long ulValue )
+{
+	prvPut16( puc, ulValue );
+	prvPut16( puc + 2, ulValue >> 16 );
+}
+
+/* Sign extension that also holds where a long is wider than 32 bits. */
+static short prvGetShort( const unsigned char *puc )
+{
+	return ( short ) ( ( long ) ( prvGet16( puc ) ^ 0x8000UL ) - 0x8000L );
+}
+
+static long prvGetLong( const unsigned char *puc )
+{
+unsigned long ulValue = prvGet32( puc );
+
+	return ( ulValue & 0x80000000UL ) ? -( long ) ( ~ulValue & 0x7fffffffUL ) - 1 : ( long ) ulValue;
+}
+
+static unsigned long prvCheck( const unsigned char *pucBlock, unsigned long ulUsed )
+{
+unsigned long ulSum = 0, x;
+
+	for( x = 0; x < ulUsed; x++ )
+	{
+		ulSum = ( ( ( ulSum << 5 ) | ( ulSum >> 27 ) ) & 0xffffffffUL ) ^
+				( ( x >= tsdbCHECK_OFFSET && x < tsdbCHECK_OFFSET + 4 ) ? 0 : pucBlock[ x ] );
+	}
+	return ~ulSum & 0xffffffffUL;
+}
+
+static unsigned long prvVarintPut( unsigned char *puc, unsigned long ulValue )
+{
+unsigned long ulLength = 0;
+
+	while( ulValue >= 0x80 )
+	{
+		puc[ ulLength++ ] = ( unsigned char ) ( ulValue | 0x80 );
+		ulValue >>= 7;
+	}
+	puc[ ulLength++ ] = ( unsigned char ) ulValue;
+	return ulLength;
+}
+
+static long prvVarintGet( xTsdbCursor *pxCursor, unsigned long *pulValue )
+{
+unsigned long ulShift;
+unsigned char uc;
+
+	*pulValue = 0;
+	for( ulShift = 0; ulShift < 35; ulShift += 7 )
+	{
+		if( pxCursor->usPos >= pxCursor->usEnd )
+		{
+			return -1;
+		}
+		uc = pxCursor->pucBlock[ pxCursor->usPos++ ];
+		*pulValue |= ( unsigned long ) ( uc & 0x7f ) << ulShift;
+		if( ( uc & 0x80 ) == 0 )
+		{
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static unsigned long prvZigzag( long lValue )
+{
+	return lValue < 0 ? ( ( unsigned long ) -lValue << 1 ) - 1 : ( unsigned long ) lValue << 1;
+}
+
+static long prvUnzigzag( unsigned long ulValue )
+{
+	return ( ulValue & 1 ) ? -( long ) ( ( ulValue + 1 ) >> 1 ) : ( long ) ( ulValue >> 1 );
+}
+
+static short prvClamp( long lValue )
+{
+	if( lValue > 32767 )
+	{
+		return 32767;
+	}
+	if( lValue < -32768 )
+	{
+		return -32768;
+	}
+	return ( short ) lValue;
+}
+
+/* Returns -1 if this is not a block header. */
+long lTsdbHeaderGet( const unsigned char *pucBlock, xTsdbHeader *pxHeader )
+{
+	if( memcmp( pucBlock, TSDB_MAGIC, 4 ) )
+	{
+		return -1;
+	}
+	pxHeader->ulSeq = prvGet32( pucBlock + 4 );
+	pxHeader->ulFirst = prvGet32( pucBlock + 8 );
+	pxHeader->ulLast = prvGet32( pucBlock + 12 );
+	pxHeader->usUsed = ( unsigned short ) prvGet16( pucBlock + 16 );
+	pxHeader->ucSeries = pucBlock[ 18 ];
+	pxHeader->ucFlags = pucBlock[ 19 ];
+	if( pxHeader->usUsed < TSDB_DATA_OFFSET || pxHeader->usUsed > TSDB_BLOCK_SIZE ||
+		pxHeader->ucSeries > TSDB_MAX_SERIES )
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/* Returns the end of the records, or -1 if the block is damaged. */
+long lTsdbBlockCheck( const unsigned char *pucBlock )
+{
+xTsdbHeader xHeader;
+
+	if( lTsdbHeaderGet( pucBlock, &xHeader ) < 0 ||
+		prvGet32( pucBlock + tsdbCHECK_OFFSET ) != prvCheck( pucBlock, xHeader.usUsed ) )
+	{
+		return -1;
+	}
+	return xHeader.usUsed;
+}
+
+/* The directory entry of a sensor, returns its index or -1 if it has none. */
+long lTsdbSeriesGet( const unsigned char *pucBlock, unsigned char ucAddr, xTsdbPoint *pxSummary )
+{
+const unsigned char *pucDir;
+unsigned long ulSeries;
+int x;
+
+	for( ulSeries = 0; ulSeries < pucBlock[ 18 ] && ulSeries < TSDB_MAX_SERIES; ulSeries++ )
+	{
+		pucDir = tsdbDIR( pucBlock, ulSeries );
+		if( pucDir[ 0 ] != ucAddr )
+		{
+			continue;
+		}
+		pxSummary->ulTime = prvGet32( pucDir + 8 );
+		pxSummary->ulLast = prvGet32( pucDir + 12 );
+		pxSummary->ulCount = prvGet16( pucDir + 2 );
+		for( x = 0; x < TSDB_FIELDS; x++ )
+		{
+			pxSummary->sMin[ x ] = prvGetShort( pucDir + 16 + x * 2 );
+			pxSummary->sMax[ x ] = prvGetShort( pucDir + 24 + x * 2 );
+			pxSummary->lSum[ x ] = prvGetLong( pucDir + 32 + x * 4 );
+		}
+		return ( long ) ulSeries;
+	}
+	return -1;
+}
+
+void vTsdbWriterInit( xTsdbWriter *pxWriter, unsigned long ulSeq )
+{
+	memset( pxWriter, 0, sizeof( xTsdbWriter ) );
+	memcpy( pxWriter->ucBlock, TSDB_MAGIC, 4 );
+	prvPut32( pxWriter->ucBlock + 4, ulSeq );
+	prvPut16( pxWriter->ucBlock + 16, TSDB_DATA_OFFSET );
+	prvPut32( pxWriter->ucBlock + tsdbCHECK_OFFSET, prvCheck( pxWriter->ucBlock, TSDB_DATA_OFFSET ) );
+}
+
+/*
+    Continues the block last written to a file.  Returns 0 if samples can
+    be added to it, 1 if it is sealed and -1 if it is damaged, the writer
+    is left for vTsdbWriterInit() in both cases.
+*/
+long lTsdbWriterResume( xTsdbWriter *pxWriter, const unsigned char *pucBlock )
+{
+xTsdbCursor xCursor;
+unsigned long ulSeries;
+long lResult;
+
+	if( lTsdbBlockCheck( pucBlock ) < 0 )
+	{
+		return -1;
+	}
+	if( pucBlock[ 19 ] & TSDB_SEALED )
+	{
+		return 1;
+	}
+
+	memcpy( pxWriter->ucBlock, pucBlock, TSDB_BLOCK_SIZE );
+	for( ulSeries = 0; ulSeries < pucBlock[ 18 ]; ulSeries++ )
+	{
+		lTsdbCursorInit( &xCursor, pxWriter->ucBlock, tsdbDIR( pucBlock, ulSeries )[ 0 ] );
+		while( ( lResult = lTsdbCursorNext( &xCursor ) ) > 0 )
+		{
+		}
+		if( lResult < 0 )
+		{
+			return -1;
+		}
+		pxWriter->ulPrev[ ulSeries ] = xCursor.ulTime;
+		memcpy( pxWriter->sPrev[ ulSeries ], xCursor.sValue, sizeof( xCursor.sValue ) );
+	}
+	return 0;
+}
+
+/*
+    Adds a sample of TSDB_FIELDS values.  Returns 0 once it is in, 1 if the
+    block is full and has to be sealed and followed by the next one, -1 if
+    it is older than the last sample of the sensor.
+*/
+long lTsdbAppend( xTsdbWriter *pxWriter, unsigned char ucAddr, unsigned long ulTime, const long *plValues )
+{
+unsigned char *pucBlock = pxWriter->ucBlock, *pucDir;
+unsigned char ucRecord[ TSDB_RECORD_MAX ];
+short sValue[ TSDB_FIELDS ];
+xTsdbHeader xHeader;
+unsigned long ulSeries, ulLength, ulCount;
+int x;
+
+	if( lTsdbHeaderGet( pucBlock, &xHeader ) < 0 || ( xHeader.ucFlags & TSDB_SEALED ) )
+	{
+		return 1;
+	}
+
+	for( ulSeries = 0; ulSeries < xHeader.ucSeries; ulSeries++ )
+	{
+		if( tsdbDIR( pucBlock, ulSeries )[ 0 ] == ucAddr )
+		{
+			break;
+		}
+	}
+	if( ulSeries == xHeader.ucSeries )
+	{
+		if( ulSeries == TSDB_MAX_SERIES )
+		{
+			return 1;
+		}
+		pxWriter->ulPrev[ ulSeries ] = ulTime;
+		memset( pxWriter->sPrev[ ulSeries ], 0, sizeof( pxWriter->sPrev[ ulSeries ] ) );
+	}
+	else if( ulTime < pxWriter->ulPrev[ ulSeries ] )
+	{
+		return -1;
+	}
+
+	ulLength = 0;
+	ucRecord[ ulLength++ ] = ( unsigned char ) ulSeries;
+	ulLength += prvVarintPut( ucRecord + ulLength, ulTime - pxWriter->ulPrev[ ulSeries ] );
+	for( x = 0; x < TSDB_FIELDS; x++ )
+	{
+		sValue[ x ] = prvClamp( plValues[ x ] );
+		ulLength += prvVarintPut( ucRecord + ulLength, prvZigzag( ( long ) sValue[ x ] - pxWriter->sPrev[ ulSeries ][ x ] ) );
+	}
+	if( xHeader.usUsed + ulLength > TSDB_BLOCK_SIZE )
+	{
+		return 1;
+	}
+	memcpy( pucBlock + xHeader.usUsed, ucRecord, ulLength );
+
+	pucDir = tsdbDIR( pucBlock, ulSeries );
+	if( ulSeries == xHeader.ucSeries )
+	{
+		memset( pucDir, 0, TSDB_DIR_SIZE );
+		pucDir[ 0 ] = ucAddr;
+		prvPut16( pucDir + 4, xHeader.usUsed );
+		prvPut32( pucDir + 8, ulTime );
+		pucBlock[ 18 ] = ( unsigned char ) ( ulSeries + 1 );
+	}
+	ulCount = prvGet16( pucDir + 2 );
+	prvPut16( pucDir + 2, ulCount + 1 );
+	prvPut32( pucDir + 12, ulTime );
+	for( x = 0; x < TSDB_FIELDS; x++ )
+	{
+		if( ulCount == 0 || sValue[ x ] < prvGetShort( pucDir + 16 + x * 2 ) )
+		{
+			prvPut16( pucDir + 16 + x * 2, ( unsigned short ) sValue[ x ] );
+		}
+		if( ulCount == 0 || sValue[ x ] > prvGetShort( pucDir + 24 + x * 2 ) )
+		{
+			prvPut16( pucDir + 24 + x * 2, ( unsigned short ) sValue[ x ] );
+		}
+		prvPut32( pucDir + 32 + x * 4, ( unsigned long ) ( prvGetLong( pucDir + 32 + x * 4 ) + sValue[ x ] ) );
+	}
+
+	if( xHeader.usUsed == TSDB_DATA_OFFSET || ulTime < xHeader.ulFirst )
+	{
+		prvPut32( pucBlock + 8, ulTime );
+	}
+	if( xHeader.usUsed == TSDB_DATA_OFFSET || ulTime > xHeader.ulLast )
+	{
+		prvPut32( pucBlock + 12, ulTime );
+	}
+	prvPut16( pucBlock + 16, xHeader.usUsed + ulLength );
+	prvPut32( pucBlock + tsdbCHECK_OFFSET, prvCheck( pucBlock, xHeader.usUsed + ulLength ) );
+
+	pxWriter->ulPrev[ ulSeries ] = ulTime;
+	memcpy( pxWriter->sPrev[ ulSeries ], sValue, sizeof( sValue ) );
+	return 0;
+}
+
+void vTsdbSeal( xTsdbWriter *pxWriter )
+{
+	pxWriter->ucBlock[ 19 ] |= TSDB_SEALED;
+	prvPut32( pxWriter->ucBlock + tsdbCHECK_OFFSET, prvCheck( pxWriter->ucBlock, prvGet16( pxWriter->ucBlock + 16 ) ) );
+}
+
+/* Returns the index of the series, or -1 if the block has none for ucAddr. */
+long lTsdbCursorInit( xTsdbCursor *pxCursor, const unsigned char *pucBlock, unsigned char ucAddr )
+{
+xTsdbPoint xSummary;
+long lSeries;
+
+	lSeries = lTsdbSeriesGet( pucBlock, ucAddr, &xSummary );
+	if( lSeries < 0 )
+	{
+		return -1;
+	}
+	pxCursor->pucBlock = pucBlock;
+	pxCursor->usPos = ( unsigned short ) prvGet16( tsdbDIR( pucBlock, lSeries ) + 4 );
+	pxCursor->usEnd = ( unsigned short ) prvGet16( pucBlock + 16 );
+	pxCursor->usLeft = ( unsigned short ) xSummary.ulCount;
+	pxCursor->ucSeries = ( unsigned char ) lSeries;
+	pxCursor->ulTime = xSummary.ulTime;
+	memset( pxCursor->sValue, 0, sizeof( pxCursor->sValue ) );
+	return lSeries;
+}
+
+/* Returns 1 with the next sample in ulTime and sValue, 0 at the end, -1 if damaged. */
+long lTsdbCursorNext( xTsdbCursor *pxCursor )
+{
+unsigned long ulSeries, ulValue;
+int x;
+
+	while( pxCursor->usLeft )
+	{
+		if( pxCursor->usPos >= pxCursor->usEnd )
+		{
+			return -1;
+		}
+		ulSeries = pxCursor->pucBlock[ pxCursor->usPos++ ];
+		if( prvVarintGet( pxCursor, &ulValue ) )
+		{
+			return -1;
+		}
+		if( ulSeries == pxCursor->ucSeries )
+		{
+			pxCursor->ulTime += ulValue;
+		}
+		for( x = 0; x < TSDB_FIELDS; x++ )
+		{
+			if( prvVarintGet( pxCursor, &ulValue ) )
+			{
+				return -1;
+			}
+			if( ulSeries == pxCursor->ucSeries )
+			{
+				pxCursor->sValue[ x ] = ( short ) ( pxCursor->sValue[ x ] + prvUnzigzag( ulValue ) );
+			}
+		}
+		if( ulSeries == pxCursor->ucSeries )
+		{
+			pxCursor->usLeft--;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static long prvRead( xTsdbQuery *pxQuery, unsigned long ulBlock, unsigned long ulOffset, unsigned long ulLength )
+{
+	return pxQuery->pxRead( pxQuery->pvFile, ulBlock * TSDB_BLOCK_SIZE + ulOffset,
+							pxQuery->pucBuffer + ulOffset, ulLength );
+}
+
+static int prvEmit( xTsdbQuery *pxQuery, const xTsdbPoint *pxPoint )
+{
+	pxQuery->ulPoints++;
+	return pxQuery->pxPoint( pxQuery->pvArg, pxPoint );
+}
+
+/* Adds to the bucket starting at ulStart, the one before is sent first. */
+static int prvBucketAdd( xTsdbQuery *pxQuery, unsigned long ulStart, const xTsdbPoint *pxPoint )
+{
+xTsdbPoint *pxBucket = &pxQuery->xBucket;
+int x;
+
+	if( pxBucket->ulCount && pxBucket->ulTime != ulStart )
+	{
+		if( prvEmit( pxQuery, pxBucket ) )
+		{
+			return 1;
+		}
+		pxBucket->ulCount = 0;
+	}
+	if( pxBucket->ulCount == 0 )
+	{
+		*pxBucket = *pxPoint;
+		pxBucket->ulTime = ulStart;
+		return 0;
+	}
+
+	pxBucket->ulCount += pxPoint->ulCount;
+	if( pxPoint->ulLast > pxBucket->ulLast )
+	{
+		pxBucket->ulLast = pxPoint->ulLast;
+	}
+	for( x = 0; x < TSDB_FIELDS; x++ )
+	{
+		if( pxPoint->sMin[ x ] < pxBucket->sMin[ x ] )
+		{
+			pxBucket->sMin[ x ] = pxPoint->sMin[ x ];
+		}
+		if( pxPoint->sMax[ x ] > pxBucket->sMax[ x ] )
+		{
+			pxBucket->sMax[ x ] = pxPoint->sMax[ x ];
+		}
+		pxBucket->lSum[ x ] += pxPoint->lSum[ x ];
+	}
+	return 0;
+}
+
+/*
+    Sends the samples of ucAddr in [ ulFrom, ulTo ), or with ulStep one
+    aggregate per bucket of ulStep seconds from ulFrom that has samples.
+    A block whose samples of the sensor all fall in one bucket is taken
+    from its directory entry.  Returns the points sent or -1 on a read
+    error, damaged blocks are skipped.
+*/
+long lTsdbQuery( xTsdbQuery *pxQuery )
+{
+unsigned long ulLow = 0, ulHigh = pxQuery->ulBlocks, ulMid, ulBlock;
+xTsdbHeader xHeader;
+xTsdbPoint xPoint;
+xTsdbCursor xCursor;
+int x;
+
+	pxQuery->ulHeaders = 0;
+	pxQuery->ulDirectories = 0;
+	pxQuery->ulDecoded = 0;
+	pxQuery->ulPoints = 0;
+	pxQuery->xBucket.ulCount = 0;
+	if( pxQuery->ulTo <= pxQuery->ulFrom )
+	{
+		return 0;
+	}
+
+	/* The first block ending at or after ulFrom. */
+	while( ulLow < ulHigh )
+	{
+		ulMid = ( ulLow + ulHigh ) / 2;
+		if( prvRead( pxQuery, ulMid, 0, TSDB_HEADER_SIZE ) )
+		{
+			return -1;
+		}
+		pxQuery->ulHeaders++;
+		if( lTsdbHeaderGet( pxQuery->pucBuffer, &xHeader ) < 0 || xHeader.ulLast < pxQuery->ulFrom )
+		{
+			ulLow = ulMid + 1;
+		}
+		else
+		{
+			ulHigh = ulMid;
+		}
+	}
+
+	for( ulBlock = ulLow; ulBlock < pxQuery->ulBlocks; ulBlock++ )
+	{
+		if( prvRead( pxQuery, ulBlock, 0, TSDB_DATA_OFFSET ) )
+		{
+			return -1;
+		}
+		pxQuery->ulHeaders++;
+		if( lTsdbHeaderGet( pxQuery->pucBuffer, &xHeader ) < 0 )
+		{
+			continue;
+		}
+		if( xHeader.ulFirst >= pxQuery->ulTo )
+		{
+			break;
+		}
+		if( lTsdbSeriesGet( pxQuery->pucBuffer, pxQuery->ucAddr, &xPoint ) < 0 ||
+			xPoint.ulLast < pxQuery->ulFrom || xPoint.ulTime >= pxQuery->ulTo )
+		{
+			continue;
+		}
+
+		if( pxQuery->ulStep && xPoint.ulTime >= pxQuery->ulFrom && xPoint.ulLast < pxQuery->ulTo &&
+			tsdbBUCKET( pxQuery, xPoint.ulTime ) == tsdbBUCKET( pxQuery, xPoint.ulLast ) )
+		{
+			pxQuery->ulDirectories++;
+			if( prvBucketAdd( pxQuery, tsdbBUCKET( pxQuery, xPoint.ulTime ), &xPoint ) )
+			{
+				return ( long ) pxQuery->ulPoints;
+			}
+			continue;
+		}
+
+		if( xHeader.usUsed > TSDB_DATA_OFFSET &&
+			prvRead( pxQuery, ulBlock, TSDB_DATA_OFFSET, xHeader.usUsed - TSDB_DATA_OFFSET ) )
+		{
+			return -1;
+		}
+		pxQuery->ulDecoded++;
+		if( lTsdbBlockCheck( pxQuery->pucBuffer ) < 0 ||
+			lTsdbCursorInit( &xCursor, pxQuery->pucBuffer, pxQuery->ucAddr ) < 0 )
+		{
+			continue;
+		}
+		while( lTsdbCursorNext( &xCursor ) > 0 )
+		{
+			if( xCursor.ulTime < pxQuery->ulFrom )
+			{
+				continue;
+			}
+			if( xCursor.ulTime >= pxQuery->ulTo )
+			{
+				break;
+			}
+			xPoint.ulTime = xCursor.ulTime;
+			xPoint.ulLast = xCursor.ulTime;
+			xPoint.ulCount = 1;
+			for( x = 0; x < TSDB_FIELDS; x++ )
+			{
+				xPoint.sMin[ x ] = xCursor.sValue[ x ];
+				xPoint.sMax[ x ] = xCursor.sValue[ x ];
+				xPoint.lSum[ x ] = xCursor.sValue[ x ];
+			}
+			if( pxQuery->ulStep ? prvBucketAdd( pxQuery, tsdbBUCKET( pxQuery, xPoint.ulTime ), &xPoint )
+								: prvEmit( pxQuery, &xPoint ) )
+			{
+				return ( long ) pxQuery->ulPoints;
+			}
+		}
+	}
+
+	if( pxQuery->xBucket.ulCount )
+	{
+		prvEmit( pxQuery, &pxQuery->xBucket );
+	}
+	return ( long ) pxQuery->ulPoints;
+}
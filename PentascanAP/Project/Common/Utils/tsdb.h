@@ -0,0 +1,141 @@
+/*
+    Time-series storage of the sensor readings.
+
+    A history file is a sequence of TSDB_BLOCK_SIZE blocks.  Samples are
+    only ever added to the last block, a block is sealed once it is full
+    and not written again, so the blocks are in time order and the one
+    covering a time is found by a binary search over the block headers.
+    All words are little endian.
+
+    Block layout:
+        0       header, TSDB_HEADER_SIZE bytes
+                0   TSDB_MAGIC
+                4   number of the block in the file
+                8   time of the first sample, seconds
+                12  time of the last sample
+                16  end of the records, offset in the block
+                18  series in the directory
+                19  flags, TSDB_SEALED
+                20  check word of the block up to the end of the records,
+                    computed with this word taken as 0
+        24      directory, a TSDB_DIR_SIZE entry per series (sensor)
+                0   sensor address
+                2   samples of the series in the block
+                4   offset of its first record in the block
+                8   time of its first sample
+                12  time of its last sample
+                16  minimum of each field, 16 bit
+                24  maximum of each field, 16 bit
+                32  sum of each field, 32 bit
+        512     records, in the order the samples came in
+                index of the series in the directory, one byte
+                seconds since the previous sample of the series, varint
+                each field less the field of the previous sample, zigzag
+                varint
+                the first sample of a series in a block is relative to
+                the first time of its entry and to 0
+
+    A varint holds 7 bits a byte, least significant first, the top bit set
+    on all bytes but the last.  Zigzag maps 0, -1, 1, -2 .. to 0, 1, 2, 3 ..
+    Fields are 16 bit signed, readings out of range are clamped.
+
+    The directory is the per-block summary: a query that only needs the
+    count, minimum, maximum and mean of a series over a bucket the block
+    falls in whole reads the first TSDB_DATA_OFFSET bytes of the block and
+    never decodes its records.
+*/
+
+#ifndef TSDB_H
+#define TSDB_H
+
+#define TSDB_MAGIC				"TSB1"
+#define TSDB_BLOCK_SIZE			2048
+#define TSDB_HEADER_SIZE		24
+#define TSDB_DIR_SIZE			48
+#define TSDB_DATA_OFFSET		512
+#define TSDB_MAX_SERIES			( ( TSDB_DATA_OFFSET - TSDB_HEADER_SIZE ) / TSDB_DIR_SIZE )
+#define TSDB_FIELDS				4		/* temperature, humidity, co2, sound */
+/* series byte, a 5 byte time step, 3 bytes for a 17 bit field delta */
+#define TSDB_RECORD_MAX			( 1 + 5 + TSDB_FIELDS * 3 )
+
+#define TSDB_SEALED				0x01
+
+typedef struct xTSDB_HEADER
+{
+	unsigned long ulSeq;
+	unsigned long ulFirst;
+	unsigned long ulLast;
+	unsigned short usUsed;
+	unsigned char ucSeries;
+	unsigned char ucFlags;
+} xTsdbHeader;
+
+/* A directory entry, or an aggregate of samples. */
+typedef struct xTSDB_POINT
+{
+	unsigned long ulTime;				/* the sample, or the start of a bucket */
+	unsigned long ulLast;				/* the last sample in */
+	unsigned long ulCount;
+	short sMin[ TSDB_FIELDS ];
+	short sMax[ TSDB_FIELDS ];
+	long lSum[ TSDB_FIELDS ];
+} xTsdbPoint;
+
+typedef struct xTSDB_WRITER
+{
+	unsigned char ucBlock[ TSDB_BLOCK_SIZE ];	/* image of the open block */
+	unsigned long ulPrev[ TSDB_MAX_SERIES ];	/* time of the last sample */
+	short sPrev[ TSDB_MAX_SERIES ][ TSDB_FIELDS ];
+} xTsdbWriter;
+
+typedef struct xTSDB_CURSOR
+{
+	const unsigned char *pucBlock;
+	unsigned short usPos;
+	unsigned short usEnd;
+	unsigned short usLeft;				/* samples of the series to come */
+	unsigned char ucSeries;
+	unsigned long ulTime;				/* of the sample read last */
+	short sValue[ TSDB_FIELDS ];
+} xTsdbCursor;
+
+/* Reads ulLength bytes at ulOffset of the file, returns 0 or -1 on error. */
+typedef int ( *pxTsdbReadFunction )( void *pvFile, unsigned long ulOffset, unsigned char *pucBuffer, unsigned long ulLength );
+/* Gets a sample or a bucket, returns nonzero to end the query. */
+typedef int ( *pxTsdbPointFunction )( void *pvArg, const xTsdbPoint *pxPoint );
+
+typedef struct xTSDB_QUERY
+{
+	unsigned char ucAddr;
+	unsigned long ulFrom;				/* first second in */
+	unsigned long ulTo;					/* first second out */
+	unsigned long ulStep;				/* bucket length, 0 for every sample */
+	unsigned long ulBlocks;				/* blocks in the file */
+	pxTsdbReadFunction pxRead;
+	void *pvFile;
+	pxTsdbPointFunction pxPoint;
+	void *pvArg;
+	unsigned char *pucBuffer;			/* TSDB_BLOCK_SIZE bytes */
+	/* Counted by lTsdbQuery(). */
+	unsigned long ulHeaders;			/* header reads of the search */
+	unsigned long ulDirectories;		/* blocks answered from the directory */
+	unsigned long ulDecoded;			/* blocks read whole and decoded */
+	unsigned long ulPoints;
+	xTsdbPoint xBucket;
+} xTsdbQuery;
+
+long lTsdbHeaderGet( const unsigned char *pucBlock, xTsdbHeader *pxHeader );
+long lTsdbBlockCheck( const unsigned char *pucBlock );
+long lTsdbSeriesGet( const unsigned char *pucBlock, unsigned char ucAddr, xTsdbPoint *pxSummary );
+
+void vTsdbWriterInit( xTsdbWriter *pxWriter, unsigned long ulSeq );
+long lTsdbWriterResume( xTsdbWriter *pxWriter, const unsigned char *pucBlock );
+long lTsdbAppend( xTsdbWriter *pxWriter, unsigned char ucAddr, unsigned long ulTime, const long *plValues );
+void vTsdbSeal( xTsdbWriter *pxWriter );
+
+long lTsdbCursorInit( xTsdbCursor *pxCursor, const unsigned char *pucBlock, unsigned char ucAddr );
+long lTsdbCursorNext( xTsdbCursor *pxCursor );
+
+long lTsdbQuery( xTsdbQuery *pxQuery );
+
+#endif /* TSDB_H */
@@ -816,6 +816,100 @@ RIT128x96x4ImageDraw(const unsigned char *pucImage, unsigned long ulX,
     }
 }
 
+//*****************************************************************************
+//
+//! Expands a font character into a 4-bit gray scale glyph.
+//!
+//! \param ch is the character to expand.
+//! \param ucLevel is the 4-bit gray scale value to be used for the glyph.
+//! \param pucGlyph is a pointer to a 24 byte buffer that receives the glyph.
+//!
+//! This function renders one 6x8 character cell into memory instead of the
+//! display, so that callers can keep their own frame buffer.  The glyph is
+//! stored row by row, three bytes (six columns) per row, in the same format
+//! used by RIT128x96x4ImageDraw().
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+RIT128x96x4GlyphGet(const char ch, unsigned char ucLevel,
+                    unsigned char *pucGlyph)
+{
+    unsigned long ulRow, ulCol;
+    unsigned char ucTemp;
+
+    ASSERT(ucLevel < 16);
+
+    ucTemp = ch & 0x7f;
+    if(ucTemp < ' ')
+    {
+        ucTemp = 0;
+    }
+    else
+    {
+        ucTemp -= ' ';
+    }
+
+    for(ulRow = 0; ulRow < 8; ulRow++)
+    {
+        for(ulCol = 0; ulCol < 6; ulCol += 2)
+        {
+            *pucGlyph = 0;
+            if(g_pucFont[ucTemp][ulCol] & (1 << ulRow))
+            {
+                *pucGlyph = (ucLevel << 4) & 0xf0;
+            }
+            if((ulCol < 4) &&
+               (g_pucFont[ucTemp][ulCol + 1] & (1 << ulRow)))
+            {
+                *pucGlyph |= (ucLevel << 0) & 0x0f;
+            }
+            pucGlyph++;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Writes full width rows of image data to the display RAM.
+//!
+//! \param pucImage is a pointer to the image data, 64 bytes per row.
+//! \param ulY is the first display RAM row to write.
+//! \param ulHeight is the number of rows to write.
+//!
+//! Unlike RIT128x96x4ImageDraw(), the rows are addressed in the 128 row
+//! display RAM rather than the 96 visible rows, so that the rows hidden by
+//! RIT128X96X4Scroll() can be updated as well.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+RIT128x96x4RowsDraw(const unsigned char *pucImage, unsigned long ulY,
+                    unsigned long ulHeight)
+{
+    ASSERT(ulY < 128);
+    ASSERT((ulY + ulHeight) <= 128);
+
+    g_pucBuffer[0] = 0x15;
+    g_pucBuffer[1] = 0;
+    g_pucBuffer[2] = 63;
+    RITWriteCommand(g_pucBuffer, 3);
+    g_pucBuffer[0] = 0x75;
+    g_pucBuffer[1] = ulY;
+    g_pucBuffer[2] = ulY + ulHeight - 1;
+    RITWriteCommand(g_pucBuffer, 3);
+    RITWriteCommand(g_pucRIT128x96x4HorizontalInc,
+                    sizeof(g_pucRIT128x96x4HorizontalInc));
+
+    while(ulHeight--)
+    {
+        RITWriteData(pucImage, 64);
+        pucImage += 64;
+    }
+}
+
 //*****************************************************************************
 //
 //! Enable the SSI component of the OLED display driver.
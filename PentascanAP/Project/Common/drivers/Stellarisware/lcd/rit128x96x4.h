@@ -45,6 +45,12 @@ extern void RIT128x96x4ImageDraw(const unsigned char *pucImage,
                                    unsigned long ulY,
                                    unsigned long ulWidth,
                                    unsigned long ulHeight);
+extern void RIT128x96x4GlyphGet(const char ch,
+                                unsigned char ucLevel,
+                                unsigned char *pucGlyph);
+extern void RIT128x96x4RowsDraw(const unsigned char *pucImage,
+                                unsigned long ulY,
+                                unsigned long ulHeight);
 extern void RIT128x96x4Init(unsigned long ulFrequency);
 extern void RIT128x96x4Enable(unsigned long ulFrequency);
 extern void RIT128x96x4Disable(void);
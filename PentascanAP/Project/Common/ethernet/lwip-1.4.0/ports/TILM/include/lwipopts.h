@@ -33,6 +33,57 @@
 #ifndef __LWIPOPTS_H__
 #define __LWIPOPTS_H__
 
+//*****************************************************************************
+//
+// ---------- Memory profiles ----------
+//
+//*****************************************************************************
+// TCP windows, send buffers and the receive pbuf pool are sized by one of
+// the profiles below, chosen with LWIP_MEM_PROFILE=... in the C defines of
+// the project, balanced without one.
+//   low memory     536 byte segments and a 4 segment window, the pools are
+//                  hard limits. Enough for the periodic reports, telnet and
+//                  the status page, leaves the heap to the file system.
+//   balanced       full segments and a 4 segment window both ways.
+//   bulk           an 8 segment receive window for wget and ota downloads.
+// The pools come from the heap (MEMP_MEM_MALLOC), "netstat" on the console
+// shows how much of each was in use at most, to size a profile from.
+#define LWIP_PROFILE_LOW_MEMORY         1
+#define LWIP_PROFILE_BALANCED           2
+#define LWIP_PROFILE_BULK               3
+
+#ifndef LWIP_MEM_PROFILE
+#define LWIP_MEM_PROFILE                LWIP_PROFILE_BALANCED
+#endif
+
+#if LWIP_MEM_PROFILE == LWIP_PROFILE_LOW_MEMORY
+#define LWIP_MEM_PROFILE_NAME           "low memory"
+#define TCP_MSS                         536
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_SND_BUF                     (4 * TCP_MSS)
+#define PBUF_POOL_SIZE                  16
+#define DEFAULT_TCP_RECVMBOX_SIZE       6
+#define MEMP_MEM_MALLOC_LIMIT           1
+#elif LWIP_MEM_PROFILE == LWIP_PROFILE_BALANCED
+#define LWIP_MEM_PROFILE_NAME           "balanced"
+#define TCP_MSS                         1460
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_SND_BUF                     (4 * TCP_MSS)
+#define PBUF_POOL_SIZE                  32
+#define DEFAULT_TCP_RECVMBOX_SIZE       10
+#define MEMP_MEM_MALLOC_LIMIT           0
+#elif LWIP_MEM_PROFILE == LWIP_PROFILE_BULK
+#define LWIP_MEM_PROFILE_NAME           "bulk"
+#define TCP_MSS                         1460
+#define TCP_WND                         (8 * TCP_MSS)
+#define TCP_SND_BUF                     (6 * TCP_MSS)
+#define PBUF_POOL_SIZE                  64
+#define DEFAULT_TCP_RECVMBOX_SIZE       16
+#define MEMP_MEM_MALLOC_LIMIT           0
+#else
+#error LWIP_MEM_PROFILE must be one of the LWIP_PROFILE_xxx values
+#endif
+
 //*****************************************************************************
 //
 // ---------- Stellaris / lwIP Port Options ----------
@@ -60,12 +111,13 @@
 //*****************************************************************************
 #define MEM_LIBC_MALLOC                 1
 #define MEM_ALIGNMENT                   4           // default is 1
-#define MEM_SIZE                        (8 * 1024)  // default is 1600
+// MEM_SIZE is not used with MEM_LIBC_MALLOC, everything comes from the heap
 //#define MEMP_OVERFLOW_CHECK             0
 //#define MEMP_SANITY_CHECK               0
 //#define MEM_USE_POOLS                   0
 //#define MEMP_USE_CUSTOM_POOLS           0
-#define MEMP_MEM_MALLOC             1
+#define MEMP_MEM_MALLOC                 1
+// MEMP_MEM_MALLOC_LIMIT is set by the memory profile
 //*****************************************************************************
 //
 // ---------- Internal Memory Pool Sizes ----------
@@ -73,8 +125,8 @@
 //*****************************************************************************
 //#define MEMP_NUM_PBUF                   16
 //#define MEMP_NUM_RAW_PCB                4
-//#define MEMP_NUM_UDP_PCB                4
-//#define MEMP_NUM_TCP_PCB                5
+#define MEMP_NUM_UDP_PCB                5       // default is 4, dhcp + dns + ntp + snmp
+#define MEMP_NUM_TCP_PCB                8       // default is 5, telnet + httpd + uploader
 //#define MEMP_NUM_TCP_PCB_LISTEN         8
 #define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
 //#define MEMP_NUM_REASSDATA              5
@@ -82,10 +134,10 @@
 //#define MEMP_NUM_IGMP_GROUP             8
 #define MEMP_NUM_SYS_TIMEOUT            15	// default is 3
 //#define MEMP_NUM_NETBUF                 2
-#define MEMP_NUM_NETCONN                8
+#define MEMP_NUM_NETCONN                10
 //#define MEMP_NUM_API_MSG                8
 //#define MEMP_NUM_TCPIP_MSG              8
-#define PBUF_POOL_SIZE                  32      // default is 16
+// PBUF_POOL_SIZE is set by the memory profile
 
 //*****************************************************************************
 //
@@ -165,11 +217,21 @@
 // ---------- SNMP options ----------
 //
 //*****************************************************************************
-//#define LWIP_SNMP                       0
-//#define SNMP_CONCURRENT_REQUESTS        1
-//#define SNMP_TRAP_DESTINATIONS          1
-//#define SNMP_PRIVATE_MIB                0
-//#define SNMP_SAFE_REQUESTS              1
+// The agent answers on UDP port 161, read only, to requests carrying the
+// SNMP_COMMUNITY string.  Set it for the site on the build command line,
+// e.g. -DSNMP_COMMUNITY="\"<community>\"", "public" is only the default.
+// MEMP_MEM_MALLOC is set, so the SNMP pools below are not preallocated, they
+// bound what the agent takes from the heap: one request at a time, and one
+// list node per row of the MIB-II tables and the private task table.
+#define LWIP_SNMP                       1           // default is 0
+#define SNMP_CONCURRENT_REQUESTS        1
+#define SNMP_TRAP_DESTINATIONS          1
+#define SNMP_PRIVATE_MIB                1           // default is 0, private_mib.c
+#define SNMP_SAFE_REQUESTS              1
+#define SNMP_MAX_OCTET_STRING_LEN       64          // default is 127
+#define PRIVATE_MIB_MAX_TASKS           16          // rows of the task table
+#define PRIVATE_MIB_SAMPLE_MSEC         5000        // cpu and sd rate interval
+#define MEMP_NUM_SNMP_NODE              (50 + PRIVATE_MIB_MAX_TASKS)
 
 //*****************************************************************************
 //
@@ -208,14 +270,13 @@
 //*****************************************************************************
 //#define LWIP_TCP                        1
 //#define TCP_TTL                         (IP_DEFAULT_TTL)
-#define TCP_WND                         4096        // default is 2048
+// TCP_WND is set by the memory profile
 //#define TCP_MAXRTX                      12
 //#define TCP_SYNMAXRTX                   6
 //#define TCP_QUEUE_OOSEQ                 1
-#define TCP_MSS                         1500        // default is 128
+// TCP_MSS is set by the memory profile
 //#define TCP_CALCULATE_EFF_SEND_MSS      1
-#define TCP_SND_BUF                     (6 * TCP_MSS)
-                                                    // default is 256
+// TCP_SND_BUF is set by the memory profile
 //#define TCP_SND_QUEUELEN                (4 * (TCP_SND_BUF/TCP_MSS))
 //#define TCP_SNDLOWAT                    (TCP_SND_BUF/2)
 #define TCP_LISTEN_BACKLOG              1
@@ -270,15 +331,15 @@
 //#define SLIPIF_THREAD_NAME             "slipif_loop"
 //#define SLIPIF_THREAD_STACKSIZE         0
 //#define SLIPIF_THREAD_PRIO              1
-//#define PPP_THREAD_NAME                "pppMain"
-//#define PPP_THREAD_STACKSIZE            0
-//#define PPP_THREAD_PRIO                 1
+#define PPP_THREAD_NAME                "ppp"
+#define PPP_THREAD_STACKSIZE            160
+#define PPP_THREAD_PRIO                 (tskIDLE_PRIORITY + 3)
 //#define DEFAULT_THREAD_NAME            "lwIP"
 //#define DEFAULT_THREAD_STACKSIZE        0
 //#define DEFAULT_THREAD_PRIO             1
 #define DEFAULT_RAW_RECVMBOX_SIZE       5
 #define DEFAULT_UDP_RECVMBOX_SIZE       5
-#define DEFAULT_TCP_RECVMBOX_SIZE       10
+// DEFAULT_TCP_RECVMBOX_SIZE is set by the memory profile
 #define DEFAULT_ACCEPTMBOX_SIZE         10
 
 //*****************************************************************************
@@ -307,7 +368,7 @@
 // ---------- Statistics options ----------
 //
 //*****************************************************************************
-//#define LWIP_STATS                      1
+#define LWIP_STATS                      1       // also read by the httpd status page
 //#define LWIP_STATS_DISPLAY              0
 //#define LINK_STATS                      1
 //#define ETHARP_STATS                    (LWIP_ARP)
@@ -318,7 +379,7 @@
 //#define UDP_STATS                       (LWIP_UDP)
 //#define TCP_STATS                       (LWIP_TCP)
 //#define MEM_STATS                       1
-//#define MEMP_STATS                      1
+#define MEMP_STATS                      1       // default is 0 with MEMP_MEM_MALLOC, for netstat
 //#define SYS_STATS                       1
 
 //*****************************************************************************
@@ -326,19 +387,20 @@
 // ---------- PPP options ----------
 //
 //*****************************************************************************
-//#define PPP_SUPPORT                     0
+// PPP over the modem on UART1, the fallback uplink of uplink.c
+#define PPP_SUPPORT                     1           // default is 0
 //#define PPPOE_SUPPORT                   0
-//#define PPPOS_SUPPORT                   PPP_SUPPORT
+#define PPPOS_SUPPORT                   PPP_SUPPORT
 
 #if PPP_SUPPORT
-//#define NUM_PPP                         1
-//#define PAP_SUPPORT                     0
-//#define CHAP_SUPPORT                    0
+#define NUM_PPP                         1
+#define PAP_SUPPORT                     1           // default is 0
+#define CHAP_SUPPORT                    1           // default is 0
 //#define MSCHAP_SUPPORT                  0
 //#define CBCP_SUPPORT                    0
 //#define CCP_SUPPORT                     0
 //#define VJ_SUPPORT                      0
-//#define MD5_SUPPORT                     0
+#define MD5_SUPPORT                     1           // default is 0, for chap
 //#define FSM_DEFTIMEOUT                  6
 //#define FSM_DEFMAXTERMREQS              2
 //#define FSM_DEFMAXCONFREQS              10
@@ -347,8 +409,8 @@
 //#define UPAP_DEFREQTIME                 30
 //#define CHAP_DEFTIMEOUT                 6
 //#define CHAP_DEFTRANSMITS               10
-//#define LCP_ECHOINTERVAL                0
-//#define LCP_MAXECHOFAILS                3
+#define LCP_ECHOINTERVAL                10          // default is 0, notice a dead modem
+#define LCP_MAXECHOFAILS                3
 //#define PPP_MAXIDLEFLAG                 100
 
 //#define PPP_MAXMTU                      1500
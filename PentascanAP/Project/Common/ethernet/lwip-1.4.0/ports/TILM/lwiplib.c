@@ -471,6 +471,8 @@ lwIPEthernetIntHandler(void)
     unsigned long ulStatus;
     portBASE_TYPE xWake;
 
+    traceISR_ENTER();
+
     //
     // Read and Clear the interrupt.
     //
@@ -496,6 +498,8 @@ lwIPEthernetIntHandler(void)
     //
     EthernetIntDisable(ETH_BASE, ETH_INT_PHY | ETH_INT_RX | ETH_INT_TX);
 
+    traceISR_EXIT();
+
     //
     // Potentially task switch as a result of the above queue write.
     //
@@ -574,6 +578,22 @@ int lwIPLinkStatusGet(void)
     return netif_is_link_up(&g_sNetIF);
 }
 
+//*****************************************************************************
+//
+//! Returns the lwIP network interface of the Ethernet controller.
+//!
+//! This is used to route traffic back to Ethernet when another interface has
+//! taken over the default route.
+//!
+//! eturn Returns a pointer to the Ethernet interface.
+//
+//*****************************************************************************
+struct netif *
+lwIPNetifGet(void)
+{
+    return(&g_sNetIF);
+}
+
 //*****************************************************************************
 //
 // Completes the network configuration change.  This is directly called when
@@ -88,6 +88,7 @@ extern unsigned long lwIPLocalNetMaskGet(void);
 extern unsigned long lwIPLocalGWAddrGet(void);
 extern void lwIPLocalMACGet(unsigned char *pucMac);
 int lwIPLinkStatusGet(void);
+struct netif *lwIPNetifGet(void);
 extern void lwIPNetworkConfigChange(unsigned long ulIPAddr,
                                     unsigned long ulNetMask,
                                     unsigned long ulGWAddr,
@@ -481,6 +481,12 @@ u32_t sys_now(void)
 	return xTaskGetTickCount();
 }
 
+/* ticks for ppp, which uses them to pace flags and seed its random numbers */
+u32_t sys_jiffies(void)
+{
+	return xTaskGetTickCount();
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  sys_thread_new
  *---------------------------------------------------------------------------*
@@ -131,7 +131,7 @@ const u16_t memp_sizes[MEMP_MAX] = {
 #include "lwip/memp_std.h"
 };
 
-#if !MEMP_MEM_MALLOC /* don't build if not configured for use in lwipopts.h */
+#if !MEMP_MEM_MALLOC || MEMP_STATS || MEMP_MEM_MALLOC_LIMIT
 
 /** This array holds the number of elements in each pool. */
 static const u16_t memp_num[MEMP_MAX] = {
@@ -139,6 +139,102 @@ static const u16_t memp_num[MEMP_MAX] = {
 #include "lwip/memp_std.h"
 };
 
+#endif /* !MEMP_MEM_MALLOC || MEMP_STATS || MEMP_MEM_MALLOC_LIMIT */
+
+#if MEMP_MEM_MALLOC && (MEMP_STATS || MEMP_MEM_MALLOC_LIMIT)
+
+#if MEMP_MEM_MALLOC_LIMIT
+/** Elements of each pool currently taken from the heap. */
+static u16_t memp_used[MEMP_MAX];
+#endif /* MEMP_MEM_MALLOC_LIMIT */
+
+/**
+ * Initialize the pool stats, the elements themselves come from the heap.
+ */
+void
+memp_init(void)
+{
+  u16_t i;
+
+  for (i = 0; i < MEMP_MAX; ++i) {
+    MEMP_STATS_AVAIL(used, i, 0);
+    MEMP_STATS_AVAIL(max, i, 0);
+    MEMP_STATS_AVAIL(err, i, 0);
+    MEMP_STATS_AVAIL(avail, i, memp_num[i]);
+  }
+}
+
+/**
+ * Get an element of a pool from the heap, counting it against the pool.
+ *
+ * @param type the pool to get an element from
+ *
+ * @return a pointer to the allocated memory or a NULL pointer on error
+ */
+void *
+memp_malloc(memp_t type)
+{
+  void *mem;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  LWIP_ERROR("memp_malloc: type < MEMP_MAX", (type < MEMP_MAX), return NULL;);
+
+#if MEMP_MEM_MALLOC_LIMIT
+  SYS_ARCH_PROTECT(old_level);
+  if (memp_used[type] >= memp_num[type]) {
+    MEMP_STATS_INC(err, type);
+    SYS_ARCH_UNPROTECT(old_level);
+    return NULL;
+  }
+  memp_used[type]++;
+  SYS_ARCH_UNPROTECT(old_level);
+#endif /* MEMP_MEM_MALLOC_LIMIT */
+
+  /* not under SYS_ARCH_PROTECT, the heap takes its own lock */
+  mem = mem_malloc(memp_sizes[type]);
+
+  SYS_ARCH_PROTECT(old_level);
+  if (mem != NULL) {
+    MEMP_STATS_INC_USED(used, type);
+  } else {
+    MEMP_STATS_INC(err, type);
+#if MEMP_MEM_MALLOC_LIMIT
+    memp_used[type]--;
+#endif /* MEMP_MEM_MALLOC_LIMIT */
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  return mem;
+}
+
+/**
+ * Return an element of a pool to the heap.
+ *
+ * @param type the pool where mem came from
+ * @param mem the memp element to free
+ */
+void
+memp_free(memp_t type, void *mem)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  if (mem == NULL) {
+    return;
+  }
+  mem_free(mem);
+
+  SYS_ARCH_PROTECT(old_level);
+  MEMP_STATS_DEC(used, type);
+#if MEMP_MEM_MALLOC_LIMIT
+  memp_used[type]--;
+#endif /* MEMP_MEM_MALLOC_LIMIT */
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+#endif /* MEMP_MEM_MALLOC && (MEMP_STATS || MEMP_MEM_MALLOC_LIMIT) */
+
+#if !MEMP_MEM_MALLOC /* don't build if not configured for use in lwipopts.h */
+
 /** This array holds a textual description of each pool. */
 #ifdef LWIP_DEBUG
 static const char *memp_desc[MEMP_MAX] = {
@@ -366,6 +366,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
           /* If the upper layer can't receive this data, store it */
           if (err != ERR_OK) {
+            TCP_STATS_INC(tcp_wnd.refused);
             pcb->refused_data = recv_data;
             LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: keep incoming packet, because pcb is \"full\"\n"));
           }
@@ -1269,6 +1270,9 @@ tcp_receive(struct tcp_pcb *pcb)
         /* Update the receiver's (our) window. */
         LWIP_ASSERT("tcp_receive: tcplen > rcv_wnd\n", pcb->rcv_wnd >= tcplen);
         pcb->rcv_wnd -= tcplen;
+        if (pcb->rcv_wnd == 0) {
+          TCP_STATS_INC(tcp_wnd.rcvfull);
+        }
 
         tcp_update_rcv_ann_wnd(pcb);
 
@@ -1247,6 +1247,7 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
 
   /* increment number of retransmissions */
   ++pcb->nrtx;
+  TCP_STATS_INC(tcp_wnd.rexmit);
 
   /* Don't take any RTT measurements after retransmitting. */
   pcb->rttest = 0;
@@ -1313,6 +1314,7 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  (u16_t)pcb->dupacks, pcb->lastack,
                  ntohl(pcb->unacked->tcphdr->seqno)));
     tcp_rexmit(pcb);
+    TCP_STATS_INC(tcp_wnd.fastrexmit);
 
     /* Set ssthresh to half of the minimum of the current
      * cwnd and the advertised window */
@@ -1415,6 +1417,8 @@ tcp_zero_window_probe(struct tcp_pcb *pcb)
                "   pcb->tmr %"U32_F" pcb->keep_cnt_sent %"U16_F"\n", 
                tcp_ticks, pcb->tmr, pcb->keep_cnt_sent));
 
+  TCP_STATS_INC(tcp_wnd.zwp);
+
   seg = pcb->unacked;
 
   if(seg == NULL) {
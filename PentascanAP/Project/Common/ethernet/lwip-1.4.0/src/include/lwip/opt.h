@@ -115,6 +115,15 @@
 #define MEMP_MEM_MALLOC                 0
 #endif
 
+/**
+* MEMP_MEM_MALLOC_LIMIT==1: With MEMP_MEM_MALLOC, still fail an allocation
+* once a pool has as many elements out as configured for it (MEMP_NUM_xxx,
+* PBUF_POOL_SIZE), so the pools cannot take more of the heap than that.
+*/
+#ifndef MEMP_MEM_MALLOC_LIMIT
+#define MEMP_MEM_MALLOC_LIMIT           0
+#endif
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> #define MEM_ALIGNMENT 4
@@ -744,6 +753,14 @@
 #define SNMP_SAFE_REQUESTS              1
 #endif
 
+/**
+ * SNMP_COMMUNITY: the community string requests must carry, and traps are
+ * sent with.
+ */
+#ifndef SNMP_COMMUNITY
+#define SNMP_COMMUNITY                  "public"
+#endif
+
 /**
  * The maximum length of strings used. This affects the size of
  * MEMP_SNMP_VALUE elements.
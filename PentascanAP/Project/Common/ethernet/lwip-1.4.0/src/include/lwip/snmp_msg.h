@@ -282,8 +282,8 @@ struct snmp_msg_trap
 
 /** Agent Version constant, 0 = v1 oddity */
 extern const s32_t snmp_version;
-/** Agent default "public" community string */
-extern const char snmp_publiccommunity[7];
+/** Agent community string, SNMP_COMMUNITY */
+extern const char snmp_community[];
 
 extern struct snmp_msg_trap trap_msg;
 
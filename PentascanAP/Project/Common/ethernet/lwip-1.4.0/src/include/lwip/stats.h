@@ -110,6 +110,15 @@ struct stats_sys {
   struct stats_syselem mbox;
 };
 
+/* TCP events that stall a connection, for sizing windows and buffers. */
+struct stats_tcp_wnd {
+  STAT_COUNTER rexmit;           /* Retransmission time-outs. */
+  STAT_COUNTER fastrexmit;       /* Fast retransmits after three dupacks. */
+  STAT_COUNTER zwp;              /* Zero window probes, the peer's window was closed. */
+  STAT_COUNTER rcvfull;          /* Our receive window filled up. */
+  STAT_COUNTER refused;          /* Data the application could not take yet. */
+};
+
 struct stats_ {
 #if LINK_STATS
   struct stats_proto link;
@@ -134,6 +143,7 @@ struct stats_ {
 #endif
 #if TCP_STATS
   struct stats_proto tcp;
+  struct stats_tcp_wnd tcp_wnd;
 #endif
 #if MEM_STATS
   struct stats_mem mem;
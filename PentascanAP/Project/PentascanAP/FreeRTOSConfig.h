@@ -100,12 +100,18 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_pcTaskGetTaskName			1
 
 /* stat setting */
 #define configGENERATE_RUN_TIME_STATS		1
-extern volatile unsigned long ulHighFrequencyTimerTicks;
+extern unsigned long RtcGetRunTimeCounter(void);
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
-#define portGET_RUN_TIME_COUNTER_VALUE()	ulHighFrequencyTimerTicks
+#define portGET_RUN_TIME_COUNTER_VALUE()	RtcGetRunTimeCounter()
+
+/* stop the tick and sleep while all tasks are blocked */
+#define configUSE_TICKLESS_IDLE				1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP	2
 
 #define configKERNEL_INTERRUPT_PRIORITY 		( 7 << 5 )	/* Priority 7, or 255 as only the top three bits are implemented.  This is the lowest priority. */
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY 	( 5 << 5 )  /* Priority 5, or 160 as only the top three bits are implemented. */
@@ -115,12 +121,16 @@ extern volatile unsigned long ulHighFrequencyTimerTicks;
 #define configTIMER_QUEUE_LENGTH		8
 #define configTIMER_TASK_STACK_DEPTH	( configMINIMAL_STACK_SIZE )
 
-extern void vParTestSetLED( unsigned long uxLED, signed long xValue );
-#define traceTASK_SWITCHED_IN() vParTestSetLED( 0, pdFALSE)
-#define traceTASK_SWITCHED_OUT() vParTestSetLED( 0, pdTRUE)
+/* command interpreter, room for help, the console commands and a few more */
+#define configCOMMAND_INT_MAX_COMMANDS		32
+#define configCOMMAND_INT_MAX_OUTPUT_SIZE	128
 
-#define traceQUEUE_CREATE_FAILED( ucQueueType ) fprintf(stderr,"Queue Create Fail %d : %s Line %d\n",ucQueueType,__FILE__,__LINE__)
-#define traceQUEUE_SEND_FAILED( pxQueue )       fprintf(stderr,"Queue Send Fail %p(%d,%d) : %s Line %d\n",pxQueue,pxQueue->ucQueueNumber,pxQueue->ucQueueType,__FILE__,__LINE__)
+/* kernel event trace recorder, see trace.h and the "trace" command */
+#define configUSE_TRACE_RECORDER		1
+#define configTRACE_RING_SIZE			256
+extern unsigned long RtcGetCycleCounter(void);
+#define configTRACE_TIMESTAMP()			RtcGetCycleCounter()
+#define configTRACE_TIMESTAMP_HZ		configCPU_CLOCK_HZ
 
 extern void UARTprint(char *message);
 #include <stdio.h>
@@ -31,6 +31,8 @@ FILE __uartin;
 FILE __zigbeeout;
 FILE __zigbeein;
 
+FILE __nullout;     /* output of background jobs whose session has closed */
+
 int fputc(int ch, FILE *f) {
     if(f == &__stdout){
         telnet_putchar_all(ch);
@@ -42,10 +44,25 @@ int fputc(int ch, FILE *f) {
         return (lcd_terminal_char(ch));
     }else if( f == &__uartout){
         return (console_putchar(ch));
+    }else if( f == &__nullout){
+        return ch;
     }else
         return telnet_putchar(f,ch);
 }
 
+/* write a block at once, telnet sessions send it as one segment */
+int fputblock(const char *buffer, int length, FILE *f) {
+    int i;
+    if(f == &__nullout)
+        return length;
+    if(f == &__stdout || f == &__stderr || f == &__lcdout || f == &__uartout){
+        for(i=0;i<length;i++)
+            fputc(buffer[i],f);
+        return length;
+    }else
+        return telnet_write(f,buffer,length);
+}
+
 int fgetc(FILE *f) {
 //  return (getkey());
     return (console_getchar());
@@ -1,6 +1,11 @@
+/* run time stat counter runs at the cpu clock >> RTC_RUN_TIME_SHIFT */
+#define RTC_RUN_TIME_SHIFT  12
+
 
 void RtcInit(void);
 unsigned long RtcGetTime(void);
+unsigned long RtcGetRunTimeCounter(void);
+unsigned long RtcGetCycleCounter(void);
 unsigned long RtcGetTick(void);
 void RtcSetTime(unsigned long new_time);
 unsigned long RtcConvertDateString(char *date_string);
@@ -7,6 +7,7 @@
 /* Scheduler includes. */
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 #include "Timers.h"
 
 /* Hardware library includes. */
@@ -22,11 +23,18 @@
 /* http client header */
 #include "ff.h"
 #include "httpc.h"
+#include "httpc_raw.h"
 #include "Rtc.h"
 #include "lcd_terminal.h"
 #include "telnet.h"
 #include "console.h"
 #include "log.h"
+#include "SensorManager.h"
+#include "httpd.h"
+#include "uplink.h"
+#include "health.h"
+#include "fileio.h"
+#include "history.h"
 
 static void StartNetwork(void)
 {
@@ -82,71 +90,200 @@ static void StartNetwork(void)
 
 extern FILE __lcdout;
 
+/* upload the periodic report with the raw API client instead of sockets */
+#define REPORT_RAW_CLIENT   1
+/* an upload taking longer than this freezes the kernel trace */
+#define REPORT_STALL_MSEC   5000
+/* the longest an upload may block the http task before the health monitor
+   resets, above the connect retries and the client time-outs */
+#define REPORT_HEALTH_MSEC  (180 * 1000UL)
+
+/* latest sensor readings, reported upstream and served by httpd */
+static sensor_node g_sensor[SENSOR_NODE_MAX] = {
+	{0xA0, 19 * 100, 41 * 100, 3600, 0, 0},
+	{0xA1, 20 * 100, 42 * 100, 3600, 0, 0},
+	{0xA2, 21 * 100, 43 * 100, 3600, 0, 0},
+	{0xA3, 22 * 100, 44 * 100, 3600, 0, 0},
+	{0xA4, 23 * 100, 45 * 100, 3600, 0, 0},
+	{0xA5, 24 * 100, 46 * 100, 3600, 0, 0},
+	{0xA6, 25 * 100, 47 * 100, 3600, 0, 0},
+	{0xA7, 26 * 100, 48 * 100, 3600, 0, 0},
+	{0xA8, 27 * 100, 49 * 100, 3600, 0, 0},
+	{0xA9, 28 * 100, 50 * 100, 3600, 0, 0}
+};
+
+static report_status g_report;
+#if configUSE_TIMERS
+/* given once per report period, the count is the report backlog */
+static xSemaphoreHandle xSemaphoreTimer = NULL;
+#endif
+
+int sensor_snapshot(sensor_node *node, int max)
+{
+    if(max > SENSOR_NODE_MAX)
+        max = SENSOR_NODE_MAX;
+
+    vTaskSuspendAll();
+    memcpy(node, g_sensor, max * sizeof(sensor_node));
+    xTaskResumeAll();
+    return max;
+}
+
+/* one node of the table, for callers without room for all of them */
+void sensor_read(int index, sensor_node *node)
+{
+    vTaskSuspendAll();
+    *node = g_sensor[index];
+    xTaskResumeAll();
+}
+
+void report_status_get(report_status *status)
+{
+    vTaskSuspendAll();
+    *status = g_report;
+    xTaskResumeAll();
+#if configUSE_TIMERS
+    if(xSemaphoreTimer)
+        status->backlog = uxQueueMessagesWaiting(xSemaphoreTimer);
+#endif
+}
+
+/*
+ * format the report request of sensor into rpt, returns its length. with
+ * last, only the sensors whose reading differs from last are put in.
+ */
+static int report_format(char *rpt, int size, const sensor_node *sensor, const sensor_node *last)
+{
+    int i, len;
+
+    len = snprintf(rpt, size, "/sensor/logging?id=%lu",RtcGetTime());
+    for(i=0;i<SENSOR_NODE_MAX && len < size;i++){
+        if(last && sensor[i].temp == last[i].temp && sensor[i].humidity == last[i].humidity
+           && sensor[i].co2 == last[i].co2 && sensor[i].sound == last[i].sound)
+            continue;
+        len += snprintf(rpt + len, size - len, "||00000000000000%02x|%d.%02d,%d.%02d,%d,%d,%d", sensor[i].addr,
+				sensor[i].temp/100,sensor[i].temp%100,
+				sensor[i].humidity/100,sensor[i].humidity%100,
+				sensor[i].co2,sensor[i].retry,sensor[i].sound);
+    }
+    return len;
+}
+
+/* build the report request of all sensors in rpt, returns its length */
+int report_build(char *rpt, int size)
+{
+    sensor_node sensor[SENSOR_NODE_MAX];
+
+    sensor_snapshot(sensor, SENSOR_NODE_MAX);
+    return report_format(rpt, size, sensor, NULL);
+}
+
+static void report_done(int status, unsigned long length, void *pv)
+{
+    /* called from the tcpip thread */
+    xSemaphoreGive((xSemaphoreHandle)pv);
+}
+
+static void report_full(void *pv)
+{
+    /* called from the tcpip thread, the response buffer is ready to save */
+    xSemaphoreGive((xSemaphoreHandle)pv);
+}
+
+#if REPORT_RAW_CLIENT
+/* the report is built here and sent by lwIP without copying */
+static http_raw_req g_upload;
+static xSemaphoreHandle xUploadDone = NULL;
+#endif
+
+/* readings of the report in flight, and of the last one answered with 200 */
+static sensor_node g_sending[SENSOR_NODE_MAX];
+static sensor_node g_sent[SENSOR_NODE_MAX];
+static int g_sent_valid;
+
 int report_measure(){
-    char *rpt;
-    char *node_string = mem_malloc(100);
     time_t timer;
     struct tm * timeinfo;
-    int i, ret;
+    int ret;
     static int count, success;
     FRESULT fresult;
-    FIL *FileObject = mem_malloc(sizeof(FIL));
-    char pcFilename[10];
+    char pcFilename[20];
     unsigned long tick_before,tick_after;
-    
-	struct {
-		unsigned char addr;
-		int temp;
-		int humidity;
-		int co2;
-		int retry;
-		int sound;
-	}sensor[10] = {
-		{0xA0, 19 * 100, 41 * 100, 3600, 0, 0},
-		{0xA1, 20 * 100, 42 * 100, 3600, 0, 0},
-		{0xA2, 21 * 100, 43 * 100, 3600, 0, 0},
-		{0xA3, 22 * 100, 44 * 100, 3600, 0, 0},
-		{0xA4, 23 * 100, 45 * 100, 3600, 0, 0},
-		{0xA5, 24 * 100, 46 * 100, 3600, 0, 0},
-		{0xA6, 25 * 100, 47 * 100, 3600, 0, 0},
-		{0xA7, 26 * 100, 48 * 100, 3600, 0, 0},
-		{0xA8, 27 * 100, 49 * 100, 3600, 0, 0},
-		{0xA9, 28 * 100, 50 * 100, 3600, 0, 0}
-	};
-			
-	
-	
-    rpt = mem_malloc(1024);
-    sprintf(rpt,"/sensor/logging?id=%lu",RtcGetTime());
-    for(i=0;i<10;i++){
-        sprintf(node_string,"||00000000000000%02x|%d.%02d,%d.%02d,%d,%d,%d", sensor[i].addr,
-				sensor[i].temp/100,sensor[i].temp%100,
-				sensor[i].humidity/100,sensor[i].humidity%100,
-				sensor[i].co2,sensor[i].retry,sensor[i].sound);
-        strcat(rpt,node_string);
-    }
+    const sensor_node *last;
+#if !REPORT_RAW_CLIENT
+    char *rpt;
+#endif
 
-    mem_free(node_string);
     timer=RtcGetTime();
     timeinfo = localtime(&timer);
     sprintf(pcFilename,"/response/%02d%02d%02d%02d",timeinfo->tm_mday,timeinfo->tm_hour,timeinfo->tm_min,timeinfo->tm_sec);
     count++;
-    fresult = f_open(FileObject, pcFilename, FA_WRITE | FA_CREATE_ALWAYS);
+    /* the response is queued to the file i/o service, the card does not
+       hold up the report */
+    fresult = fio_write(pcFilename, 0, "", 0, FIO_CREATE, NULL, NULL);
     tick_before = xTaskGetTickCount();
+    /* on the modem only what changed since the last good report is sent */
+    sensor_snapshot(g_sending, SENSOR_NODE_MAX);
+    last = uplink_is_slow() && g_sent_valid ? g_sent : NULL;
+#if REPORT_RAW_CLIENT
+    report_format(g_upload.location, sizeof(g_upload.location), g_sending, last);
+    g_upload.hostname = REPORT_HOST;
+    g_upload.port = REPORT_PORT;
+    g_upload.done = report_done;
+    g_upload.full = (fresult == FR_OK) ? report_full : NULL;
+    g_upload.pv = (void*)xUploadDone;
+    if(http_raw_get(&g_upload) == 0){
+        /* the body goes to the file a buffer at a time as it arrives, the
+           request is still busy after each buffer but the last */
+        for(;;){
+            xSemaphoreTake(xUploadDone, portMAX_DELAY);
+            if(fresult == FR_OK && g_upload.response_len)
+                fio_http(g_upload.response_len,g_upload.response,(void*)pcFilename);
+            if(!g_upload.busy)
+                break;
+            http_raw_resume(&g_upload);
+        }
+        ret = g_upload.status;
+        if(g_upload.date[0])
+            http_date_sync(g_upload.date);
+    }else
+        ret = -1;
+#else
+    rpt = mem_malloc(1024);
+    report_format(rpt, 1024, g_sending, last);
     if(fresult == FR_OK)
-        ret = http_get("pentascan.dyndns.org",2222,rpt,file_http,(void*)FileObject);
+        ret = http_get(REPORT_HOST,REPORT_PORT,rpt,fio_http,(void*)pcFilename);
     else
-        ret = http_get("pentascan.dyndns.org",2222,rpt,NULL,NULL);
+        ret = http_get(REPORT_HOST,REPORT_PORT,rpt,NULL,NULL);
+    mem_free(rpt);
+#endif
     tick_after = xTaskGetTickCount();
-    if(ret == 200)
+    if(ret == 200){
         success++;
-    if(fresult == FR_OK)
-        f_close(FileObject);
-    mem_free(FileObject);
-    mem_free(rpt);
+        memcpy(g_sent, g_sending, sizeof(g_sent));
+        g_sent_valid = 1;
+    }
+
+    vTaskSuspendAll();
+    g_report.count = count;
+    g_report.success = success;
+    g_report.result = ret;
+    g_report.time = timer;
+    g_report.elapsed = tick_after - tick_before;
+    if(g_report.elapsed > g_report.max_elapsed)
+        g_report.max_elapsed = g_report.elapsed;
+    xTaskResumeAll();
 
     syslog(LOG_LEVEL_INFO,"measure result = %d,(%d/%d), time elapsed %d msec",ret,success,count,tick_after - tick_before);
 
+#if ( configUSE_TRACE_RECORDER == 1 )
+    /* keep the kernel trace of a stalled upload for "trace dump" */
+    if(tick_after - tick_before > REPORT_STALL_MSEC / portTICK_RATE_MS && ulTraceCount()){
+        vTraceStop();
+        syslog(LOG_LEVEL_WARNING,"report stalled, kernel trace stopped");
+    }
+#endif
+
     fprintf(&__lcdout,"^a<%d/%d>`result ^f[%d]`\n",success,count,ret);
     timer=RtcGetTime();
     fprintf(&__lcdout,"^f%s`",asctime(localtime(&timer)) + 11);
@@ -154,11 +291,60 @@ int report_measure(){
 
 }
 
+/*
+ * one report upload for the benchmark, with the socket or the raw client.
+ * elapsed is in msec, cpu is the time in usec the cpu was not idle.
+ */
+int report_bench(int raw, unsigned long *elapsed, unsigned long *cpu)
+{
+    xTaskHandle idle = xTaskGetIdleTaskHandle();
+    xSemaphoreHandle done;
+    http_raw_req *req;
+    unsigned long tick, run, idle_run;
+    int ret = -1;
+
+    req = mem_malloc(sizeof(http_raw_req));
+    done = xSemaphoreCreateCounting(1, 0);
+    if(req == NULL || done == NULL){
+        if(req)
+            mem_free(req);
+        if(done)
+            vQueueDelete(done);
+        return ret;
+    }
+    report_build(req->location, sizeof(req->location));
+
+    tick = xTaskGetTickCount();
+    run = RtcGetRunTimeCounter();
+    idle_run = ulTaskGetRunTimeCounter(idle);
+
+    if(raw){
+        req->hostname = REPORT_HOST;
+        req->port = REPORT_PORT;
+        req->done = report_done;
+        req->full = NULL;
+        req->pv = (void*)done;
+        req->busy = 0;
+        if(http_raw_get(req) == 0){
+            xSemaphoreTake(done, portMAX_DELAY);
+            ret = req->status;
+        }
+    }else
+        ret = http_get(REPORT_HOST,REPORT_PORT,req->location,NULL,NULL);
+
+    run = RtcGetRunTimeCounter() - run;
+    idle_run = ulTaskGetRunTimeCounter(idle) - idle_run;
+    *elapsed = (xTaskGetTickCount() - tick) * portTICK_RATE_MS;
+    *cpu = (unsigned long)((unsigned long long)(run - idle_run) * (1UL << RTC_RUN_TIME_SHIFT) / (configCPU_CLOCK_HZ / 1000000));
+
+    vQueueDelete(done);
+    mem_free(req);
+    return ret;
+}
+
 
 #if configUSE_TIMERS
 // periodic timer
-static xSemaphoreHandle xSemaphoreTimer = NULL;
-
 static void TimerCallback( xTimerHandle pxExpiredTimer )
 {
 	xSemaphoreGive(xSemaphoreTimer);
@@ -167,6 +353,8 @@ static void TimerCallback( xTimerHandle pxExpiredTimer )
 void vTimerTask( void *pvParameters )
 {
     static xTimerHandle xPeriodicTimer = NULL;
+    int periods = 0;
+    int health;
 
 	// Semaphore cannot be used before a call to xSemaphoreCreateCounting().
 	// The max value to which the semaphore can count should be 10, and the
@@ -178,6 +366,14 @@ void vTimerTask( void *pvParameters )
 		printf("#### Fail to create semaphore\n");
 		return;
 	}
+#if REPORT_RAW_CLIENT
+	xUploadDone = xSemaphoreCreateCounting( 1, 0 );
+	if( xUploadDone == NULL )
+	{
+		printf("#### Fail to create semaphore\n");
+		return;
+	}
+#endif
 
     xPeriodicTimer = xTimerCreate(  ( const signed char * ) "http timer",/* Text name to facilitate debugging.  The kernel does not use this itself. */
                                     ( 60 * configTICK_RATE_HZ ),            /* The period for the timer. */
@@ -188,10 +384,18 @@ void vTimerTask( void *pvParameters )
     xTimerStart(xPeriodicTimer,0);
         
     syslog(LOG_LEVEL_INFO,"Starting periodic Http loop");
+    health = health_register("http", REPORT_HEALTH_MSEC);
     for( ;; )
     {
+        health_checkin(health);
         /* wait 100msec */
         if(xSemaphoreTake( xSemaphoreTimer, 100 * portTICK_RATE_MS ) == pdTRUE){
+            /* the history keeps every period, also when the report is skipped */
+            history_sample();
+            /* on the modem report only every REPORT_SLOW_PERIODS periods */
+            if(uplink_is_slow() && ++periods < REPORT_SLOW_PERIODS)
+                continue;
+            periods = 0;
             report_measure();
         }
     }
@@ -205,21 +409,26 @@ void vMainTask( void *pvParameters )
     extern FILE __uartout;
 
     int c;
-	line_buffer *cmd_buffer = console_buffer_get(CMD_BUFFER_LEN);
+	line_buffer *cmd_buffer = console_buffer_get(CMD_BUFFER_LEN, &__uartout);
 	int cmd_index = 0;
 
 	if(cmd_buffer == NULL){
 		printf("cmd_buffer malloc fail\n");
 		return;
 	}
-	cmd_buffer->file = &__uartout;
 
 //    syslog(LOG_LEVEL_INFO,"Starting Network");
     StartNetwork();
+    uplink_start();
     if(mountSd())
         syslog(LOG_LEVEL_WARNING,"SD card not available");
+    /* reports why the last reset happened, so after the card is up */
+    health_start();
+    history_start();
+    console_register();
     syslog(LOG_LEVEL_INFO,"Starting Telnet");
     telnet_start(23);
+    httpd_start(80);
     
     fprintf(&__lcdout,"Pentascan AP\n");
     /* start http timer */
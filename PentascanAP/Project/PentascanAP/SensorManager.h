@@ -0,0 +1,33 @@
+#define SENSOR_NODE_MAX     10
+
+/* server the sensor readings are reported to */
+#define REPORT_HOST         "pentascan.dyndns.org"
+#define REPORT_PORT         2222
+/* while the uplink is the modem, one report per this many periods */
+#define REPORT_SLOW_PERIODS 5
+
+typedef struct {
+	unsigned char addr;
+	int temp;           /* 1/100 degree */
+	int humidity;       /* 1/100 % */
+	int co2;
+	int retry;
+	int sound;
+}sensor_node;
+
+typedef struct {
+	int count;                  /* reports sent */
+	int success;                /* reports answered with 200 */
+	int result;                 /* http result of the last report */
+	unsigned long time;         /* rtc time of the last report */
+	unsigned long elapsed;      /* duration of the last report in msec */
+	unsigned long max_elapsed;  /* longest report so far in msec */
+	int backlog;                /* periodic reports waiting to be sent */
+}report_status;
+
+int sensor_snapshot(sensor_node *node, int max);
+void sensor_read(int index, sensor_node *node);
+void report_status_get(report_status *status);
+int report_build(char *rpt, int size);
+int report_bench(int raw, unsigned long *elapsed, unsigned long *cpu);
+
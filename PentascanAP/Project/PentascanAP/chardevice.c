@@ -62,6 +62,8 @@ static void charIntHandler(char_device *dev)
     unsigned long ulStatus;
     unsigned char ucData;
 
+    traceISR_ENTER();
+
     //
     // Get the interrrupt status.
     //
@@ -81,6 +83,7 @@ static void charIntHandler(char_device *dev)
         if(xQueueReceiveFromISR(dev->TxQueue, &ucData, &xHigherPriorityTaskWoken))
             UARTCharPut(dev->PortBase, ucData);
     }
+    traceISR_EXIT();
 	portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
 }
 
@@ -202,3 +205,80 @@ int console_puterr(char ch)
     return ch;
 }
 
+
+//////////////////////////////////////////////
+//  UART1 : modem for the PPP uplink
+//////////////////////////////////////////////
+char_device charModem;
+
+static void modem_isr(void)
+{
+    charIntHandler(&charModem);
+}
+
+int modem_init(unsigned long baud)
+{
+    int result;
+
+    /* a ppp frame is up to 2 * mru bytes escaped, keep a few of them */
+    charModem.TxQueueLength = 64;
+    charModem.RxQueueLength = 512;
+    charModem.QueueWait = 100 * portTICK_RATE_MS;
+    charModem.PortBase = UART1_BASE;
+
+    result = prepare_device(&charModem);
+    if(result){
+        printf("Modem queue creation fail\n");
+        return result;
+    }
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UART1);
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+    GPIOPinTypeUART(GPIO_PORTD_BASE, GPIO_PIN_2 | GPIO_PIN_3);
+
+    UARTConfigSetExpClk(UART1_BASE, SysCtlClockGet(), baud,
+                        (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
+                         UART_CONFIG_PAR_NONE));
+
+    IntRegister(INT_UART1, modem_isr);
+
+    UARTIntDisable(UART1_BASE, 0xFFFFFFFF);
+    IntPrioritySet(INT_UART1,configKERNEL_INTERRUPT_PRIORITY);
+    IntEnable(INT_UART1);
+    UARTEnable(UART1_BASE);
+    UARTFIFODisable(UART1_BASE);
+    UARTIntEnable(UART1_BASE, UART_INT_TX | UART_INT_RX);
+
+    return result;
+}
+
+/* wait up to wait ticks for the first byte, then take what is already queued */
+int modem_read(char *buf, int len, unsigned long wait)
+{
+    int count = 0;
+
+    if(len > 0 && xQueueReceive(charModem.RxQueue, &buf[0], wait)){
+        count++;
+        while(count < len && xQueueReceive(charModem.RxQueue, &buf[count], 0))
+            count++;
+    }
+    return count;
+}
+
+/* returns the number of bytes queued, less when the modem stops taking them */
+int modem_write(const char *buf, int len)
+{
+    int count;
+    char ch;
+
+    for(count=0;count<len;count++){
+        if(xQueueSend(charModem.TxQueue, &buf[count], charModem.QueueWait) != pdPASS)
+            break;
+        /* kick the transmitter when it is idle, the tx interrupt does the rest */
+        taskENTER_CRITICAL();
+        if(UARTSpaceAvail(charModem.PortBase) && xQueueReceive(charModem.TxQueue, &ch, 0))
+            UARTCharPut(charModem.PortBase, ch);
+        taskEXIT_CRITICAL();
+    }
+    return count;
+}
@@ -7,3 +7,6 @@ int console_getchar(void);
 int console_putchar(char ch);
 int console_puterr(char ch);
 
+int modem_init(unsigned long baud);
+int modem_read(char *buf, int len, unsigned long wait);
+int modem_write(const char *buf, int len);
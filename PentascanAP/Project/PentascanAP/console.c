@@ -13,65 +13,83 @@
 
 /* lwip library */
 #include "lwiplib.h"
+#include "lwip/stats.h"
 #include "console.h"
 /* http client header */
 #include "ff.h"
+#include "diskio.h"
 #include "httpc.h"
 #include "ntp.h"
 #include "Rtc.h"
 #include "lcd_terminal.h"
 #include "telnet.h"
+#include "SensorManager.h"
+#include "ota.h"
+#include "logzip.h"
+#include "health.h"
+#include "fileio.h"
+#include "history.h"
+#include "log.h"
 
 
 //*****************************************************************************
 //
-// Defines the size of the buffers that hold the path, or temporary
-// data from the SD card.  There are two buffers allocated of this size.
-// The buffer size must be large enough to hold the longest expected
-// full path name, including the file name, and a trailing null character.
+// Defines the size of the buffer that holds a single command argument, such
+// as an URL.  It matches the longest command line accepted by the sessions.
 //
 //*****************************************************************************
-#define PATH_BUF_SIZE   80
+#define ARG_BUF_SIZE    100
 
 //*****************************************************************************
 //
-// Defines the size of the buffer that holds the command line.
+// Stack size and priority of the tasks running background commands ("&").
 //
 //*****************************************************************************
-#define CMD_BUF_SIZE    64
+#define JOB_STACK_SIZE  256
+#define JOB_PRIORITY    ( tskIDLE_PRIORITY + 1 )
 
 //*****************************************************************************
 //
-// This buffer holds the full path to the current working directory.
-// Initially it is root ("/").
+// Bytes of the trace snapshot printed per line by "trace dump" on the console.
+// Two hex digits each, so a line fits in the output buffer.
 //
 //*****************************************************************************
-static char g_cCwdBuf[PATH_BUF_SIZE] = "/";
+#define TRACE_LINE_BYTES    32
 
 //*****************************************************************************
 //
-// A temporary data buffer used when manipulating file paths, or reading data
-// from the SD card.
+// Buffer for vTaskList() and vTaskGetRunTimeStats(), which write a line per
+// task with no bound.  A line is the name and at most 40 more characters, two
+// spare lines cover tasks created while the buffer is allocated.
 //
 //*****************************************************************************
-static char g_cTmpBuf[PATH_BUF_SIZE];
+#define TASK_LIST_SIZE      ((uxTaskGetNumberOfTasks() + 2) * (configMAX_TASK_NAME_LEN + 40) + 1)
 
 //*****************************************************************************
 //
-// The buffer that holds the command line.
+// The following are data structures used by FatFs.  File and directory
+// objects live in the console session, see console_context.
 //
 //*****************************************************************************
-static char g_cCmdBuf[CMD_BUF_SIZE];
+static FATFS g_sFatFs;
 
 //*****************************************************************************
 //
-// The following are data structures used by FatFs.
+// A command started with a trailing "&".  It runs in its own task with a
+// copy of the session it was started from.  Jobs are kept in a list so they
+// can be detached from a telnet session that closes before they finish.
 //
 //*****************************************************************************
-static FATFS g_sFatFs;
-static DIR g_sDirObject;
-static FILINFO g_sFileInfo;
-static FIL g_sFileObject;
+typedef struct console_job_s{
+    struct console_job_s *next;
+    int detached;                   /* session closed, output is dropped */
+    console_context ctx;
+    char cmd[1];
+}console_job;
+
+static console_job *g_jobs;
+
+extern FILE __nullout;
 
 int mountSd(void)
 {
@@ -85,9 +103,7 @@ int mountSd(void)
 void print_http(unsigned long size,char *content,void *pv)
 {
     FILE *file = (FILE *)pv;
-	unsigned long i;
-	for(i=0;i<size;i++)
-		fputc(content[i],file);
+    fputblock(content, size, file);
 }
 
 void file_http(unsigned long size,char *content,void *pv)
@@ -100,59 +116,90 @@ void file_http(unsigned long size,char *content,void *pv)
 		&usBytesWritten);
 }
 
+/* pv is the path, the data is queued to the file i/o service */
+void fio_http(unsigned long size,char *content,void *pv)
+{
+    fio_append((const char *)pv, content, size, NULL, NULL);
+}
 
 //*****************************************************************************
 //
-// This function implements the "ls" command.  It opens the current
-// directory and enumerates through the contents, and prints a line for
-// each item it finds.  It shows details such as file attributes, time and
-// date, and the file size, along with the name.  It shows a summary of
-// file sizes at the end along with free space.
+// Copies the n'th word of the command line into buffer as a null terminated
+// string.  Returns NULL if the argument is not given.
 //
 //*****************************************************************************
-static int Cmd_ls(FILE *file,char *path)
+static char *console_arg(const signed char *pcCommandString,
+                         unsigned portBASE_TYPE n, char *buffer, int size)
 {
-    unsigned long ulTotalSize;
-    unsigned long ulFileCount;
-    unsigned long ulDirCount;
-    unsigned int uIdx;
-    FRESULT fresult;
-    FATFS *pFatFs;
+    const signed char *pcParam;
+    portBASE_TYPE xLength;
+
+    pcParam = pcCmdIntGetParameter(pcCommandString, n, &xLength);
+    if(pcParam == NULL)
+        return NULL;
+
+    if(xLength > size - 1)
+        xLength = size - 1;
+    memcpy(buffer, pcParam, xLength);
+    buffer[xLength] = 0;
+    return buffer;
+}
+
+//*****************************************************************************
+//
+// Returns the rest of the command line starting at the n'th word, or NULL
+// if there are not that many words.
+//
+//*****************************************************************************
+static const char *console_rest(const signed char *pcCommandString,
+                                unsigned portBASE_TYPE n)
+{
+    portBASE_TYPE xLength;
 
+    return (const char *)pcCmdIntGetParameter(pcCommandString, n, &xLength);
+}
 
+//*****************************************************************************
+//
+// Builds the full path of path into the session's temporary buffer.  The
+// argument can be one of the following:
+// * nothing (NULL), which gives the current working directory
+// * a fully specified path ("/my/path/to/mydir")
+// * a single name that is in the current directory ("mydir")
+// * parent directory ("..")
+//
+// It does not understand relative paths, so dont try something like this:
+// ("../my/new/path")
+//
+// Returns non zero if the resulting path would not fit in the buffer.
+//
+//*****************************************************************************
+static int console_path(console_context *ctx, const char *path)
+{
+    unsigned int uIdx;
 
     //
     // Copy the current working path into a temporary buffer so
     // it can be manipulated.
     //
-    strcpy(g_cTmpBuf, g_cCwdBuf);
+    strcpy(ctx->tmp, ctx->cwd);
+
+    if(path == NULL)
+    {
+        return(0);
+    }
 
     //
     // If the first character is /, then this is a fully specified
     // path, and it should just be used as-is.
     //
-    if(path == 0){
-		//fprintf(file,"current directory\n");
-    }
-    else if(path[0] == '/')
+    if(path[0] == '/')
     {
-        //
-        // Make sure the new path is not bigger than the cwd buffer.
-        //
-        if(strlen(path) + 1 > sizeof(g_cCwdBuf))
-        {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
-        }
-
-        //
-        // If the new path name (in argv[1])  is not too long, then
-        // copy it into the temporary buffer so it can be checked.
-        //
-        else
+        if(strlen(path) + 1 > sizeof(ctx->tmp))
         {
-            strncpy(g_cTmpBuf, path, sizeof(g_cTmpBuf));
+            return(-1);
         }
+        strcpy(ctx->tmp, path);
     }
 
     //
@@ -161,20 +208,13 @@ static int Cmd_ls(FILE *file,char *path)
     //
     else if(!strcmp(path, ".."))
     {
-        //
-        // Get the index to the last character in the current path.
-        //
-        uIdx = strlen(g_cTmpBuf) - 1;
-
         //
         // Back up from the end of the path name until a separator (/)
         // is found, or until we bump up to the start of the path.
         //
-        while((g_cTmpBuf[uIdx] != '/') && (uIdx > 1))
+        uIdx = strlen(ctx->tmp) - 1;
+        while((ctx->tmp[uIdx] != '/') && (uIdx > 1))
         {
-            //
-            // Back up one character.
-            //
             uIdx--;
         }
 
@@ -184,890 +224,1247 @@ static int Cmd_ls(FILE *file,char *path)
         // So set the new end of string here, effectively removing
         // that last part of the path.
         //
-        g_cTmpBuf[uIdx] = 0;
+        ctx->tmp[uIdx] = 0;
     }
 
     //
     // Otherwise this is just a normal path name from the current
     // directory, and it needs to be appended to the current path.
+    // There must be room for a new separator and a trailing null.
     //
     else
     {
-        //
-        // Test to make sure that when the new additional path is
-        // added on to the current path, there is room in the buffer
-        // for the full new path.  It needs to include a new separator,
-        // and a trailing null character.
-        //
-        if(strlen(g_cTmpBuf) + strlen(path) + 1 + 1 > sizeof(g_cCwdBuf))
+        if(strlen(ctx->tmp) + strlen(path) + 1 + 1 > sizeof(ctx->tmp))
         {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
+            return(-1);
         }
 
         //
-        // The new path is okay, so add the separator and then append
-        // the new directory to the path.
+        // If not already at the root level, then append a /
         //
-        else
+        if(strcmp(ctx->tmp, "/"))
         {
-            //
-            // If not already at the root level, then append a /
-            //
-            if(strcmp(g_cTmpBuf, "/"))
-            {
-                strcat(g_cTmpBuf, "/");
-            }
-
-            //
-            // Append the new directory to the path.
-            //
-            strcat(g_cTmpBuf, path);
+            strcat(ctx->tmp, "/");
         }
-    }    
+        strcat(ctx->tmp, path);
+    }
 
-	//
-    // Open the current directory for access.
-    //
-    fresult = f_opendir(&g_sDirObject, g_cTmpBuf);
+    return(0);
+}
 
-    //
-    // Check for error and return if there is a problem.
-    //
-    if(fresult != FR_OK)
-    {
-        fprintf(file,"open error\n");
-        return(fresult);
-    }
+//*****************************************************************************
+//
+// Sends the next part of the heap string ctx->stream, as much as fits in
+// the output buffer.  The string is freed once it has been sent completely.
+//
+//*****************************************************************************
+static portBASE_TYPE console_stream(console_context *ctx, char *pcOut,
+                                    size_t xLength)
+{
+    size_t xCount = strlen(ctx->stream + ctx->stream_pos);
 
-    ulTotalSize = 0;
-    ulFileCount = 0;
-    ulDirCount = 0;
+    if(xCount > xLength - 1)
+        xCount = xLength - 1;
+    memcpy(pcOut, ctx->stream + ctx->stream_pos, xCount);
+    pcOut[xCount] = 0;
+    ctx->stream_pos += xCount;
 
-    //
-    // Give an extra blank line before the listing.
-    //
-    fprintf(file,"\n");
+    if(ctx->stream[ctx->stream_pos])
+        return pdTRUE;
 
-    //
-    // Enter loop to enumerate through all directory entries.
-    //
-    for(;;)
-    {
-        //
-        // Read an entry from the directory.
-        //
-        fresult = f_readdir(&g_sDirObject, &g_sFileInfo);
+    mem_free(ctx->stream);
+    ctx->stream = NULL;
+    return pdFALSE;
+}
 
-        //
-        // Check for error and return if there is a problem.
-        //
-        if(fresult != FR_OK)
-        {
-            return(fresult);
-        }
+//*****************************************************************************
+//
+// This function implements the "ls" command.  It opens the current
+// directory and enumerates through the contents, and prints a line for
+// each item it finds.  It shows details such as file attributes, time and
+// date, and the file size, along with the name.  It shows a summary of
+// file sizes at the end along with free space.
+//
+// One directory entry is returned per call, so the listing of a large
+// directory streams out through the session's output buffer.
+//
+//*****************************************************************************
+static portBASE_TYPE Cmd_ls(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                            size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char path[PATH_BUF_SIZE];
+    unsigned long ulFree;
+    FRESULT fresult;
+    FATFS *pFatFs;
 
-        //
-        // If the file name is blank, then this is the end of the
-        // listing.
-        //
-        if(!g_sFileInfo.fname[0])
+    if(pxState->uxCallCount == 0)
+    {
+        if(console_path(ctx, console_arg(pcCommandString, 1, path, sizeof(path))))
         {
-            break;
+            snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+            return pdFALSE;
         }
 
         //
-        // If the attribue is directory, then increment the directory count.
+        // Open the directory for access.
         //
-        if(g_sFileInfo.fattrib & AM_DIR)
+        fresult = f_opendir(&ctx->dir_object, ctx->tmp);
+        if(fresult != FR_OK)
         {
-            ulDirCount++;
+            snprintf(pcOut, xWriteBufferLen, "open error\n");
+            return pdFALSE;
         }
 
-        //
-        // Otherwise, it is a file.  Increment the file count, and
-        // add in the file size to the total.
-        //
-        else
-        {
-            ulFileCount++;
-            ulTotalSize += g_sFileInfo.fsize;
-        }
+        ctx->total_size = 0;
+        ctx->file_count = 0;
+        ctx->dir_count = 0;
 
         //
-        // Print the entry information on a single line with formatting
-        // to show the attributes, date, time, size, and name.
+        // Give an extra blank line before the listing.
         //
-        fprintf(file,"%c%c%c%c%c %u/%02u/%02u %02u:%02u %9u  %s\n",
-                    (g_sFileInfo.fattrib & AM_DIR) ? 'D' : '-',
-                    (g_sFileInfo.fattrib & AM_RDO) ? 'R' : '-',
-                    (g_sFileInfo.fattrib & AM_HID) ? 'H' : '-',
-                    (g_sFileInfo.fattrib & AM_SYS) ? 'S' : '-',
-                    (g_sFileInfo.fattrib & AM_ARC) ? 'A' : '-',
-                    (g_sFileInfo.fdate >> 9) + 1980,
-                    (g_sFileInfo.fdate >> 5) & 15,
-                     g_sFileInfo.fdate & 31,
-                    (g_sFileInfo.ftime >> 11),
-                    (g_sFileInfo.ftime >> 5) & 63,
-                     g_sFileInfo.fsize,
-                     g_sFileInfo.fname);
-    }   // endfor
-
-    //
-    // Print summary lines showing the file, dir, and size totals.
-    //
-    fprintf(file,"\n%4u File(s),%10u bytes total\n%4u Dir(s)",
-                ulFileCount, ulTotalSize, ulDirCount);
-
-    //
-    // Get the free space.
-    //
-    fresult = f_getfree("/", &ulTotalSize, &pFatFs);
+        snprintf(pcOut, xWriteBufferLen, "\n");
+        return pdTRUE;
+    }
 
     //
-    // Check for error and return if there is a problem.
+    // Read an entry from the directory.
     //
+    ctx->file_info.lfname = ctx->lfn;
+    ctx->file_info.lfsize = sizeof(ctx->lfn);
+    fresult = f_readdir(&ctx->dir_object, &ctx->file_info);
     if(fresult != FR_OK)
     {
-        return(fresult);
+        pcOut[0] = 0;
+        return pdFALSE;
     }
 
     //
-    // Display the amount of free space that was calculated.
+    // If the file name is not blank, print the entry information on a
+    // single line with formatting to show the attributes, date, time, size,
+    // and name.
     //
-    fprintf(file,", %10uK bytes free\n", ulTotalSize * pFatFs->csize / 2);
+    if(ctx->file_info.fname[0])
+    {
+        if(ctx->file_info.fattrib & AM_DIR)
+        {
+            ctx->dir_count++;
+        }
+        else
+        {
+            ctx->file_count++;
+            ctx->total_size += ctx->file_info.fsize;
+        }
+
+        snprintf(pcOut, xWriteBufferLen, "%c%c%c%c%c %u/%02u/%02u %02u:%02u %9u  %s\n",
+                    (ctx->file_info.fattrib & AM_DIR) ? 'D' : '-',
+                    (ctx->file_info.fattrib & AM_RDO) ? 'R' : '-',
+                    (ctx->file_info.fattrib & AM_HID) ? 'H' : '-',
+                    (ctx->file_info.fattrib & AM_SYS) ? 'S' : '-',
+                    (ctx->file_info.fattrib & AM_ARC) ? 'A' : '-',
+                    (ctx->file_info.fdate >> 9) + 1980,
+                    (ctx->file_info.fdate >> 5) & 15,
+                     ctx->file_info.fdate & 31,
+                    (ctx->file_info.ftime >> 11),
+                    (ctx->file_info.ftime >> 5) & 63,
+                     ctx->file_info.fsize,
+                     ctx->lfn[0] ? ctx->lfn : ctx->file_info.fname);
+        return pdTRUE;
+    }
 
     //
-    // Made it to here, return with no errors.
+    // End of the listing, print summary lines showing the file, dir, and
+    // size totals along with the free space.
     //
-    return(0);
+    fresult = f_getfree("/", &ulFree, &pFatFs);
+    if(fresult != FR_OK)
+    {
+        snprintf(pcOut, xWriteBufferLen, "\n%4u File(s),%10u bytes total\n%4u Dir(s)\n",
+                    ctx->file_count, ctx->total_size, ctx->dir_count);
+    }
+    else
+    {
+        snprintf(pcOut, xWriteBufferLen, "\n%4u File(s),%10u bytes total\n%4u Dir(s), %10uK bytes free\n",
+                    ctx->file_count, ctx->total_size, ctx->dir_count,
+                    ulFree * pFatFs->csize / 2);
+    }
+    return pdFALSE;
 }
 
 //*****************************************************************************
 //
 // This function implements the "cd" command.  It takes an argument
 // that specifes the directory to make the current working directory.
-// Path separators must use a forward slash "/".  The argument to cd
-// can be one of the following:
-// * root ("/")
-// * a fully specified path ("/my/path/to/mydir")
-// * a single directory name that is in the current directory ("mydir")
-// * parent directory ("..")
-//
-// It does not understand relative paths, so dont try something like this:
-// ("../my/new/path")
+// Path separators must use a forward slash "/".  See console_path() for
+// the accepted forms of the argument.
 //
 // Once the new directory is specified, it attempts to open the directory
 // to make sure it exists.  If the new path is opened successfully, then
-// the current working directory (cwd) is changed to the new path.
+// the current working directory (cwd) of the session is changed to the
+// new path.
 //
 //*****************************************************************************
-static int Cmd_cd(FILE *file,char *path)
+static portBASE_TYPE Cmd_cd(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                            size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    unsigned int uIdx;
-    FRESULT fresult;
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char path[PATH_BUF_SIZE];
 
-    //
-    // Copy the current working path into a temporary buffer so
-    // it can be manipulated.
-    //
-    strcpy(g_cTmpBuf, g_cCwdBuf);
+    pcOut[0] = 0;
 
-    //
-    // If the first character is /, then this is a fully specified
-    // path, and it should just be used as-is.
-    //
-    if(path[0] == '/')
+    if(console_arg(pcCommandString, 1, path, sizeof(path)) == NULL)
     {
-        //
-        // Make sure the new path is not bigger than the cwd buffer.
-        //
-        if(strlen(path) + 1 > sizeof(g_cCwdBuf))
-        {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
-        }
+        return pdFALSE;
+    }
 
-        //
-        // If the new path name (in argv[1])  is not too long, then
-        // copy it into the temporary buffer so it can be checked.
-        //
-        else
-        {
-            strncpy(g_cTmpBuf, path, sizeof(g_cTmpBuf));
-        }
+    if(console_path(ctx, path))
+    {
+        snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+        return pdFALSE;
     }
 
     //
-    // If the argument is .. then attempt to remove the lowest level
-    // on the CWD.
+    // At this point, a candidate new directory path is in the temporary
+    // buffer.  Try to open it to make sure it is valid.
     //
-    else if(!strcmp(path, ".."))
+    if(f_opendir(&ctx->dir_object, ctx->tmp) != FR_OK)
     {
-        //
-        // Get the index to the last character in the current path.
-        //
-        uIdx = strlen(g_cTmpBuf) - 1;
+        snprintf(pcOut, xWriteBufferLen, "cd: %s\n", ctx->tmp);
+    }
+    else
+    {
+        strcpy(ctx->cwd, ctx->tmp);
+    }
+    return pdFALSE;
+}
 
-        //
-        // Back up from the end of the path name until a separator (/)
-        // is found, or until we bump up to the start of the path.
-        //
-        while((g_cTmpBuf[uIdx] != '/') && (uIdx > 1))
-        {
-            //
-            // Back up one character.
-            //
-            uIdx--;
-        }
+static portBASE_TYPE Cmd_mkdir(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                               size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char path[PATH_BUF_SIZE];
 
-        //
-        // Now we are either at the lowest level separator in the
-        // current path, or at the beginning of the string (root).
-        // So set the new end of string here, effectively removing
-        // that last part of the path.
-        //
-        g_cTmpBuf[uIdx] = 0;
+    pcOut[0] = 0;
+
+    if(console_arg(pcCommandString, 1, path, sizeof(path)) == NULL)
+    {
+        return pdFALSE;
     }
 
-    //
-    // Otherwise this is just a normal path name from the current
-    // directory, and it needs to be appended to the current path.
-    //
-    else
+    if(console_path(ctx, path))
     {
-        //
-        // Test to make sure that when the new additional path is
-        // added on to the current path, there is room in the buffer
-        // for the full new path.  It needs to include a new separator,
-        // and a trailing null character.
-        //
-        if(strlen(g_cTmpBuf) + strlen(path) + 1 + 1 > sizeof(g_cCwdBuf))
+        snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+        return pdFALSE;
+    }
+
+    if(f_mkdir(ctx->tmp) != FR_OK)
+    {
+        snprintf(pcOut, xWriteBufferLen, "mkdir: %s fail\n", ctx->tmp);
+    }
+    return pdFALSE;
+}
+
+
+//*****************************************************************************
+//
+// This function implements the "cat" command.  It reads the contents of
+// a file and prints it to the console.  This should only be used on
+// text files.  If it is used on a binary file, then a bunch of garbage
+// is likely to printed on the console.
+//
+// Each call reads as much of the file as fits in the output buffer, so the
+// file is streamed out without holding any other buffer.  Log archives
+// (*.LZ) are decompressed on the way, with a reader taken from the heap
+// until the end of the file.
+//
+//*****************************************************************************
+static portBASE_TYPE Cmd_cat(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char path[PATH_BUF_SIZE];
+    unsigned int usBytesRead;
+    FRESULT fresult;
+    int n;
+
+    if(pxState->uxCallCount == 0)
+    {
+        pcOut[0] = 0;
+
+        if(console_arg(pcCommandString, 1, path, sizeof(path)) == NULL)
+        {
+            return pdFALSE;
+        }
+
+        if(console_path(ctx, path))
         {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
+            snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+            return pdFALSE;
         }
 
         //
-        // The new path is okay, so add the separator and then append
-        // the new directory to the path.
+        // Log archives are shown decompressed, from a file of our own.
         //
-        else
+        if(lz_is_archive(ctx->tmp))
         {
-            //
-            // If not already at the root level, then append a /
-            //
-            if(strcmp(g_cTmpBuf, "/"))
+            if(f_open(&ctx->file_object, ctx->tmp, FA_READ) != FR_OK)
             {
-                strcat(g_cTmpBuf, "/");
+                return pdFALSE;
+            }
+            ctx->lz = mem_malloc(sizeof(lz_reader));
+            if(ctx->lz == NULL || lz_open(ctx->lz, &ctx->file_object) < 0)
+            {
+                snprintf(pcOut, xWriteBufferLen, ctx->lz ? "Not a log archive\n" : "Out of memory\n");
+                goto done;
             }
-
-            //
-            // Append the new directory to the path.
-            //
-            strcat(g_cTmpBuf, path);
         }
+        ctx->stream_pos = 0;
     }
 
-    //
-    // At this point, a candidate new directory path is in chTmpBuf.
-    // Try to open it to make sure it is valid.
-    //
-    fresult = f_opendir(&g_sDirObject, g_cTmpBuf);
+    if(ctx->lz)
+    {
+        n = lz_read(ctx->lz, pcOut, xWriteBufferLen - 1);
+        if(n < 0)
+        {
+            snprintf(pcOut, xWriteBufferLen, "\n");
+            goto done;
+        }
+        pcOut[n] = 0;
+        if(n == xWriteBufferLen - 1)
+        {
+            return pdTRUE;
+        }
+        goto done;
+    }
 
     //
-    // If it cant be opened, then it is a bad path.  Inform
-    // user and return.
+    // Read a block of data from the file.  Read as much as can fit
+    // in the output buffer, including a space for the trailing null.
+    // The file i/o service does the read ahead of the queued writes,
+    // after the ones to this file.
     //
+    fresult = fio_read(ctx->tmp, ctx->stream_pos, pcOut, xWriteBufferLen - 1,
+                       &usBytesRead);
     if(fresult != FR_OK)
     {
-        fprintf(file,"cd: %s\n", g_cTmpBuf);
-        return(fresult);
+        snprintf(pcOut, xWriteBufferLen, pxState->uxCallCount ? "\n" : "");
+        return pdFALSE;
     }
+    pcOut[usBytesRead] = 0;
+    ctx->stream_pos += usBytesRead;
 
     //
-    // Otherwise, it is a valid new path, so copy it into the CWD.
+    // Continue reading until less than the full number of bytes are
+    // read.  That means the end of the file was reached.
     //
-    else
+    if(usBytesRead == xWriteBufferLen - 1)
     {
-        strncpy(g_cCwdBuf, g_cTmpBuf, sizeof(g_cCwdBuf));
+        return pdTRUE;
     }
+    return pdFALSE;
 
-    //
-    // Return success.
-    //
-    return(0);
+done:
+    if(ctx->lz)
+    {
+        mem_free(ctx->lz);
+        ctx->lz = NULL;
+    }
+    f_close(&ctx->file_object);
+    return pdFALSE;
 }
 
-static int Cmd_mkdir(FILE *file,char *path)
+//*****************************************************************************
+//
+// This function implements the "log" command.  It appends a time stamped
+// line of text to a file.
+//
+//*****************************************************************************
+static portBASE_TYPE Cmd_log(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    unsigned int uIdx;
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
     FRESULT fresult;
+    unsigned int usBytesWritten;
+    char filename[PATH_BUF_SIZE];
+    const char *string;
+    char ts_string[22];
+    time_t tm = RtcGetTime();
+    struct tm * timeinfo;
 
-    //
-    // Copy the current working path into a temporary buffer so
-    // it can be manipulated.
-    //
-    strcpy(g_cTmpBuf, g_cCwdBuf);
+    pcOut[0] = 0;
 
-    //
-    // If the first character is /, then this is a fully specified
-    // path, and it should just be used as-is.
-    //
-    if(path[0] == '/')
-    {
-        //
-        // Make sure the new path is not bigger than the cwd buffer.
-        //
-        if(strlen(path) + 1 > sizeof(g_cCwdBuf))
-        {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
-        }
+    timeinfo = localtime(&tm);
 
-        //
-        // If the new path name (in argv[1])  is not too long, then
-        // copy it into the temporary buffer so it can be checked.
-        //
-        else
-        {
-            strncpy(g_cTmpBuf, path, sizeof(g_cTmpBuf));
-        }
+    sprintf(ts_string,"%04d/%02d/%02d %02d:%02d:%02d ",timeinfo->tm_year + 1900, timeinfo->tm_mon+ 1 , timeinfo->tm_mday,
+            timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
+
+    if(console_arg(pcCommandString, 1, filename, sizeof(filename)) == NULL){
+        snprintf(pcOut, xWriteBufferLen, "filename not given\n");
+        return pdFALSE;
+    }
+    string = console_rest(pcCommandString, 2);
+    if(string == NULL){
+        snprintf(pcOut, xWriteBufferLen, "string not given\n");
+        return pdFALSE;
     }
 
-    //
-    // If the argument is .. then attempt to remove the lowest level
-    // on the CWD.
-    //
-    else if(!strcmp(path, ".."))
+    if(console_path(ctx, filename))
     {
-        //
-        // Get the index to the last character in the current path.
-        //
-        uIdx = strlen(g_cTmpBuf) - 1;
-
-        //
-        // Back up from the end of the path name until a separator (/)
-        // is found, or until we bump up to the start of the path.
-        //
-        while((g_cTmpBuf[uIdx] != '/') && (uIdx > 1))
-        {
-            //
-            // Back up one character.
-            //
-            uIdx--;
-        }
-
-        //
-        // Now we are either at the lowest level separator in the
-        // current path, or at the beginning of the string (root).
-        // So set the new end of string here, effectively removing
-        // that last part of the path.
-        //
-        g_cTmpBuf[uIdx] = 0;
+        snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+        return pdFALSE;
     }
 
-    //
-    // Otherwise this is just a normal path name from the current
-    // directory, and it needs to be appended to the current path.
-    //
-    else
+    fresult = f_open(&ctx->file_object, ctx->tmp, FA_WRITE | FA_OPEN_ALWAYS);
+    if(fresult != FR_OK)
     {
-        //
-        // Test to make sure that when the new additional path is
-        // added on to the current path, there is room in the buffer
-        // for the full new path.  It needs to include a new separator,
-        // and a trailing null character.
-        //
-        if(strlen(g_cTmpBuf) + strlen(path) + 1 + 1 > sizeof(g_cCwdBuf))
-        {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
-        }
-
-        //
-        // The new path is okay, so add the separator and then append
-        // the new directory to the path.
-        //
-        else
-        {
-            //
-            // If not already at the root level, then append a /
-            //
-            if(strcmp(g_cTmpBuf, "/"))
-            {
-                strcat(g_cTmpBuf, "/");
-            }
-
-            //
-            // Append the new directory to the path.
-            //
-            strcat(g_cTmpBuf, path);
-        }
+        return pdFALSE;
     }
 
-    //
-    // At this point, a candidate new directory path is in chTmpBuf.
-    // Try to open it to make sure it is valid.
-    //
-    fresult = f_mkdir(g_cTmpBuf);
-
-    //
-    // If it cant be opened, then it is a bad path.  Inform
-    // user and return.
-    //
+    // seek to end of file
+    fresult = f_lseek(&ctx->file_object, f_size(&ctx->file_object));
     if(fresult != FR_OK)
     {
-        fprintf(file,"mkdir: %s fail\n", g_cTmpBuf);
-        return(fresult);
+        f_close(&ctx->file_object);
+        return pdFALSE;
     }
 
-    //
-    // Return success.
-    //
-    return(0);
+    fresult = f_write(&ctx->file_object, ts_string, strlen(ts_string),
+                     &usBytesWritten);
+    if(fresult == FR_OK && strlen(ts_string) == usBytesWritten)
+        fresult = f_write(&ctx->file_object, string, strlen(string),
+                         &usBytesWritten);
+    if(fresult == FR_OK && strlen(string) == usBytesWritten)
+        fresult = f_write(&ctx->file_object, "\n", 1,
+                         &usBytesWritten);
+
+    f_close(&ctx->file_object);
+    return pdFALSE;
 }
 
+static portBASE_TYPE Cmd_lcd(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    const char *string = console_rest(pcCommandString, 1);
+
+    pcWriteBuffer[0] = 0;
+    if(string && *string)
+        fprintf(stderr,"%s\n",string);
+    return pdFALSE;
+}
 
 //*****************************************************************************
 //
-// This function implements the "cat" command.  It reads the contents of
-// a file and prints it to the console.  This should only be used on
-// text files.  If it is used on a binary file, then a bunch of garbage
-// is likely to printed on the console.
+// Returns the size of the largest block that can be allocated from the heap.
+// The size is found with a binary search, so it only takes a few malloc
+// calls and can be used by the status page of httpd as well.
 //
 //*****************************************************************************
-static int Cmd_cat(FILE *file,char *filename)
+unsigned long checkFreeMem(void)
 {
-    FRESULT fresult;
-    unsigned int usBytesRead;
+    unsigned long low = 0, high = 0x10000, memsize;
+    char *ptr = NULL;
 
-    //
-    // First, check to make sure that the current path (CWD), plus
-    // the file name, plus a separator and trailing null, will all
-    // fit in the temporary buffer that will be used to hold the
-    // file name.  The file name must be fully specified, with path,
-    // to FatFs.
-    //
-    if(strlen(g_cCwdBuf) + strlen(filename) + 1 + 1 > sizeof(g_cTmpBuf))
-    {
-        fprintf(file,"Resulting path name is too long\n");
-        return(0);
+	vTaskSuspendAll();
+    while(low + 1 < high){
+        memsize = (low + high) / 2;
+        ptr = malloc(memsize);
+        if(ptr){
+            free(ptr);
+            low = memsize;
+        }else
+            high = memsize;
     }
+	xTaskResumeAll();
 
-    //
-    // Copy the current path to the temporary buffer so it can be manipulated.
-    //
-    strcpy(g_cTmpBuf, g_cCwdBuf);
+    return low;
+}
 
-    //
-    // If not already at the root level, then append a separator.
-    //
-    if(strcmp("/", g_cCwdBuf))
-    {
-        strcat(g_cTmpBuf, "/");
-    }
 
-    //
-    // Now finally, append the file name to result in a fully specified file.
-    //
-    strcat(g_cTmpBuf, filename);
+static portBASE_TYPE Cmd_free(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                              size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+	unsigned long free = checkFreeMem();
+	snprintf((char *)pcWriteBuffer, xWriteBufferLen, "Free mem = %d\n",free);
+#if( configUSE_MEMALLOCTRACE == 1)
+    /*  char free_mem[80];
+        show_free(free_mem);
+        fprintf(file,free_mem); */
+        show_alloctable();
+#endif
+    return pdFALSE;
+}
 
-    //
-    // Open the file for reading.
-    //
-    fresult = f_open(&g_sFileObject, g_cTmpBuf, FA_READ);
+static portBASE_TYPE Cmd_date(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                              size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+	time_t timer;
+	timer=RtcGetTime();
+	snprintf((char *)pcWriteBuffer, xWriteBufferLen, "%s",asctime(localtime(&timer)));
+	return pdFALSE;
+}
 
-    //
-    // If there was some problem opening the file, then return
-    // an error.
-    //
-    if(fresult != FR_OK)
-    {
-        return(fresult);
-    }
+static portBASE_TYPE Cmd_wget(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                              size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char url[ARG_BUF_SIZE];
+    char filename[PATH_BUF_SIZE];
+    FRESULT fresult;
+    unsigned long tick_before,tick_after;
 
-    //
-    // Enter a loop to repeatedly read data from the file and display it,
-    // until the end of the file is reached.
-    //
-    do
-    {
-        //
-        // Read a block of data from the file.  Read as much as can fit
-        // in the temporary buffer, including a space for the trailing null.
-        //
-        fresult = f_read(&g_sFileObject, g_cTmpBuf, sizeof(g_cTmpBuf) - 1,
-                         &usBytesRead);
+    pcOut[0] = 0;
 
-        //
-        // If there was an error reading, then print a newline and
-        // return the error to the user.
-        //
-        if(fresult != FR_OK)
-        {
-            fprintf(file,"\n");
-            f_close(&g_sFileObject);
-            return(fresult);
+    if(console_arg(pcCommandString, 1, url, sizeof(url)) == NULL)
+        return pdFALSE;
+
+    fprintf(ctx->file,"url = %s\n",url);
+
+    if(console_arg(pcCommandString, 2, filename, sizeof(filename)) == NULL)
+    	http_req(url,print_http,(void*)ctx->file);
+    else{
+        fprintf(ctx->file,"file = %s\n",filename);
+
+        if(console_path(ctx, filename)){
+            snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+            return pdFALSE;
         }
 
-        //
-        // Null terminate the last block that was read to make it a
-        // null terminated string that can be used with printf.
-        //
-        g_cTmpBuf[usBytesRead] = 0;
+    	fresult = fio_write(ctx->tmp, 0, "", 0, FIO_CREATE | FIO_WAIT, NULL, NULL);
+    	if(fresult != FR_OK){
+    	    snprintf(pcOut, xWriteBufferLen, "file open error\n");
+    	    return pdFALSE;
+    	}
 
-        //
-        // Print the last chunk of the file that was received.
-        //
-        fprintf(file,"%s", g_cTmpBuf);
+        tick_before = xTaskGetTickCount();
+    	http_req(url,fio_http,(void*)ctx->tmp);
+    	fio_sync(ctx->tmp, FIO_WAIT, NULL, NULL);
+        tick_after = xTaskGetTickCount();
 
-    //
-    // Continue reading until less than the full number of bytes are
-    // read.  That means the end of the buffer was reached.
-    //
+    	snprintf(pcOut, xWriteBufferLen, "lap %ld ticks (%ld sec)\n",tick_after - tick_before, (tick_after - tick_before) / configTICK_RATE_HZ);
     }
-    while(usBytesRead == sizeof(g_cTmpBuf) - 1);
 
-    f_close(&g_sFileObject);
-    //
-    // Return success.
-    //
-    return(0);
+    return pdFALSE;
 }
 
-//*****************************************************************************
-//
-// This function implements the "cat" command.  It reads the contents of
-// a file and prints it to the console.  This should only be used on
-// text files.  If it is used on a binary file, then a bunch of garbage
-// is likely to printed on the console.
-//
-//*****************************************************************************
-static int Cmd_log(FILE *file,char *argv)
+static portBASE_TYPE Cmd_task(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                              size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    FRESULT fresult;
-    unsigned int usBytesWritten;
-	char *filename,*string;
-	char ts_string[22];
-    time_t tm = RtcGetTime();
-    struct tm * timeinfo;
-
-    timeinfo = localtime(&tm);
+    console_context *ctx = (console_context *)pxState->pvContext;
 
-	sprintf(ts_string,"%04d/%02d/%02d %02d:%02d:%02d ",timeinfo->tm_year + 1900, timeinfo->tm_mon+ 1 , timeinfo->tm_mday,
-			timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
-	
-
-	filename = strtok(argv," \t\r\n");
-	if(filename == NULL){
-		fprintf(file,"filename not given\n");
-		return 0;
-	}
-	string = strtok(NULL,"\r");
-	if(string== NULL){
-		fprintf(file,"string not given\n");
-		return 0 ;
-	}
-	
-    strcpy(g_cTmpBuf, g_cCwdBuf);
-    if(filename[0] == '/')
-        strncpy(g_cTmpBuf, filename, sizeof(g_cTmpBuf));
-    else
-    {
-        if(strlen(g_cCwdBuf) + strlen(filename) + 1 + 1 > sizeof(g_cTmpBuf))
-        {
-            fprintf(file,"Resulting path name is too long\n");
-            return(0);
+    if(pxState->uxCallCount == 0){
+        ctx->stream = mem_malloc(TASK_LIST_SIZE);
+        if(ctx->stream == NULL){
+            snprintf((char *)pcWriteBuffer, xWriteBufferLen, "task_status malloc fail\n");
+            return pdFALSE;
         }
+        ctx->stream_pos = 0;
+        vTaskList((signed char *)ctx->stream);
+        snprintf((char *)pcWriteBuffer, xWriteBufferLen, "name\t\tstatus\tpri\tstack\ttcb");
+        return pdTRUE;
+    }
+    return console_stream(ctx, (char *)pcWriteBuffer, xWriteBufferLen);
+}
 
-        if(strcmp(g_cTmpBuf, "/"))
-        {
-            strcat(g_cTmpBuf, "/");
+static portBASE_TYPE Cmd_top(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+#if configGENERATE_RUN_TIME_STATS
+    console_context *ctx = (console_context *)pxState->pvContext;
+
+    if(pxState->uxCallCount == 0){
+        ctx->stream = mem_malloc(TASK_LIST_SIZE);
+        if(ctx->stream == NULL){
+            snprintf((char *)pcWriteBuffer, xWriteBufferLen, "top_string malloc fail\n");
+            return pdFALSE;
         }
-        strcat(g_cTmpBuf, filename);
+        ctx->stream_pos = 0;
+        vTaskGetRunTimeStats((signed char *)ctx->stream);
     }
+    return console_stream(ctx, (char *)pcWriteBuffer, xWriteBufferLen);
+#else
+    pcWriteBuffer[0] = 0;
+    return pdFALSE;
+#endif
+}
 
-    //
-    // Open the file for reading.
-    //
-    fresult = f_open(&g_sFileObject, g_cTmpBuf, FA_WRITE | FA_OPEN_ALWAYS);
+static portBASE_TYPE Cmd_ntp(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    char hostname[ARG_BUF_SIZE];
 
-    //
-    // If there was some problem opening the file, then return
-    // an error.
-    //
-    if(fresult != FR_OK)
-    {
-        return(fresult);
-    }
+    pcWriteBuffer[0] = 0;
+    if(console_arg(pcCommandString, 1, hostname, sizeof(hostname)))
+        sntp_request(hostname);
+    return pdFALSE;
+}
 
-    // seek to end of file
-    fresult = f_lseek(&g_sFileObject, f_size(&g_sFileObject));
+static portBASE_TYPE Cmd_reboot(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    health_reset("console");
+    pcWriteBuffer[0] = 0;
+    return pdFALSE;
+}
 
-    //
-    // If there was some problem opening the file, then return
-    // an error.
-    //
-    if(fresult != FR_OK)
-    {
-        return(fresult);
-    }
+static portBASE_TYPE Cmd_health(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    char *pcOut = (char *)pcWriteBuffer;
+    health_info info;
 
-    fresult = f_write(&g_sFileObject, ts_string, strlen(ts_string),
-                     &usBytesWritten);
-    if(fresult != FR_OK || strlen(ts_string) != usBytesWritten)
-    {
-        f_close(&g_sFileObject);
-        return(fresult);
+    /* one line per call, the last reset then the monitored tasks */
+    if(pxState->uxCallCount == 0){
+        snprintf(pcOut, xWriteBufferLen, "last reset: %s\n", health_last_reset());
+        return pdTRUE;
     }
-	
-
-    fresult = f_write(&g_sFileObject, string, strlen(string),
-                     &usBytesWritten);
-    if(fresult != FR_OK || strlen(string) != usBytesWritten)
-    {
-        f_close(&g_sFileObject);
-        return(fresult);
+    if(health_info_get(pxState->uxCallCount - 1, &info)){
+        pcOut[0] = 0;
+        return pdFALSE;
     }
+    snprintf(pcOut, xWriteBufferLen, "%-12s checked in %6lu msec ago, period %6lu, stack free %4lu\n",
+             info.name, info.age, info.period, info.stack_free);
+    return pdTRUE;
+}
 
-    fresult = f_write(&g_sFileObject, "\n", 1,
-                     &usBytesWritten);
-    if(fresult != FR_OK || usBytesWritten != 1)
-    {
-        f_close(&g_sFileObject);
-        return(fresult);
+static portBASE_TYPE Cmd_fio(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    char *pcOut = (char *)pcWriteBuffer;
+    fio_stats stats;
+    fio_op_stats *st;
+    unsigned long op;
+
+    /* one line per call, the queue then one row per request type */
+    fio_stats_get(&stats);
+    if(pxState->uxCallCount == 0){
+        snprintf(pcOut, xWriteBufferLen, "queued %lu, max %lu\n%-7s %7s %6s %9s %8s %9s %8s %5s\n",
+                 stats.queued, stats.queued_max, "type", "count", "merged",
+                 "wait avg", "wait max", "busy avg", "busy max", "err");
+        return pdTRUE;
     }
-
-    f_close(&g_sFileObject);
-    //
-    // Return success.
-    //
-    return(0);
+    op = pxState->uxCallCount - 1;
+    if(op >= fio_op_count){
+        pcOut[0] = 0;
+        return pdFALSE;
+    }
+    st = &stats.op[op];
+    snprintf(pcOut, xWriteBufferLen, "%-7s %7lu %6lu %9lu %8lu %9lu %8lu %5lu\n",
+             fio_op_name((fio_op)op), st->count, st->merged,
+             st->count ? st->wait_total / st->count : 0, st->wait_max,
+             st->count ? st->busy_total / st->count : 0, st->busy_max, st->errors);
+    return pdTRUE;
 }
 
-static int Cmd_lcd(FILE *file,char *argv)
+static portBASE_TYPE Cmd_expat(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                               size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    if(argv && *argv)
-        fprintf(stderr,"%s\n",argv);
-    return(0);
+    extern int expat_main(char *pcFilename);
+    char filename[PATH_BUF_SIZE];
+
+    pcWriteBuffer[0] = 0;
+    if(console_arg(pcCommandString, 1, filename, sizeof(filename)))
+        expat_main(filename);
+    return pdFALSE;
 }
 
-static unsigned long checkFreeMem(void)
+static portBASE_TYPE Cmd_ifconfig(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                  size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    unsigned long memsize = 0;
-    char *ptr = NULL;
+    char *pcOut = (char *)pcWriteBuffer;
+    unsigned char pucMACArray[6];
+    unsigned long addr;
 
-	vTaskSuspendAll();
-    do{
-        memsize+=1;
-        ptr = malloc(memsize);
-        if(ptr)
-            free(ptr);
-    }while(ptr);
-	xTaskResumeAll();
-    
-    return memsize;
+    /* one line per call */
+    switch(pxState->uxCallCount){
+    case 0:
+        snprintf(pcOut, xWriteBufferLen, "Link is %s\n",lwIPLinkStatusGet() ? "UP":"DOWN");
+        break;
+    case 1:
+        lwIPLocalMACGet(pucMACArray);
+        snprintf(pcOut, xWriteBufferLen, "MAC address = %02X:%02X:%02X:%02X:%02X:%02X\n",pucMACArray[0],pucMACArray[1],
+                pucMACArray[2],pucMACArray[3],pucMACArray[4],pucMACArray[5]);
+        break;
+    case 2:
+        addr = lwIPLocalIPAddrGet();
+        snprintf(pcOut, xWriteBufferLen, "IP address = %s\n",inet_ntoa(addr));
+        break;
+    case 3:
+        addr = lwIPLocalNetMaskGet();
+        snprintf(pcOut, xWriteBufferLen, "IP netmask = %s\n",inet_ntoa(addr));
+        break;
+    default:
+        addr = lwIPLocalGWAddrGet();
+        snprintf(pcOut, xWriteBufferLen, "IP gateway = %s\n",inet_ntoa(addr));
+        return pdFALSE;
+    }
+    return pdTRUE;
 }
 
+/* netstat lines before the pool table */
+#define NETSTAT_HEAD_LINES  5
 
-static int Cmd_free(FILE *file,char *argv)
+static portBASE_TYPE Cmd_netstat(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                 size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-	unsigned long free = checkFreeMem();
-	fprintf(file,"Free mem = %d\n",free);
-#if( configUSE_MEMALLOCTRACE == 1)
-    /*  char free_mem[80];
-        show_free(free_mem);
-        fprintf(file,free_mem); */
-        show_alloctable();
+    char *pcOut = (char *)pcWriteBuffer;
+#if LWIP_STATS && TCP_STATS && MEMP_STATS
+    struct stats_mem *pool;
+    unsigned int line = pxState->uxCallCount;
+
+    /* one line per call, the counters then a row per pool */
+    switch(line){
+    case 0:
+        snprintf(pcOut, xWriteBufferLen, "profile %s, mss %u, window %u, send buffer %u, pbuf pool %u x %u%s\n",
+                 LWIP_MEM_PROFILE_NAME, TCP_MSS, TCP_WND, TCP_SND_BUF, PBUF_POOL_SIZE, PBUF_POOL_BUFSIZE,
+                 MEMP_MEM_MALLOC_LIMIT ? ", pools limited" : "");
+        return pdTRUE;
+    case 1:
+        snprintf(pcOut, xWriteBufferLen, "link xmit %lu recv %lu drop %lu memerr %lu\n",
+                 (unsigned long)lwip_stats.link.xmit, (unsigned long)lwip_stats.link.recv,
+                 (unsigned long)lwip_stats.link.drop, (unsigned long)lwip_stats.link.memerr);
+        return pdTRUE;
+    case 2:
+        snprintf(pcOut, xWriteBufferLen, "tcp xmit %lu recv %lu drop %lu memerr %lu err %lu\n",
+                 (unsigned long)lwip_stats.tcp.xmit, (unsigned long)lwip_stats.tcp.recv,
+                 (unsigned long)lwip_stats.tcp.drop, (unsigned long)lwip_stats.tcp.memerr,
+                 (unsigned long)lwip_stats.tcp.err);
+        return pdTRUE;
+    case 3:
+        snprintf(pcOut, xWriteBufferLen, "tcp retransmits %lu fast %lu, zero window probes %lu, receive window full %lu, refused %lu\n",
+                 (unsigned long)lwip_stats.tcp_wnd.rexmit, (unsigned long)lwip_stats.tcp_wnd.fastrexmit,
+                 (unsigned long)lwip_stats.tcp_wnd.zwp, (unsigned long)lwip_stats.tcp_wnd.rcvfull,
+                 (unsigned long)lwip_stats.tcp_wnd.refused);
+        return pdTRUE;
+    case 4:
+        snprintf(pcOut, xWriteBufferLen, "%-16s %5s %5s %5s %5s\n", "pool", "used", "max", "size", "err");
+        return pdTRUE;
+    }
+
+    line -= NETSTAT_HEAD_LINES;
+    pool = &lwip_stats.memp[line];
+    snprintf(pcOut, xWriteBufferLen, "%-16s %5u %5u %5u %5lu\n", pool->name, (unsigned int)pool->used,
+             (unsigned int)pool->max, (unsigned int)pool->avail, (unsigned long)pool->err);
+    return (line + 1 < MEMP_MAX) ? pdTRUE : pdFALSE;
+#else
+    snprintf(pcOut, xWriteBufferLen, "lwIP stats are not enabled\n");
+    return pdFALSE;
 #endif
-    return 0;
 }
 
-static int Cmd_date(FILE *file,char *argv)
+static portBASE_TYPE Cmd_bench(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                               size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-	time_t timer;
-	timer=RtcGetTime();
-	fprintf(file,"%s",asctime(localtime(&timer)));
-	return 0;
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char arg[ARG_BUF_SIZE];
+    unsigned long count = 5, index, elapsed, cpu;
+    int raw, ret, len;
+
+    /* count socket uploads followed by count raw uploads, one per call */
+    if(console_arg(pcCommandString, 1, arg, sizeof(arg)) && atoi(arg) > 0)
+        count = atoi(arg);
+
+    index = pxState->uxCallCount % count;
+    raw = pxState->uxCallCount >= count;
+    if(index == 0){
+        ctx->total_size = 0;
+        ctx->file_count = 0;
+    }
+
+    ret = report_bench(raw, &elapsed, &cpu);
+    ctx->total_size += elapsed;
+    ctx->file_count += cpu;
+
+    len = snprintf(pcOut, xWriteBufferLen, "%s %lu: result %d, %lu ms, cpu %lu us\n",
+                   raw ? "raw " : "sock", index + 1, ret, elapsed, cpu);
+    if(index == count - 1 && len < xWriteBufferLen)
+        snprintf(pcOut + len, xWriteBufferLen - len, "%s avg %lu ms, cpu %lu us\n",
+                 raw ? "raw " : "sock", ctx->total_size / count, ctx->file_count / count);
+
+    return (pxState->uxCallCount + 1 < 2 * count) ? pdTRUE : pdFALSE;
 }
 
-static int Cmd_wget(FILE *file,char *argv)
-{
-    char *url,*filename;
-    FRESULT fresult;
-    unsigned long tick_before,tick_after;
+/* bench directory names look like the /response files, 8 digits */
+#define DIRBENCH_CREATE     500     /* files created per call */
+#define DIRBENCH_LOOKUPS    32
 
-    url = strtok(argv," \t\r\n");
-    if(url == NULL)
-        return 0;
+/* time lookups of names in the bench directory, present or missing */
+static void dirbench_lookup(console_context *ctx, int hit, unsigned long *ms10, unsigned long *sectors)
+{
+    DSTATS before, after;
+    portTickType start;
+    unsigned long i, n = ctx->file_count;
+
+    disk_stats(&before);
+    start = xTaskGetTickCount();
+    for(i=0;i<DIRBENCH_LOOKUPS;i++){
+        sprintf(ctx->tmp, "/DB%lu/%08lu", n, hit ? rand() % n : n + rand() % n);
+        if(f_open(&ctx->file_object, ctx->tmp, FA_READ) == FR_OK)
+            f_close(&ctx->file_object);
+    }
+    *ms10 = (xTaskGetTickCount() - start) * portTICK_RATE_MS * 10 / DIRBENCH_LOOKUPS;
+    disk_stats(&after);
+    *sectors = (after.read_bytes - before.read_bytes) / 512 / DIRBENCH_LOOKUPS;
+}
 
-    fprintf(file,"url = %s\n",url);
+static portBASE_TYPE Cmd_dirbench(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                  size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char arg[ARG_BUF_SIZE];
+    unsigned long hit_ms, hit_sect, miss_ms, miss_sect, build;
+    portTickType start;
+    FRESULT fresult;
 
-    filename = strtok(NULL," \r\n");
-    if(filename == NULL)
-    	http_req(url,print_http,(void*)file);
-    else{
-        fprintf(file,"file = %s\n",filename);
-        
-        strcpy(g_cTmpBuf, g_cCwdBuf);
-        if(filename[0] == '/')
-            strncpy(g_cTmpBuf, filename, sizeof(g_cTmpBuf));
-        else
-        {
-            if(strcmp(g_cTmpBuf, "/"))
-            {
-                strcat(g_cTmpBuf, "/");
-            }
-            strcat(g_cTmpBuf, filename);
+    /* /DBn is filled with n files first, kept for the next run */
+    if(pxState->uxCallCount == 0){
+        ctx->file_count = 1000;
+        if(console_arg(pcCommandString, 1, arg, sizeof(arg)) && atoi(arg) > 0)
+            ctx->file_count = atoi(arg);
+        ctx->stream_pos = 0;
+        ctx->dir_count = 0;
+        sprintf(ctx->tmp, "/DB%lu", ctx->file_count);
+        fresult = f_mkdir(ctx->tmp);
+        if(fresult != FR_OK && fresult != FR_EXIST){
+            snprintf(pcOut, xWriteBufferLen, "mkdir %s error %d\n", ctx->tmp, fresult);
+            return pdFALSE;
         }
+    }
 
-    	fresult = f_open(&g_sFileObject, g_cTmpBuf, FA_WRITE | FA_CREATE_ALWAYS);
-    	if(fresult != FR_OK){
-    	    fprintf(file,"file open error\n");
-    	    return 0;
-    	}
+    if(ctx->stream_pos < ctx->file_count){
+        do{
+            sprintf(ctx->tmp, "/DB%lu/%08lu", ctx->file_count, ctx->stream_pos);
+            fresult = f_open(&ctx->file_object, ctx->tmp, FA_WRITE | FA_CREATE_NEW);
+            if(fresult == FR_OK)
+                f_close(&ctx->file_object);
+            else if(fresult != FR_EXIST){
+                snprintf(pcOut, xWriteBufferLen, "create %s error %d\n", ctx->tmp, fresult);
+                return pdFALSE;
+            }
+        }while(++ctx->stream_pos % DIRBENCH_CREATE && ctx->stream_pos < ctx->file_count);
+        snprintf(pcOut, xWriteBufferLen, "%lu/%lu files\n", ctx->stream_pos, ctx->file_count);
+        return pdTRUE;
+    }
 
-        tick_before = xTaskGetTickCount();
-    	http_req(url,file_http,(void*)&g_sFileObject);
-    	f_close(&g_sFileObject);
-        tick_after = xTaskGetTickCount();
-        
-    	fprintf(file,"lap %ld ticks (%ld sec)\n",tick_after - tick_before, (tick_after - tick_before) / configTICK_RATE_HZ);
+    /* one row searching linearly, one through the directory cache */
+    f_dcache(ctx->dir_count);
+    build = 0;
+    if(ctx->dir_count){
+        start = xTaskGetTickCount();
+        sprintf(ctx->tmp, "/DB%lu/%08lu", ctx->file_count, ctx->file_count);
+        f_stat(ctx->tmp, &ctx->file_info);
+        build = (xTaskGetTickCount() - start) * portTICK_RATE_MS;
     }
+    dirbench_lookup(ctx, 1, &hit_ms, &hit_sect);
+    dirbench_lookup(ctx, 0, &miss_ms, &miss_sect);
+    snprintf(pcOut, xWriteBufferLen, "%s: hit %lu.%lu ms %lu sect, miss %lu.%lu ms %lu sect, build %lu ms\n",
+             ctx->dir_count ? "cached" : "linear", hit_ms / 10, hit_ms % 10, hit_sect,
+             miss_ms / 10, miss_ms % 10, miss_sect, build);
+    if(ctx->dir_count++ == 0)
+        return pdTRUE;
+    return pdFALSE;
+}
 
+/* history lines, one per sample or per step */
+static int history_print(void *pv, const xTsdbPoint *point)
+{
+    console_context *ctx = (console_context *)pv;
+    char a[12], b[12], c[12], d[12], e[12], f[12];
+    time_t timer = point->ulTime;
+    struct tm *timeinfo = localtime(&timer);
+    long n = point->ulCount;
+
+    fprintf(ctx->file, "%02d/%02d %02d:%02d:%02d", timeinfo->tm_mon + 1, timeinfo->tm_mday,
+            timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
+    if(n == 1)
+        fprintf(ctx->file, " %7s %7s %5d %4d\n", history_fixed(a, point->sMax[0]),
+                history_fixed(b, point->sMax[1]), point->sMax[2], point->sMax[3]);
+    else
+        fprintf(ctx->file, " n %3ld  t %s/%s/%s  h %s/%s/%s  co2 %d/%ld/%d  snd %d/%ld/%d\n", n,
+                history_fixed(a, point->sMin[0]), history_fixed(b, point->lSum[0] / n), history_fixed(c, point->sMax[0]),
+                history_fixed(d, point->sMin[1]), history_fixed(e, point->lSum[1] / n), history_fixed(f, point->sMax[1]),
+                point->sMin[2], point->lSum[2] / n, point->sMax[2],
+                point->sMin[3], point->lSum[3] / n, point->sMax[3]);
     return 0;
 }
 
-static int Cmd_task(FILE *file,char*argv)
+static int history_skip(void *pv, const xTsdbPoint *point)
 {
-    char *task_status = mem_malloc(200);
-
-	if(task_status == NULL){
-		fprintf(file,"task_status malloc fail\n");
-		return 0;
-	}
-	vTaskList(task_status);
-	fprintf(file,"name\t\tstatus\tpri\tstack\ttcb");
-	fprintf(file,task_status);
-	mem_free(task_status);
-	return 0;
+    return 0;
 }
 
-static int Cmd_top(FILE *file,char*argv)
+/* history bench spans, each queried for every sample and in 60 steps */
+static const unsigned long history_spans[] = { 3600, 6 * 3600, 24 * 3600, 7 * 24 * 3600 };
+
+static portBASE_TYPE history_bench(xCommandLineState *pxState, char *pcOut, size_t xWriteBufferLen,
+                                   const signed char *pcCommandString)
 {
-#if configGENERATE_RUN_TIME_STATS
-    char *top_string = mem_malloc(200);
+    char arg[ARG_BUF_SIZE];
+    unsigned long row, span, elapsed;
+    DSTATS before, after;
+    portTickType start;
+    xTsdbQuery query;
+    long ret;
+
+    /* one row per call */
+    if(pxState->uxCallCount == 0){
+        snprintf(pcOut, xWriteBufferLen, "%-7s %-5s %6s %7s %4s %7s %7s %6s\n",
+                 "span", "step", "points", "headers", "dir", "decoded", "sectors", "msec");
+        return pdTRUE;
+    }
+    row = pxState->uxCallCount - 1;
+    span = history_spans[row / 2];
+
+    memset(&query, 0, sizeof(query));
+    query.ucAddr = 0xA0;
+    if(console_arg(pcCommandString, 2, arg, sizeof(arg)))
+        query.ucAddr = strtoul(arg, NULL, 16);
+    query.ulTo = RtcGetTime() + 1;
+    query.ulFrom = query.ulTo > span ? query.ulTo - span : 0;
+    query.ulStep = (row % 2) ? span / 60 : 0;
+    query.pxPoint = history_skip;
+
+    disk_stats(&before);
+    start = xTaskGetTickCount();
+    ret = history_query(&query);
+    elapsed = (xTaskGetTickCount() - start) * portTICK_RATE_MS;
+    disk_stats(&after);
+    if(ret < 0){
+        snprintf(pcOut, xWriteBufferLen, "history read error\n");
+        return pdFALSE;
+    }
+    snprintf(pcOut, xWriteBufferLen, "%-7lu %-5lu %6lu %7lu %4lu %7lu %7lu %6lu\n",
+             span, query.ulStep, query.ulPoints, query.ulHeaders, query.ulDirectories,
+             query.ulDecoded, (after.read_bytes - before.read_bytes) / 512, elapsed);
+    return (row + 1 < 2 * sizeof(history_spans) / sizeof(history_spans[0])) ? pdTRUE : pdFALSE;
+}
 
-	if(top_string == NULL){
-		fprintf(file,"top_string malloc fail\n");
-		return 0;
-	}
+static portBASE_TYPE Cmd_history(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                                 size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char *pcOut = (char *)pcWriteBuffer;
+    char arg[ARG_BUF_SIZE];
+    unsigned long hours = 6;
+    xTsdbQuery query;
+    long ret;
+
+    pcOut[0] = 0;
+    if(console_arg(pcCommandString, 1, arg, sizeof(arg)) == NULL){
+        snprintf(pcOut, xWriteBufferLen, "%s: %lu blocks of %d bytes\n",
+                 HISTORY_PATH, history_blocks(), TSDB_BLOCK_SIZE);
+        return pdFALSE;
+    }
+    if(!strcmp(arg, "bench"))
+        return history_bench(pxState, pcOut, xWriteBufferLen, pcCommandString);
+
+    /* history <addr> [hours] [step minutes], the points go out as they come */
+    memset(&query, 0, sizeof(query));
+    query.ucAddr = strtoul(arg, NULL, 16);
+    if(console_arg(pcCommandString, 2, arg, sizeof(arg)) && atoi(arg) > 0)
+        hours = atoi(arg);
+    if(console_arg(pcCommandString, 3, arg, sizeof(arg)))
+        query.ulStep = atoi(arg) * 60;
+    query.ulTo = RtcGetTime() + 1;
+    query.ulFrom = query.ulTo > hours * 3600 ? query.ulTo - hours * 3600 : 0;
+    query.pxPoint = history_print;
+    query.pvArg = ctx;
+
+    ret = history_query(&query);
+    if(ret < 0)
+        snprintf(pcOut, xWriteBufferLen, "history read error\n");
+    else
+        snprintf(pcOut, xWriteBufferLen, "%ld points, %lu blocks decoded, %lu from the directory\n",
+                 ret, query.ulDecoded, query.ulDirectories);
+    return pdFALSE;
+}
 
-    vTaskGetRunTimeStats(top_string);
-	fprintf(file,top_string);
-	mem_free(top_string);
-#endif    
-    return 0;
+static portBASE_TYPE Cmd_ota(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                             size_t xWriteBufferLen, const signed char *pcCommandString)
+{
+    static const char * const state[] = { "idle", "downloading", "ready", "failed" };
+    char *pcOut = (char *)pcWriteBuffer;
+    char arg[ARG_BUF_SIZE];
+    ota_status status;
+
+    pcOut[0] = 0;
+
+    if(console_arg(pcCommandString, 1, arg, sizeof(arg)) == NULL){
+        ota_status_get(&status);
+        snprintf(pcOut, xWriteBufferLen, "%s %lu/%lu bytes, version %lu%s%s\n",
+                 state[status.state], status.received, status.total, status.version,
+                 status.error ? ", " : "", status.error ? status.error : "");
+    }else if(!strcmp(arg, "install")){
+        if(ota_install())
+            snprintf(pcOut, xWriteBufferLen, "no verified image\n");
+    }else if(ota_start(arg)){
+        snprintf(pcOut, xWriteBufferLen, "ota busy or out of memory\n");
+    }else{
+        snprintf(pcOut, xWriteBufferLen, "downloading %s\n", arg);
+    }
+    return pdFALSE;
 }
-static int Cmd_ntp(FILE *file,char *argv)
+
+static portBASE_TYPE Cmd_trace(xCommandLineState *pxState, signed char *pcWriteBuffer,
+                               size_t xWriteBufferLen, const signed char *pcCommandString)
 {
-    sntp_request(argv);
-    return 0;
+    char *pcOut = (char *)pcWriteBuffer;
+#if ( configUSE_TRACE_RECORDER == 1 )
+    console_context *ctx = (console_context *)pxState->pvContext;
+    char arg[ARG_BUF_SIZE];
+    unsigned char data[TRACE_LINE_BYTES];
+    unsigned int written;
+    int i, n, len;
+
+    /* hex dump of the snapshot, one line per call */
+    if(pxState->uxCallCount){
+        n = iTraceRead(ctx->stream_pos, data, sizeof(data));
+        ctx->stream_pos += n;
+        for(i=0,len=0;i<n;i++)
+            len += snprintf(pcOut + len, xWriteBufferLen - len, "%02x", data[i]);
+        snprintf(pcOut + len, xWriteBufferLen - len, "\n");
+        return (n > 0 && ctx->stream_pos < ctx->total_size) ? pdTRUE : pdFALSE;
+    }
+
+    if(console_arg(pcCommandString, 1, arg, sizeof(arg)) == NULL){
+        snprintf(pcOut, xWriteBufferLen, "trace %lu records\n", ulTraceCount());
+    }else if(!strcmp(arg, "start")){
+        vTraceStart();
+        pcOut[0] = 0;
+    }else if(!strcmp(arg, "stop")){
+        vTraceStop();
+        pcOut[0] = 0;
+    }else if(!strcmp(arg, "clear")){
+        vTraceClear();
+        pcOut[0] = 0;
+    }else if(!strcmp(arg, "dump")){
+        /* freezes the ring until "trace start" */
+        ctx->total_size = ulTraceSnapshot();
+        ctx->stream_pos = 0;
+
+        if(console_arg(pcCommandString, 2, arg, sizeof(arg)) == NULL){
+            snprintf(pcOut, xWriteBufferLen, "trace %lu bytes\n", ctx->total_size);
+            return pdTRUE;
+        }
+
+        if(console_path(ctx, arg)){
+            snprintf(pcOut, xWriteBufferLen, "Resulting path name is too long\n");
+            return pdFALSE;
+        }
+        if(f_open(&ctx->file_object, ctx->tmp, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK){
+            snprintf(pcOut, xWriteBufferLen, "file open error\n");
+            return pdFALSE;
+        }
+        while(ctx->stream_pos < ctx->total_size){
+            n = iTraceRead(ctx->stream_pos, (unsigned char *)ctx->out, sizeof(ctx->out));
+            if(n <= 0 || f_write(&ctx->file_object, ctx->out, n, &written) != FR_OK || written != n)
+                break;
+            ctx->stream_pos += n;
+        }
+        f_close(&ctx->file_object);
+        snprintf(pcOut, xWriteBufferLen, "%lu bytes written to %s\n", ctx->stream_pos, ctx->tmp);
+    }else{
+        snprintf(pcOut, xWriteBufferLen, "usage: trace [start|stop|clear|dump [file]]\n");
+    }
+#else
+    pcOut[0] = 0;
+#endif
+    return pdFALSE;
 }
 
-static int Cmd_reboot(FILE *file,char *argv)
+//*****************************************************************************
+//
+// The console commands.  They are registered with the command interpreter,
+// which keeps them sorted for lookup; "help" is provided by the interpreter.
+//
+//*****************************************************************************
+static const xCommandLineInput CMD_TABLE[] =
+{
+	{ (const signed char *)"ls",       (const signed char *)"ls\t: list files\n",                      Cmd_ls,       -1 },
+	{ (const signed char *)"cd",       (const signed char *)"cd\t: change directory\n",                Cmd_cd,       -1 },
+	{ (const signed char *)"mkdir",    (const signed char *)"mkdir\t: make directory\n",               Cmd_mkdir,    -1 },
+	{ (const signed char *)"cat",      (const signed char *)"cat\t: show file content, log archives decompressed\n", Cmd_cat,      -1 },
+	{ (const signed char *)"free",     (const signed char *)"free\t: show free memory\n",              Cmd_free,     -1 },
+	{ (const signed char *)"date",     (const signed char *)"date\t: show current time\n",             Cmd_date,     -1 },
+	{ (const signed char *)"wget",     (const signed char *)"wget\t: get URL\n",                       Cmd_wget,     -1 },
+	{ (const signed char *)"task",     (const signed char *)"task\t: show task status\n",              Cmd_task,     -1 },
+	{ (const signed char *)"top",      (const signed char *)"top\t: show cpu usage\n",                 Cmd_top,      -1 },
+	{ (const signed char *)"log",      (const signed char *)"log\t: write log\n",                      Cmd_log,      -1 },
+	{ (const signed char *)"lcd",      (const signed char *)"lcd\t: print message to lcd\n",           Cmd_lcd,      -1 },
+	{ (const signed char *)"ntp",      (const signed char *)"ntp\t: sync time with ntp server\n",      Cmd_ntp,      -1 },
+	{ (const signed char *)"expat",    (const signed char *)"expat\t: Test expat XML parser\n",        Cmd_expat,    -1 },
+	{ (const signed char *)"reboot",   (const signed char *)"reboot\t: reboot system\n",               Cmd_reboot,   -1 },
+	{ (const signed char *)"health",   (const signed char *)"health\t: last reset and monitored tasks\n", Cmd_health, -1 },
+	{ (const signed char *)"fio",      (const signed char *)"fio\t: file i/o service queue latency in msec\n", Cmd_fio, -1 },
+	{ (const signed char *)"bench",    (const signed char *)"bench\t: compare socket and raw uploads\n", Cmd_bench,    -1 },
+	{ (const signed char *)"trace",    (const signed char *)"trace\t: kernel event trace [start|stop|clear|dump [file]]\n", Cmd_trace, -1 },
+	{ (const signed char *)"ifconfig", (const signed char *)"ifconfig\t: show network configuration\n", Cmd_ifconfig, -1 },
+	{ (const signed char *)"netstat",  (const signed char *)"netstat\t: lwIP memory profile, tcp and pool usage\n", Cmd_netstat, -1 },
+	{ (const signed char *)"ota",      (const signed char *)"ota\t: firmware update [url|install]\n",  Cmd_ota,      -1 },
+	{ (const signed char *)"dirbench", (const signed char *)"dirbench\t: time file lookups in a directory of [n] files\n", Cmd_dirbench, -1 },
+	{ (const signed char *)"history",  (const signed char *)"history\t: sensor history <addr> [hours] [step min], or bench [addr]\n", Cmd_history, -1 }
+};
+
+void console_register(void)
 {
-    return 0;
+    static int registered;
+    int i;
+
+    if(!registered){
+        /* simple way to prevent double excution */
+        registered = 1;
+        for(i=0;i<sizeof(CMD_TABLE)/sizeof(xCommandLineInput);i++){
+            if(xCmdIntRegisterCommand(&CMD_TABLE[i]) != pdPASS)
+                printf("command table full, %s not registered\n", CMD_TABLE[i].pcCommand);
+        }
+    }
 }
 
-static int Cmd_expat(FILE *file,char *argv)
+//*****************************************************************************
+//
+// Runs one command line to completion, sending each chunk of output to the
+// session as soon as the command has produced it.
+//
+//*****************************************************************************
+static void console_run(console_context *ctx, const char *cmd)
 {
-    extern int expat_main(char *pcFilename);
-    expat_main(argv);
-    return 0;
+    xCommandLineState state;
+    portBASE_TYPE more;
+
+    state.pxCommand = NULL;
+    state.pvContext = ctx;
+    state.uxCallCount = 0;
+
+    do{
+        more = xCmdIntProcessCommand(&state, (const signed char *)cmd,
+                                     (signed char *)ctx->out, sizeof(ctx->out));
+        fputblock(ctx->out, strlen(ctx->out), ctx->file);
+    }while(more);
 }
 
-static int Cmd_ifconfig(FILE *file,char *argv)
+/* takes a job off the list, returns whether its session has closed */
+static int console_job_unlink(console_job *job)
 {
-    unsigned char pucMACArray[6];
-    unsigned long addr;
-    
-    fprintf(file,"Link is %s\n",lwIPLinkStatusGet() ? "UP":"DOWN");
-    lwIPLocalMACGet(pucMACArray);
-    fprintf(file,"MAC address = %02X:%02X:%02X:%02X:%02X:%02X\n",pucMACArray[0],pucMACArray[1],
-            pucMACArray[2],pucMACArray[3],pucMACArray[4],pucMACArray[5]);
-    addr = lwIPLocalIPAddrGet();
-    fprintf(file,"IP address = %s\n",inet_ntoa(addr));
-    addr = lwIPLocalNetMaskGet();
-    fprintf(file,"IP netmask = %s\n",inet_ntoa(addr));
-    addr = lwIPLocalGWAddrGet();
-    fprintf(file,"IP gateway = %s\n",inet_ntoa(addr));
+    console_job **prev;
+    int detached;
 
-    return 0;
+    taskENTER_CRITICAL();
+    for(prev = &g_jobs; *prev != job; prev = &(*prev)->next)
+        ;
+    *prev = job->next;
+    detached = job->detached;
+    taskEXIT_CRITICAL();
+
+    return detached;
 }
 
-static int Cmd_help(FILE *file,char *argv);
+static void console_job_task(void *pvParameters)
+{
+    console_job *job = (console_job *)pvParameters;
 
-typedef int (*cmd_func)(FILE *file,char *argv);
+    console_run(&job->ctx, job->cmd);
+
+    if(console_job_unlink(job))
+        syslog(LOG_LEVEL_INFO,"job done, session closed: %s",job->cmd);
+    else
+        fprintf(job->ctx.file,"\n[done] %s\n",job->cmd);
 
-typedef struct {
-	const char *cmd;
-	const char *desc;
-	cmd_func cb;
-}command_table;
+    mem_free(job);
+    vTaskDelete( NULL );
+}
 
-command_table CMD_TABLE[] = 
+//*****************************************************************************
+//
+// Detaches the background jobs writing to a session that is closing.  The
+// output slot of a telnet session is reused by the next one, so the rest of
+// their output is dropped and their completion goes to the syslog instead.
+//
+//*****************************************************************************
+void console_detach(FILE *file)
 {
-	"ls","list files",Cmd_ls,
-	"cd","change directory",Cmd_cd,
-	"mkdir","make directory",Cmd_mkdir,
-	"cat","show file content",Cmd_cat,
-	"free","show free memory",Cmd_free,
-	"date","show current time",Cmd_date,
-	"wget","get URL",Cmd_wget,
-	"task","show task status",Cmd_task,
-	"top","show cpu usage",Cmd_top,
-	"log","write log",Cmd_log,
-	"lcd","print message to lcd",Cmd_lcd,
-	"ntp","sync time with ntp server",Cmd_ntp,
-	"expat","Test expat XML parser",Cmd_expat,
-	"reboot","reboot system",Cmd_reboot,
-	"ifconfig","show network configuration",Cmd_ifconfig,
-	"help","show this message",Cmd_help
-};
-	
-static int Cmd_help(FILE *file,char *argv)
+    console_job *job;
+
+    taskENTER_CRITICAL();
+    for(job = g_jobs; job; job = job->next){
+        if(job->ctx.file == file){
+            job->ctx.file = &__nullout;
+            job->detached = 1;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Starts cmd in a task of its own, so the session can take the next command
+// while it runs.  The job inherits the output and current directory of the
+// session but uses its own file objects and buffers.
+//
+//*****************************************************************************
+static void console_background(console_context *ctx, const char *cmd)
 {
-	int i;
-    for(i=0;i<sizeof(CMD_TABLE)/sizeof(command_table);i++){
-        fprintf(file,"%s\t: %s\n",CMD_TABLE[i].cmd,CMD_TABLE[i].desc);
-    }   
-	return 0;
+    console_job *job;
+
+    job = (console_job *) mem_malloc(sizeof(console_job) + strlen(cmd));
+    if(job == NULL){
+        fprintf(ctx->file,"job malloc fail\n");
+        return;
+    }
+
+    memset(job, 0, sizeof(console_job));
+    job->ctx.file = ctx->file;
+    strcpy(job->ctx.cwd, ctx->cwd);
+    strcpy(job->cmd, cmd);
+
+    taskENTER_CRITICAL();
+    job->next = g_jobs;
+    g_jobs = job;
+    taskEXIT_CRITICAL();
+
+    if(xTaskCreate( console_job_task, ( signed portCHAR * ) "job", JOB_STACK_SIZE, (void*)job, JOB_PRIORITY, NULL ) != pdPASS){
+        fprintf(ctx->file,"job task creation fail\n");
+        console_job_unlink(job);
+        mem_free(job);
+        return;
+    }
+    fprintf(ctx->file,"[started] %s\n",cmd);
 }
 
-static void parse_cmd(FILE *file,char *cmd)
+static void parse_cmd(console_context *ctx, char *cmd)
 {
-	int i;
-	char *ptr;
-	fprintf(file,"\n");
-	if(cmd && *cmd){
-    	ptr = strtok(cmd," \t\n\r");
-		if(ptr){
-	    	for(i=0;i<sizeof(CMD_TABLE)/sizeof(command_table);i++){
-	    		if(!strcmp(CMD_TABLE[i].cmd,ptr)){
-	    			CMD_TABLE[i].cb(file,strtok(NULL,"\r"));
-	    			break;
-	    		}
-	    	}	
-            if(i ==sizeof(CMD_TABLE)/sizeof(command_table))
-                fprintf(file,"Unknown command\n");
-		}
+    char *end;
+
+	fprintf(ctx->file,"\n");
+
+    /* strip leading and trailing white space */
+    while(*cmd == ' ' || *cmd == '\t')
+        cmd++;
+    end = cmd + strlen(cmd);
+    while(end > cmd && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+        *--end = 0;
+
+	if(*cmd){
+        if(end[-1] == '&'){
+            /* trailing '&' runs the command in the background */
+            *--end = 0;
+            while(end > cmd && (end[-1] == ' ' || end[-1] == '\t'))
+                *--end = 0;
+            if(*cmd)
+                console_background(ctx, cmd);
+        }else
+            console_run(ctx, cmd);
     }
-	fprintf(file,"%s>",g_cCwdBuf);
+	fprintf(ctx->file,"%s>",ctx->cwd);
 }
 
-line_buffer *console_buffer_get(int length)
+line_buffer *console_buffer_get(int length, FILE *file)
 {
     line_buffer *lb;
 
@@ -1075,6 +1472,8 @@ line_buffer *console_buffer_get(int length)
     if(lb){
         memset(lb,0,sizeof(line_buffer) + length);
         lb->length = length;
+        lb->ctx.file = file;
+        strcpy(lb->ctx.cwd, "/");
     }
     return lb;
 }
@@ -1084,20 +1483,20 @@ void console_parse(line_buffer *lb, char ch)
     if(ch == '\0')
         return;
 
-    fputc(ch,lb->file);
-        
+    fputc(ch,lb->ctx.file);
+
     if(ch == '\r'){
         (lb->buffer)[lb->index++] = ch;
         (lb->buffer)[lb->index] = '\0';
         lb->index = 0;
-        parse_cmd(lb->file,lb->buffer);
+        parse_cmd(&lb->ctx,lb->buffer);
     }else if(ch == '\b'){
         if(lb->index > 0)
             lb->index--;
     }else if(lb->index < lb->length){
         (lb->buffer)[lb->index++] = ch;
     }else{
-        fprintf(lb->file,"cmd buffer overflow\n");
+        fprintf(lb->ctx.file,"cmd buffer overflow\n");
     }
 }
 
@@ -1,7 +1,46 @@
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "ff.h"
+#include "CommandInterpreter.h"
 
+//*****************************************************************************
+//
+// Defines the size of the buffers that hold the path, or temporary
+// data from the SD card.  There are two buffers allocated of this size
+// in every console session.
+// The buffer size must be large enough to hold the longest expected
+// full path name, including the file name, and a trailing null character.
+//
+//*****************************************************************************
+#define PATH_BUF_SIZE   80
+#define LFN_BUF_SIZE    64
 
+//*****************************************************************************
+//
+// State of one console session.  Every UART, telnet session and background
+// job owns one, so commands running concurrently do not share buffers or
+// file objects.
+//
+//*****************************************************************************
 typedef struct{
-    FILE *file; 
+    FILE *file;                     /* output of the session */
+    char cwd[PATH_BUF_SIZE];        /* current working directory */
+    char tmp[PATH_BUF_SIZE];        /* scratch buffer for path names */
+    FIL file_object;
+    DIR dir_object;
+    FILINFO file_info;
+    char lfn[LFN_BUF_SIZE];         /* long name of file_info, shorter ones than this */
+    char *stream;                   /* heap string being streamed out by a command */
+    unsigned long stream_pos;
+    void *lz;                       /* lz_reader of an archive cat decompresses */
+    unsigned long total_size;       /* counters kept by streaming commands */
+    unsigned long file_count;
+    unsigned long dir_count;
+    char out[configCOMMAND_INT_MAX_OUTPUT_SIZE];
+}console_context;
+
+typedef struct{
+    console_context ctx;
     int index;
     int length;
     char buffer[1];
@@ -9,8 +48,13 @@ typedef struct{
 
 
 int mountSd(void);
+unsigned long checkFreeMem(void);
 void print_http(unsigned long size,char *content,void *pv);
 void file_http(unsigned long size,char *content,void *pv);
-line_buffer *console_buffer_get(int length);
+void fio_http(unsigned long size,char *content,void *pv);
+void console_register(void);
+line_buffer *console_buffer_get(int length, FILE *file);
 void console_parse(line_buffer *lb, char ch);
+void console_detach(FILE *file);
+int fputblock(const char *buffer, int length, FILE *f);
 
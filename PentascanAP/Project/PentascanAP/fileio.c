@@ -0,0 +1,603 @@
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* lwip library */
+#include "lwiplib.h"
+
+#include "ff.h"
+#include "health.h"
+#include "fileio.h"
+
+#define FIO_PRIORITY        (tskIDLE_PRIORITY + 2)
+#define FIO_STACK_SIZE      256
+#define FIO_REQUESTS        8
+/* files kept open between requests */
+#define FIO_FILES           2
+/* open files are synced and closed after this long without a request */
+#define FIO_IDLE_MSEC       5000
+/* a caller waits this long for a free request before giving up */
+#define FIO_QUEUE_MSEC      2000
+/* an idle service still wakes in time to check in */
+#define FIO_HEALTH_MSEC     60000
+
+typedef struct fio_request{
+    struct fio_request *next;
+    fio_op op;
+    int flags;
+    unsigned long seq;              /* order across both queues */
+    char path[FIO_PATH_LEN];        /* empty: every file, for a sync */
+    unsigned long offset;
+    unsigned int len;
+    unsigned char *data;            /* buf, or the buffer of a read */
+    fio_func fn;
+    void *arg;
+    fio_done done;
+    void *pv;
+    portTickType queued;
+    FRESULT result;
+    unsigned int moved;
+    xSemaphoreHandle wake;          /* for FIO_WAIT, made on first use */
+    unsigned char buf[FIO_BUF_SIZE];
+}fio_request;
+
+typedef struct{
+    fio_request *head;
+    fio_request *tail;
+}fio_queue;
+
+typedef struct{
+    char path[FIO_PATH_LEN];        /* empty when not open */
+    int write;
+    int dirty;
+    portTickType used;
+    FIL fil;
+}fio_file;
+
+static const char * const op_names[fio_op_count] = {
+    "read", "write", "append", "sync", "call"
+};
+
+static xSemaphoreHandle fio_lock;   /* queues, free list and stats */
+static xSemaphoreHandle fio_kick;   /* something was queued */
+static xSemaphoreHandle fio_slots;  /* counts the free requests */
+static fio_request *fio_free;
+static fio_queue fio_urgent;
+static fio_queue fio_normal;
+static unsigned long fio_seq;
+static fio_file *fio_files;
+static fio_stats fio_st;
+
+static fio_request *request_get(void)
+{
+    fio_request *req;
+
+    if(fio_lock == NULL)
+        return NULL;
+    if(xSemaphoreTake(fio_slots, FIO_QUEUE_MSEC / portTICK_RATE_MS) != pdPASS)
+        return NULL;
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    req = fio_free;
+    fio_free = req->next;
+    xSemaphoreGive(fio_lock);
+
+    req->next = NULL;
+    req->flags = 0;
+    req->path[0] = 0;
+    req->offset = 0;
+    req->len = 0;
+    req->data = req->buf;
+    req->fn = NULL;
+    req->arg = NULL;
+    req->done = NULL;
+    req->pv = NULL;
+    req->result = FR_OK;
+    req->moved = 0;
+    return req;
+}
+
+static void request_put(fio_request *req)
+{
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    req->next = fio_free;
+    fio_free = req;
+    xSemaphoreGive(fio_lock);
+    xSemaphoreGive(fio_slots);
+}
+
+/*
+ * queues a filled request. with FIO_WAIT it blocks until the service is
+ * done with it and gives the request back, moved gets the bytes moved.
+ */
+static FRESULT request_submit(fio_request *req, unsigned int *moved)
+{
+    fio_queue *q = (req->flags & FIO_URGENT) ? &fio_urgent : &fio_normal;
+    FRESULT result;
+
+    if((req->flags & FIO_WAIT) && req->wake == NULL){
+        vSemaphoreCreateBinary(req->wake);
+        if(req->wake == NULL){
+            request_put(req);
+            return FR_NOT_ENOUGH_CORE;
+        }
+        xSemaphoreTake(req->wake, 0);
+    }
+
+    req->queued = xTaskGetTickCount();
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    req->seq = ++fio_seq;
+    if(q->tail)
+        q->tail->next = req;
+    else
+        q->head = req;
+    q->tail = req;
+    if(++fio_st.queued > fio_st.queued_max)
+        fio_st.queued_max = fio_st.queued;
+    xSemaphoreGive(fio_lock);
+    xSemaphoreGive(fio_kick);
+
+    if(!(req->flags & FIO_WAIT))
+        return FR_OK;
+    xSemaphoreTake(req->wake, portMAX_DELAY);
+    result = req->result;
+    if(moved)
+        *moved = req->moved;
+    request_put(req);
+    return result;
+}
+
+static int path_match(const char *a, const char *b)
+{
+    return a[0] == 0 || b[0] == 0 || strcmp(a, b) == 0;
+}
+
+static void queue_remove(fio_queue *q, fio_request *req)
+{
+    fio_request *prev = NULL, *it;
+
+    for(it = q->head;it != req;prev = it, it = it->next)
+        ;
+    if(prev)
+        prev->next = req->next;
+    else
+        q->head = req->next;
+    if(q->tail == req)
+        q->tail = prev;
+    req->next = NULL;
+}
+
+/*
+ * next request to serve: the urgent queue first, but a normal request for
+ * the same file queued before the urgent one goes ahead of it.
+ */
+static fio_request *request_take(void)
+{
+    fio_queue *q;
+    fio_request *req, *it;
+
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    q = fio_urgent.head ? &fio_urgent : &fio_normal;
+    req = q->head;
+    if(req && q == &fio_urgent){
+        for(it = fio_normal.head;it && it->seq < req->seq;it = it->next){
+            if(path_match(it->path, req->path)){
+                q = &fio_normal;
+                req = it;
+                break;
+            }
+        }
+    }
+    if(req){
+        queue_remove(q, req);
+        fio_st.queued--;
+    }
+    xSemaphoreGive(fio_lock);
+    return req;
+}
+
+static void request_done(fio_request *req)
+{
+    if(req->done)
+        req->done(req->result, req->moved, req->pv);
+    if(req->flags & FIO_WAIT)
+        xSemaphoreGive(req->wake);
+    else
+        request_put(req);
+}
+
+static FRESULT file_close(fio_file *f)
+{
+    FRESULT result = FR_OK;
+
+    if(f->path[0])
+        result = f_close(&f->fil);
+    f->path[0] = 0;
+    f->dirty = 0;
+    return result;
+}
+
+static int files_open(void)
+{
+    int i;
+
+    for(i=0;i<FIO_FILES;i++)
+        if(fio_files[i].path[0])
+            return 1;
+    return 0;
+}
+
+/* the cached file for path, opened or reopened for what the request needs */
+static FRESULT file_get(const char *path, int write, int create, fio_file **out)
+{
+    fio_file *f, *lru = NULL;
+    FRESULT result;
+    BYTE mode;
+    int i;
+
+    *out = NULL;
+    for(i=0;i<FIO_FILES;i++){
+        f = &fio_files[i];
+        if(f->path[0] && strcmp(f->path, path) == 0){
+            if(!create && (f->write || !write)){
+                f->used = xTaskGetTickCount();
+                *out = f;
+                return FR_OK;
+            }
+            file_close(f);
+        }
+        if(lru == NULL || (lru->path[0] && (!f->path[0] || f->used - lru->used > 0x80000000UL)))
+            lru = f;
+    }
+
+    file_close(lru);
+    if(create)
+        mode = FA_READ | FA_WRITE | FA_CREATE_ALWAYS;
+    else if(write)
+        mode = FA_READ | FA_WRITE | FA_OPEN_ALWAYS;
+    else
+        mode = FA_READ | FA_OPEN_EXISTING;
+    result = f_open(&lru->fil, path, mode);
+    if(result != FR_OK)
+        return result;
+    strcpy(lru->path, path);
+    lru->write = write || create;
+    lru->used = xTaskGetTickCount();
+    *out = lru;
+    return FR_OK;
+}
+
+static void request_run(fio_request *req)
+{
+    fio_file *f = NULL;
+    FRESULT result;
+    UINT moved = 0;
+    int i;
+
+    switch(req->op){
+    case fio_op_read:
+        result = file_get(req->path, 0, 0, &f);
+        if(result == FR_OK)
+            result = f_lseek(&f->fil, req->offset);
+        if(result == FR_OK)
+            result = f_read(&f->fil, req->data, req->len, &moved);
+        break;
+    case fio_op_write:
+    case fio_op_append:
+        result = file_get(req->path, 1, req->flags & FIO_CREATE, &f);
+        if(result == FR_OK)
+            result = f_lseek(&f->fil, req->op == fio_op_append ? f_size(&f->fil) : req->offset);
+        if(result == FR_OK && req->len){
+            result = f_write(&f->fil, req->data, req->len, &moved);
+            f->dirty = 1;
+            /* a full card writes short without an error */
+            if(result == FR_OK && moved != req->len)
+                result = FR_DENIED;
+        }
+        break;
+    case fio_op_sync:
+        result = FR_OK;
+        for(i=0;i<FIO_FILES;i++){
+            f = &fio_files[i];
+            if(f->path[0] && f->dirty && path_match(f->path, req->path)){
+                f->dirty = 0;
+                if(f_sync(&f->fil) != FR_OK){
+                    result = FR_DISK_ERR;
+                    file_close(f);
+                }
+            }
+        }
+        f = NULL;
+        break;
+    default:
+        /* the function gets the file to itself, it may rename or remove it */
+        for(i=0;i<FIO_FILES;i++)
+            if(fio_files[i].path[0] && path_match(fio_files[i].path, req->path))
+                file_close(&fio_files[i]);
+        result = req->fn(req->path, req->arg);
+        break;
+    }
+
+    /* opened again by the next request, the card may have been swapped */
+    if(result != FR_OK && f)
+        file_close(f);
+    req->result = result;
+    req->moved = moved;
+}
+
+static void fio_task(void *pvParameters)
+{
+    fio_request *req;
+    fio_op_stats *st;
+    portTickType start;
+    unsigned long wait, busy;
+    int health = health_register("fileio", FIO_HEALTH_MSEC);
+    int i;
+
+    for(;;){
+        health_checkin(health);
+        req = request_take();
+        if(req == NULL){
+            if(xSemaphoreTake(fio_kick, (files_open() ? FIO_IDLE_MSEC : FIO_HEALTH_MSEC / 2)
+                              / portTICK_RATE_MS) != pdPASS){
+                for(i=0;i<FIO_FILES;i++)
+                    file_close(&fio_files[i]);
+                /* directory caches left unused since the last idle wake go
+                   back to the heap */
+                f_dcache(2);
+            }
+            continue;
+        }
+
+        start = xTaskGetTickCount();
+        request_run(req);
+        wait = (start - req->queued) * portTICK_RATE_MS;
+        busy = (xTaskGetTickCount() - start) * portTICK_RATE_MS;
+
+        xSemaphoreTake(fio_lock, portMAX_DELAY);
+        st = &fio_st.op[req->op];
+        st->count++;
+        st->wait_total += wait;
+        if(wait > st->wait_max)
+            st->wait_max = wait;
+        st->busy_total += busy;
+        if(busy > st->busy_max)
+            st->busy_max = busy;
+        if(req->result != FR_OK)
+            st->errors++;
+        xSemaphoreGive(fio_lock);
+
+        if(req->result != FR_OK)
+            printf("fileio %s %s: error %d\n", op_names[req->op], req->path, req->result);
+        request_done(req);
+    }
+}
+
+/* before the scheduler or from a task, once */
+void fio_start(void)
+{
+    fio_request *reqs;
+    xSemaphoreHandle lock;
+    int i;
+
+    if(fio_lock)
+        return;
+
+    fio_files = mem_malloc(sizeof(fio_file) * FIO_FILES);
+    reqs = mem_malloc(sizeof(fio_request) * FIO_REQUESTS);
+    fio_slots = xSemaphoreCreateCounting(FIO_REQUESTS, FIO_REQUESTS);
+    vSemaphoreCreateBinary(fio_kick);
+    lock = xSemaphoreCreateMutex();
+    if(fio_files == NULL || reqs == NULL || fio_slots == NULL || fio_kick == NULL || lock == NULL){
+        printf("fileio start fail\n");
+        return;
+    }
+    memset(fio_files, 0, sizeof(fio_file) * FIO_FILES);
+    memset(reqs, 0, sizeof(fio_request) * FIO_REQUESTS);
+    for(i=0;i<FIO_REQUESTS;i++){
+        reqs[i].next = fio_free;
+        fio_free = &reqs[i];
+    }
+
+    fio_lock = lock;
+    if(xTaskCreate(fio_task, (signed portCHAR *)"fileio", FIO_STACK_SIZE, NULL, FIO_PRIORITY, NULL) != pdPASS){
+        printf("fileio task creation fail\n");
+        fio_lock = NULL;
+    }
+}
+
+static FRESULT fio_path(fio_request *req, const char *path)
+{
+    if(path == NULL)
+        path = "";
+    if(strlen(path) >= FIO_PATH_LEN){
+        request_put(req);
+        return FR_INVALID_NAME;
+    }
+    strcpy(req->path, path);
+    return FR_OK;
+}
+
+FRESULT fio_read_async(const char *path, unsigned long offset, void *buf,
+                       unsigned int len, fio_done done, void *pv)
+{
+    fio_request *req = request_get();
+
+    if(req == NULL)
+        return fio_lock ? FR_TIMEOUT : FR_NOT_ENABLED;
+    if(fio_path(req, path) != FR_OK)
+        return FR_INVALID_NAME;
+    req->op = fio_op_read;
+    req->flags = FIO_URGENT;
+    req->offset = offset;
+    req->data = buf;
+    req->len = len;
+    req->done = done;
+    req->pv = pv;
+    return request_submit(req, NULL);
+}
+
+FRESULT fio_read(const char *path, unsigned long offset, void *buf,
+                 unsigned int len, unsigned int *read)
+{
+    fio_request *req = request_get();
+
+    *read = 0;
+    if(req == NULL)
+        return fio_lock ? FR_TIMEOUT : FR_NOT_ENABLED;
+    if(fio_path(req, path) != FR_OK)
+        return FR_INVALID_NAME;
+    req->op = fio_op_read;
+    req->flags = FIO_URGENT | FIO_WAIT;
+    req->offset = offset;
+    req->data = buf;
+    req->len = len;
+    return request_submit(req, read);
+}
+
+/* longer data goes in several requests, done and FIO_WAIT on the last */
+FRESULT fio_write(const char *path, unsigned long offset, const void *data,
+                  unsigned int len, int flags, fio_done done, void *pv)
+{
+    const unsigned char *p = data;
+    fio_request *req;
+    unsigned int n;
+    FRESULT result;
+
+    do{
+        req = request_get();
+        if(req == NULL)
+            return fio_lock ? FR_TIMEOUT : FR_NOT_ENABLED;
+        if(fio_path(req, path) != FR_OK)
+            return FR_INVALID_NAME;
+        n = len < FIO_BUF_SIZE ? len : FIO_BUF_SIZE;
+        req->op = fio_op_write;
+        req->flags = flags;
+        req->offset = offset;
+        memcpy(req->buf, p, n);
+        req->len = n;
+        len -= n;
+        p += n;
+        offset += n;
+        if(len){
+            req->flags &= ~FIO_WAIT;
+        }else{
+            req->done = done;
+            req->pv = pv;
+        }
+        result = request_submit(req, NULL);
+        flags &= ~FIO_CREATE;
+    }while(len && result == FR_OK);
+    return result;
+}
+
+FRESULT fio_append(const char *path, const void *data, unsigned int len,
+                   fio_done done, void *pv)
+{
+    const unsigned char *p = data;
+    fio_request *req, *tail;
+    unsigned int n;
+    int merged = 0;
+    FRESULT result = FR_OK;
+
+    if(fio_lock == NULL)
+        return FR_NOT_ENABLED;
+
+    /* fill up an append to the same file still waiting at the end of the
+       queue, it can carry one done callback */
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    tail = fio_normal.tail;
+    if(tail && tail->op == fio_op_append && !(done && tail->done)
+       && tail->len < FIO_BUF_SIZE && strcmp(tail->path, path) == 0){
+        n = FIO_BUF_SIZE - tail->len;
+        if(n > len)
+            n = len;
+        memcpy(tail->buf + tail->len, p, n);
+        tail->len += n;
+        len -= n;
+        p += n;
+        if(len == 0 && done){
+            tail->done = done;
+            tail->pv = pv;
+        }
+        fio_st.op[fio_op_append].merged++;
+        merged = 1;
+    }
+    xSemaphoreGive(fio_lock);
+    if(merged && len == 0)
+        return FR_OK;
+
+    do{
+        req = request_get();
+        if(req == NULL)
+            return FR_TIMEOUT;
+        if(fio_path(req, path) != FR_OK)
+            return FR_INVALID_NAME;
+        n = len < FIO_BUF_SIZE ? len : FIO_BUF_SIZE;
+        req->op = fio_op_append;
+        memcpy(req->buf, p, n);
+        req->len = n;
+        len -= n;
+        p += n;
+        if(len == 0){
+            req->done = done;
+            req->pv = pv;
+        }
+        result = request_submit(req, NULL);
+    }while(len && result == FR_OK);
+    return result;
+}
+
+/* path NULL syncs every open file */
+FRESULT fio_sync(const char *path, int flags, fio_done done, void *pv)
+{
+    fio_request *req = request_get();
+
+    if(req == NULL)
+        return fio_lock ? FR_TIMEOUT : FR_NOT_ENABLED;
+    if(fio_path(req, path) != FR_OK)
+        return FR_INVALID_NAME;
+    req->op = fio_op_sync;
+    req->flags = flags;
+    req->done = done;
+    req->pv = pv;
+    return request_submit(req, NULL);
+}
+
+/*
+ * runs fn in the service after the requests queued before, with path
+ * closed. for what the other requests do not cover: stat, rename, remove.
+ */
+FRESULT fio_call(const char *path, fio_func fn, void *arg, int flags)
+{
+    fio_request *req = request_get();
+
+    if(req == NULL)
+        return fio_lock ? FR_TIMEOUT : FR_NOT_ENABLED;
+    if(fio_path(req, path) != FR_OK)
+        return FR_INVALID_NAME;
+    req->op = fio_op_call;
+    req->flags = flags;
+    req->fn = fn;
+    req->arg = arg;
+    return request_submit(req, NULL);
+}
+
+void fio_stats_get(fio_stats *stats)
+{
+    if(fio_lock == NULL){
+        memset(stats, 0, sizeof(fio_stats));
+        return;
+    }
+    xSemaphoreTake(fio_lock, portMAX_DELAY);
+    *stats = fio_st;
+    xSemaphoreGive(fio_lock);
+}
+
+const char *fio_op_name(fio_op op)
+{
+    return op < fio_op_count ? op_names[op] : "?";
+}
@@ -0,0 +1,68 @@
+/*
+ * file i/o service. one task owns the card for the tasks that write to it,
+ * they queue requests and go on instead of waiting for the card.
+ *
+ * writes and appends copy the data into the request, a done callback (run
+ * in the service task) tells how it went. reads and requests marked
+ * FIO_URGENT are served ahead of the normal queue, after the normal
+ * requests queued earlier for the same file so a read sees what was
+ * written before it. appends to a file queued back to back are merged into
+ * one request. the service keeps the last FIO_FILES files open and syncs
+ * and closes them once it has been idle for FIO_IDLE_MSEC.
+ *
+ * with FIO_WAIT the caller blocks until the request is done and gets its
+ * result, fio_read() always waits.
+ */
+#include "ff.h"
+
+#define FIO_PATH_LEN        48
+#define FIO_BUF_SIZE        256
+
+/* flags */
+#define FIO_CREATE          0x01    /* write: create the file or truncate it first */
+#define FIO_URGENT          0x02    /* ahead of the normal queue */
+#define FIO_WAIT            0x04    /* block until done, returns the result */
+
+typedef enum{
+    fio_op_read,
+    fio_op_write,
+    fio_op_append,
+    fio_op_sync,
+    fio_op_call,
+    fio_op_count
+}fio_op;
+
+/* called in the service task, len is the bytes read or written */
+typedef void (*fio_done)(FRESULT result, unsigned int len, void *pv);
+/* run by fio_call() in the service task, the file is not held open */
+typedef FRESULT (*fio_func)(const char *path, void *arg);
+
+typedef struct{
+    unsigned long count;
+    unsigned long merged;           /* appends folded into a queued one */
+    unsigned long wait_total;       /* msec in the queue */
+    unsigned long wait_max;
+    unsigned long busy_total;       /* msec on the card */
+    unsigned long busy_max;
+    unsigned long errors;
+}fio_op_stats;
+
+typedef struct{
+    fio_op_stats op[fio_op_count];
+    unsigned long queued;           /* requests in the queues now */
+    unsigned long queued_max;
+}fio_stats;
+
+void fio_start(void);
+FRESULT fio_read(const char *path, unsigned long offset, void *buf,
+                 unsigned int len, unsigned int *read);
+FRESULT fio_read_async(const char *path, unsigned long offset, void *buf,
+                       unsigned int len, fio_done done, void *pv);
+FRESULT fio_write(const char *path, unsigned long offset, const void *data,
+                  unsigned int len, int flags, fio_done done, void *pv);
+FRESULT fio_append(const char *path, const void *data, unsigned int len,
+                   fio_done done, void *pv);
+FRESULT fio_sync(const char *path, int flags, fio_done done, void *pv);
+FRESULT fio_call(const char *path, fio_func fn, void *arg, int flags);
+void fio_stats_get(fio_stats *stats);
+const char *fio_op_name(fio_op op);
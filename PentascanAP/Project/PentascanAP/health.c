@@ -0,0 +1,372 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Hardware library includes. */
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "hw_ints.h"
+#include "sysctl.h"
+#include "interrupt.h"
+#include "watchdog.h"
+
+/* lwip library */
+#include "lwiplib.h"
+
+#include "ff.h"
+#include "Rtc.h"
+#include "log.h"
+#include "health.h"
+
+/* the supervisor runs above every task it watches */
+#define HEALTH_PRIORITY         (configMAX_PRIORITIES - 1)
+#define HEALTH_STACK_SIZE       160
+#define HEALTH_POLL_MSEC        1000
+/* without a feed for this long the watchdog interrupt writes a record, the
+   second time-out resets */
+#define HEALTH_WATCHDOG_MSEC    4000
+/* above configMAX_SYSCALL_INTERRUPT_PRIORITY so critical sections do not
+   hold it off, it uses no kernel calls that need masking */
+#define HEALTH_WATCHDOG_PRIO    (1 << 5)
+/* the tcpip thread is checked through a callback posted every poll */
+#define HEALTH_TCPIP_MSEC       10000
+
+#define HEALTH_MAGIC            0x48544c48UL    /* "HLTH" */
+#define HEALTH_WHY_LEN          16
+
+typedef struct{
+    unsigned long magic;
+    unsigned long reason;       /* health_reason */
+    unsigned long time;         /* RtcGetTime() */
+    unsigned long overdue;      /* msec past the period, for a stall */
+    unsigned long stack_free;   /* words */
+    char task[configMAX_TASK_NAME_LEN];
+    char why[HEALTH_WHY_LEN];
+    unsigned long events;
+#if ( configUSE_TRACE_RECORDER == 1 )
+    xTraceRecord trace[HEALTH_TRACE_EVENTS];
+#endif
+    unsigned long check;
+}health_record;
+
+/* fails to compile when the record outgrows its ram */
+typedef char health_record_fits[(sizeof(health_record) <= HEALTH_RECORD_SIZE) ? 1 : -1];
+
+#define crash   ((health_record *)HEALTH_RECORD_BASE)
+
+typedef struct{
+    const char *name;
+    xTaskHandle task;
+    portTickType period;
+    volatile portTickType last;
+}health_task;
+
+static const char * const reason_names[] = {
+    "none", "stall", "watchdog", "stack overflow", "reboot"
+};
+
+static health_task tasks[HEALTH_MAX_TASKS];
+static volatile int task_count;
+static int tcpip_id = -1;
+static int stalled;
+static char last_reset[48] = "unknown";
+
+static unsigned long record_check(void)
+{
+    const unsigned long *word = (const unsigned long *)crash;
+    unsigned long sum = 0;
+    int i;
+
+    for(i=0;i<(int)(offsetof(health_record, check) / sizeof(unsigned long));i++)
+        sum = (sum << 1 | sum >> 31) ^ word[i];
+    return ~sum;
+}
+
+static void copy_name(char *dst, const char *src, int len)
+{
+    int i;
+
+    for(i=0;i<len - 1 && src && src[i];i++)
+        dst[i] = src[i];
+    dst[i] = 0;
+}
+
+/*
+ * fills the crash record, from a task, the watchdog interrupt or the stack
+ * overflow hook. only reads kernel state, never blocks.
+ */
+static void record_write(health_reason reason, xTaskHandle task, const char *name,
+                         unsigned long overdue, const char *why)
+{
+    memset(crash, 0, sizeof(health_record));
+    crash->reason = reason;
+    crash->time = RtcGetTime();
+    crash->overdue = overdue;
+    if(task != NULL){
+        if(name == NULL)
+            name = (const char *)pcTaskGetTaskName(task);
+        /* an overflowed stack has no high-water mark worth reading */
+        if(reason != health_stack_overflow)
+            crash->stack_free = uxTaskGetStackHighWaterMark(task);
+    }
+    copy_name(crash->task, name, sizeof(crash->task));
+    copy_name(crash->why, why, sizeof(crash->why));
+#if ( configUSE_TRACE_RECORDER == 1 )
+    /* keep what led up to it in the ring too, for "trace dump" if it lives on */
+    vTraceStop();
+    crash->events = ulTraceLast(crash->trace, HEALTH_TRACE_EVENTS);
+#endif
+    crash->magic = HEALTH_MAGIC;
+    crash->check = record_check();
+}
+
+static int record_valid(void)
+{
+    return crash->magic == HEALTH_MAGIC && crash->reason <= health_reboot
+           && crash->events <= HEALTH_TRACE_EVENTS && crash->check == record_check();
+}
+
+/*
+ * the watchdog timed out once, the supervisor has not fed it for
+ * HEALTH_WATCHDOG_MSEC. the interrupt is left pending so the second
+ * time-out resets.
+ */
+void WatchdogIntHandler(void)
+{
+    if(!record_valid())
+        record_write(health_watchdog, xTaskGetCurrentTaskHandle(), NULL, 0, NULL);
+    IntDisable(INT_WATCHDOG);
+}
+
+/* appends the record to the crash log */
+static void record_save(void)
+{
+    FIL *file;
+    char *line;
+    unsigned int written;
+    int len;
+    unsigned long i;
+    struct tm *tm;
+#if ( configUSE_TRACE_RECORDER == 1 )
+    const xTraceRecord *event, *last;
+#endif
+
+    file = mem_malloc(sizeof(FIL));
+    line = mem_malloc(96);
+    if(file == NULL || line == NULL)
+        goto done;
+    if(f_open(file, HEALTH_CRASH_LOG, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK)
+        goto done;
+    if(f_lseek(file, f_size(file)) != FR_OK)
+        goto close;
+
+    tm = localtime((time_t *)&crash->time);
+    len = sprintf(line, "%04d/%02d/%02d %02d:%02d:%02d %s, task %s, stack free %lu words",
+                  tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec,
+                  reason_names[crash->reason], crash->task, crash->stack_free);
+    if(crash->reason == health_stall)
+        len += sprintf(line + len, ", %lu msec late", crash->overdue);
+    len += sprintf(line + len, "\n");
+    f_write(file, line, len, &written);
+
+#if ( configUSE_TRACE_RECORDER == 1 )
+    /* oldest first, times in usec before the last event, ids as in trace.h */
+    last = &crash->trace[crash->events ? crash->events - 1 : 0];
+    for(i=0;i<crash->events;i++){
+        event = &crash->trace[i];
+        len = sprintf(line, "  -%8lu event %3u id %3u param %5u\n",
+                      (last->ulTime - event->ulTime) / (configCPU_CLOCK_HZ / 1000000),
+                      event->ucEvent, event->ucId, event->usParam);
+        if(f_write(file, line, len, &written) != FR_OK)
+            break;
+    }
+#endif
+
+close:
+    f_close(file);
+done:
+    if(file)
+        mem_free(file);
+    if(line)
+        mem_free(line);
+}
+
+static const char *reset_cause(unsigned long cause)
+{
+    if(cause & SYSCTL_CAUSE_WDOG)
+        return "watchdog";
+    if(cause & SYSCTL_CAUSE_SW)
+        return "software";
+    if(cause & SYSCTL_CAUSE_BOR)
+        return "brown-out";
+    if(cause & SYSCTL_CAUSE_POR)
+        return "power on";
+    if(cause & SYSCTL_CAUSE_EXT)
+        return "reset pin";
+    return "unknown";
+}
+
+/* reports the previous reset, the card must be mounted for the crash log */
+static void health_report(void)
+{
+    unsigned long cause = SysCtlResetCauseGet();
+
+    SysCtlResetCauseClear(cause);
+    if(!record_valid()){
+        snprintf(last_reset, sizeof(last_reset), "%s", reset_cause(cause));
+        syslog(LOG_LEVEL_INFO,"health: reset by %s", last_reset);
+        return;
+    }
+
+    if(crash->reason == health_reboot){
+        snprintf(last_reset, sizeof(last_reset), "reboot, %s", crash->why);
+        syslog(LOG_LEVEL_INFO,"health: rebooted by %s", crash->why);
+    }else{
+        snprintf(last_reset, sizeof(last_reset), "%s, %s %s", reset_cause(cause),
+                 crash->task, reason_names[crash->reason]);
+        syslog(LOG_LEVEL_ERROR,"health: reset by %s, stack free %lu words, details in %s",
+               last_reset, crash->stack_free, HEALTH_CRASH_LOG);
+        record_save();
+    }
+    crash->magic = 0;
+}
+
+static void health_tcpip(void *arg)
+{
+    if(tcpip_id < 0)
+        tcpip_id = health_register("tcpip", HEALTH_TCPIP_MSEC);
+    health_checkin(tcpip_id);
+}
+
+static void health_supervisor(void *pvParameters)
+{
+    portTickType now, late;
+    unsigned long load = SysCtlClockGet() / 1000 * HEALTH_WATCHDOG_MSEC;
+    int i;
+
+    for(;;){
+        vTaskDelay(HEALTH_POLL_MSEC / portTICK_RATE_MS);
+        /* does not block, a full mailbox shows up as a missed check-in */
+        tcpip_callback_with_block(health_tcpip, NULL, 0);
+
+        now = xTaskGetTickCount();
+        for(i=0;i<task_count;i++){
+            late = now - tasks[i].last;
+            if(late > tasks[i].period)
+                break;
+        }
+        if(i == task_count){
+            /* restarts the count down, the load register ignores writes
+               while locked */
+            WatchdogUnlock(WATCHDOG_BASE);
+            WatchdogReloadSet(WATCHDOG_BASE, load);
+            WatchdogLock(WATCHDOG_BASE);
+            continue;
+        }
+
+        /* stop feeding, the watchdog resets once the log is out */
+        if(!stalled){
+            stalled = 1;
+            record_write(health_stall, tasks[i].task, tasks[i].name,
+                         (late - tasks[i].period) * portTICK_RATE_MS, NULL);
+            syslog(LOG_LEVEL_ERROR,"health: %s missed its check-in by %lu msec, resetting",
+                   tasks[i].name, crash->overdue);
+            syslog_flush(HEALTH_WATCHDOG_MSEC / 2);
+        }
+    }
+}
+
+/*
+ * registers the calling task, it has to check in at least every period msec
+ * from now on. returns the id for health_checkin(), -1 when the table is
+ * full.
+ */
+int health_register(const char *name, unsigned long period)
+{
+    int id = -1;
+
+    taskENTER_CRITICAL();
+    if(task_count < HEALTH_MAX_TASKS){
+        id = task_count;
+        tasks[id].name = name;
+        tasks[id].task = xTaskGetCurrentTaskHandle();
+        tasks[id].period = period / portTICK_RATE_MS;
+        tasks[id].last = xTaskGetTickCount();
+        task_count++;
+    }
+    taskEXIT_CRITICAL();
+    return id;
+}
+
+void health_checkin(int id)
+{
+    if(id >= 0 && id < task_count)
+        tasks[id].last = xTaskGetTickCount();
+}
+
+/*
+ * reports the last reset and arms the watchdog. call once syslog runs and
+ * the card is mounted.
+ */
+void health_start(void)
+{
+    static int started;
+
+    if(started)
+        return;
+    started = 1;
+
+    health_report();
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_WDOG);
+    WatchdogReloadSet(WATCHDOG_BASE, SysCtlClockGet() / 1000 * HEALTH_WATCHDOG_MSEC);
+    /* hold the count while the debugger has the cpu halted */
+    WatchdogStallEnable(WATCHDOG_BASE);
+    WatchdogResetEnable(WATCHDOG_BASE);
+    IntPrioritySet(INT_WATCHDOG, HEALTH_WATCHDOG_PRIO);
+    IntEnable(INT_WATCHDOG);
+    WatchdogEnable(WATCHDOG_BASE);
+    WatchdogLock(WATCHDOG_BASE);
+
+    xTaskCreate(health_supervisor, (signed portCHAR *)"health", HEALTH_STACK_SIZE, NULL, HEALTH_PRIORITY, NULL);
+}
+
+int health_info_get(int id, health_info *info)
+{
+    if(id < 0 || id >= task_count)
+        return -1;
+    info->name = tasks[id].name;
+    info->period = tasks[id].period * portTICK_RATE_MS;
+    info->age = (xTaskGetTickCount() - tasks[id].last) * portTICK_RATE_MS;
+    info->stack_free = uxTaskGetStackHighWaterMark(tasks[id].task);
+    return 0;
+}
+
+const char *health_last_reset(void)
+{
+    return last_reset;
+}
+
+/*
+ * records a fatal error and resets at once, from the stack overflow hook or
+ * a fault handler where nothing can wait.
+ */
+void health_panic(health_reason reason, xTaskHandle task, const char *name)
+{
+    record_write(reason, task, name, 0, NULL);
+    SysCtlReset();
+}
+
+/* a reset somebody asked for, why shows up in the log after it */
+void health_reset(const char *why)
+{
+    syslog(LOG_LEVEL_INFO,"health: reset by %s", why);
+    syslog_flush(1000);
+    record_write(health_reboot, NULL, NULL, 0, why);
+    SysCtlReset();
+}
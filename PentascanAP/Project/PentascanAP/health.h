@@ -0,0 +1,49 @@
+/*
+ * health monitor and watchdog.
+ *
+ * a task that must keep running registers with health_register() and calls
+ * health_checkin() at least once a period. the supervisor looks at the
+ * check-ins every HEALTH_POLL_MSEC and feeds the watchdog only while all of
+ * them are on time. a task that is late gets a crash record written naming
+ * it, with its stack high-water mark and the last kernel trace events, and
+ * the watchdog resets the board. a supervisor that does not run at all is
+ * caught by the watchdog interrupt, which writes the record for whatever
+ * task was running.
+ *
+ * the record sits in the top HEALTH_RECORD_SIZE bytes of ram, which neither
+ * the app (IRAM in the project ends below it) nor the boot stage use, so it
+ * survives the reset. health_start() logs it and appends it to
+ * HEALTH_CRASH_LOG.
+ */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define HEALTH_RECORD_BASE  0x2000FE00UL
+#define HEALTH_RECORD_SIZE  0x200
+#define HEALTH_CRASH_LOG    "/log/crash.log"
+
+#define HEALTH_MAX_TASKS    8
+#define HEALTH_TRACE_EVENTS 40
+
+typedef enum{
+    health_none,
+    health_stall,               /* a task missed its check-in */
+    health_watchdog,            /* the supervisor itself did not run */
+    health_stack_overflow,
+    health_reboot               /* asked for, reboot command or ota */
+}health_reason;
+
+typedef struct{
+    const char *name;
+    unsigned long period;       /* msec */
+    unsigned long age;          /* msec since the last check-in */
+    unsigned long stack_free;   /* words never used */
+}health_info;
+
+int health_register(const char *name, unsigned long period);
+void health_checkin(int id);
+void health_start(void);
+int health_info_get(int id, health_info *info);
+const char *health_last_reset(void);
+void health_panic(health_reason reason, xTaskHandle task, const char *name);
+void health_reset(const char *why);
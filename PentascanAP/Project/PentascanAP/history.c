@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* lwip library */
+#include "lwiplib.h"
+
+#include "ff.h"
+#include "Rtc.h"
+#include "log.h"
+#include "fileio.h"
+#include "SensorManager.h"
+#include "history.h"
+
+#define HISTORY_DIR         "/history"
+/* samples taken before the clock was set are dropped, 2013/01/01 */
+#define HISTORY_MIN_TIME    1356998400UL
+
+static xTsdbWriter *history_writer;
+static int history_ready;
+static volatile unsigned long history_count;   /* blocks a query looks at */
+static unsigned long history_synced;    /* records of the open block on the card */
+static volatile int history_lost;       /* a write failed, rewrite the block whole */
+static sensor_node history_node[SENSOR_NODE_MAX];
+
+/* in the file i/o service, picks up the open block left in the file */
+static FRESULT history_open(const char *path, void *arg)
+{
+    FIL *file;
+    unsigned char *block;
+    unsigned long blocks = 0;
+    unsigned int count;
+    FRESULT fresult;
+    long resume = -1;
+
+    fresult = f_mkdir(HISTORY_DIR);
+    if(fresult != FR_OK && fresult != FR_EXIST)
+        return fresult;
+
+    file = mem_malloc(sizeof(FIL));
+    block = mem_malloc(TSDB_BLOCK_SIZE);
+    if(file == NULL || block == NULL){
+        fresult = FR_NOT_ENOUGH_CORE;
+        goto done;
+    }
+    fresult = f_open(file, path, FA_READ | FA_OPEN_EXISTING);
+    if(fresult == FR_OK){
+        blocks = (f_size(file) + TSDB_BLOCK_SIZE - 1) / TSDB_BLOCK_SIZE;
+        memset(block, 0, TSDB_BLOCK_SIZE);
+        if(blocks && f_lseek(file, (blocks - 1) * TSDB_BLOCK_SIZE) == FR_OK
+           && f_read(file, block, TSDB_BLOCK_SIZE, &count) == FR_OK)
+            resume = lTsdbWriterResume(history_writer, block);
+        f_close(file);
+    }else if(fresult == FR_NO_FILE){
+        fresult = FR_OK;
+    }else{
+        goto done;
+    }
+
+    if(resume == 0){
+        history_synced = lTsdbBlockCheck(block);
+    }else{
+        /* a new block after a sealed one, or over a damaged one */
+        if(blocks && resume < 0)
+            blocks--;
+        vTsdbWriterInit(history_writer, blocks);
+        history_synced = TSDB_DATA_OFFSET;
+    }
+    history_count = blocks;
+
+done:
+    if(file)
+        mem_free(file);
+    if(block)
+        mem_free(block);
+    return fresult;
+}
+
+static int history_prepare(void)
+{
+    if(history_ready)
+        return 0;
+    if(history_writer == NULL){
+        history_writer = mem_malloc(sizeof(xTsdbWriter));
+        if(history_writer == NULL)
+            return -1;
+    }
+    if(fio_call(HISTORY_PATH, history_open, NULL, FIO_WAIT) != FR_OK)
+        return -1;
+    history_ready = 1;
+    return 0;
+}
+
+/* after the card is mounted, before the first sample */
+int history_start(void)
+{
+    if(history_prepare()){
+        syslog(LOG_LEVEL_WARNING, "history: %s not available", HISTORY_PATH);
+        return -1;
+    }
+    syslog(LOG_LEVEL_INFO, "history: %lu blocks in %s", history_count, HISTORY_PATH);
+    return 0;
+}
+
+static void history_done(FRESULT result, unsigned int len, void *pv)
+{
+    if(result != FR_OK)
+        history_lost = 1;
+}
+
+/* queues what changed in the open block, the records before the header */
+static void history_write(void)
+{
+    unsigned char *block = history_writer->ucBlock;
+    xTsdbHeader header;
+    unsigned long base;
+
+    lTsdbHeaderGet(block, &header);
+    base = header.ulSeq * TSDB_BLOCK_SIZE;
+    if(history_lost){
+        history_lost = 0;
+        history_synced = TSDB_DATA_OFFSET;
+    }
+    if(header.usUsed > history_synced
+       && fio_write(HISTORY_PATH, base + history_synced, block + history_synced,
+                    header.usUsed - history_synced, 0, history_done, NULL) != FR_OK)
+        history_lost = 1;
+    if(fio_write(HISTORY_PATH, base, block, TSDB_DATA_OFFSET, 0, history_done, NULL) != FR_OK)
+        history_lost = 1;
+    history_synced = header.usUsed;
+    history_count = header.ulSeq + 1;
+}
+
+/* one sample of every sensor, once a report period from the http task */
+void history_sample(void)
+{
+    unsigned long now = RtcGetTime();
+    long values[TSDB_FIELDS];
+    xTsdbHeader header;
+    int i, count;
+
+    if(now < HISTORY_MIN_TIME || history_prepare())
+        return;
+
+    count = sensor_snapshot(history_node, SENSOR_NODE_MAX);
+    for(i=0;i<count;i++){
+        values[0] = history_node[i].temp;
+        values[1] = history_node[i].humidity;
+        values[2] = history_node[i].co2;
+        values[3] = history_node[i].sound;
+        if(lTsdbAppend(history_writer, history_node[i].addr, now, values) > 0){
+            /* full, sealed and followed by the next block */
+            vTsdbSeal(history_writer);
+            history_write();
+            lTsdbHeaderGet(history_writer->ucBlock, &header);
+            vTsdbWriterInit(history_writer, header.ulSeq + 1);
+            history_synced = TSDB_DATA_OFFSET;
+            lTsdbAppend(history_writer, history_node[i].addr, now, values);
+        }
+    }
+    history_write();
+}
+
+unsigned long history_blocks(void)
+{
+    return history_count;
+}
+
+/* reads go ahead of queued writes, after the ones to the history file */
+static int history_read(void *pv, unsigned long offset, unsigned char *buf, unsigned long len)
+{
+    unsigned int count;
+
+    if(fio_read(HISTORY_PATH, offset, buf, len, &count) != FR_OK)
+        return -1;
+    /* a block header may be on the card before its records */
+    memset(buf + count, 0, len - count);
+    return 0;
+}
+
+/*
+ * runs query over the history file, the caller fills in the sensor, the
+ * time range, the step and the point function. returns the points sent or
+ * -1 on an error.
+ */
+long history_query(xTsdbQuery *query)
+{
+    long ret;
+
+    query->ulBlocks = history_count;
+    query->pxRead = history_read;
+    query->pvFile = NULL;
+    query->pucBuffer = mem_malloc(TSDB_BLOCK_SIZE);
+    if(query->pucBuffer == NULL)
+        return -1;
+    ret = lTsdbQuery(query);
+    mem_free(query->pucBuffer);
+    query->pucBuffer = NULL;
+    return ret;
+}
+
+/* temperature and humidity are kept in 1/100 */
+char *history_fixed(char *buf, long value)
+{
+    sprintf(buf, "%s%ld.%02ld", value < 0 ? "-" : "", labs(value) / 100, labs(value) % 100);
+    return buf;
+}
@@ -0,0 +1,20 @@
+/*
+ * sensor history. every report period one sample of each sensor is added
+ * to HISTORY_PATH, a block indexed time-series file (Common/Utils/tsdb.h),
+ * so the gateway itself can tell what a sensor read over the last hours.
+ * "history" on the console and /history?addr=A3 on the http server query
+ * it, Tools/tsdump reads a copy of the file on the host.
+ *
+ * the open block is rewritten through the file i/o service after every
+ * sample, its records first and then the header that counts them, so a
+ * reset loses at most the samples still queued.
+ */
+#include "tsdb.h"
+
+#define HISTORY_PATH        "/history/sensor.tsd"
+
+int history_start(void);
+void history_sample(void);
+unsigned long history_blocks(void);
+long history_query(xTsdbQuery *query);
+char *history_fixed(char *buf, long value);
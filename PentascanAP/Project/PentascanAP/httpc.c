@@ -20,6 +20,9 @@
 #define PROTO_FTP   82
 
 #define HTTP_BUFFER_SIZE    2048
+/* a recv() waiting longer than this fails the request, lwIP 1.4 has no
+   send or connect time-out, those end with the tcp retransmission limits */
+#define HTTP_RECV_TIMEOUT_MS    10000
 #define LINEBUFFER_SIZE	160
 
 typedef enum{
@@ -30,7 +33,9 @@ typedef enum{
 	http_transfer_encoding,
     http_date,
 	http_resp_version,
-	http_connection_close
+	http_connection_close,
+	http_content_range,
+	http_range
 }http_string;
 
 static const char * const http_string_table[] = 
@@ -42,7 +47,9 @@ static const char * const http_string_table[] =
 	"Transfer-Encoding: chunked",
     "Date: ",
 	" HTTP/1.1\r\nAccept: *.*\r\n",
-	"\r\nConnection: close\r\n\r\n"
+	"\r\nConnection: close\r\n\r\n",
+	"Content-Range: bytes ",
+	"\r\nRange: bytes="
 };
 
 /* split host, port, url */
@@ -172,6 +179,23 @@ static int parseUrl(char *url, char **hostname, unsigned int *port_num, char **l
 	return protocol;
 }
 
+/* date set usign http date */
+void http_date_sync(char *date)
+{
+    unsigned long http_time, system_time;
+    system_time = RtcGetTime();
+    http_time = RtcConvertDateString(date);
+    if(http_time){
+        if(system_time > http_time){
+            if(system_time - http_time > 10 * 60) // 10 minute
+                RtcSetTime(http_time);
+        }else{
+            if(http_time - system_time > 10 * 60) // 10 minute
+                RtcSetTime(http_time);
+        }
+    }
+}
+
 static char *GetLine(int sock, char *buffer, int buffer_len)
 {
 	int pack_len;
@@ -196,7 +220,36 @@ static char *GetLine(int sock, char *buffer, int buffer_len)
 }
 
 
-int http_get(char *hostname, unsigned short port, char *location, http_parse_cb callback, void *pv)
+/*
+ * passes received body data to the callback. a server ignoring the Range
+ * header sends the whole body, the part before the requested offset is
+ * dropped here. returns the negative callback result to abort.
+ */
+static int http_deliver(unsigned long *skip, unsigned long size, char *data, int abortable,
+                        http_parse_cb callback, void *pv)
+{
+    int ret;
+
+    if(*skip >= size){
+        *skip -= size;
+        return 0;
+    }
+    data += *skip;
+    size -= *skip;
+    *skip = 0;
+
+    if(callback == NULL)
+        return 0;
+    ret = (callback)(size, data, pv);
+    return (abortable && ret < 0) ? ret : 0;
+}
+
+/*
+ * GET location from offset on. with abortable the callback is only called
+ * for a 200 or 206 response and a negative return of it ends the transfer.
+ */
+static int http_request(char *hostname, unsigned short port, char *location, unsigned long offset,
+                        int abortable, http_parse_cb callback, void *pv)
 {
     char *ptr;
     char *recv_buffer;
@@ -205,11 +258,14 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
     int http_socket;
 	int ret_code = -1;
     int i,ret;
+    int timeout = HTTP_RECV_TIMEOUT_MS;
 	
 	int http_chunked = 0;
 	int http_status = 0;
 	long http_length = 0, total_length = 0, chunk_length = 0, remain_length;
 	int pack_len;
+	unsigned long skip = 0, range_start = 0;
+	char range[20];
 
     struct hostent *http_host;
     struct sockaddr_in sock_addr;
@@ -220,6 +276,8 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
         DEBUG_HTTP(("socket create fail\n"));
         return http_status;
     }
+    /* every recv() below, the header lines included, gives up after this */
+    setsockopt(http_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
     sock_addr.sin_family = AF_INET;
     sock_addr.sin_len = sizeof(struct sockaddr_in);
@@ -258,6 +316,13 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 		ret = send(http_socket,"Host: ",6,MSG_MORE);
 	if(ret > 0)
 		ret = send(http_socket,hostname,strlen(hostname),MSG_MORE);
+	if(ret > 0 && offset){
+		ret = send(http_socket,http_string_table[http_range],strlen(http_string_table[http_range]),MSG_MORE);
+		if(ret > 0){
+			sprintf(range,"%lu-",offset);
+			ret = send(http_socket,range,strlen(range),MSG_MORE);
+		}
+	}
 	if(ret > 0)
 		ret = send(http_socket,http_string_table[http_connection_close],strlen(http_string_table[http_connection_close]),0);
 
@@ -297,23 +362,15 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 		}
 		else if(!strncmp(ptr,http_string_table[http_date],strlen(http_string_table[http_date])))
 		{
-		    /* date set usign http date */
-		    unsigned long http_time, system_time;
-		    system_time = RtcGetTime();
-		    http_time = RtcConvertDateString(ptr + strlen(http_string_table[http_date]));
-		    if(http_time){
-		        if(system_time > http_time){
-		            if(system_time - http_time > 10 * 60) // 10 minute
-		                RtcSetTime(http_time);
-		        }else{
-		            if(http_time - system_time > 10 * 60) // 10 minute
-		                RtcSetTime(http_time);
-		        }
-		    }
+		    http_date_sync(ptr + strlen(http_string_table[http_date]));
 		}
 		else if(!strncmp(ptr,http_string_table[http_content_type],strlen(http_string_table[http_content_type])))
 		{
 		}
+		else if(!strncmp(ptr,http_string_table[http_content_range],strlen(http_string_table[http_content_range])))
+		{
+			range_start = strtoul(ptr + strlen(http_string_table[http_content_range]), NULL, 10);
+		}
 
         ptr = GetLine(http_socket,line_buffer, 256);
 	}
@@ -321,6 +378,21 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 	DEBUG_HTTP(("http result code = %d\n",http_status));
 	DEBUG_HTTP(("content length = %ld\n",http_length));
 
+	if(abortable && http_status != 200 && http_status != 206){
+		close(http_socket);
+        mem_free(line_buffer);
+		return http_status;
+	}
+	if(offset && http_status == 200){
+		DEBUG_HTTP(("range ignored, skip %lu\n",offset));
+		skip = offset;
+	}else if(http_status == 206 && range_start != offset){
+		DEBUG_HTTP(("range %lu, expected %lu\n",range_start,offset));
+		close(http_socket);
+        mem_free(line_buffer);
+		return -9;
+	}
+
 	recv_buffer = mem_malloc(HTTP_BUFFER_SIZE);
 	if(!recv_buffer){
 		DEBUG_HTTP(("memory allocation fail\n"));
@@ -353,8 +425,13 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 					remain_length -= pack_len;
 
 					/* process data here */
-					if(callback)
-					    (callback)(pack_len, recv_buffer, pv);
+					ret = http_deliver(&skip, pack_len, recv_buffer, abortable, callback, pv);
+					if(ret < 0){
+						close(http_socket);
+						mem_free(recv_buffer);
+						mem_free(line_buffer);
+						return -8;
+					}
 #if 0
 					for(i=0;i<pack_len;i++)
 						printf("%c",recv_buffer[i]);
@@ -393,8 +470,13 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 		{
 			total_length += pack_len;
             /* process data here */
-            if(callback)
-                (callback)(pack_len, recv_buffer, pv);
+            ret = http_deliver(&skip, pack_len, recv_buffer, abortable, callback, pv);
+            if(ret < 0){
+                close(http_socket);
+                mem_free(recv_buffer);
+                mem_free(line_buffer);
+                return -8;
+            }
 #if 0
 			for(i=0;i<pack_len;i++)
 				printf("%c",recv_buffer[i]);
@@ -419,6 +501,31 @@ int http_get(char *hostname, unsigned short port, char *location, http_parse_cb
 	return http_status;
 }
 
+int http_get(char *hostname, unsigned short port, char *location, http_parse_cb callback, void *pv)
+{
+    return http_request(hostname, port, location, 0, 0, callback, pv);
+}
+
+/*
+ * GET url from offset on, for resuming a download. the result is 206 or 200
+ * when the data from offset on was passed to the callback, a negative
+ * return of the callback aborts the transfer with -8.
+ */
+int http_req_range(char *url, unsigned long offset, http_parse_cb callback, void *pv)
+{
+    char *hostname;
+    char *location;
+    int port;
+	int code = 0;
+
+	if( parseUrl(url,&hostname,&port,&location) == PROTO_HTTP ){
+		code = http_request(hostname,port,location,offset,1,callback,pv);
+		mem_free(hostname);
+		mem_free(location);
+	}
+	return code;
+}
+
 int http_req(char *url, http_parse_cb callback, void *pv)
 {
     char *hostname;
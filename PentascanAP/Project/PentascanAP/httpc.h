@@ -3,4 +3,6 @@ typedef int (*http_parse_cb)(unsigned long size, char *response, void *pv);
 
 int http_req(char *url,http_parse_cb callback, void *pv);
 int http_get(char *hostname, unsigned short port, char *location, http_parse_cb callback, void *pv);
+int http_req_range(char *url, unsigned long offset, http_parse_cb callback, void *pv);
+void http_date_sync(char *date);
 
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "lwip/opt.h"
+#include "lwip/tcp.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+#include "httpc_raw.h"
+
+#define HTTP_RAW_DEBUGx
+
+#ifdef HTTP_RAW_DEBUG
+    #define DEBUG_HTTP_RAW(x)   do { printf x; } while(0)
+#else
+    #define DEBUG_HTTP_RAW(x)
+#endif
+
+/* tcp_poll interval in tcp coarse timer units (500 msec) */
+#define HTTP_RAW_POLL_INTERVAL  2
+/* give up after this many polls without the request completing */
+#define HTTP_RAW_TIMEOUT        30
+
+typedef enum{
+    raw_idle,
+    raw_dns,
+    raw_connect,
+    raw_header,
+    raw_body,
+    raw_chunk_size,
+    raw_chunk_data,
+    raw_chunk_end,
+    raw_trailer
+}http_raw_state;
+
+/* sent as they are from flash, tcp_write does not copy them */
+static const char http_raw_get_str[] = "GET ";
+static const char http_raw_version[] = " HTTP/1.1\r\nAccept: *.*\r\nHost: ";
+static const char http_raw_close[] = "\r\nConnection: close\r\n\r\n";
+
+static err_t http_raw_connected(void *arg, struct tcp_pcb *pcb, err_t err);
+
+/* end the request, the pcb is closed here and done is called exactly once */
+static err_t http_raw_finish(http_raw_req *req, int status)
+{
+    err_t err = ERR_OK;
+    struct tcp_pcb *pcb = req->pcb;
+
+    if(pcb){
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+        tcp_poll(pcb, NULL, 0);
+        /* unacked data still points at the request buffer, which the caller
+           gets back now, so drop the connection instead of closing it */
+        if(req->unacked || tcp_close(pcb) != ERR_OK){
+            tcp_abort(pcb);
+            err = ERR_ABRT;
+        }
+        req->pcb = NULL;
+    }
+    if(req->held){
+        pbuf_free(req->held);
+        req->held = NULL;
+    }
+
+    DEBUG_HTTP_RAW(("http raw result %d, length %ld\n",status,req->total_length));
+
+    req->status = status;
+    req->state = raw_idle;
+    req->busy = 0;
+    if(req->done)
+        req->done(status, req->total_length, req->pv);
+    return err;
+}
+
+/* returns the bytes taken, less than len only when the caller streams the
+   body and response[] is full */
+static int http_raw_body(http_raw_req *req, const char *data, int len)
+{
+    unsigned long copy = 0;
+
+    if(req->response_len < HTTP_RAW_RESPONSE_SIZE){
+        copy = HTTP_RAW_RESPONSE_SIZE - req->response_len;
+        if(copy > len)
+            copy = len;
+        memcpy(req->response + req->response_len, data, copy);
+        req->response_len += copy;
+    }
+    if(req->full)
+        len = copy;
+    req->total_length += len;
+    return len;
+}
+
+/* returns 1 when the response is complete, -1 on a broken chunk */
+static int http_raw_line(http_raw_req *req)
+{
+    char *line = req->line;
+    int end = !strcmp(line, "\r\n");
+
+    switch(req->state){
+    case raw_header:
+        if(end){
+            if(req->chunked)
+                req->state = raw_chunk_size;
+            else if(req->content_length == 0 || req->status == 204 || req->status == 304)
+                return 1;
+            else
+                req->state = raw_body;
+        }else if(!strncmp(line, "HTTP/1.", 7) && line[7] && line[8] == ' '){
+            req->status = atoi(line + 9);
+        }else if(!strncmp(line, "Content-Length: ", 16)){
+            req->content_length = atol(line + 16);
+        }else if(!strncmp(line, "Transfer-Encoding: chunked", 26)){
+            req->chunked = 1;
+        }else if(!strncmp(line, "Date: ", 6)){
+            strncpy(req->date, line + 6, HTTP_RAW_DATE_SIZE - 1);
+            req->date[HTTP_RAW_DATE_SIZE - 1] = 0;
+        }
+        break;
+    case raw_chunk_size:
+        req->chunk_remain = strtol(line, NULL, 16);
+        req->state = req->chunk_remain ? raw_chunk_data : raw_trailer;
+        break;
+    case raw_chunk_end:
+        if(!end)
+            return -1;
+        req->state = raw_chunk_size;
+        break;
+    case raw_trailer:
+        if(end)
+            return 1;
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/*
+ * feed received data, returns 1 when the response is complete and 2 when
+ * response[] is full with *used bytes of data taken
+ */
+static int http_raw_parse(http_raw_req *req, char *data, int len, int *used)
+{
+    int i = 0, n, want, ret;
+
+    *used = len;
+    while(i < len){
+        if(req->state == raw_body){
+            n = http_raw_body(req, data + i, len - i);
+            if(req->content_length >= 0 && req->total_length >= req->content_length)
+                return 1;
+            if(n < len - i){
+                *used = i + n;
+                return 2;
+            }
+            return 0;
+        }
+        if(req->state == raw_chunk_data){
+            want = len - i;
+            if(want > req->chunk_remain)
+                want = req->chunk_remain;
+            n = http_raw_body(req, data + i, want);
+            req->chunk_remain -= n;
+            if(req->chunk_remain == 0)
+                req->state = raw_chunk_end;
+            i += n;
+            if(n < want){
+                *used = i;
+                return 2;
+            }
+            continue;
+        }
+
+        /* header, chunk size and trailer lines, truncated like GetLine() */
+        if(req->line_len < HTTP_RAW_LINE_SIZE - 1)
+            req->line[req->line_len++] = data[i];
+        if(data[i++] == '\n' && req->line_len > 1 && req->line[req->line_len - 2] == '\r'){
+            req->line[req->line_len] = 0;
+            req->line_len = 0;
+            ret = http_raw_line(req);
+            if(ret)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+/* the server closed the connection after all its data was parsed */
+static err_t http_raw_closed(http_raw_req *req)
+{
+    if(req->state == raw_body){
+        if(req->content_length > 0 && req->content_length != req->total_length)
+            return http_raw_finish(req, -2);
+        return http_raw_finish(req, req->status);
+    }
+    return http_raw_finish(req, (req->state == raw_header) ? req->status : -7);
+}
+
+/*
+ * parse the held data from where it stopped. it is acknowledged to the
+ * server only once all of it is parsed, so while the caller takes a full
+ * response[] the window stays closed and the server waits.
+ */
+static err_t http_raw_feed(http_raw_req *req)
+{
+    struct pbuf *p = req->held, *q;
+    u16_t pos, skip;
+    int used, ret = 0;
+
+    for(q = p, pos = 0; q != NULL && ret == 0; pos += q->len, q = q->next){
+        if(req->held_pos >= pos + q->len)
+            continue;
+        skip = req->held_pos - pos;
+        ret = http_raw_parse(req, (char *)q->payload + skip, q->len - skip, &used);
+        req->held_pos = pos + skip + used;
+    }
+
+    if(ret == 2){
+        req->full(req->pv);
+        return ERR_OK;
+    }
+
+    req->held = NULL;
+    tcp_recved(req->pcb, p->tot_len);
+    pbuf_free(p);
+
+    if(ret > 0)
+        return http_raw_finish(req, req->status);
+    if(ret < 0){
+        DEBUG_HTTP_RAW(("abnormal chunk, abort\n"));
+        return http_raw_finish(req, req->status);
+    }
+    if(req->held_fin)
+        return http_raw_closed(req);
+    return ERR_OK;
+}
+
+static err_t http_raw_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    if(p == NULL){
+        /* closed by the server, after the held data if there is any */
+        if(req->held){
+            req->held_fin = 1;
+            return ERR_OK;
+        }
+        return http_raw_closed(req);
+    }
+
+    req->poll = 0;
+    if(req->held){
+        /* the caller is still taking response[], this waits behind the rest */
+        pbuf_cat(req->held, p);
+        return ERR_OK;
+    }
+    req->held = p;
+    req->held_pos = 0;
+    return http_raw_feed(req);
+}
+
+static err_t http_raw_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    req->unacked -= len;
+    req->poll = 0;
+    return ERR_OK;
+}
+
+static err_t http_raw_poll(void *arg, struct tcp_pcb *pcb)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    if(++req->poll >= HTTP_RAW_TIMEOUT){
+        DEBUG_HTTP_RAW(("http raw timeout\n"));
+        return http_raw_finish(req, -1);
+    }
+    return ERR_OK;
+}
+
+static void http_raw_err(void *arg, err_t err)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    DEBUG_HTTP_RAW(("http raw error %d\n",err));
+
+    /* the pcb is already freed */
+    req->pcb = NULL;
+    req->unacked = 0;
+    http_raw_finish(req, (req->state == raw_connect) ? 0 : -1);
+}
+
+static err_t http_raw_write(http_raw_req *req, const char *data, u16_t len, u8_t more)
+{
+    err_t err;
+
+    err = tcp_write(req->pcb, data, len, more ? TCP_WRITE_FLAG_MORE : 0);
+    if(err == ERR_OK)
+        req->unacked += len;
+    return err;
+}
+
+static err_t http_raw_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    if(err != ERR_OK)
+        return http_raw_finish(req, 0);
+
+    req->state = raw_header;
+
+    /* request line and headers straight from the request buffer */
+    err = http_raw_write(req, http_raw_get_str, sizeof(http_raw_get_str) - 1, 1);
+    if(err == ERR_OK)
+        err = http_raw_write(req, req->location, strlen(req->location), 1);
+    if(err == ERR_OK)
+        err = http_raw_write(req, http_raw_version, sizeof(http_raw_version) - 1, 1);
+    if(err == ERR_OK)
+        err = http_raw_write(req, req->hostname, strlen(req->hostname), 1);
+    if(err == ERR_OK)
+        err = http_raw_write(req, http_raw_close, sizeof(http_raw_close) - 1, 0);
+    if(err == ERR_OK)
+        err = tcp_output(pcb);
+
+    if(err != ERR_OK){
+        DEBUG_HTTP_RAW(("http raw send fail %d\n",err));
+        return http_raw_finish(req, 0);
+    }
+    return ERR_OK;
+}
+
+static void http_raw_connect(http_raw_req *req)
+{
+    err_t err;
+
+    req->pcb = tcp_new();
+    if(req->pcb == NULL){
+        http_raw_finish(req, 0);
+        return;
+    }
+
+    req->state = raw_connect;
+    tcp_arg(req->pcb, req);
+    tcp_recv(req->pcb, http_raw_recv);
+    tcp_sent(req->pcb, http_raw_sent);
+    tcp_err(req->pcb, http_raw_err);
+    tcp_poll(req->pcb, http_raw_poll, HTTP_RAW_POLL_INTERVAL);
+
+    err = tcp_connect(req->pcb, &req->addr, req->port, http_raw_connected);
+    if(err != ERR_OK)
+        http_raw_finish(req, 0);
+}
+
+static void http_raw_dns_found(const char *name, ip_addr_t *ipaddr, void *arg)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    if(ipaddr == NULL){
+        DEBUG_HTTP_RAW(("host addr %s can't resolved\n",name));
+        http_raw_finish(req, 0);
+        return;
+    }
+    req->addr = *ipaddr;
+    http_raw_connect(req);
+}
+
+/* runs in the tcpip thread */
+static void http_raw_start(void *arg)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+    err_t err;
+
+    req->state = raw_dns;
+    err = dns_gethostbyname(req->hostname, &req->addr, http_raw_dns_found, req);
+    if(err == ERR_OK)
+        http_raw_connect(req);
+    else if(err != ERR_INPROGRESS)
+        http_raw_finish(req, 0);
+}
+
+/*
+ * start a GET of req->location from req->hostname:req->port.
+ * returns 0 when started, req->done is then called with the result from
+ * the tcpip thread; returns -1 when the request could not be started.
+ */
+int http_raw_get(http_raw_req *req)
+{
+    if(req->busy || req->hostname == NULL)
+        return -1;
+
+    req->busy = 1;
+    req->status = 0;
+    req->response_len = 0;
+    req->date[0] = 0;
+    req->pcb = NULL;
+    req->state = raw_idle;
+    req->chunked = 0;
+    req->poll = 0;
+    req->unacked = 0;
+    req->content_length = -1;       /* until a Content-Length header */
+    req->total_length = 0;
+    req->chunk_remain = 0;
+    req->line_len = 0;
+    req->held = NULL;
+    req->held_pos = 0;
+    req->held_fin = 0;
+
+    if(tcpip_callback(http_raw_start, req) != ERR_OK){
+        req->busy = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* runs in the tcpip thread */
+static void http_raw_resumed(void *arg)
+{
+    http_raw_req *req = (http_raw_req *)arg;
+
+    /* the request may have ended meanwhile, on an error or a timeout */
+    if(req->held && req->pcb)
+        http_raw_feed(req);
+}
+
+/*
+ * after the full callback, once the caller has taken response[]. the
+ * buffer is emptied and the rest of the body parsed into it.
+ */
+int http_raw_resume(http_raw_req *req)
+{
+    /* the tcpip thread does not touch response[] until the callback runs */
+    req->response_len = 0;
+    return tcpip_callback(http_raw_resumed, req) == ERR_OK ? 0 : -1;
+}
+
@@ -0,0 +1,62 @@
+#include "lwip/tcp.h"
+
+/*
+ * http client on the lwIP raw TCP API.
+ * everything runs in the tcpip thread, so a request costs no socket
+ * mailbox round trips. the request line is sent straight from the
+ * request buffer without copying, so the request must not be touched
+ * until the done callback is called.
+ *
+ * the body is kept in response[]. without a full callback only its start
+ * is kept. with one, the client stops reading when response[] fills and
+ * calls full; the caller takes the data and calls http_raw_resume(). the
+ * unread data holds the TCP window closed meanwhile, so the whole body can
+ * be streamed out through the buffer.
+ */
+
+#define HTTP_RAW_LOCATION_SIZE  1024
+#define HTTP_RAW_RESPONSE_SIZE  512
+#define HTTP_RAW_LINE_SIZE      128
+#define HTTP_RAW_DATE_SIZE      40
+
+/* called once per request in the tcpip thread, must not block */
+typedef void (*http_done_cb)(int status, unsigned long length, void *pv);
+/* called in the tcpip thread when response[] is full, must not block */
+typedef void (*http_full_cb)(void *pv);
+
+typedef struct{
+    /* set by the caller */
+    const char *hostname;               /* must stay valid until done */
+    unsigned short port;
+    char location[HTTP_RAW_LOCATION_SIZE];
+    http_done_cb done;
+    http_full_cb full;                  /* NULL to keep only the start of the body */
+    void *pv;
+
+    /* result, valid when done is called */
+    int status;                         /* same as http_get() */
+    char response[HTTP_RAW_RESPONSE_SIZE];  /* start of the body, or the part since the last resume */
+    unsigned long response_len;
+    char date[HTTP_RAW_DATE_SIZE];      /* Date header, for http_date_sync() */
+
+    /* private */
+    struct tcp_pcb *pcb;
+    ip_addr_t addr;
+    int busy;
+    int state;
+    int chunked;
+    int poll;
+    unsigned long unacked;
+    long content_length;
+    long total_length;
+    long chunk_remain;
+    int line_len;
+    char line[HTTP_RAW_LINE_SIZE];
+    struct pbuf *held;                  /* received, not parsed yet while response[] is full */
+    u16_t held_pos;                     /* bytes of held already parsed */
+    int held_fin;                       /* the server closed after held */
+}http_raw_req;
+
+int http_raw_get(http_raw_req *req);
+int http_raw_resume(http_raw_req *req);
+
@@ -0,0 +1,536 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include "Lwiplib.h"
+#include "lwip/stats.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "ff.h"
+#include "console.h"
+#include "rtc.h"
+#include "SensorManager.h"
+#include "httpd.h"
+#include "uplink.h"
+#include "logzip.h"
+#include "history.h"
+
+#define HTTPD_DEBUGx
+
+#ifdef HTTPD_DEBUG
+    #define DEBUG_HTTPD(x)   do { printf x; } while(0)
+#else
+    #define DEBUG_HTTPD(x)
+#endif
+
+/* number of requests served at the same time, each owns a worker task */
+#define HTTPD_MAX_CONN          2
+/* accepted connections waiting for a worker, more are answered with 503 */
+#define HTTPD_BACKLOG           2
+/* request and file data buffer of a worker */
+#define HTTPD_BUFFER_SIZE       1024
+/* buffer for formatted response lines */
+#define HTTPD_LINE_SIZE         128
+/* give up on a client that does not send or accept data for this long */
+#define HTTPD_TIMEOUT_MS        5000
+
+#define HTTPD_STACK_SIZE        256
+#define HTTPD_PRIORITY          ( tskIDLE_PRIORITY + 1 )
+
+typedef struct{
+    int socket;
+    FIL file_object;
+    char buffer[HTTPD_BUFFER_SIZE];
+    char line[HTTPD_LINE_SIZE];
+    sensor_node node[SENSOR_NODE_MAX];  /* readings of /status, too big for the worker stack */
+}httpd_conn;
+
+/* the only directories files are served from, the rest of the card (settings,
+   history database, firmware) is not published */
+static const char * const httpd_doc_root[] =
+{
+    "/log/",
+    "/response/",
+    NULL
+};
+
+/* all memory of the server is allocated here, only the decompressor of a log
+   archive download is taken from the heap for the length of the request */
+static httpd_conn g_httpd_conn[HTTPD_MAX_CONN];
+static xQueueHandle HttpdQueue;
+
+static const char * const http_status_string[] =
+{
+    "200 OK",
+    "206 Partial Content",
+    "400 Bad Request",
+    "404 Not Found",
+    "405 Method Not Allowed",
+    "416 Requested Range Not Satisfiable",
+    "503 Service Unavailable"
+};
+
+typedef enum{
+    http_ok,
+    http_partial,
+    http_bad_request,
+    http_not_found,
+    http_not_allowed,
+    http_bad_range,
+    http_unavailable
+}http_status;
+
+static int httpd_send(httpd_conn *conn, const char *data, int length)
+{
+    int ret;
+
+    while(length > 0){
+        ret = send(conn->socket, data, length, 0);
+        if(ret <= 0)
+            return -1;
+        data += ret;
+        length -= ret;
+    }
+    return 0;
+}
+
+static int httpd_printf(httpd_conn *conn, const char *format, ...)
+{
+	va_list args;
+	int length;
+
+	va_start(args,format);
+	length = vsnprintf(conn->line, sizeof(conn->line), format, args);
+	va_end (args);
+
+	if(length >= (int)sizeof(conn->line))
+	    length = sizeof(conn->line) - 1;
+	return httpd_send(conn, conn->line, length);
+}
+
+static void httpd_header(httpd_conn *conn, http_status status, const char *type)
+{
+    httpd_printf(conn, "HTTP/1.1 %s\r\nServer: PentascanAP\r\nConnection: close\r\n",
+                 http_status_string[status]);
+    if(type)
+        httpd_printf(conn, "Content-Type: %s\r\n", type);
+}
+
+static void httpd_error(httpd_conn *conn, http_status status)
+{
+    httpd_header(conn, status, "text/plain");
+    httpd_printf(conn, "Content-Length: %d\r\n\r\n%s\n",
+                 strlen(http_status_string[status]) + 1, http_status_string[status]);
+}
+
+/* status page : tasks, heap, network and the latest sensor readings */
+static void httpd_status(httpd_conn *conn)
+{
+    sensor_node *node = conn->node;
+    report_status report;
+    char *ptr, *next, *tab;
+    char state;
+    unsigned int prio, stack, num;
+    unsigned long addr;
+    char a[12], b[12];
+    int i, count, first;
+
+    httpd_header(conn, http_ok, "application/json");
+    httpd_printf(conn, "\r\n{\"time\":%lu,\"uptime\":%lu,\"heap_free\":%lu,\"tasks\":[",
+                 RtcGetTime(), xTaskGetTickCount() / configTICK_RATE_HZ, checkFreeMem());
+
+    /* vTaskList prints "name\t\tstate\tprio\tstack\tnum\r\n" per task */
+    vTaskList((signed char *)conn->buffer);
+    first = 1;
+    for(ptr = conn->buffer; *ptr; ptr = next){
+        next = strchr(ptr, '\n');
+        if(next)
+            *next++ = 0;
+        else
+            next = ptr + strlen(ptr);
+        tab = strchr(ptr, '\t');
+        if(tab == NULL)
+            continue;
+        *tab++ = 0;
+        if(sscanf(tab, " %c %u %u %u", &state, &prio, &stack, &num) != 4)
+            continue;
+        httpd_printf(conn, "%s{\"name\":\"%s\",\"state\":\"%c\",\"prio\":%u,\"stack\":%u}",
+                     first ? "" : ",", ptr, state, prio, stack);
+        first = 0;
+    }
+
+    addr = lwIPLocalIPAddrGet();
+    httpd_printf(conn, "],\"net\":{\"link\":%d,\"ip\":\"%s\",\"uplink\":\"%s\"",
+                 lwIPLinkStatusGet() ? 1 : 0, inet_ntoa(addr), uplink_name());
+#if LWIP_STATS && TCP_STATS
+    httpd_printf(conn, ",\"tcp\":{\"xmit\":%u,\"recv\":%u,\"memerr\":%u,\"drop\":%u,\"err\":%u}",
+                 lwip_stats.tcp.xmit, lwip_stats.tcp.recv, lwip_stats.tcp.memerr,
+                 lwip_stats.tcp.drop, lwip_stats.tcp.err);
+#endif
+    report_status_get(&report);
+    httpd_printf(conn, "},\"report\":{\"count\":%d,\"success\":%d,\"result\":%d,\"time\":%lu,\"elapsed_ms\":%lu},\"sensors\":[",
+                 report.count, report.success, report.result, report.time, report.elapsed);
+
+    count = sensor_snapshot(node, SENSOR_NODE_MAX);
+    for(i=0;i<count;i++){
+        httpd_printf(conn, "%s{\"addr\":\"%02X\",\"temp\":%s,\"humidity\":%s,\"co2\":%d,\"retry\":%d,\"sound\":%d}",
+                     i ? "," : "", node[i].addr,
+                     history_fixed(a, node[i].temp), history_fixed(b, node[i].humidity),
+                     node[i].co2, node[i].retry, node[i].sound);
+    }
+    httpd_printf(conn, "]}\n");
+}
+
+/*
+ * parse "Range: bytes=first-last", "bytes=first-" and "bytes=-suffix"
+ * returns 0 if no usable range, 1 if range given, -1 if unsatisfiable
+ */
+static int httpd_range(const char *header, unsigned long size, unsigned long *first, unsigned long *last)
+{
+    const char *ptr;
+    char *end;
+
+    ptr = strstr(header, "\r\nRange: bytes=");
+    if(ptr == NULL)
+        return 0;
+    ptr += strlen("\r\nRange: bytes=");
+
+    if(*ptr == '-'){
+        *last = size - 1;
+        *first = strtoul(ptr + 1, &end, 10);
+        if(end == ptr + 1)
+            return 0;
+        *first = (*first >= size) ? 0 : size - *first;
+    }else{
+        *first = strtoul(ptr, &end, 10);
+        if(end == ptr || *end != '-')
+            return 0;
+        ptr = end + 1;
+        *last = strtoul(ptr, &end, 10);
+        if(end == ptr || *last >= size)
+            *last = size - 1;
+    }
+
+    if(size == 0 || *first >= size || *first > *last)
+        return -1;
+    return 1;
+}
+
+/*
+ * a file below one of the document roots. no ".." to climb out of it, and no
+ * drive number or backslash FatFs would read as another path
+ */
+static int httpd_path_allowed(const char *path)
+{
+    const char * const *root;
+
+    if(strstr(path, "..") || strchr(path, ':') || strchr(path, '\\'))
+        return 0;
+    for(root = httpd_doc_root; *root; root++){
+        if(!strncmp(path, *root, strlen(*root)) && path[strlen(*root)])
+            return 1;
+    }
+    return 0;
+}
+
+/* stream a file from the SD card, the data goes from f_read straight to send */
+static void httpd_file(httpd_conn *conn, const char *path, const char *header)
+{
+    unsigned long size, first, last, remain;
+    unsigned int count;
+    int range;
+
+    if(f_open(&conn->file_object, path, FA_READ) != FR_OK){
+        httpd_error(conn, http_not_found);
+        return;
+    }
+
+    size = f_size(&conn->file_object);
+    range = httpd_range(header, size, &first, &last);
+    if(range < 0){
+        httpd_header(conn, http_bad_range, NULL);
+        httpd_printf(conn, "Content-Range: bytes */%lu\r\nContent-Length: 0\r\n\r\n", size);
+        f_close(&conn->file_object);
+        return;
+    }
+    if(range == 0){
+        first = 0;
+        last = size - 1;
+        httpd_header(conn, http_ok, "application/octet-stream");
+    }else{
+        httpd_header(conn, http_partial, "application/octet-stream");
+        httpd_printf(conn, "Content-Range: bytes %lu-%lu/%lu\r\n", first, last, size);
+    }
+    remain = size ? last - first + 1 : 0;
+    httpd_printf(conn, "Accept-Ranges: bytes\r\nContent-Length: %lu\r\n\r\n", remain);
+
+    if(first && f_lseek(&conn->file_object, first) != FR_OK)
+        remain = 0;
+
+    while(remain){
+        if(f_read(&conn->file_object, conn->buffer,
+                  remain > HTTPD_BUFFER_SIZE ? HTTPD_BUFFER_SIZE : remain, &count) != FR_OK || count == 0)
+            break;
+        if(httpd_send(conn, conn->buffer, count))
+            break;
+        remain -= count;
+    }
+    f_close(&conn->file_object);
+}
+
+/*
+ * send a log archive decompressed, the original size is in the archive
+ * header so the length is known up front. no ranges, "?raw" gets the
+ * archive itself for Tools/lzcat.
+ */
+static void httpd_archive(httpd_conn *conn, const char *path)
+{
+    lz_reader *reader;
+    long size;
+    int count;
+
+    if(f_open(&conn->file_object, path, FA_READ) != FR_OK){
+        httpd_error(conn, http_not_found);
+        return;
+    }
+
+    reader = mem_malloc(sizeof(lz_reader));
+    if(reader == NULL){
+        httpd_error(conn, http_unavailable);
+        f_close(&conn->file_object);
+        return;
+    }
+
+    size = lz_open(reader, &conn->file_object);
+    if(size < 0){
+        httpd_error(conn, http_not_found);
+    }else{
+        httpd_header(conn, http_ok, "text/plain");
+        httpd_printf(conn, "Content-Length: %lu\r\n\r\n", size);
+        /* a broken archive ends the connection short of Content-Length */
+        while((count = lz_read(reader, conn->buffer, HTTPD_BUFFER_SIZE)) > 0){
+            if(httpd_send(conn, conn->buffer, count))
+                break;
+        }
+    }
+    mem_free(reader);
+    f_close(&conn->file_object);
+}
+
+/* value of name in a query string "a=1&b=2", or def */
+static unsigned long httpd_param(const char *query, const char *name, int base, unsigned long def)
+{
+    int len = strlen(name);
+
+    while(query && *query){
+        if(!strncmp(query, name, len) && query[len] == '=')
+            return strtoul(query + len + 1, NULL, base);
+        query = strchr(query, '&');
+        if(query)
+            query++;
+    }
+    return def;
+}
+
+typedef struct{
+    httpd_conn *conn;
+    int step;
+    int count;
+}httpd_history_state;
+
+static int httpd_history_point(void *pv, const xTsdbPoint *point)
+{
+    httpd_history_state *state = (httpd_history_state *)pv;
+    httpd_conn *conn = state->conn;
+    char a[12], b[12], c[12];
+    long n = point->ulCount;
+    int ret;
+
+    ret = httpd_printf(conn, "%s{\"t\":%lu", state->count++ ? ",\n" : "", point->ulTime);
+    if(!state->step){
+        ret |= httpd_printf(conn, ",\"temp\":%s,\"humidity\":%s,\"co2\":%d,\"sound\":%d}",
+                            history_fixed(a, point->sMax[0]), history_fixed(b, point->sMax[1]),
+                            point->sMax[2], point->sMax[3]);
+        return ret;
+    }
+    /* [min,mean,max] of the step */
+    ret |= httpd_printf(conn, ",\"n\":%ld,\"temp\":[%s,%s,%s]", n, history_fixed(a, point->sMin[0]),
+                        history_fixed(b, point->lSum[0] / n), history_fixed(c, point->sMax[0]));
+    ret |= httpd_printf(conn, ",\"humidity\":[%s,%s,%s]", history_fixed(a, point->sMin[1]),
+                        history_fixed(b, point->lSum[1] / n), history_fixed(c, point->sMax[1]));
+    ret |= httpd_printf(conn, ",\"co2\":[%d,%ld,%d],\"sound\":[%d,%ld,%d]}",
+                        point->sMin[2], point->lSum[2] / n, point->sMax[2],
+                        point->sMin[3], point->lSum[3] / n, point->sMax[3]);
+    return ret;
+}
+
+/*
+ * sensor history : /history?addr=A3 [&hours=6 | &from=&to=] [&step=600]
+ * times in unix seconds, the step in seconds, 0 for every sample
+ */
+static void httpd_history(httpd_conn *conn, const char *query)
+{
+    httpd_history_state state;
+    xTsdbQuery q;
+    unsigned long now = RtcGetTime() + 1;
+    unsigned long hours = httpd_param(query, "hours", 10, 6);
+
+    memset(&q, 0, sizeof(q));
+    q.ucAddr = httpd_param(query, "addr", 16, 0);
+    q.ulTo = httpd_param(query, "to", 10, now);
+    q.ulFrom = httpd_param(query, "from", 10, q.ulTo > hours * 3600 ? q.ulTo - hours * 3600 : 0);
+    q.ulStep = httpd_param(query, "step", 10, 0);
+    if(q.ucAddr == 0){
+        httpd_error(conn, http_bad_request);
+        return;
+    }
+    state.conn = conn;
+    state.step = q.ulStep != 0;
+    state.count = 0;
+    q.pxPoint = httpd_history_point;
+    q.pvArg = &state;
+
+    httpd_header(conn, http_ok, "application/json");
+    httpd_printf(conn, "\r\n{\"addr\":\"%02X\",\"from\":%lu,\"to\":%lu,\"step\":%lu,\"points\":[\n",
+                 q.ucAddr, q.ulFrom, q.ulTo, q.ulStep);
+    /* a read error ends the list early */
+    history_query(&q);
+    httpd_printf(conn, "]}\n");
+}
+
+static void httpd_request(httpd_conn *conn)
+{
+    int length = 0, ret;
+    char *uri, *ptr, *query;
+
+    /* read the request header, it has to fit in the buffer */
+    while(length < HTTPD_BUFFER_SIZE - 1){
+        ret = recv(conn->socket, conn->buffer + length, HTTPD_BUFFER_SIZE - 1 - length, 0);
+        if(ret <= 0)
+            return;
+        length += ret;
+        conn->buffer[length] = 0;
+        if(strstr(conn->buffer, "\r\n\r\n"))
+            break;
+    }
+
+    DEBUG_HTTPD(("httpd: %s", conn->buffer));
+
+    if(strncmp(conn->buffer, "GET ", 4)){
+        httpd_error(conn, http_not_allowed);
+        return;
+    }
+
+    uri = conn->buffer + 4;
+    ptr = strchr(uri, ' ');
+    if(ptr == NULL || ptr - uri >= PATH_BUF_SIZE){
+        httpd_error(conn, http_bad_request);
+        return;
+    }
+    *ptr++ = 0;
+
+    query = strchr(uri, '?');
+    if(query)
+        *query++ = 0;
+
+    if(!strcmp(uri, "/status"))
+        httpd_status(conn);
+    else if(!strcmp(uri, "/history"))
+        httpd_history(conn, query);
+    else if(!httpd_path_allowed(uri))
+        httpd_error(conn, http_not_found);
+    else if(lz_is_archive(uri) && (query == NULL || strcmp(query, "raw")))
+        httpd_archive(conn, uri);
+    else
+        httpd_file(conn, uri, ptr);
+}
+
+static void httpd_worker(void *pvParameters)
+{
+    httpd_conn *conn = (httpd_conn *)pvParameters;
+    int timeout = HTTPD_TIMEOUT_MS;
+
+    for(;;){
+        xQueueReceive(HttpdQueue, &conn->socket, portMAX_DELAY);
+        setsockopt(conn->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        httpd_request(conn);
+        close(conn->socket);
+    }
+}
+
+static void httpd(void *pvParameters)
+{
+    int listen_socket;
+    struct sockaddr_in local_addr;
+    unsigned int port = (unsigned int) pvParameters;
+    int i;
+
+    listen_socket = socket(AF_INET,SOCK_STREAM, IPPROTO_TCP);
+
+    if(listen_socket < 0){
+        printf("socket create fail\n");
+        vTaskDelete( NULL );
+        return;
+    }
+
+    memset((char *)&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_len = sizeof(local_addr);
+    local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    local_addr.sin_port = htons(port);
+
+    if (bind(listen_socket, (struct sockaddr *)&local_addr, sizeof(local_addr)) < 0) {
+        printf("socket bind fail\n");
+        close(listen_socket);
+        vTaskDelete( NULL );
+        return;
+    }
+
+    if ( listen(listen_socket, HTTPD_BACKLOG) != 0 ){
+        printf("socket listen fail\n");
+        close(listen_socket);
+        vTaskDelete( NULL );
+        return;
+    }
+
+    for(i=0;i<HTTPD_MAX_CONN;i++)
+        xTaskCreate( httpd_worker, ( signed portCHAR * ) "httpw", HTTPD_STACK_SIZE, (void*)&g_httpd_conn[i], HTTPD_PRIORITY, NULL );
+
+    printf("httpd ready at port %d\n",port);
+
+    while (1) {
+        int clientfd;
+        struct sockaddr_in client_addr;
+        int addrlen=sizeof(client_addr);
+
+        clientfd = accept(listen_socket, (struct sockaddr*)&client_addr, (socklen_t *)&addrlen);
+        if (clientfd < 0)
+            continue;
+
+        /* all workers busy, refuse instead of queueing without bound */
+        if(xQueueSend(HttpdQueue, &clientfd, 0) != pdPASS){
+            static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+            send(clientfd, busy, sizeof(busy) - 1, 0);
+            close(clientfd);
+        }
+    }
+}
+
+void httpd_start(unsigned int port)
+{
+    static int start;
+    if(!start){
+        /* simple way to prevent double excution */
+        start = 1;
+        HttpdQueue = xQueueCreate( HTTPD_BACKLOG, sizeof(int) );
+        if(HttpdQueue == NULL){
+            printf("httpd queue creation fail\n");
+            return;
+        }
+        xTaskCreate( httpd, ( signed portCHAR * ) "httpd", 128, (void*)port, HTTPD_PRIORITY, NULL );
+    }
+}
+
@@ -0,0 +1,2 @@
+void httpd_start(unsigned int port);
+
@@ -1,4 +1,11 @@
- #include "rit128x96x4.h"
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "rit128x96x4.h"
 #include "lcd_terminal.h"
 
 #define FONT_HEIGHT				( 8 )
@@ -9,24 +16,152 @@
 #define mainFULL_SCALE						( 15 )
 #define ulSSI_FREQUENCY						( 3500000UL )
 
+/* frame buffer holds two pixels per byte, same layout as the display RAM */
+#define LCD_STRIDE              ( LCD_WIDTH / 2 )
+#define LCD_TEXT_ROWS           ( LCD_HEIGHT / FONT_HEIGHT )
+#define GLYPH_STRIDE            ( FONT_WIDTH / 2 )
+#define GLYPH_SIZE              ( GLYPH_STRIDE * FONT_HEIGHT )
+
+/* direct mapped glyph cache, must be power of 2 */
+#define GLYPH_CACHE_SIZE        ( 32 )
+
+/* maximum panel refresh rate */
+#define LCD_FLUSH_HZ            ( 20 )
+
+typedef struct{
+    unsigned char ch;       /* 0 means empty slot */
+    unsigned char level;
+    unsigned char glyph[GLYPH_SIZE];
+}glyph_entry;
+
+static unsigned char frame_buffer[LCD_HEIGHT][LCD_STRIDE];
+static glyph_entry glyph_cache[GLYPH_CACHE_SIZE];
+
+/* one bit per text row, protected by LcdMutex */
+static unsigned long dirty_rows;
+static int scroll_dirty;
+static int flush_pending;
+
+static xSemaphoreHandle LcdMutex;
+static xSemaphoreHandle LcdFlushSem;
 
 static int screen_offset;
 static int cursor_x, cursor_y;
 static unsigned char level = mainFULL_SCALE;
 
+static void lcd_lock(void)
+{
+	while( xSemaphoreTake( LcdMutex, portMAX_DELAY ) != pdPASS );
+}
+
+static void lcd_unlock(void)
+{
+    /* wake flush task once, further output is merged into the same frame */
+    if((dirty_rows || scroll_dirty) && !flush_pending){
+        flush_pending = 1;
+        xSemaphoreGive(LcdFlushSem);
+    }
+    xSemaphoreGive(LcdMutex);
+}
+
+static const unsigned char *lcd_glyph_get(int ch, unsigned char lvl)
+{
+    glyph_entry *entry;
+
+    ch &= 0x7f;
+    if(ch < ' ')
+        ch = ' ';
+
+    entry = &glyph_cache[(ch ^ (lvl << 3)) & (GLYPH_CACHE_SIZE - 1)];
+    if(entry->ch != ch || entry->level != lvl){
+        RIT128x96x4GlyphGet(ch, lvl, entry->glyph);
+        entry->ch = ch;
+        entry->level = lvl;
+    }
+    return entry->glyph;
+}
+
+static void lcd_put_glyph(int ch, int x, int y)
+{
+    const unsigned char *glyph = lcd_glyph_get(ch, level);
+    unsigned char *dst = &frame_buffer[y][x / 2];
+    int row;
+
+    for(row = 0; row < FONT_HEIGHT; row++){
+        dst[0] = glyph[0];
+        dst[1] = glyph[1];
+        dst[2] = glyph[2];
+        glyph += GLYPH_STRIDE;
+        dst += LCD_STRIDE;
+    }
+    dirty_rows |= 1UL << (y / FONT_HEIGHT);
+}
+
+static void lcd_clear_line(int y)
+{
+    memset(frame_buffer[y], 0, FONT_HEIGHT * LCD_STRIDE);
+    dirty_rows |= 1UL << (y / FONT_HEIGHT);
+}
+
+/* push coalesced dirty rows to the panel, at most LCD_FLUSH_HZ times a second */
+static void lcd_flushd(void *pv)
+{
+    unsigned long rows;
+    int offset, scroll;
+    int first, last;
+
+    for(;;){
+        xSemaphoreTake(LcdFlushSem, portMAX_DELAY);
+
+        lcd_lock();
+        rows = dirty_rows;
+        scroll = scroll_dirty;
+        offset = screen_offset;
+        dirty_rows = 0;
+        scroll_dirty = 0;
+        flush_pending = 0;
+        xSemaphoreGive(LcdMutex);
+
+        /* rows written while flushing are marked dirty again and sent next frame */
+        for(first = 0; first < LCD_TEXT_ROWS; first = last){
+            last = first + 1;
+            if(!(rows & (1UL << first)))
+                continue;
+            while(last < LCD_TEXT_ROWS && (rows & (1UL << last)))
+                last++;
+            RIT128x96x4RowsDraw(frame_buffer[first * FONT_HEIGHT], first * FONT_HEIGHT,
+                                (last - first) * FONT_HEIGHT);
+        }
+
+        if(scroll)
+            RIT128X96X4Scroll(offset);
+
+        vTaskDelay(configTICK_RATE_HZ / LCD_FLUSH_HZ);
+    }
+}
+
 void lcd_terminal_init(void)
 {
+    LcdMutex = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(LcdFlushSem);
+    xSemaphoreTake(LcdFlushSem, 0);
+
     RIT128x96x4Init(ulSSI_FREQUENCY);
     lcd_terminal_clear();
+
+    xTaskCreate( lcd_flushd, ( signed portCHAR * ) "lcd", 128, NULL, tskIDLE_PRIORITY, NULL );
 }
 
 void lcd_terminal_clear(void)
 {
+    lcd_lock();
     screen_offset = 0;
     cursor_x = 0;
     cursor_y = 0;
-    RIT128x96x4Clear();
-    RIT128X96X4Scroll(screen_offset);
+    memset(frame_buffer, 0, sizeof(frame_buffer));
+    dirty_rows = (1UL << LCD_TEXT_ROWS) - 1;
+    scroll_dirty = 1;
+    lcd_unlock();
 }
 
 void lcd_terminal_set_level(unsigned char lvl)
@@ -40,6 +175,8 @@ void lcd_terminal_char(int ch)
     int check_scroll = 0;
     static int intensity_waiting = 0;
 
+    lcd_lock();
+
 /* process intensity */
     if(intensity_waiting){
         if(ch >= '0' && ch <= '9')
@@ -52,18 +189,22 @@ void lcd_terminal_char(int ch)
             level = 5;
         intensity_waiting = 0;
 
-        if(ch != '^')
+        if(ch != '^'){
+            lcd_unlock();
             return;
+        }
     }else if(ch == '^'){
         intensity_waiting = 1;
+        lcd_unlock();
         return;
     }else if(ch == '`'){
         level = 5;
+        lcd_unlock();
         return;
-    }        
-        
+    }
+
 
-/* process cursor increment */    
+/* process cursor increment */
     if(ch == '\n'){
         if(cursor_x == 0)
             check_scroll = 1;
@@ -81,47 +222,54 @@ void lcd_terminal_char(int ch)
             clear_line = 1;
         }
     }else{
-        RIT128x96x4Char(ch, cursor_x, cursor_y % LCD_HEIGHT, level);
+        lcd_put_glyph(ch, cursor_x, cursor_y % LCD_HEIGHT);
         if(cursor_x == 0)
             check_scroll = 1;
         cursor_x += FONT_WIDTH;
     }
-        
-/* process cursor_x */        
+
+/* process cursor_x */
     if(cursor_x >= ( LCD_WIDTH - FONT_WIDTH )){
         cursor_x = 0;
         cursor_y += FONT_HEIGHT;
         clear_line = 1;
     }
-    
-/* process cursor_y */            
+
+/* process cursor_y */
     if(cursor_y > ( LCD_HEIGHT - FONT_HEIGHT ))
         cursor_y = 0;
 
 /* clear new line */
     if(clear_line)
-        RIT128x96x4StringDraw("                     ",0,cursor_y,level);
-        
-/* process scroll */   
-    if(!check_scroll)
-        return;
+        lcd_clear_line(cursor_y);
 
-    if(screen_offset > cursor_y){
-        if(LCD_HEIGHT + cursor_y - screen_offset >= LCD_HEIGHT_VIEW){
+/* process scroll */
+    if(check_scroll){
+        if(screen_offset > cursor_y){
+            if(LCD_HEIGHT + cursor_y - screen_offset >= LCD_HEIGHT_VIEW){
+                screen_offset += FONT_HEIGHT;
+                if(screen_offset >= LCD_HEIGHT)
+                    screen_offset = 0;
+                scroll_dirty = 1;
+            }
+        }else if(cursor_y - screen_offset >= LCD_HEIGHT_VIEW ){
             screen_offset += FONT_HEIGHT;
             if(screen_offset >= LCD_HEIGHT)
                 screen_offset = 0;
-            RIT128X96X4Scroll(screen_offset);
+            scroll_dirty = 1;
         }
-    }else if(cursor_y - screen_offset >= LCD_HEIGHT_VIEW ){
-        screen_offset += FONT_HEIGHT;
-        if(screen_offset >= LCD_HEIGHT)
-            screen_offset = 0;
-        RIT128X96X4Scroll(screen_offset);
     }
+
+    lcd_unlock();
 }
 
 void lcd_terminal_str(char *string)
 {
-    RIT128x96x4StringDraw(string, cursor_x, cursor_y, level);
+    int x;
+
+    lcd_lock();
+    for(x = cursor_x; *string && x <= LCD_WIDTH - FONT_WIDTH; x += FONT_WIDTH)
+        lcd_put_glyph(*string++, x, cursor_y);
+    lcd_unlock();
 }
+
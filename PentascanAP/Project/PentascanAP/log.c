@@ -17,6 +17,9 @@
 #include "Rtc.h"
 
 #include "log.h"
+#include "logzip.h"
+#include "health.h"
+#include "fileio.h"
 
 const char *log_level_string[] =
 {
@@ -71,66 +74,84 @@ void syslog(log_level level,char *format,...)
 	xSemaphoreGive(LogMutex);
 }
 
-static void filelog(char *path,char *ts,char *string)
+/* the file i/o service keeps the log file open and syncs it once the card
+   has been idle, past this the file is rotated into a compressed archive,
+   see logzip.h */
+#define LOG_ROTATE_SIZE     (64 * 1024UL)
+/* an idle syslogd still wakes this often to check in with the health monitor */
+#define LOG_IDLE_MSEC       30000
+
+static long log_size = -1;          /* of the log file, -1 until looked up */
+static volatile int log_synced;
+
+/* in the file i/o service, once the card is there */
+static FRESULT filelog_stat(const char *path, void *arg)
 {
+    FILINFO info;
     FRESULT fresult;
-    FIL *FileObject = mem_malloc(sizeof(FIL));
-    unsigned int usBytesWritten;
 
-    fresult = f_open(FileObject, path, FA_WRITE | FA_OPEN_ALWAYS);
+#if _USE_LFN
+    info.lfname = NULL;
+    info.lfsize = 0;
+#endif
+    fresult = f_stat(path, &info);
+    if(fresult == FR_NO_FILE){
+        info.fsize = 0;
+        fresult = FR_OK;
+    }
     if(fresult != FR_OK)
-        goto file_error;
+        return fresult;
+    *(long *)arg = info.fsize;
+    logzip_start(path);
+    return FR_OK;
+}
 
-    // seek to end of file
-    fresult = f_lseek(FileObject, f_size(FileObject));
-    if(fresult != FR_OK)
-    {
-        f_close(FileObject);
-        goto file_error;
-    }
+static FRESULT filelog_rotate(const char *path, void *arg)
+{
+    logzip_rotate(path);
+    return FR_OK;
+}
 
-    fresult = f_write(FileObject, ts, strlen(ts),
-                     &usBytesWritten);
-    if(fresult != FR_OK || strlen(ts) != usBytesWritten)
-    {
-        f_close(FileObject);
-        goto file_error;
-    }
+static void filelog(char *path,char *ts,char *string)
+{
+    unsigned long len = strlen(ts) + strlen(string) + 1;
 
-    fresult = f_write(FileObject, string, strlen(string),
-                     &usBytesWritten);
-    if(fresult != FR_OK || strlen(string) != usBytesWritten)
-    {
-        f_close(FileObject);
+    if(log_size < 0 && fio_call(path, filelog_stat, &log_size, FIO_WAIT) != FR_OK)
         goto file_error;
-    }
 
-    fresult = f_write(FileObject, "\n", strlen("\n"),
-                     &usBytesWritten);
-    if(fresult != FR_OK || strlen("\n") != usBytesWritten)
-    {
-        f_close(FileObject);
+    /* queued back to back the three are merged into one write */
+    if(fio_append(path, ts, strlen(ts), NULL, NULL) != FR_OK
+       || fio_append(path, string, strlen(string), NULL, NULL) != FR_OK
+       || fio_append(path, "\n", 1, NULL, NULL) != FR_OK)
         goto file_error;
-    }
 
-    f_close(FileObject);
-    mem_free(FileObject);
+    log_size += len;
+    if(log_size >= LOG_ROTATE_SIZE){
+        fio_call(path, filelog_rotate, NULL, 0);
+        log_size = 0;
+    }
     return;
-    
+
 file_error:
     printf("filelog fail\n");
     printf(string);
     printf("--------------------------\n");
-    mem_free(FileObject);
     return;
 }
 
+static void syslog_synced(FRESULT result, unsigned int len, void *pv)
+{
+    log_synced = 1;
+}
+
 void syslogd(void *pv)
 {
     log_message *log;
     char *path;
     char *timestamp = mem_malloc(60);
     struct tm * timeinfo;
+    portBASE_TYPE got;
+    int health;
     
     LogQueue = xQueueCreate( 20, sizeof(log_message *) );
     if(LogQueue == NULL){
@@ -159,9 +180,19 @@ void syslogd(void *pv)
         return;
     }
     strcpy(path,(char*)pv);
+    health = health_register("syslogd", 2 * LOG_IDLE_MSEC);
 
     for(;;){
-        xQueueReceive(LogQueue, &log, portMAX_DELAY);
+        got = xQueueReceive(LogQueue, &log, LOG_IDLE_MSEC / portTICK_RATE_MS);
+        health_checkin(health);
+        if(got != pdPASS)
+            continue;
+        /* a NULL message from syslog_flush() syncs what came before it */
+        if(log == NULL){
+            if(fio_sync(path, 0, syslog_synced, NULL) != FR_OK)
+                log_synced = 1;
+            continue;
+        }
         timeinfo = localtime(&(log->time_stamp));
         sprintf(timestamp,"<syslog - %04d/%02d/%02d %02d:%02d:%02d %s>\n",timeinfo->tm_year + 1900, timeinfo->tm_mon+ 1 , timeinfo->tm_mday,
                 timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,log_level_string[log->level]);
@@ -177,12 +208,31 @@ void syslogd(void *pv)
     }
 }
 
+/*
+ * waits up to msec for the queued messages to be written and the file to be
+ * synced, before a reset.
+ */
+void syslog_flush(unsigned long msec)
+{
+    log_message *log = NULL;
+    portTickType start = xTaskGetTickCount();
+
+    if(LogQueue == NULL)
+        return;
+    log_synced = 0;
+    if(xQueueSend(LogQueue, (void*)&log, msec / portTICK_RATE_MS) != pdPASS)
+        return;
+    while(!log_synced && xTaskGetTickCount() - start < msec / portTICK_RATE_MS)
+        vTaskDelay(10 / portTICK_RATE_MS);
+}
+
 void syslog_start(char *path)
 {
     static int start;
     if(!start){
         /* simple way to prevent double excution */
         start = 1;
-        xTaskCreate( syslogd, ( signed portCHAR * ) "syslogd", 128, (void*)path, tskIDLE_PRIORITY + 1, NULL );
+        fio_start();
+        xTaskCreate( syslogd, ( signed portCHAR * ) "syslogd", 160, (void*)path, tskIDLE_PRIORITY + 1, NULL );
     }
 }
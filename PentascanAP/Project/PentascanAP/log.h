@@ -8,5 +8,6 @@ typedef enum {
 }log_level;
 
 void syslog_start(char *path);
+void syslog_flush(unsigned long msec);
 void syslog(log_level level,char *format,...);
 
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* lwip library */
+#include "lwiplib.h"
+
+#include "ff.h"
+#include "lzss.h"
+#include "log.h"
+#include "logzip.h"
+
+/* below everything else, compressing is never urgent */
+#define LOGZIP_PRIORITY     tskIDLE_PRIORITY
+#define LOGZIP_STACK_SIZE   160
+
+#define LOGZIP_DIR_LEN      40
+
+typedef struct{
+    xLzssEncoder enc;
+    unsigned char in[LZSS_BLOCK];
+    unsigned char out[LZSS_BOUND(LZSS_BLOCK)];
+    FIL raw;
+    FIL lz;
+}logzip_work;
+
+static char logzip_dir[LOGZIP_DIR_LEN];
+static unsigned long logzip_seq;
+static xSemaphoreHandle logzip_kick;
+static DIR logzip_dir_object;
+static FILINFO logzip_info;
+
+/* number of an archive or segment name "Lnnnnnnn.ext", 0 if it is none */
+static unsigned long logzip_number(const char *name, const char *ext)
+{
+    char *end;
+    unsigned long seq;
+
+    if(name[0] != 'L')
+        return 0;
+    seq = strtoul(name + 1, &end, 10);
+    if(end != name + 8 || *end != '.' || strcmp(end + 1, ext))
+        return 0;
+    return seq;
+}
+
+static void logzip_name(char *name, unsigned long seq, const char *ext)
+{
+    sprintf(name, "%s/L%07lu.%s", logzip_dir, seq, ext);
+}
+
+/* lowest segment waiting to be compressed, 0 if there is none */
+static unsigned long logzip_next(void)
+{
+    unsigned long seq, lowest = 0;
+
+    if(f_opendir(&logzip_dir_object, logzip_dir[0] ? logzip_dir : "/") != FR_OK)
+        return 0;
+    while(f_readdir(&logzip_dir_object, &logzip_info) == FR_OK && logzip_info.fname[0]){
+        seq = logzip_number(logzip_info.fname, "RAW");
+        if(seq && (lowest == 0 || seq < lowest))
+            lowest = seq;
+    }
+    return lowest;
+}
+
+static int logzip_file(logzip_work *work, unsigned long seq)
+{
+    char name[LOGZIP_DIR_LEN + 14];
+    unsigned int count, written;
+    unsigned long size, len;
+    FRESULT fresult;
+
+    logzip_name(name, seq, "RAW");
+    if(f_open(&work->raw, name, FA_READ) != FR_OK)
+        return -1;
+    size = f_size(&work->raw);
+
+    /* a segment cut short by a reset is simply compressed again */
+    logzip_name(name, seq, "LZ");
+    if(f_open(&work->lz, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK){
+        f_close(&work->raw);
+        return -1;
+    }
+
+    vLzssHeader(work->out, size);
+    fresult = f_write(&work->lz, work->out, LZSS_HEADER_SIZE, &written);
+    vLzssEncodeInit(&work->enc);
+    while(fresult == FR_OK){
+        fresult = f_read(&work->raw, work->in, sizeof(work->in), &count);
+        if(fresult != FR_OK)
+            break;
+        if(count == 0){
+            len = ulLzssEncodeEnd(&work->enc, work->out);
+            if(len)
+                fresult = f_write(&work->lz, work->out, len, &written);
+            break;
+        }
+        len = ulLzssEncode(&work->enc, work->in, count, work->out);
+        if(len)
+            fresult = f_write(&work->lz, work->out, len, &written);
+    }
+
+    f_close(&work->raw);
+    if(f_close(&work->lz) != FR_OK || fresult != FR_OK){
+        f_unlink(name);
+        return -1;
+    }
+
+    syslog(LOG_LEVEL_INFO,"log segment %lu compressed, %lu to %lu bytes",seq,size,f_size(&work->lz));
+    logzip_name(name, seq, "RAW");
+    f_unlink(name);
+    return 0;
+}
+
+static void vLogzipTask(void *pvParameters)
+{
+    logzip_work *work;
+    unsigned long seq;
+
+    for(;;){
+        while((seq = logzip_next()) != 0){
+            work = mem_malloc(sizeof(logzip_work));
+            if(work == NULL)
+                break;
+            if(logzip_file(work, seq)){
+                syslog(LOG_LEVEL_WARNING,"log segment %lu not compressed",seq);
+                mem_free(work);
+                break;
+            }
+            mem_free(work);
+        }
+        /* woken by the next rotation, or retries a failure later */
+        xSemaphoreTake(logzip_kick, 10 * 60 * configTICK_RATE_HZ);
+    }
+}
+
+/*
+ * called with the log file path once the card is there, picks the next
+ * segment number and compresses segments left by the last run.
+ */
+void logzip_start(const char *path)
+{
+    const char *slash;
+    unsigned long seq;
+
+    if(logzip_kick)
+        return;
+
+    slash = strrchr(path, '/');
+    if(slash == NULL || slash - path >= LOGZIP_DIR_LEN)
+        return;
+    memcpy(logzip_dir, path, slash - path);
+    logzip_dir[slash - path] = 0;
+
+    if(f_opendir(&logzip_dir_object, logzip_dir[0] ? logzip_dir : "/") == FR_OK){
+        while(f_readdir(&logzip_dir_object, &logzip_info) == FR_OK && logzip_info.fname[0]){
+            seq = logzip_number(logzip_info.fname, "RAW");
+            if(seq == 0)
+                seq = logzip_number(logzip_info.fname, "LZ");
+            if(seq > logzip_seq)
+                logzip_seq = seq;
+        }
+    }
+
+    vSemaphoreCreateBinary(logzip_kick);
+    if(logzip_kick == NULL)
+        return;
+    xTaskCreate(vLogzipTask, (signed portCHAR *)"logzip", LOGZIP_STACK_SIZE, NULL, LOGZIP_PRIORITY, NULL);
+}
+
+/* move the closed log file aside as the next segment */
+int logzip_rotate(const char *path)
+{
+    char name[LOGZIP_DIR_LEN + 14];
+
+    if(logzip_kick == NULL)
+        return -1;
+    logzip_name(name, logzip_seq + 1, "RAW");
+    if(f_rename(path, name) != FR_OK)
+        return -1;
+    logzip_seq++;
+    xSemaphoreGive(logzip_kick);
+    return 0;
+}
+
+/* archive names end in .LZ, FatFs gives them upper case */
+int lz_is_archive(const char *path)
+{
+    int len = strlen(path);
+
+    return len > 3 && path[len - 3] == '.' && (path[len - 2] == 'L' || path[len - 2] == 'l')
+           && (path[len - 1] == 'Z' || path[len - 1] == 'z');
+}
+
+/* start reading an archive open in file, returns the original size or -1 */
+long lz_open(lz_reader *reader, FIL *file)
+{
+    unsigned int count;
+
+    reader->file = file;
+    if(f_read(file, reader->in, LZSS_HEADER_SIZE, &count) != FR_OK || count != LZSS_HEADER_SIZE)
+        return -1;
+    reader->remain = lLzssHeaderCheck(reader->in);
+    reader->avail = 0;
+    vLzssDecodeInit(&reader->dec);
+    return reader->remain;
+}
+
+/* read up to len bytes of the original, 0 at the end, -1 on error */
+int lz_read(lz_reader *reader, char *buf, int len)
+{
+    unsigned int count = 1;
+    unsigned long n;
+    int total = 0;
+
+    if(len > reader->remain)
+        len = reader->remain;
+    while(total < len){
+        if(reader->avail == 0){
+            if(f_read(reader->file, reader->in, sizeof(reader->in), &count) != FR_OK)
+                return -1;
+            reader->next = reader->in;
+            reader->avail = count;
+        }
+        n = ulLzssDecode(&reader->dec, &reader->next, &reader->avail, (unsigned char *)buf + total, len - total);
+        /* no input left and no match being copied, the archive is short */
+        if(n == 0 && reader->avail == 0 && count == 0)
+            break;
+        total += n;
+    }
+    reader->remain -= total;
+    return total;
+}
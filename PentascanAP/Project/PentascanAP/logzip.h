@@ -0,0 +1,27 @@
+/*
+ * log archives. syslog.log is rotated into Lnnnnnnn.RAW next to it once it
+ * reaches LOG_ROTATE_SIZE, a background task compresses the segment into
+ * Lnnnnnnn.LZ (Common/Utils/lzss.h) and deletes it. cat and the http
+ * server decompress archives on the fly through lz_reader, Tools/lzcat
+ * does it on the host.
+ */
+#include "ff.h"
+#include "lzss.h"
+
+#define LZ_READ_SIZE        64
+
+typedef struct{
+    FIL *file;
+    long remain;                /* bytes of the original still to come */
+    const unsigned char *next;
+    unsigned long avail;
+    unsigned char in[LZ_READ_SIZE];
+    xLzssDecoder dec;
+}lz_reader;
+
+void logzip_start(const char *path);
+int logzip_rotate(const char *path);
+
+int lz_is_archive(const char *path);
+long lz_open(lz_reader *reader, FIL *file);
+int lz_read(lz_reader *reader, char *buf, int len);
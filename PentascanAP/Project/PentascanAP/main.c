@@ -19,6 +19,7 @@
 #include "Rtc.h"
 #include "lcd_terminal.h"
 #include "chardevice.h"
+#include "health.h"
 
 /*-----------------------------------------------------------*/
 
@@ -101,14 +102,11 @@ extern void UARTprint(char *message);
 
 void vApplicationStackOverflowHook( xTaskHandle *pxTask, signed portCHAR *pcTaskName )
 {
-	( void ) pxTask;
-	( void ) pcTaskName;
-
-    
     UARTprint("Stack Overflow : ");
-    UARTprint(pcTaskName);
-    
-	for( ;; );
+    UARTprint((char *)pcTaskName);
+
+    /* the hook passes the handle itself despite the prototype */
+    health_panic(health_stack_overflow, (xTaskHandle)pxTask, (const char *)pcTaskName);
 }
 
 #ifdef DEBUG
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Hardware library includes. */
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "lmi_flash.h"
+
+/* lwip library */
+#include "lwiplib.h"
+
+#include "httpc.h"
+#include "sha256.h"
+#include "ota_image.h"
+#include "log.h"
+#include "ota.h"
+#include "health.h"
+
+/* attempts of one download and the wait between them */
+#define OTA_RETRIES             20
+#define OTA_RETRY_MSEC          10000
+
+#define OTA_STACK_SIZE          256
+#define OTA_PRIORITY            (tskIDLE_PRIORITY + 1)
+/* above the download so a page is written while the next one comes in */
+#define OTA_FLASH_STACK_SIZE    128
+#define OTA_FLASH_PRIORITY      (tskIDLE_PRIORITY + 2)
+
+/* tells the flash task to exit */
+#define OTA_PAGE_END            0xffffffffUL
+
+typedef struct {
+    unsigned long page;         /* slot page, or OTA_PAGE_END */
+    int buf;
+}ota_write;
+
+static struct {
+    volatile ota_state state;
+    volatile unsigned long received;
+    unsigned long total;
+    unsigned long version;
+    const char * volatile error;
+    int resumed;
+    xOtaHeader header;
+    xHmacSha256Context mac;
+    char url[100];
+    /* two pages, one filled from the network while the other is written */
+    unsigned char *buf[2];
+    int cur;
+    xQueueHandle full;          /* filled pages to the flash task */
+    xQueueHandle free;          /* written pages back */
+}ota;
+
+static const unsigned char ota_key[] = OTA_KEY;
+static const xOtaState * const flash_state = (const xOtaState *)OTA_STATE_BASE;
+
+/* program one word of the state page */
+static long ota_state_write(const unsigned long *word, unsigned long value)
+{
+    return FlashProgram(&value, (unsigned long)word, sizeof(value));
+}
+
+static const char *ota_header_check(const xOtaHeader *header)
+{
+    if(header->ulMagic != OTA_IMAGE_MAGIC || header->ulFormat != OTA_IMAGE_FORMAT)
+        return "not an image";
+    if(header->ulLength > OTA_APP_SIZE || header->ulLength % 4)
+        return "bad image size";
+
+    ota.total = OTA_HEADER_SIZE + header->ulLength;
+    ota.version = header->ulVersion;
+    return NULL;
+}
+
+static void vOtaFlashTask(void *pvParameters)
+{
+    ota_write req;
+    unsigned long addr;
+
+    for(;;){
+        xQueueReceive(ota.full, &req, portMAX_DELAY);
+        if(req.page == OTA_PAGE_END)
+            break;
+
+        addr = OTA_SLOT_BASE + req.page * OTA_PAGE_SIZE;
+        if(ota.error == NULL){
+            if(FlashErase(addr) || FlashProgram((unsigned long *)ota.buf[req.buf], addr, OTA_PAGE_SIZE))
+                ota.error = "flash program failed";
+            else if(memcmp((void *)addr, ota.buf[req.buf], OTA_PAGE_SIZE))
+                ota.error = "flash verify failed";
+            else
+                ota_state_write(&flash_state->ulPage[req.page], 0);
+        }
+        xQueueSend(ota.free, &req.buf, portMAX_DELAY);
+    }
+    /* -1 tells the download task the queues are no longer used */
+    req.buf = -1;
+    xQueueSend(ota.free, &req.buf, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+/* hand the page being filled to the flash task and take the other one */
+static void ota_flush(void)
+{
+    ota_write req;
+
+    req.page = (ota.received - 1) / OTA_PAGE_SIZE;
+    req.buf = ota.cur;
+    xQueueSend(ota.full, &req, portMAX_DELAY);
+    xQueueReceive(ota.free, &ota.cur, portMAX_DELAY);
+}
+
+/* wait until the flash task has written all pages handed to it */
+static void ota_sync(void)
+{
+    int buf;
+
+    xQueueReceive(ota.free, &buf, portMAX_DELAY);
+    xQueueSend(ota.free, &buf, portMAX_DELAY);
+}
+
+/* http callback, the image is hashed as it comes in */
+static int ota_data(unsigned long size, char *data, void *pv)
+{
+    unsigned long pos, fill, n, skip;
+
+    while(size){
+        if(ota.error)
+            return -1;
+        pos = ota.received;
+        if(ota.total && pos == ota.total)
+            return 0;
+
+        fill = pos % OTA_PAGE_SIZE;
+        n = OTA_PAGE_SIZE - fill;
+        if(n > size)
+            n = size;
+        if(ota.total && n > ota.total - pos)
+            n = ota.total - pos;
+        memcpy(ota.buf[ota.cur] + fill, data, n);
+
+        if(pos < OTA_HEADER_SIZE && pos + n >= OTA_HEADER_SIZE){
+            /* the header is at the start of the first page */
+            memcpy(&ota.header, ota.buf[ota.cur], OTA_HEADER_SIZE);
+            ota.error = ota_header_check(&ota.header);
+            if(ota.error)
+                return -1;
+            vHmacSha256Init(&ota.mac, ota_key, sizeof(ota_key) - 1);
+            vHmacSha256Update(&ota.mac, &ota.header, OTA_HEADER_MAC_OFFSET);
+        }
+        if(pos + n > OTA_HEADER_SIZE){
+            skip = pos < OTA_HEADER_SIZE ? OTA_HEADER_SIZE - pos : 0;
+            vHmacSha256Update(&ota.mac, data + skip, n - skip);
+        }
+
+        ota.received = pos + n;
+        data += n;
+        size -= n;
+
+        if(ota.received == ota.total){
+            memset(ota.buf[ota.cur] + fill + n, 0xff, OTA_PAGE_SIZE - fill - n);
+            ota_flush();
+        }else if(ota.received % OTA_PAGE_SIZE == 0){
+            ota_flush();
+        }
+    }
+    return 0;
+}
+
+/*
+ * picks up an interrupted download from the pages already in the slot,
+ * returns the offset to continue from or 0 to start over.
+ */
+static unsigned long ota_resume(void)
+{
+    const xOtaHeader *header = (const xOtaHeader *)OTA_SLOT_BASE;
+    unsigned long pages, offset;
+
+    if(flash_state->ulMagic != OTA_STATE_MAGIC || flash_state->ulPending != OTA_STATE_ERASED)
+        return 0;
+    for(pages=0;pages<OTA_SLOT_PAGES && flash_state->ulPage[pages] == 0;pages++);
+    if(pages == 0 || ota_header_check(header))
+        return 0;
+
+    /* fetch the last page again rather than ask for an empty range */
+    offset = pages * OTA_PAGE_SIZE;
+    if(offset >= ota.total)
+        offset = (ota.total - 1) / OTA_PAGE_SIZE * OTA_PAGE_SIZE;
+    if(offset < OTA_HEADER_SIZE)
+        return 0;
+
+    ota.header = *header;
+    vHmacSha256Init(&ota.mac, ota_key, sizeof(ota_key) - 1);
+    vHmacSha256Update(&ota.mac, header, OTA_HEADER_MAC_OFFSET);
+    vHmacSha256Update(&ota.mac, (const void *)(OTA_SLOT_BASE + OTA_HEADER_SIZE), offset - OTA_HEADER_SIZE);
+    return offset;
+}
+
+/*
+ * returns 0 once the image is in the slot and verified, -2 when the image
+ * in the slot does not belong to the one on the server.
+ */
+static int ota_download(int resume)
+{
+    unsigned char mac[SHA256_DIGEST_SIZE];
+    int ret = 0, attempt;
+
+    ota.error = NULL;
+    ota.total = 0;
+    ota.received = resume ? ota_resume() : 0;
+    ota.resumed = ota.received != 0;
+    if(ota.resumed)
+        syslog(LOG_LEVEL_INFO,"ota: resuming at %lu of %lu",ota.received,ota.total);
+    else if(FlashErase(OTA_STATE_BASE) || ota_state_write(&flash_state->ulMagic, OTA_STATE_MAGIC))
+        ota.error = "flash erase failed";
+
+    for(attempt=0;ota.error == NULL && attempt < OTA_RETRIES;attempt++){
+        if(attempt)
+            vTaskDelay(OTA_RETRY_MSEC / portTICK_RATE_MS);
+        ret = http_req_range(ota.url, ota.received, ota_data, NULL);
+        if(ota.total && ota.received == ota.total)
+            break;
+        syslog(LOG_LEVEL_WARNING,"ota: stopped at %lu, result %d",ota.received,ret);
+        if(ret >= 400)
+            ota.error = "http error";
+    }
+    if(ota.error == NULL && (ota.total == 0 || ota.received != ota.total))
+        ota.error = "too many retries";
+
+    ota_sync();
+    if(ota.error)
+        return (ota.resumed && ret == 416) ? -2 : -1;
+
+    vHmacSha256Final(&ota.mac, mac);
+    if(memcmp(mac, ota.header.ucMac, sizeof(mac))){
+        ota.error = "bad signature";
+        /* nothing in the slot is worth resuming */
+        FlashErase(OTA_STATE_BASE);
+        return ota.resumed ? -2 : -1;
+    }
+    if(ota_state_write(&flash_state->ulPending, OTA_STATE_PENDING)){
+        ota.error = "flash program failed";
+        return -1;
+    }
+    return 0;
+}
+
+static void ota_cleanup(void)
+{
+    if(ota.full)
+        vQueueDelete(ota.full);
+    if(ota.free)
+        vQueueDelete(ota.free);
+    if(ota.buf[0])
+        mem_free(ota.buf[0]);
+    if(ota.buf[1])
+        mem_free(ota.buf[1]);
+    ota.full = ota.free = NULL;
+    ota.buf[0] = ota.buf[1] = NULL;
+}
+
+static void vOtaTask(void *pvParameters)
+{
+    ota_write req;
+    int ret = -1, buf;
+
+    if(xTaskCreate(vOtaFlashTask, (signed portCHAR *)"ota flash", OTA_FLASH_STACK_SIZE, NULL,
+                   OTA_FLASH_PRIORITY, NULL) != pdPASS){
+        ota.error = "out of memory";
+    }else{
+        ret = ota_download(1);
+        if(ret == -2){
+            syslog(LOG_LEVEL_WARNING,"ota: slot holds another image, starting over");
+            ret = ota_download(0);
+        }
+
+        /* stop the flash task and wait until it is gone */
+        req.page = OTA_PAGE_END;
+        xQueueSend(ota.full, &req, portMAX_DELAY);
+        do{
+            xQueueReceive(ota.free, &buf, portMAX_DELAY);
+        }while(buf != -1);
+    }
+
+    if(ret == 0){
+        syslog(LOG_LEVEL_INFO,"ota: version %lu verified, \"ota install\" to update",ota.version);
+        ota.state = ota_ready;
+    }else{
+        syslog(LOG_LEVEL_ERROR,"ota: failed, %s",ota.error);
+        ota.state = ota_failed;
+    }
+    ota_cleanup();
+    vTaskDelete(NULL);
+}
+
+/*
+ * start downloading the image at url in the background, resuming what is
+ * in the slot. returns -1 when a download is running or out of memory.
+ */
+int ota_start(const char *url)
+{
+    int buf = 1;
+
+    if(ota.state == ota_downloading || strlen(url) >= sizeof(ota.url))
+        return -1;
+    strcpy(ota.url, url);
+
+    ota.buf[0] = mem_malloc(OTA_PAGE_SIZE);
+    ota.buf[1] = mem_malloc(OTA_PAGE_SIZE);
+    ota.full = xQueueCreate(2, sizeof(ota_write));
+    ota.free = xQueueCreate(2, sizeof(int));
+    if(ota.buf[0] == NULL || ota.buf[1] == NULL || ota.full == NULL || ota.free == NULL){
+        ota_cleanup();
+        return -1;
+    }
+    ota.cur = 0;
+    xQueueSend(ota.free, &buf, 0);
+
+    ota.state = ota_downloading;
+    if(xTaskCreate(vOtaTask, (signed portCHAR *)"ota", OTA_STACK_SIZE, NULL, OTA_PRIORITY, NULL) != pdPASS){
+        ota.state = ota_idle;
+        ota_cleanup();
+        return -1;
+    }
+    return 0;
+}
+
+void ota_status_get(ota_status *status)
+{
+    const xOtaHeader *header = (const xOtaHeader *)OTA_SLOT_BASE;
+
+    status->state = ota.state;
+    status->received = ota.received;
+    status->total = ota.total;
+    status->version = ota.version;
+    status->error = ota.error;
+
+    /* verified before the last reset, the boot stage did not install it */
+    if(status->state == ota_idle && flash_state->ulMagic == OTA_STATE_MAGIC
+       && flash_state->ulPending == OTA_STATE_PENDING){
+        status->state = ota_ready;
+        status->total = status->received = OTA_HEADER_SIZE + header->ulLength;
+        status->version = header->ulVersion;
+    }
+}
+
+/* reset into the boot stage to install the verified image */
+int ota_install(void)
+{
+    if(ota.state == ota_downloading || flash_state->ulMagic != OTA_STATE_MAGIC
+       || flash_state->ulPending != OTA_STATE_PENDING)
+        return -1;
+
+    /* flushes the log first */
+    health_reset("ota install");
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * firmware update over HTTP, see Common/Utils/ota_image.h for the flash
+ * layout and the image format.
+ *
+ * ota_start() downloads a signed image into the slot, resuming a download
+ * interrupted by a dropped connection or a reset with an HTTP Range request.
+ * once the image is verified ota_install() resets into the boot stage which
+ * copies it over the running firmware.
+ */
+
+/* key the images are signed with, the one given to Tools/otasign.  there is
+   no default, every build sets its own in the C/C++ Define of the target
+   options as OTA_KEY="\"<key>\"" */
+#ifndef OTA_KEY
+#error "OTA_KEY not defined, set the update signing key at build time"
+#endif
+
+typedef enum{
+    ota_idle,
+    ota_downloading,
+    ota_ready,
+    ota_failed
+}ota_state;
+
+typedef struct {
+    ota_state state;
+    unsigned long received;     /* bytes of the image in the slot */
+    unsigned long total;        /* image size, 0 until the header is in */
+    unsigned long version;      /* from the image header */
+    const char *error;          /* why it failed */
+}ota_status;
+
+int ota_start(const char *url);
+void ota_status_get(ota_status *status);
+int ota_install(void);
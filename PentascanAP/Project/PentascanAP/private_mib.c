@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <string.h>
+#include "lwip/opt.h"
+
+#if LWIP_SNMP && SNMP_PRIVATE_MIB
+
+#include "lwip/snmp.h"
+#include "lwip/snmp_asn1.h"
+#include "lwip/snmp_structs.h"
+#include "lwip/timers.h"
+#include "lwip/mem.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "diskio.h"
+#include "console.h"
+#include "SensorManager.h"
+#include "Rtc.h"
+
+/*
+ * the private MIB described in private_mib.h.
+ * the agent runs in the tcpip thread, so do the callbacks below and the
+ * sampler, which is an lwIP timeout. values that are cheap to read are read
+ * when asked for, cpu usage and sd rates are taken every
+ * PRIVATE_MIB_SAMPLE_MSEC.
+ */
+
+#define MIB_INTEG       (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_INTEG)
+#define MIB_OC_STR      (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_OC_STR)
+#define MIB_COUNTER     (SNMP_ASN1_APPLIC | SNMP_ASN1_PRIMIT | SNMP_ASN1_COUNTER)
+#define MIB_GAUGE       (SNMP_ASN1_APPLIC | SNMP_ASN1_PRIMIT | SNMP_ASN1_GAUGE)
+
+typedef struct{
+    char name[configMAX_TASK_NAME_LEN];
+    unsigned long run;          /* run time counter at the last sample */
+    unsigned long cpu;          /* 1/100 % of the last sample */
+}mib_task;
+
+static mib_task task_row[PRIVATE_MIB_MAX_TASKS];
+static int task_rows;
+static unsigned long sample_run;
+static DSTATS sample_disk;
+static unsigned long sample_read_rate, sample_write_rate;
+static unsigned long heap_low = 0xffffffff;
+
+static const u8_t sysdescr[] = "PentascanAP sensor gateway";
+static const u8_t sysdescr_len = sizeof(sysdescr) - 1;
+
+static void upload_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void upload_get_value(struct obj_def *od, u16_t len, void *value);
+static void sensor_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void sensor_get_value(struct obj_def *od, u16_t len, void *value);
+static void system_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void system_get_value(struct obj_def *od, u16_t len, void *value);
+static void task_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void task_get_value(struct obj_def *od, u16_t len, void *value);
+static void sd_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void sd_get_value(struct obj_def *od, u16_t len, void *value);
+
+/* upload .1.3.6.1.4.1.E.1.1 */
+static const u8_t upload_types[6] = {
+    MIB_COUNTER, MIB_COUNTER, MIB_INTEG, MIB_GAUGE, MIB_GAUGE, MIB_GAUGE
+};
+static const mib_scalar_node upload_scalar = {
+  &upload_get_object_def,
+  &upload_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_SC,
+  0
+};
+static const s32_t upload_ids[6] = { 1, 2, 3, 4, 5, 6 };
+static struct mib_node* const upload_nodes[6] = {
+  (struct mib_node*)&upload_scalar, (struct mib_node*)&upload_scalar,
+  (struct mib_node*)&upload_scalar, (struct mib_node*)&upload_scalar,
+  (struct mib_node*)&upload_scalar, (struct mib_node*)&upload_scalar
+};
+static const struct mib_array_node upload = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  6,
+  upload_ids,
+  upload_nodes
+};
+
+/* sensor .1.3.6.1.4.1.E.1.2 */
+static const u8_t sensor_types[2] = { MIB_GAUGE, MIB_COUNTER };
+static const mib_scalar_node sensor_scalar = {
+  &sensor_get_object_def,
+  &sensor_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_SC,
+  0
+};
+static const s32_t sensor_ids[2] = { 1, 2 };
+static struct mib_node* const sensor_nodes[2] = {
+  (struct mib_node*)&sensor_scalar, (struct mib_node*)&sensor_scalar
+};
+static const struct mib_array_node sensor = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  2,
+  sensor_ids,
+  sensor_nodes
+};
+
+/* task table .1.3.6.1.4.1.E.1.3.4, a row per task seen by the sampler */
+static struct mib_list_rootnode tasklist_root = {
+  &task_get_object_def,
+  &task_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_LR,
+  0,
+  NULL,
+  NULL,
+  0
+};
+static const s32_t taskentry_ids[4] = { 1, 2, 3, 4 };
+static struct mib_node* const taskentry_nodes[4] = {
+  (struct mib_node*)&tasklist_root, (struct mib_node*)&tasklist_root,
+  (struct mib_node*)&tasklist_root, (struct mib_node*)&tasklist_root
+};
+static const struct mib_array_node taskentry = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  4,
+  taskentry_ids,
+  taskentry_nodes
+};
+static s32_t tasktable_id = 1;
+static struct mib_node* tasktable_node = (struct mib_node*)&taskentry;
+/* maxlength is set to 1 once there are rows, to allow getnext */
+static struct mib_ram_array_node tasktable = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_RA,
+  0,
+  &tasktable_id,
+  &tasktable_node
+};
+
+/* system .1.3.6.1.4.1.E.1.3 */
+static const u8_t system_types[3] = { MIB_GAUGE, MIB_GAUGE, MIB_GAUGE };
+static const mib_scalar_node system_scalar = {
+  &system_get_object_def,
+  &system_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_SC,
+  0
+};
+static const s32_t system_ids[4] = { 1, 2, 3, 4 };
+static struct mib_node* const system_nodes[4] = {
+  (struct mib_node*)&system_scalar, (struct mib_node*)&system_scalar,
+  (struct mib_node*)&system_scalar, (struct mib_node*)&tasktable
+};
+static const struct mib_array_node gw_system = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  4,
+  system_ids,
+  system_nodes
+};
+
+/* sd .1.3.6.1.4.1.E.1.4 */
+static const u8_t sd_types[5] = {
+    MIB_COUNTER, MIB_COUNTER, MIB_GAUGE, MIB_GAUGE, MIB_COUNTER
+};
+static const mib_scalar_node sd_scalar = {
+  &sd_get_object_def,
+  &sd_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_SC,
+  0
+};
+static const s32_t sd_ids[5] = { 1, 2, 3, 4, 5 };
+static struct mib_node* const sd_nodes[5] = {
+  (struct mib_node*)&sd_scalar, (struct mib_node*)&sd_scalar,
+  (struct mib_node*)&sd_scalar, (struct mib_node*)&sd_scalar,
+  (struct mib_node*)&sd_scalar
+};
+static const struct mib_array_node sd = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  5,
+  sd_ids,
+  sd_nodes
+};
+
+/* gateway .1.3.6.1.4.1.E.1 */
+static const s32_t gateway_ids[4] = { 1, 2, 3, 4 };
+static struct mib_node* const gateway_nodes[4] = {
+  (struct mib_node*)&upload, (struct mib_node*)&sensor,
+  (struct mib_node*)&gw_system, (struct mib_node*)&sd
+};
+static const struct mib_array_node gateway = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  4,
+  gateway_ids,
+  gateway_nodes
+};
+
+/* .1.3.6.1.4.1.E */
+static const s32_t pentascan_ids[1] = { 1 };
+static struct mib_node* const pentascan_nodes[1] = { (struct mib_node*)&gateway };
+static const struct mib_array_node pentascan = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  pentascan_ids,
+  pentascan_nodes
+};
+
+/* enterprises .1.3.6.1.4.1 */
+static const s32_t enterprises_ids[1] = { PRIVATE_MIB_ENTERPRISE };
+static struct mib_node* const enterprises_nodes[1] = { (struct mib_node*)&pentascan };
+static const struct mib_array_node enterprises = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  enterprises_ids,
+  enterprises_nodes
+};
+
+/* private .1.3.6.1.4 */
+static const s32_t private_ids[1] = { 1 };
+static struct mib_node* const private_nodes[1] = { (struct mib_node*)&enterprises };
+const struct mib_array_node mib_private = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  private_ids,
+  private_nodes
+};
+
+/* read only scalar objectname.0, every value is 32 bit */
+static void scalar_get_object_def(const u8_t *types, s32_t count, u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    /* return to object name, adding index depth (1) */
+    ident_len += 1;
+    ident -= 1;
+    if(ident_len == 2 && ident[0] >= 1 && ident[0] <= count){
+        od->id_inst_len = ident_len;
+        od->id_inst_ptr = ident;
+        od->instance = MIB_OBJECT_SCALAR;
+        od->access = MIB_OBJECT_READ_ONLY;
+        od->asn_type = types[ident[0] - 1];
+        od->v_len = sizeof(u32_t);
+    }else{
+        od->instance = MIB_OBJECT_NONE;
+    }
+}
+
+static void upload_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    scalar_get_object_def(upload_types, sizeof(upload_types), ident_len, ident, od);
+}
+
+static void upload_get_value(struct obj_def *od, u16_t len, void *value)
+{
+    report_status status;
+    u32_t *uint_ptr = (u32_t*)value;
+
+    report_status_get(&status);
+    switch(od->id_inst_ptr[0]){
+    case 1: /* count */
+        *uint_ptr = status.count;
+        break;
+    case 2: /* success */
+        *uint_ptr = status.success;
+        break;
+    case 3: /* http result of the last report */
+        *(s32_t*)value = status.result;
+        break;
+    case 4: /* latency */
+        *uint_ptr = status.elapsed;
+        break;
+    case 5: /* max latency */
+        *uint_ptr = status.max_elapsed;
+        break;
+    case 6: /* backlog */
+        *uint_ptr = status.backlog;
+        break;
+    }
+}
+
+static void sensor_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    scalar_get_object_def(sensor_types, sizeof(sensor_types), ident_len, ident, od);
+}
+
+static void sensor_get_value(struct obj_def *od, u16_t len, void *value)
+{
+    /* one node at a time, the table does not fit on the tcpip stack */
+    static sensor_node node;
+    u32_t *uint_ptr = (u32_t*)value;
+    int i;
+
+    switch(od->id_inst_ptr[0]){
+    case 1: /* count */
+        *uint_ptr = SENSOR_NODE_MAX;
+        break;
+    case 2: /* retries */
+        *uint_ptr = 0;
+        for(i=0;i<SENSOR_NODE_MAX;i++){
+            sensor_read(i, &node);
+            *uint_ptr += node.retry;
+        }
+        break;
+    }
+}
+
+static void system_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    scalar_get_object_def(system_types, sizeof(system_types), ident_len, ident, od);
+}
+
+static void system_get_value(struct obj_def *od, u16_t len, void *value)
+{
+    u32_t *uint_ptr = (u32_t*)value;
+
+    switch(od->id_inst_ptr[0]){
+    case 1: /* heap free */
+        *uint_ptr = checkFreeMem();
+        if(*uint_ptr < heap_low)
+            heap_low = *uint_ptr;
+        break;
+    case 2: /* lowest heap free seen */
+        *uint_ptr = heap_low;
+        break;
+    case 3: /* task count */
+        *uint_ptr = uxTaskGetNumberOfTasks();
+        break;
+    }
+}
+
+static void task_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    /* return to object name, adding index depth (1) */
+    ident_len += 1;
+    ident -= 1;
+    if(ident_len == 2 && ident[1] >= 1 && ident[1] <= task_rows){
+        od->id_inst_len = ident_len;
+        od->id_inst_ptr = ident;
+        od->instance = MIB_OBJECT_TAB;
+        od->access = MIB_OBJECT_READ_ONLY;
+        od->v_len = sizeof(u32_t);
+        switch(ident[0]){
+        case 1: /* index */
+            od->asn_type = MIB_INTEG;
+            break;
+        case 2: /* name */
+            od->asn_type = MIB_OC_STR;
+            od->v_len = strlen(task_row[ident[1] - 1].name);
+            break;
+        case 3: /* run time */
+            od->asn_type = MIB_COUNTER;
+            break;
+        case 4: /* cpu */
+            od->asn_type = MIB_GAUGE;
+            break;
+        default:
+            od->instance = MIB_OBJECT_NONE;
+            break;
+        }
+    }else{
+        od->instance = MIB_OBJECT_NONE;
+    }
+}
+
+static void task_get_value(struct obj_def *od, u16_t len, void *value)
+{
+    mib_task *task = &task_row[od->id_inst_ptr[1] - 1];
+
+    switch(od->id_inst_ptr[0]){
+    case 1:
+        *(s32_t*)value = od->id_inst_ptr[1];
+        break;
+    case 2:
+        memcpy(value, task->name, len);
+        break;
+    case 3:
+        *(u32_t*)value = task->run;
+        break;
+    case 4:
+        *(u32_t*)value = task->cpu;
+        break;
+    }
+}
+
+static void sd_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+    scalar_get_object_def(sd_types, sizeof(sd_types), ident_len, ident, od);
+}
+
+static void sd_get_value(struct obj_def *od, u16_t len, void *value)
+{
+    u32_t *uint_ptr = (u32_t*)value;
+    DSTATS stats;
+
+    disk_stats(&stats);
+    switch(od->id_inst_ptr[0]){
+    case 1: /* read bytes */
+        *uint_ptr = stats.read_bytes;
+        break;
+    case 2: /* write bytes */
+        *uint_ptr = stats.write_bytes;
+        break;
+    case 3: /* read bytes/sec */
+        *uint_ptr = sample_read_rate;
+        break;
+    case 4: /* write bytes/sec */
+        *uint_ptr = sample_write_rate;
+        break;
+    case 5: /* busy msec */
+        *uint_ptr = stats.busy_ticks * portTICK_RATE_MS;
+        break;
+    }
+}
+
+/* update the task table from the run time stats, rows are kept by name */
+static void task_sample(unsigned long total)
+{
+    /* counters copied as they are, no printf or scanf on the tcpip stack */
+    static xTaskRunTime list[PRIVATE_MIB_MAX_TASKS];
+    const char *line;
+    unsigned long run;
+    struct mib_list_node *node;
+    int i, n, count;
+
+    count = uxTaskGetRunTimes(list, PRIVATE_MIB_MAX_TASKS);
+    for(n=0;n<count;n++){
+        line = (const char *)list[n].pcTaskName;
+        run = list[n].ulRunTimeCounter;
+
+        for(i=0;i<task_rows;i++)
+            if(!strcmp(task_row[i].name, line))
+                break;
+        if(i == task_rows){
+            /* a new task, deleted tasks keep their row and last values */
+            if(task_rows == PRIVATE_MIB_MAX_TASKS)
+                continue;
+            node = NULL;
+            if(snmp_mib_node_insert(&tasklist_root, i + 1, &node) == -1)
+                continue;
+            strncpy(task_row[i].name, line, configMAX_TASK_NAME_LEN - 1);
+            task_row[i].run = run;
+            task_rows++;
+            tasktable.maxlength = 1;
+        }
+        task_row[i].cpu = total ? (unsigned long)((unsigned long long)(run - task_row[i].run) * 10000 / total) : 0;
+        task_row[i].run = run;
+    }
+}
+
+static void private_mib_sample(void *arg)
+{
+    unsigned long run;
+    DSTATS stats;
+
+    run = RtcGetRunTimeCounter();
+    task_sample(run - sample_run);
+    sample_run = run;
+
+    disk_stats(&stats);
+    sample_read_rate = (stats.read_bytes - sample_disk.read_bytes) / (PRIVATE_MIB_SAMPLE_MSEC / 1000);
+    sample_write_rate = (stats.write_bytes - sample_disk.write_bytes) / (PRIVATE_MIB_SAMPLE_MSEC / 1000);
+    sample_disk = stats;
+
+    sys_timeout(PRIVATE_MIB_SAMPLE_MSEC, private_mib_sample, NULL);
+}
+
+void private_mib_init(void)
+{
+    snmp_set_sysdesr((u8_t*)sysdescr, (u8_t*)&sysdescr_len);
+
+    sample_run = RtcGetRunTimeCounter();
+    disk_stats(&sample_disk);
+    sys_timeout(PRIVATE_MIB_SAMPLE_MSEC, private_mib_sample, NULL);
+}
+
+/* sysUpTime in 1/100 sec */
+unsigned long private_mib_uptime(void)
+{
+    return xTaskGetTickCount() / (configTICK_RATE_HZ / 100);
+}
+
+#endif /* LWIP_SNMP && SNMP_PRIVATE_MIB */
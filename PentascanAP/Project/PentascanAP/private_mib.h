@@ -0,0 +1,43 @@
+#ifndef PRIVATE_MIB_H
+#define PRIVATE_MIB_H
+
+/*
+ * private MIB of the gateway, included by lwIP's snmp_structs.h when
+ * SNMP_PRIVATE_MIB is set. the tree is hung under
+ * .1.3.6.1.4.1.PRIVATE_MIB_ENTERPRISE.1 (gateway):
+ *
+ *  .1 upload   .1 count .2 success .3 result .4 latency msec
+ *              .5 max latency msec .6 backlog
+ *  .2 sensor   .1 count .2 retries
+ *  .3 system   .1 heap free .2 lowest heap free .3 task count
+ *              .4 task table, per task: .1 index .2 name .3 run time
+ *                 .4 cpu in 1/100 % over the last sample
+ *  .4 sd       .1 read bytes .2 write bytes .3 read bytes/sec
+ *              .4 write bytes/sec .5 busy msec
+ *
+ * e.g. snmpwalk -v1 -c <SNMP_COMMUNITY> <gateway> .1.3.6.1.4.1.26381.1
+ */
+
+/* lwIP's enterprise number, which mib2.c also reports as sysObjectID */
+#define PRIVATE_MIB_ENTERPRISE      26381
+
+#ifndef PRIVATE_MIB_MAX_TASKS
+#define PRIVATE_MIB_MAX_TASKS       16
+#endif
+
+#ifndef PRIVATE_MIB_SAMPLE_MSEC
+#define PRIVATE_MIB_SAMPLE_MSEC     5000
+#endif
+
+/* .1.3.6.1.4, the struct is defined after this file is included */
+extern const struct mib_array_node mib_private;
+
+void private_mib_init(void);
+unsigned long private_mib_uptime(void);
+
+/* called by snmp_init() */
+#define SNMP_PRIVATE_MIB_INIT()             private_mib_init()
+/* sysUpTime from the kernel tick instead of snmp_inc_sysuptime() */
+#define SNMP_GET_SYSUPTIME(sysuptime)       ((sysuptime) = private_mib_uptime())
+
+#endif
@@ -8,6 +8,7 @@
 #include "sysctl.h"
 #include "lmi_timer.h"
 #include "hw_timer.h"
+#include "Rtc.h"
 
 #include <time.h>
 #include <stdio.h>
@@ -17,10 +18,10 @@
 static volatile unsigned long timeval;
 static volatile unsigned long timeoffset;
 
-/* Counts the total number of times that the high frequency timer has 'ticked'.
-This value is used by the run time stats function to work out what percentage
-of CPU time each task is taking. */
-volatile unsigned long ulHighFrequencyTimerTicks = 0UL;
+/* Timer 1 free runs at the cpu clock and is used by the run time stats
+function to work out what percentage of CPU time each task is taking.  It only
+interrupts when the 32 bit count wraps, to extend the count in software. */
+static volatile unsigned long ulHighFrequencyTimerWraps = 0UL;
 
 static const char * const g_strweekday[] = {
     "Mon","Tue","Wed","Thu","Fri","Sat","Sun"
@@ -69,22 +70,50 @@ void RtcInit(void)
     SysCtlPeripheralEnable( SYSCTL_PERIPH_TIMER1 );
     TimerConfigure( TIMER1_BASE, TIMER_CFG_32_BIT_PER );
 
-	/* Just used to measure time. */
-    TimerLoadSet(TIMER1_BASE, TIMER_A, configCPU_CLOCK_HZ / 10000 );    /* sys tick = 1msec, so 100usec will be set */
-	IntPrioritySet( INT_TIMER1A, configMAX_SYSCALL_INTERRUPT_PRIORITY );
+	/* Just used to measure time, wraps every 85 sec at 50MHz. */
+    TimerLoadSet(TIMER1_BASE, TIMER_A, 0xFFFFFFFF );
+	IntPrioritySet( INT_TIMER1A, configKERNEL_INTERRUPT_PRIORITY );
     IntEnable( INT_TIMER1A );
     TimerIntEnable( TIMER1_BASE, TIMER_TIMA_TIMEOUT );
 
     timeval = 0;
     timeoffset = 0;
 
-    ulHighFrequencyTimerTicks = 0;
+    ulHighFrequencyTimerWraps = 0;
 
 	/* Enable rtc timer. */	
     TimerEnable( TIMER0_BASE, TIMER_A );
     TimerEnable( TIMER1_BASE, TIMER_A );
 }
 
+/*
+ * run time stat counter, called by the kernel at every task switch.
+ * a wrap that is not yet counted by Timer1IntHandler (interrupts masked
+ * in the context switch) is detected from the raw interrupt status.
+ */
+unsigned long RtcGetRunTimeCounter(void)
+{
+    unsigned long wraps, high, low;
+
+    do{
+        wraps = ulHighFrequencyTimerWraps;
+        high = wraps;
+        low = 0xFFFFFFFF - TimerValueGet( TIMER1_BASE, TIMER_A );
+        if(TimerIntStatus( TIMER1_BASE, false ) & TIMER_TIMA_TIMEOUT){
+            high++;
+            low = 0xFFFFFFFF - TimerValueGet( TIMER1_BASE, TIMER_A );
+        }
+    }while(wraps != ulHighFrequencyTimerWraps);
+
+    return (high << (32 - RTC_RUN_TIME_SHIFT)) | (low >> RTC_RUN_TIME_SHIFT);
+}
+
+/* raw count of timer 1, time stamp of the trace recorder */
+unsigned long RtcGetCycleCounter(void)
+{
+    return 0xFFFFFFFF - HWREG( TIMER1_BASE + TIMER_O_TAR );
+}
+
 unsigned long RtcGetTime(void)
 {
     return timeval + timeoffset;
@@ -200,13 +229,17 @@ unsigned long RtcConvertDateString(char *date_string)
 
 void Timer0IntHandler( void )
 {
+    traceISR_ENTER();
     timeval++;
 	TimerIntClear( TIMER0_BASE, TIMER_TIMA_TIMEOUT );
+    traceISR_EXIT();
 }
 void Timer1IntHandler( void )
 {
-    ulHighFrequencyTimerTicks++;
+    traceISR_ENTER();
+    ulHighFrequencyTimerWraps++;
 	TimerIntClear( TIMER1_BASE, TIMER_TIMA_TIMEOUT );
+    traceISR_EXIT();
 }
 
 
@@ -30,6 +30,14 @@ int telnet_putchar(FILE *file, char ch)
     return ch;
 }
 
+int telnet_write(FILE *file, const char *buffer, int length)
+{
+    if(file->handle && length > 0)
+        send(file->handle, buffer, length, 0);
+
+    return length;
+}
+
 FILE *telnet_add_tty(int socket)
 {
     int i;
@@ -56,6 +64,7 @@ static void telnet_proc( void *pvParameters )
     int client_socket = (int)pvParameters;
     char *buffer = mem_malloc(TELNET_RCV_BUFFER_LENGTH);
     line_buffer *cmd_buffer;
+    FILE *tty;
     int i, nbytes;
 
     if(buffer == NULL){
@@ -65,16 +74,17 @@ static void telnet_proc( void *pvParameters )
         return;
     }
 
-    cmd_buffer = console_buffer_get(100);
+    tty = telnet_add_tty(client_socket);
+    cmd_buffer = (tty == NULL) ? NULL : console_buffer_get(100, tty);
     if(cmd_buffer == NULL){
         printf("cmd buffer malloc fail\n");
         mem_free(buffer);
+        telnet_del_tty(client_socket);
         close(client_socket);
         vTaskDelete( NULL );
         return;
     }
 
-    cmd_buffer->file = telnet_add_tty(client_socket);
     do{
         nbytes = recv(client_socket, buffer, TELNET_RCV_BUFFER_LENGTH,0);
         for(i=0;i<nbytes;i++){
@@ -84,6 +94,8 @@ static void telnet_proc( void *pvParameters )
     
     mem_free(buffer);
     mem_free(cmd_buffer);
+    /* jobs started from this session must not write to the next one using the slot */
+    console_detach(tty);
     telnet_del_tty(client_socket);
     close(client_socket);
     vTaskDelete( NULL );
@@ -3,4 +3,5 @@
 void telnet_start(unsigned int port);
 void telnet_putchar_all(char ch);
 int telnet_putchar(FILE *file, char ch);
+int telnet_write(FILE *file, const char *buffer, int length);
 
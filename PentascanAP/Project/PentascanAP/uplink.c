@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* lwip library */
+#include "lwiplib.h"
+#include "lwip/sio.h"
+#include "ppp.h"
+
+#include "chardevice.h"
+#include "log.h"
+#include "uplink.h"
+#include "health.h"
+
+#define UPLINK_BAUD             115200
+/* how often the task looks at the links */
+#define UPLINK_POLL_MSEC        500
+/* Ethernet must have been bad this long before the modem is dialed, this
+   also covers getting a DHCP lease after boot */
+#define UPLINK_FAILOVER_MSEC    10000
+/* Ethernet must have been good this long before traffic moves back */
+#define UPLINK_FAILBACK_MSEC    10000
+/* wait between dial attempts, also lets the old ppp input thread exit */
+#define UPLINK_RETRY_MSEC       5000
+/* negotiation has to finish within this after dialing */
+#define UPLINK_CONNECT_MSEC     30000
+/* dialing blocks the task for up to 32 sec */
+#define UPLINK_HEALTH_MSEC      60000
+/* how long sio_read() blocks for the first byte */
+#define UPLINK_READ_WAIT        (100 / portTICK_RATE_MS)
+
+/* "ATD*99#" for a GPRS modem, empty when wired straight to pppd */
+#define UPLINK_DIAL             ""
+/* for PAP or CHAP, NULL when the peer does not ask */
+#define UPLINK_USER             NULL
+#define UPLINK_PASSWORD         NULL
+
+typedef enum{
+    uplink_ethernet,
+    uplink_dial,
+    uplink_connecting,
+    uplink_ppp
+}uplink_state;
+
+static const char * const uplink_names[] = {
+    "ethernet", "dial", "connecting", "ppp"
+};
+
+static uplink_state state = uplink_ethernet;
+static volatile int ppp_pd = -1;
+static volatile int ppp_up;
+static volatile int sio_abort;
+static int modem_ready;
+static int slow;
+
+/*
+ * sio for lwIP's PPPoS, there is only the modem.
+ */
+sio_fd_t sio_open(u8_t devnum)
+{
+    if(!modem_ready){
+        if(modem_init(UPLINK_BAUD))
+            return NULL;
+        modem_ready = 1;
+    }
+    return (sio_fd_t)&modem_ready;
+}
+
+u32_t sio_write(sio_fd_t fd, u8_t *data, u32_t len)
+{
+    return modem_write((const char *)data, len);
+}
+
+u32_t sio_read(sio_fd_t fd, u8_t *data, u32_t len)
+{
+    if(sio_abort){
+        sio_abort = 0;
+        return 0;
+    }
+    return modem_read((char *)data, len, UPLINK_READ_WAIT);
+}
+
+void sio_read_abort(sio_fd_t fd)
+{
+    sio_abort = 1;
+}
+
+/* modem chat, returns 0 when expect is seen within timeout msec */
+static int modem_expect(const char *expect, unsigned long timeout)
+{
+    char line[32];
+    int len = 0, n;
+    portTickType start = xTaskGetTickCount();
+
+    while(xTaskGetTickCount() - start < timeout / portTICK_RATE_MS){
+        n = modem_read(line + len, sizeof(line) - 1 - len, UPLINK_READ_WAIT);
+        len += n;
+        line[len] = 0;
+        if(strstr(line, expect))
+            return 0;
+        if(len == sizeof(line) - 1){
+            /* keep the tail, the answer may straddle */
+            memmove(line, line + len / 2, len - len / 2);
+            len -= len / 2;
+        }
+    }
+    return -1;
+}
+
+static int modem_dial(void)
+{
+    static const char at[] = "AT\r";
+    static const char dial[] = UPLINK_DIAL "\r";
+
+    if(sizeof(UPLINK_DIAL) == 1)
+        return 0;
+
+    modem_write(at, sizeof(at) - 1);
+    if(modem_expect("OK", 2000))
+        return -1;
+    modem_write(dial, sizeof(dial) - 1);
+    return modem_expect("CONNECT", 30000);
+}
+
+/* the callbacks below run in the tcpip thread */
+static void ppp_status(void *ctx, int err, void *arg)
+{
+    if(err == PPPERR_NONE){
+        ppp_up = 1;
+    }else{
+        ppp_up = 0;
+        ppp_pd = -1;
+    }
+}
+
+static void ppp_open(void *arg)
+{
+    ppp_pd = pppOverSerialOpen(arg, ppp_status, NULL);
+}
+
+static void ppp_close(void *arg)
+{
+    if(ppp_pd >= 0)
+        pppClose(ppp_pd);
+}
+
+static void route_ethernet(void *arg)
+{
+    struct netif *netif = lwIPNetifGet();
+
+    if(netif_default != netif)
+        netif_set_default(netif);
+}
+
+static int ethernet_good(void)
+{
+    struct netif *netif = lwIPNetifGet();
+
+    return netif_is_link_up(netif) && netif_is_up(netif) && netif->ip_addr.addr != 0;
+}
+
+static void vUplinkTask(void *pvParameters)
+{
+    sio_fd_t fd;
+    portTickType now, good_since = 0, bad_since, since = 0;
+    int good, health;
+
+    fd = sio_open(0);
+    if(fd == NULL){
+        syslog(LOG_LEVEL_ERROR,"uplink: no modem");
+        vTaskDelete(NULL);
+    }
+    pppInit();
+    if(UPLINK_USER)
+        pppSetAuth(PPPAUTHTYPE_ANY, UPLINK_USER, UPLINK_PASSWORD);
+
+    bad_since = xTaskGetTickCount();
+    health = health_register("uplink", UPLINK_HEALTH_MSEC);
+    for(;;){
+        vTaskDelay(UPLINK_POLL_MSEC / portTICK_RATE_MS);
+        health_checkin(health);
+        now = xTaskGetTickCount();
+
+        good = ethernet_good();
+        if(good){
+            bad_since = now;
+            if(!good_since)
+                good_since = now;
+        }else{
+            good_since = 0;
+        }
+
+        switch(state){
+        case uplink_ethernet:
+            if(good){
+                /* ppp clears the default route when it goes down */
+                if(netif_default != lwIPNetifGet())
+                    tcpip_callback(route_ethernet, NULL);
+                break;
+            }
+            if(now - bad_since < UPLINK_FAILOVER_MSEC / portTICK_RATE_MS)
+                break;
+            syslog(LOG_LEVEL_WARNING,"uplink: ethernet lost, dialing");
+            slow = 1;
+            state = uplink_dial;
+            since = now - UPLINK_RETRY_MSEC / portTICK_RATE_MS;
+            break;
+        case uplink_dial:
+            if(good){
+                syslog(LOG_LEVEL_INFO,"uplink: ethernet back");
+                slow = 0;
+                state = uplink_ethernet;
+                break;
+            }
+            if(now - since < UPLINK_RETRY_MSEC / portTICK_RATE_MS || ppp_pd >= 0)
+                break;
+            since = now;
+            if(modem_dial()){
+                syslog(LOG_LEVEL_WARNING,"uplink: dial failed");
+                break;
+            }
+            ppp_up = 0;
+            tcpip_callback(ppp_open, fd);
+            state = uplink_connecting;
+            break;
+        case uplink_connecting:
+            if(ppp_up){
+                /* ipcp made the ppp interface the default route */
+                syslog(LOG_LEVEL_INFO,"uplink: ppp up");
+                state = uplink_ppp;
+            }else if(now - since > UPLINK_CONNECT_MSEC / portTICK_RATE_MS){
+                syslog(LOG_LEVEL_WARNING,"uplink: ppp negotiation failed");
+                tcpip_callback(ppp_close, NULL);
+                since = now;
+                state = uplink_dial;
+            }
+            break;
+        case uplink_ppp:
+            if(!ppp_up){
+                syslog(LOG_LEVEL_WARNING,"uplink: ppp down");
+                since = now;
+                state = uplink_dial;
+            }else if(good && now - good_since >= UPLINK_FAILBACK_MSEC / portTICK_RATE_MS){
+                syslog(LOG_LEVEL_INFO,"uplink: ethernet back, hanging up");
+                tcpip_callback(route_ethernet, NULL);
+                tcpip_callback(ppp_close, NULL);
+                slow = 0;
+                state = uplink_ethernet;
+            }
+            break;
+        }
+    }
+}
+
+void uplink_start(void)
+{
+    xTaskCreate(vUplinkTask, (signed portCHAR *)"uplink", 192, NULL, tskIDLE_PRIORITY + 2, NULL);
+}
+
+/* set while traffic goes, or is about to go, over the modem */
+int uplink_is_slow(void)
+{
+    return slow;
+}
+
+const char *uplink_name(void)
+{
+    return uplink_names[state];
+}
@@ -0,0 +1,18 @@
+/*
+ * uplink failover between Ethernet and PPP over the modem on UART1.
+ *
+ * Ethernet is the default route while it has a link and an address. When
+ * it goes away the modem is dialed and the PPP interface becomes the
+ * default route, once Ethernet has been back for UPLINK_FAILBACK_MSEC the
+ * route moves back and the modem hangs up.
+ *
+ * to test with a Linux box as the remote side, on the serial port wired to
+ * UART1 (or a pty bridged to it):
+ *   pppd /dev/ttyUSB0 115200 local noauth passive nodetach debug \
+ *        10.64.0.1:10.64.0.2 ms-dns 8.8.8.8
+ * and unplug the Ethernet cable.
+ */
+
+void uplink_start(void);
+int uplink_is_slow(void);
+const char *uplink_name(void);
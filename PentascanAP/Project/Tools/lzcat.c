@@ -0,0 +1,109 @@
+/*
+ * lzcat - decompress the log archives written by the gateway
+ *
+ * Rotated segments of /log/syslog.log are compressed into /log/Lnnnnnnn.LZ
+ * on the SD card, the format is described in Common/Utils/lzss.h.  Fetch
+ * them as they are with http://<gateway>/log/L0000012.LZ?raw (without ?raw
+ * the gateway decompresses them itself) or copy them off the card.
+ *
+ * build on the host : gcc -O2 -I../Common/Utils -o lzcat lzcat.c ../Common/Utils/lzss.c
+ * usage             : lzcat L0000012.LZ [...] > syslog.txt
+ *                     lzcat -c syslog.log > L0000012.LZ   compresses like the gateway
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lzss.h"
+
+static int compress(FILE *in, FILE *out)
+{
+    static xLzssEncoder enc;
+    unsigned char header[LZSS_HEADER_SIZE], buf[LZSS_BLOCK], packed[LZSS_BOUND(LZSS_BLOCK)];
+    unsigned long total = 0, n;
+
+    /* the length is patched in at the end, stdout may not seek */
+    vLzssHeader(header, 0);
+    fwrite(header, 1, sizeof(header), out);
+    vLzssEncodeInit(&enc);
+    while((n = fread(buf, 1, sizeof(buf), in)) > 0){
+        total += n;
+        fwrite(packed, 1, ulLzssEncode(&enc, buf, n, packed), out);
+    }
+    fwrite(packed, 1, ulLzssEncodeEnd(&enc, packed), out);
+    vLzssHeader(header, total);
+    if(fseek(out, 0, SEEK_SET) == 0)
+        fwrite(header, 1, sizeof(header), out);
+    else
+        fprintf(stderr, "output does not seek, length left 0\n");
+    return 0;
+}
+
+static int decompress(const char *name, FILE *in, FILE *out)
+{
+    static xLzssDecoder dec;
+    unsigned char header[LZSS_HEADER_SIZE], buf[4096], text[4096];
+    const unsigned char *next;
+    unsigned long avail, n;
+    long remain;
+
+    if(fread(header, 1, sizeof(header), in) != sizeof(header) || (remain = lLzssHeaderCheck(header)) < 0){
+        fprintf(stderr, "%s: not a log archive\n", name);
+        return 1;
+    }
+    vLzssDecodeInit(&dec);
+    while(remain > 0 && (avail = fread(buf, 1, sizeof(buf), in)) > 0){
+        next = buf;
+        while(avail && remain > 0){
+            n = ulLzssDecode(&dec, &next, &avail, text, remain < (long)sizeof(text) ? remain : sizeof(text));
+            fwrite(text, 1, n, out);
+            remain -= n;
+        }
+    }
+    /* a match can end exactly at the end of the input */
+    while(remain > 0){
+        avail = 0;
+        n = ulLzssDecode(&dec, &next, &avail, text, remain < (long)sizeof(text) ? remain : sizeof(text));
+        if(n == 0)
+            break;
+        fwrite(text, 1, n, out);
+        remain -= n;
+    }
+    if(remain){
+        fprintf(stderr, "%s: truncated, %ld bytes missing\n", name, remain);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *f;
+    int i, ret = 0;
+
+    if(argc == 3 && !strcmp(argv[1], "-c")){
+        f = fopen(argv[2], "rb");
+        if(f == NULL){
+            perror(argv[2]);
+            return 1;
+        }
+        ret = compress(f, stdout);
+        fclose(f);
+        return ret;
+    }
+    if(argc < 2){
+        fprintf(stderr, "usage: %s <archive> [...]\n       %s -c <file>\n", argv[0], argv[0]);
+        return 1;
+    }
+    for(i=1;i<argc;i++){
+        f = fopen(argv[i], "rb");
+        if(f == NULL){
+            perror(argv[i]);
+            ret = 1;
+            continue;
+        }
+        ret |= decompress(argv[i], f, stdout);
+        fclose(f);
+    }
+    return ret;
+}
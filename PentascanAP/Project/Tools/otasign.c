@@ -0,0 +1,91 @@
+/*
+ * otasign - make a firmware update image out of the app binary
+ *
+ * Pads the binary to a multiple of 4 bytes, puts the xOtaHeader of
+ * Common/Utils/ota_image.h in front of it and signs header and body with
+ * HMAC-SHA256 under the key the firmware was built with (OTA_KEY in ota.h).
+ * The image is served over HTTP for "ota <url>" on the console.
+ *
+ * build on the host : gcc -O2 -I../Common/Utils -o otasign otasign.c ../Common/Utils/sha256.c
+ * usage             : otasign -k key [-v version] PentascanAP.bin PentascanAP.ota
+ *
+ * fromelf --bin -o PentascanAP.bin PentascanAP.axf gives the binary.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256.h"
+#include "ota_image.h"
+
+static void put32(unsigned char *p, unsigned long v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+int main(int argc, char *argv[])
+{
+    static unsigned char body[OTA_APP_SIZE + 4];
+    unsigned char header[OTA_HEADER_SIZE];
+    xHmacSha256Context mac;
+    const char *key = NULL;
+    unsigned long version = 0, len;
+    FILE *f;
+    int i;
+
+    for(i=1;i<argc && argv[i][0] == '-';i++){
+        if(!strcmp(argv[i], "-k") && i + 1 < argc)
+            key = argv[++i];
+        else if(!strcmp(argv[i], "-v") && i + 1 < argc)
+            version = strtoul(argv[++i], NULL, 0);
+        else
+            break;
+    }
+    if(key == NULL || argc - i != 2){
+        fprintf(stderr, "usage: %s -k key [-v version] <app binary> <image>\n", argv[0]);
+        return 1;
+    }
+
+    f = fopen(argv[i], "rb");
+    if(f == NULL){
+        perror(argv[i]);
+        return 1;
+    }
+    len = fread(body, 1, sizeof(body), f);
+    fclose(f);
+    if(len > OTA_APP_SIZE){
+        fprintf(stderr, "%s: larger than the app area of %d bytes\n", argv[i], OTA_APP_SIZE);
+        return 1;
+    }
+    while(len % 4)
+        body[len++] = 0xff;
+
+    memset(header, 0, sizeof(header));
+    put32(header, OTA_IMAGE_MAGIC);
+    put32(header + 4, OTA_IMAGE_FORMAT);
+    put32(header + 8, len);
+    put32(header + 12, version);
+
+    vHmacSha256Init(&mac, (const unsigned char *)key, strlen(key));
+    vHmacSha256Update(&mac, header, OTA_HEADER_MAC_OFFSET);
+    vHmacSha256Update(&mac, body, len);
+    vHmacSha256Final(&mac, header + OTA_HEADER_MAC_OFFSET);
+
+    f = fopen(argv[i + 1], "wb");
+    if(f == NULL){
+        perror(argv[i + 1]);
+        return 1;
+    }
+    if(fwrite(header, 1, sizeof(header), f) != sizeof(header) || fwrite(body, 1, len, f) != len){
+        perror(argv[i + 1]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+    fprintf(stderr, "%lu bytes, version %lu\n", len, version);
+    return 0;
+}
@@ -0,0 +1,288 @@
+/*
+ * tracecvt - convert a kernel trace dump into a timeline
+ *
+ * Reads the image written by "trace dump <file>" on the SD card, or the hex
+ * lines printed by "trace dump" on the console or telnet (captured to a text
+ * file, other lines are skipped), and writes the Trace Event Format JSON
+ * understood by chrome://tracing and https://ui.perfetto.dev :
+ *  - one row per task, a slice for every time it was running
+ *  - one row per interrupt, a slice from entry to exit
+ *  - queue, semaphore and mutex operations as instant events on the task
+ *    or interrupt that made them
+ *
+ * build on the host : gcc -O2 -o tracecvt tracecvt.c
+ * usage             : tracecvt dump.bin > trace.json
+ *
+ * The layout of the image is defined in Common/Utils/trace.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define HEADER_SIZE     20
+#define TASK_SIZE       16
+#define RECORD_SIZE     8
+#define NAME_LEN        12
+
+#define ISR_TID_BASE    1000
+#define MAX_VECTOR      512
+
+/* event codes, see trace.h */
+enum{
+    EV_TASK_SWITCHED_IN = 1,
+    EV_TASK_CREATE,
+    EV_TASK_DELETE,
+    EV_TASK_DELAY,
+    EV_TASK_DELAY_UNTIL,
+    EV_TASK_SUSPEND,
+    EV_TASK_RESUME,
+    EV_QUEUE_CREATE = 10,
+    EV_QUEUE_CREATE_FAILED,
+    EV_QUEUE_SEND,
+    EV_QUEUE_SEND_FAILED,
+    EV_QUEUE_BLOCK_SEND,
+    EV_QUEUE_RECEIVE,
+    EV_QUEUE_RECEIVE_FAILED,
+    EV_QUEUE_BLOCK_RECEIVE,
+    EV_QUEUE_PEEK,
+    EV_QUEUE_SEND_FROM_ISR,
+    EV_QUEUE_RECEIVE_FROM_ISR,
+    EV_QUEUE_ISR_FAILED,
+    EV_ISR_ENTER = 30,
+    EV_ISR_EXIT,
+    EV_USER = 40
+};
+
+static const char * const queue_type[] = {
+    "queue", "mutex", "counting sem", "binary sem", "recursive mutex"
+};
+
+/* exception numbers of the LM3S6965 interrupts in use */
+static const struct{
+    int vector;
+    const char *name;
+}isr_name[] = {
+    { 15, "SysTick" },
+    { 21, "UART0" },
+    { 22, "UART1" },
+    { 35, "Timer0A" },
+    { 37, "Timer1A" },
+    { 49, "UART2" },
+    { 58, "Ethernet" },
+};
+
+static unsigned char *image;
+static long image_len;
+
+static unsigned long get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static int append(const unsigned char *data, long len)
+{
+    static long size;
+
+    if(image_len + len > size){
+        size = (image_len + len) * 2 + 1024;
+        image = realloc(image, size);
+        if(image == NULL)
+            return -1;
+    }
+    memcpy(image + image_len, data, len);
+    image_len += len;
+    return 0;
+}
+
+static int hexval(int c)
+{
+    return isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+}
+
+/* load a binary image, or the hex lines of a console capture */
+static int load(FILE *f)
+{
+    unsigned char buf[4096];
+    char line[1024];
+    long n;
+    int i, len;
+
+    n = fread(buf, 1, 4, f);
+    if(n == 4 && !memcmp(buf, "PTRC", 4)){
+        if(append(buf, 4))
+            return -1;
+        while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            if(append(buf, n))
+                return -1;
+        return 0;
+    }
+
+    rewind(f);
+    while(fgets(line, sizeof(line), f)){
+        len = strcspn(line, "\r\n");
+        if(len == 0 || len & 1)
+            continue;
+        for(i=0;i<len;i++)
+            if(!isxdigit((unsigned char)line[i]))
+                break;
+        if(i < len)
+            continue;
+        for(i=0;i<len/2;i++)
+            buf[i] = (hexval(line[2*i]) << 4) | hexval(line[2*i+1]);
+        if(append(buf, len/2))
+            return -1;
+    }
+    return 0;
+}
+
+static const char *isr_label(int vector, char *buf)
+{
+    int i;
+
+    for(i=0;i<sizeof(isr_name)/sizeof(isr_name[0]);i++)
+        if(isr_name[i].vector == vector)
+            return isr_name[i].name;
+    sprintf(buf, "ISR %d", vector);
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *f;
+    unsigned long clock_hz, tasks, records, i;
+    unsigned long long now, last = 0, wrap = 0;
+    double first = -1, ts = 0, run_start = 0;
+    double isr_start[MAX_VECTOR];
+    const unsigned char *rec;
+    char name[NAME_LEN + 1], label[32];
+    int event, id, param, current = -1, isr = 0, tid, sep = 0;
+    int isr_seen[MAX_VECTOR];
+
+    if(argc != 2){
+        fprintf(stderr, "usage: %s <trace dump>\n", argv[0]);
+        return 1;
+    }
+    f = fopen(argv[1], "rb");
+    if(f == NULL){
+        perror(argv[1]);
+        return 1;
+    }
+    if(load(f)){
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fclose(f);
+
+    if(image_len < HEADER_SIZE || memcmp(image, "PTRC", 4) || get32(image + 4) != 1){
+        fprintf(stderr, "%s: not a trace dump\n", argv[1]);
+        return 1;
+    }
+    clock_hz = get32(image + 8);
+    tasks = get32(image + 12);
+    records = get32(image + 16);
+    if(image_len < HEADER_SIZE + tasks * TASK_SIZE + records * RECORD_SIZE){
+        fprintf(stderr, "%s: truncated, %lu records\n", argv[1],
+                (image_len - HEADER_SIZE - tasks * TASK_SIZE) / RECORD_SIZE);
+        records = (image_len - HEADER_SIZE - tasks * TASK_SIZE) / RECORD_SIZE;
+    }
+
+    memset(isr_seen, 0, sizeof(isr_seen));
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    /* row names */
+    for(i=0;i<tasks;i++){
+        memcpy(name, image + HEADER_SIZE + i * TASK_SIZE + 4, NAME_LEN);
+        name[NAME_LEN] = 0;
+        printf("%s{\"ph\":\"M\",\"pid\":0,\"tid\":%lu,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+               sep++ ? ",\n" : "", get32(image + HEADER_SIZE + i * TASK_SIZE), name);
+    }
+
+    rec = image + HEADER_SIZE + tasks * TASK_SIZE;
+    for(i=0;i<records;i++, rec += RECORD_SIZE){
+        /* the cycle counter is 32 bit, records are assumed less than one
+           wrap apart */
+        now = get32(rec);
+        if(i && now + wrap < last)
+            wrap += 0x100000000ULL;
+        now += wrap;
+        last = now;
+
+        ts = (double)now * 1e6 / clock_hz;
+        if(first < 0)
+            first = ts;
+        ts -= first;
+
+        event = rec[4];
+        id = rec[5];
+        param = get16(rec + 6);
+        tid = isr ? ISR_TID_BASE + isr : current;
+
+        switch(event){
+        case EV_TASK_SWITCHED_IN:
+            if(current >= 0 && ts > run_start)
+                printf(",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"running\"}",
+                       current, run_start, ts - run_start);
+            current = id;
+            run_start = ts;
+            break;
+        case EV_ISR_ENTER:
+            if(id < MAX_VECTOR){
+                if(!isr_seen[id]++)
+                    printf(",\n{\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                           ISR_TID_BASE + id, isr_label(id, label));
+                isr_start[id] = ts;
+                isr = id;
+            }
+            break;
+        case EV_ISR_EXIT:
+            if(id < MAX_VECTOR && isr_seen[id]){
+                printf(",\n{\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"%s\"}",
+                       ISR_TID_BASE + id, isr_start[id], ts - isr_start[id], isr_label(id, label));
+            }
+            isr = 0;
+            break;
+        case EV_TASK_CREATE:
+        case EV_TASK_DELETE:
+        case EV_TASK_DELAY:
+        case EV_TASK_DELAY_UNTIL:
+        case EV_TASK_SUSPEND:
+        case EV_TASK_RESUME:
+            {
+                static const char * const task_event[] = {
+                    "", "", "create", "delete", "delay", "delay until", "suspend", "resume"
+                };
+                printf(",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"name\":\"%s\",\"args\":{\"task\":%d,\"param\":%d}}",
+                       tid, ts, task_event[event], id, param);
+            }
+            break;
+        default:
+            if(event >= EV_QUEUE_CREATE && event <= EV_QUEUE_ISR_FAILED){
+                static const char * const queue_event[] = {
+                    "create", "create failed", "send", "send failed", "block on send",
+                    "receive", "receive failed", "block on receive", "peek",
+                    "send from isr", "receive from isr", "isr failed"
+                };
+                printf(",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"name\":\"%s %04x\",\"args\":{\"type\":\"%s\"}}",
+                       tid, ts, queue_event[event - EV_QUEUE_CREATE], param,
+                       id < sizeof(queue_type)/sizeof(queue_type[0]) ? queue_type[id] : "?");
+            }else{
+                printf(",\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"name\":\"event %d\",\"args\":{\"id\":%d,\"param\":%d}}",
+                       tid, ts, event, id, param);
+            }
+            break;
+        }
+    }
+
+    printf("\n]}\n");
+    fprintf(stderr, "%lu records, %lu tasks, %.3f msec\n", records, tasks, records ? ts / 1000 : 0.0);
+    free(image);
+    return 0;
+}
+
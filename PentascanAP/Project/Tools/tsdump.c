@@ -0,0 +1,279 @@
+/*
+ * tsdump - read the sensor history written by the gateway
+ *
+ * The gateway keeps one sample of every sensor a report period in
+ * /history/sensor.tsd on the SD card, the format is described in
+ * Common/Utils/tsdb.h.  Fetch it with http://<gateway>/history/sensor.tsd
+ * or copy it off the card.
+ *
+ * build on the host : gcc -O2 -I../Common/Utils -o tsdump tsdump.c ../Common/Utils/tsdb.c -lm
+ * usage             : tsdump sensor.tsd                      lists the blocks
+ *                     tsdump sensor.tsd A3 [from to [step]]  samples of sensor A3 as csv, with
+ *                                                            step count/min/mean/max per step
+ *                                                            seconds, times in unix seconds
+ *                     tsdump -g sensor.tsd days              writes a made up history of 10
+ *                                                            sensors, a sample a minute
+ *                     tsdump -b sensor.tsd [A3]              times queries over the file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "tsdb.h"
+
+#define GEN_START       1388534400UL    /* 2014/01/01 */
+#define GEN_SENSORS     10
+#define GEN_PERIOD      60
+#define BENCH_REPEAT    20
+
+static const char * const field_names[TSDB_FIELDS] = { "temp", "humidity", "co2", "sound" };
+
+typedef struct{
+    FILE *f;
+    unsigned long bytes;
+    unsigned long reads;
+}ts_file;
+
+static int file_read(void *pv, unsigned long offset, unsigned char *buf, unsigned long len)
+{
+    ts_file *file = pv;
+    size_t n;
+
+    file->bytes += len;
+    file->reads++;
+    if(fseek(file->f, offset, SEEK_SET))
+        return -1;
+    n = fread(buf, 1, len, file->f);
+    /* the open block may be short of the records the header counts */
+    memset(buf + n, 0, len - n);
+    return 0;
+}
+
+static unsigned long file_blocks(FILE *f)
+{
+    fseek(f, 0, SEEK_END);
+    return (ftell(f) + TSDB_BLOCK_SIZE - 1) / TSDB_BLOCK_SIZE;
+}
+
+/* temperature and humidity are in 1/100 */
+static void print_field(int field, double value)
+{
+    if(field < 2)
+        printf(",%.2f", value / 100);
+    else
+        printf(",%.0f", value);
+}
+
+static int print_point(void *pv, const xTsdbPoint *point)
+{
+    int step = *(int *)pv;
+    int i;
+
+    printf("%lu", point->ulTime);
+    if(step)
+        printf(",%lu", point->ulCount);
+    for(i=0;i<TSDB_FIELDS;i++){
+        if(step){
+            print_field(i, point->sMin[i]);
+            print_field(i, (double)point->lSum[i] / point->ulCount);
+        }
+        print_field(i, point->sMax[i]);
+    }
+    printf("\n");
+    return 0;
+}
+
+static int count_point(void *pv, const xTsdbPoint *point)
+{
+    (*(unsigned long *)pv)++;
+    return 0;
+}
+
+static int list(FILE *f)
+{
+    unsigned char block[TSDB_BLOCK_SIZE];
+    unsigned long i, blocks = file_blocks(f), samples = 0;
+    xTsdbHeader header;
+    ts_file file = { f, 0, 0 };
+    long used;
+
+    for(i=0;i<blocks;i++){
+        memset(block, 0, sizeof(block));
+        file_read(&file, i * TSDB_BLOCK_SIZE, block, TSDB_BLOCK_SIZE);
+        used = lTsdbBlockCheck(block);
+        if(lTsdbHeaderGet(block, &header) < 0){
+            printf("%6lu not a block\n", i);
+            continue;
+        }
+        printf("%6lu seq %6lu  %lu-%lu  %2u series %4u bytes%s%s\n", i, header.ulSeq,
+               header.ulFirst, header.ulLast, header.ucSeries, header.usUsed,
+               (header.ucFlags & TSDB_SEALED) ? "" : "  open", used < 0 ? "  DAMAGED" : "");
+        samples += (header.usUsed - TSDB_DATA_OFFSET);
+    }
+    printf("%lu blocks, %lu bytes of records\n", blocks, samples);
+    return 0;
+}
+
+static int query(FILE *f, unsigned char addr, unsigned long from, unsigned long to, unsigned long step)
+{
+    unsigned char block[TSDB_BLOCK_SIZE];
+    ts_file file = { f, 0, 0 };
+    xTsdbQuery q;
+    int i, print_step = step != 0;
+
+    memset(&q, 0, sizeof(q));
+    q.ucAddr = addr;
+    q.ulFrom = from;
+    q.ulTo = to;
+    q.ulStep = step;
+    q.ulBlocks = file_blocks(f);
+    q.pxRead = file_read;
+    q.pvFile = &file;
+    q.pxPoint = print_point;
+    q.pvArg = &print_step;
+    q.pucBuffer = block;
+
+    printf("time");
+    if(step)
+        printf(",count");
+    for(i=0;i<TSDB_FIELDS;i++){
+        if(step)
+            printf(",%s_min,%s_mean,%s_max", field_names[i], field_names[i], field_names[i]);
+        else
+            printf(",%s", field_names[i]);
+    }
+    printf("\n");
+    if(lTsdbQuery(&q) < 0){
+        fprintf(stderr, "read error\n");
+        return 1;
+    }
+    fprintf(stderr, "%lu points, %lu headers, %lu from the directory, %lu blocks decoded, %lu bytes read\n",
+            q.ulPoints, q.ulHeaders, q.ulDirectories, q.ulDecoded, file.bytes);
+    return 0;
+}
+
+static int generate(const char *name, int days)
+{
+    static xTsdbWriter writer;
+    FILE *f = fopen(name, "wb");
+    unsigned long t, end = GEN_START + days * 86400UL, seq = 0;
+    long values[TSDB_FIELDS];
+    double day;
+    int i;
+
+    if(f == NULL){
+        perror(name);
+        return 1;
+    }
+    srand(1);
+    vTsdbWriterInit(&writer, seq);
+    for(t=GEN_START;t<end;t+=GEN_PERIOD){
+        day = sin((t % 86400) * 2 * M_PI / 86400);
+        for(i=0;i<GEN_SENSORS;i++){
+            values[0] = 2000 + i * 100 + (long)(300 * day) + rand() % 20;
+            values[1] = 4500 - (long)(800 * day) + rand() % 50;
+            values[2] = 500 + (long)(400 * (day > 0 ? day : 0)) + rand() % 30;
+            values[3] = 35 + rand() % 10;
+            if(lTsdbAppend(&writer, 0xA0 + i, t, values) > 0){
+                vTsdbSeal(&writer);
+                fwrite(writer.ucBlock, 1, TSDB_BLOCK_SIZE, f);
+                vTsdbWriterInit(&writer, ++seq);
+                lTsdbAppend(&writer, 0xA0 + i, t, values);
+            }
+        }
+    }
+    fwrite(writer.ucBlock, 1, TSDB_BLOCK_SIZE, f);
+    fclose(f);
+    printf("%lu blocks, %lu-%lu\n", seq + 1, GEN_START, end - GEN_PERIOD);
+    return 0;
+}
+
+/* queries ending at the last sample, every sample and 60 buckets */
+static int bench(FILE *f, unsigned char addr)
+{
+    static const unsigned long spans[] = { 3600, 6 * 3600, 86400, 7 * 86400, 30 * 86400 };
+    unsigned char block[TSDB_BLOCK_SIZE];
+    ts_file file = { f, 0, 0 };
+    xTsdbHeader header;
+    xTsdbQuery q;
+    unsigned long points, last;
+    clock_t start;
+    double usec;
+    int i, r, step;
+
+    memset(&q, 0, sizeof(q));
+    q.ulBlocks = file_blocks(f);
+    if(q.ulBlocks == 0 || file_read(&file, (q.ulBlocks - 1) * TSDB_BLOCK_SIZE, block, TSDB_HEADER_SIZE)
+       || lTsdbHeaderGet(block, &header) < 0){
+        fprintf(stderr, "no history\n");
+        return 1;
+    }
+    last = header.ulLast;
+    q.ucAddr = addr;
+    q.pxRead = file_read;
+    q.pvFile = &file;
+    q.pxPoint = count_point;
+    q.pvArg = &points;
+    q.pucBuffer = block;
+
+    printf("%-8s %-5s %7s %8s %7s %7s %9s %10s\n", "span", "step", "points", "headers", "dir", "decoded", "sectors", "usec");
+    for(i=0;i<(int)(sizeof(spans) / sizeof(spans[0]));i++){
+        for(step=0;step<2;step++){
+            q.ulTo = last + 1;
+            q.ulFrom = q.ulTo > spans[i] ? q.ulTo - spans[i] : 0;
+            q.ulStep = step ? spans[i] / 60 : 0;
+            start = clock();
+            for(r=0;r<BENCH_REPEAT;r++){
+                points = 0;
+                file.bytes = 0;
+                lTsdbQuery(&q);
+            }
+            usec = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / BENCH_REPEAT;
+            printf("%-8lu %-5lu %7lu %8lu %7lu %7lu %9lu %10.0f\n", spans[i], q.ulStep, points,
+                   q.ulHeaders, q.ulDirectories, q.ulDecoded, (file.bytes + 511) / 512, usec);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *f;
+    int ret;
+
+    if(argc == 4 && !strcmp(argv[1], "-g"))
+        return generate(argv[2], atoi(argv[3]));
+    if(argc < 2 || (!strcmp(argv[1], "-b") && argc < 3)){
+        fprintf(stderr, "usage: %s <file> [<addr> [<from> <to> [<step>]]]\n"
+                        "       %s -g <file> <days>\n"
+                        "       %s -b <file> [<addr>]\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if(!strcmp(argv[1], "-b")){
+        f = fopen(argv[2], "rb");
+        if(f == NULL){
+            perror(argv[2]);
+            return 1;
+        }
+        ret = bench(f, (unsigned char)strtoul(argc > 3 ? argv[3] : "A3", NULL, 16));
+    }else{
+        f = fopen(argv[1], "rb");
+        if(f == NULL){
+            perror(argv[1]);
+            return 1;
+        }
+        if(argc == 2)
+            ret = list(f);
+        else
+            ret = query(f, (unsigned char)strtoul(argv[2], NULL, 16),
+                        argc > 4 ? strtoul(argv[3], NULL, 10) : 0,
+                        argc > 4 ? strtoul(argv[4], NULL, 10) : 0xffffffffUL,
+                        argc > 5 ? strtoul(argv[5], NULL, 10) : 0);
+    }
+    fclose(f);
+    return ret;
+}
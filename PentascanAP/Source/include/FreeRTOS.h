@@ -247,6 +247,21 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define portPOINTER_SIZE_TYPE unsigned long
 #endif
 
+#ifndef configUSE_TRACE_RECORDER
+	#define configUSE_TRACE_RECORDER 0
+#endif
+
+#if ( configUSE_TRACE_RECORDER == 1 )
+	#if ( configUSE_TRACE_FACILITY != 1 )
+		#error configUSE_TRACE_RECORDER requires configUSE_TRACE_FACILITY to be set to 1.
+	#endif
+	#ifndef configTRACE_TIMESTAMP
+		#error configUSE_TRACE_RECORDER requires configTRACE_TIMESTAMP() to return a free running cycle count.
+	#endif
+	/* The recorder defines the trace macros it uses. */
+	#include "trace.h"
+#endif
+
 /* Remove any unused trace macros. */
 #ifndef traceSTART
 	/* Used to perform any necessary initialisation - for example, open a file
@@ -266,6 +281,17 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define traceTASK_SWITCHED_IN()
 #endif
 
+#ifndef traceISR_ENTER
+	/* Called on entry to an interrupt service routine that has been
+	instrumented for tracing. */
+	#define traceISR_ENTER()
+#endif
+
+#ifndef traceISR_EXIT
+	/* Called before an instrumented interrupt service routine returns. */
+	#define traceISR_EXIT()
+#endif
+
 #ifndef traceTASK_SWITCHED_OUT
 	/* Called before a task has been selected to run.  pxCurrentTCB holds a pointer
 	to the task control block of the task being switched out. */
@@ -493,5 +519,29 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define vPortFreeAligned( pvBlockToFree ) vPortFree( pvBlockToFree )
 #endif
 
+#ifndef configUSE_TICKLESS_IDLE
+	#define configUSE_TICKLESS_IDLE 0
+#endif
+
+#ifndef portSUPPRESS_TICKS_AND_SLEEP
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )
+#endif
+
+#ifndef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+	#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+#endif
+
+#if configEXPECTED_IDLE_TIME_BEFORE_SLEEP < 2
+	#error configEXPECTED_IDLE_TIME_BEFORE_SLEEP must not be less than 2
+#endif
+
+#ifndef configPRE_SLEEP_PROCESSING
+	#define configPRE_SLEEP_PROCESSING( x )
+#endif
+
+#ifndef configPOST_SLEEP_PROCESSING
+	#define configPOST_SLEEP_PROCESSING( x )
+#endif
+
 #endif /* INC_FREERTOS_H */
 
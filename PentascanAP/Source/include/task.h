@@ -117,6 +117,22 @@ typedef struct xTASK_PARAMTERS
 	xMemoryRegion xRegions[ portNUM_CONFIGURABLE_REGIONS ];
 } xTaskParameters;
 
+/*
+ * Run time counter of one task, as filled in by uxTaskGetRunTimes().
+ */
+typedef struct xTASK_RUN_TIME
+{
+	signed char pcTaskName[ configMAX_TASK_NAME_LEN ];
+	unsigned long ulRunTimeCounter;
+} xTaskRunTime;
+
+/* Possible return values for eTaskConfirmSleepModeStatus(). */
+typedef enum
+{
+	eAbortSleep = 0,		/* A task has been made ready or a context switch pended since portSUPPRESS_TICKS_AND_SLEEP() was called - abort entering a sleep mode. */
+	eStandardSleep			/* Enter a sleep mode that will not last any longer than the expected idle time. */
+} eSleepModeStatus;
+
 /*
  * Defines the priority used by the idle task.  This must not be modified.
  *
@@ -1071,6 +1087,48 @@ void vTaskList( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
  */
 void vTaskGetRunTimeStats( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <PRE>unsigned long ulTaskGetRunTimeCounter( xTaskHandle xTask );</PRE>
+ *
+ * configGENERATE_RUN_TIME_STATS must be defined as 1 for this function
+ * to be available.
+ *
+ * Returns the total execution time of a task, in units of the run time
+ * counter, as accumulated up to the last time the task was switched out.
+ * Sampling the counter of the idle task before and after an operation
+ * gives the CPU time used by everything else meanwhile.
+ *
+ * @param xTask Handle of the task to query.  Passing NULL queries the
+ * calling task.
+ *
+ * \page ulTaskGetRunTimeCounter ulTaskGetRunTimeCounter
+ * \ingroup TaskUtils
+ */
+unsigned long ulTaskGetRunTimeCounter( xTaskHandle xTask ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <PRE>unsigned portBASE_TYPE uxTaskGetRunTimes( xTaskRunTime *pxTaskRunTimes, unsigned portBASE_TYPE uxArraySize );</PRE>
+ *
+ * configGENERATE_RUN_TIME_STATS must be defined as 1 for this function
+ * to be available.
+ *
+ * Copies the name and run time counter of each task into pxTaskRunTimes,
+ * the same data vTaskGetRunTimeStats() prints but without formatting it,
+ * so it needs next to no stack.  Tasks beyond uxArraySize are left out.
+ *
+ * @param pxTaskRunTimes Array the counters are copied into.
+ *
+ * @param uxArraySize Number of entries in pxTaskRunTimes.
+ *
+ * @return The number of entries filled in.
+ *
+ * \page uxTaskGetRunTimes uxTaskGetRunTimes
+ * \ingroup TaskUtils
+ */
+unsigned portBASE_TYPE uxTaskGetRunTimes( xTaskRunTime *pxTaskRunTimes, unsigned portBASE_TYPE uxArraySize ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * <PRE>void vTaskStartTrace( char * pcBuffer, unsigned portBASE_TYPE uxBufferSize );</PRE>
@@ -1190,6 +1248,33 @@ xTaskHandle xTaskGetIdleTaskHandle( void );
  */
 void vTaskIncrementTick( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * Only available when configUSE_TICKLESS_IDLE is set to 1.  Called from
+ * portSUPPRESS_TICKS_AND_SLEEP() with the scheduler suspended, after the
+ * tick interrupt has been stopped for a period, to correct the tick count
+ * by the number of whole tick periods that passed while the processor was
+ * asleep.  xTicksToJump must not take the tick count past the time at which
+ * the next blocked task is due to unblock.
+ */
+void vTaskStepTick( portTickType xTicksToJump ) PRIVILEGED_FUNCTION;
+
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * Only available when configUSE_TICKLESS_IDLE is set to 1.  Called from
+ * portSUPPRESS_TICKS_AND_SLEEP() with interrupts disabled, immediately
+ * before the processor is put to sleep, to check that nothing readied a
+ * task or pended a tick since the expected idle time was calculated.
+ * Returns eAbortSleep if the sleep must not be entered.
+ */
+eSleepModeStatus eTaskConfirmSleepModeStatus( void ) PRIVILEGED_FUNCTION;
+
 /*
  * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS AN
  * INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
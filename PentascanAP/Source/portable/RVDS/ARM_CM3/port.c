@@ -66,11 +66,13 @@
 /* Constants required to manipulate the NVIC. */
 #define portNVIC_SYSTICK_CTRL		( ( volatile unsigned long *) 0xe000e010 )
 #define portNVIC_SYSTICK_LOAD		( ( volatile unsigned long *) 0xe000e014 )
+#define portNVIC_SYSTICK_CURRENT_VALUE	( ( volatile unsigned long *) 0xe000e018 )
 #define portNVIC_INT_CTRL			( ( volatile unsigned long *) 0xe000ed04 )
 #define portNVIC_SYSPRI2			( ( volatile unsigned long *) 0xe000ed20 )
 #define portNVIC_SYSTICK_CLK		0x00000004
 #define portNVIC_SYSTICK_INT		0x00000002
 #define portNVIC_SYSTICK_ENABLE		0x00000001
+#define portNVIC_SYSTICK_COUNT_FLAG	0x00010000
 #define portNVIC_PENDSVSET			0x10000000
 #define portNVIC_PENDSV_PRI			( ( ( unsigned long ) configKERNEL_INTERRUPT_PRIORITY ) << 16 )
 #define portNVIC_SYSTICK_PRI		( ( ( unsigned long ) configKERNEL_INTERRUPT_PRIORITY ) << 24 )
@@ -78,10 +80,33 @@
 /* Constants required to set up the initial stack. */
 #define portINITIAL_XPSR			( 0x01000000 )
 
+/* The SysTick is a 24-bit counter. */
+#define portMAX_24_BIT_NUMBER		( 0xffffffUL )
+
+/* A fiddle factor to estimate the number of SysTick counts that would have
+occurred while the SysTick counter is stopped during tickless idle
+calculations. */
+#define portMISSED_COUNTS_FACTOR	( 45UL )
+
+/* Argument of the __dsb() and __isb() intrinsics. */
+#define portSY_FULL_READ_WRITE		( 15 )
+
 /* Each task maintains its own interrupt status in the critical nesting
 variable. */
 static unsigned portBASE_TYPE uxCriticalNesting = 0xaaaaaaaa;
 
+/*
+ * The number of SysTick increments that make up one tick period, the maximum
+ * number of tick periods that can be suppressed is limited by the 24 bit
+ * resolution of the SysTick timer, and the compensation for the SysTick
+ * counts lost while it is stopped.
+ */
+#if configUSE_TICKLESS_IDLE == 1
+	static unsigned long ulTimerCountsForOneTick = 0;
+	static unsigned long xMaximumPossibleSuppressedTicks = 0;
+	static unsigned long ulStoppedTimerCompensation = 0;
+#endif /* configUSE_TICKLESS_IDLE */
+
 /* 
  * Setup the timer to generate the tick interrupts.
  */
@@ -248,6 +273,8 @@ void xPortSysTickHandler( void )
 {
 unsigned long ulDummy;
 
+	traceISR_ENTER();
+
 	/* If using preemption, also force a context switch. */
 	#if configUSE_PREEMPTION == 1
 		*(portNVIC_INT_CTRL) = portNVIC_PENDSVSET;	
@@ -258,15 +285,164 @@ unsigned long ulDummy;
 		vTaskIncrementTick();
 	}
 	portCLEAR_INTERRUPT_MASK_FROM_ISR( ulDummy );
+
+	traceISR_EXIT();
 }
 /*-----------------------------------------------------------*/
 
+#if configUSE_TICKLESS_IDLE == 1
+
+	void vPortSuppressTicksAndSleep( portTickType xExpectedIdleTime )
+	{
+	unsigned long ulReloadValue, ulCompleteTickPeriods, ulCompletedSysTickDecrements, ulSysTickCTRL;
+	portTickType xModifiableIdleTime;
+
+		/* Make sure the SysTick reload value does not overflow the counter. */
+		if( xExpectedIdleTime > xMaximumPossibleSuppressedTicks )
+		{
+			xExpectedIdleTime = xMaximumPossibleSuppressedTicks;
+		}
+
+		/* Stop the SysTick momentarily.  The time the SysTick is stopped for
+		is accounted for as best it can be, but using the tickless mode will
+		inevitably result in some tiny drift of the time maintained by the
+		kernel with respect to calendar time. */
+		*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT;
+
+		/* Calculate the reload value required to wait xExpectedIdleTime
+		tick periods.  -1 is used because this code will execute part way
+		through one of the tick periods. */
+		ulReloadValue = *(portNVIC_SYSTICK_CURRENT_VALUE) + ( ulTimerCountsForOneTick * ( xExpectedIdleTime - 1UL ) );
+		if( ulReloadValue > ulStoppedTimerCompensation )
+		{
+			ulReloadValue -= ulStoppedTimerCompensation;
+		}
+
+		/* Enter a critical section but don't use the taskENTER_CRITICAL()
+		method as that will mask interrupts that should exit sleep mode. */
+		__disable_irq();
+
+		/* If a context switch is pending or a task is waiting for the
+		scheduler to be unsuspended then abandon the low power entry. */
+		if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+		{
+			/* Restart from whatever is left in the count register to complete
+			this tick period, then reset the reload value to its standard
+			value. */
+			*(portNVIC_SYSTICK_LOAD) = *(portNVIC_SYSTICK_CURRENT_VALUE);
+			*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT | portNVIC_SYSTICK_ENABLE;
+			*(portNVIC_SYSTICK_LOAD) = ulTimerCountsForOneTick - 1UL;
+
+			/* Re-enable interrupts - see comments above __disable_irq() call
+			above. */
+			__enable_irq();
+		}
+		else
+		{
+			/* Set the new reload value and restart the SysTick from it. */
+			*(portNVIC_SYSTICK_LOAD) = ulReloadValue;
+			*(portNVIC_SYSTICK_CURRENT_VALUE) = 0UL;
+			*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT | portNVIC_SYSTICK_ENABLE;
+
+			/* Sleep until something happens.  configPRE_SLEEP_PROCESSING() can
+			set its parameter to 0 to indicate that its implementation contains
+			its own wait for interrupt or wait for event instruction, and so
+			wfi should not be executed again.  The original expected idle
+			time variable must remain unmodified, so a copy is taken. */
+			xModifiableIdleTime = xExpectedIdleTime;
+			configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+			if( xModifiableIdleTime > 0 )
+			{
+				__dsb( portSY_FULL_READ_WRITE );
+				__wfi();
+				__isb( portSY_FULL_READ_WRITE );
+			}
+			configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+			/* Stop SysTick.  Reading the control register also clears the
+			count flag, so its value is kept for the test below. */
+			ulSysTickCTRL = *(portNVIC_SYSTICK_CTRL);
+			*(portNVIC_SYSTICK_CTRL) = ( ulSysTickCTRL & ~portNVIC_SYSTICK_ENABLE );
+
+			/* Re-enable interrupts so the interrupt that ended the sleep, or
+			a pending tick, is serviced now. */
+			__enable_irq();
+
+			if( ( ulSysTickCTRL & portNVIC_SYSTICK_COUNT_FLAG ) != 0 )
+			{
+			unsigned long ulCalculatedLoadValue;
+
+				/* The tick interrupt has already executed, and the SysTick
+				count reloaded with ulReloadValue.  Reset the reload register
+				with whatever remains of this tick period. */
+				ulCalculatedLoadValue = ( ulTimerCountsForOneTick - 1UL ) - ( ulReloadValue - *(portNVIC_SYSTICK_CURRENT_VALUE) );
+
+				/* Don't allow a tiny value, or values that have somehow
+				underflowed because the post sleep hook did something that
+				took too long. */
+				if( ( ulCalculatedLoadValue < ulStoppedTimerCompensation ) || ( ulCalculatedLoadValue > ulTimerCountsForOneTick ) )
+				{
+					ulCalculatedLoadValue = ( ulTimerCountsForOneTick - 1UL );
+				}
+
+				*(portNVIC_SYSTICK_LOAD) = ulCalculatedLoadValue;
+
+				/* The tick interrupt handler counted one tick as missed while
+				the scheduler is suspended, and that tick is processed when
+				the scheduler is resumed.  So step the tick forward by one
+				less than the time spent waiting. */
+				ulCompleteTickPeriods = xExpectedIdleTime - 1UL;
+			}
+			else
+			{
+				/* Something other than the tick interrupt ended the sleep.
+				Work out how long the sleep lasted rounded to complete tick
+				periods (not the ulReload value which accounted for part
+				ticks). */
+				ulCompletedSysTickDecrements = ( xExpectedIdleTime * ulTimerCountsForOneTick ) - *(portNVIC_SYSTICK_CURRENT_VALUE);
+
+				/* How many complete tick periods passed while the processor
+				was waiting? */
+				ulCompleteTickPeriods = ulCompletedSysTickDecrements / ulTimerCountsForOneTick;
+
+				/* The reload value is set to whatever fraction of a single
+				tick period remains. */
+				*(portNVIC_SYSTICK_LOAD) = ( ( ulCompleteTickPeriods + 1UL ) * ulTimerCountsForOneTick ) - ulCompletedSysTickDecrements;
+			}
+
+			/* Restart SysTick so it runs from the reload register again, then
+			set the reload register back to its standard value.  The critical
+			section is used to ensure the tick interrupt can only execute once
+			in the case that the reload register is near zero. */
+			*(portNVIC_SYSTICK_CURRENT_VALUE) = 0UL;
+			portENTER_CRITICAL();
+			{
+				*(portNVIC_SYSTICK_CTRL) |= portNVIC_SYSTICK_ENABLE;
+				vTaskStepTick( ulCompleteTickPeriods );
+				*(portNVIC_SYSTICK_LOAD) = ulTimerCountsForOneTick - 1UL;
+			}
+			portEXIT_CRITICAL();
+		}
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
 /*
  * Setup the systick timer to generate the tick interrupts at the required
  * frequency.
  */
 void prvSetupTimerInterrupt( void )
 {
+	/* Calculate the constants required to configure the tick interrupt. */
+	#if configUSE_TICKLESS_IDLE == 1
+	{
+		ulTimerCountsForOneTick = ( configCPU_CLOCK_HZ / configTICK_RATE_HZ );
+		xMaximumPossibleSuppressedTicks = portMAX_24_BIT_NUMBER / ulTimerCountsForOneTick;
+		ulStoppedTimerCompensation = portMISSED_COUNTS_FACTOR;
+	}
+	#endif /* configUSE_TICKLESS_IDLE */
+
 	/* Configure SysTick to interrupt at the requested rate. */
 	*(portNVIC_SYSTICK_LOAD) = ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) - 1UL;
 	*(portNVIC_SYSTICK_CTRL) = portNVIC_SYSTICK_CLK | portNVIC_SYSTICK_INT | portNVIC_SYSTICK_ENABLE;
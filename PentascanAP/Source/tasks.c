@@ -176,6 +176,7 @@ PRIVILEGED_DATA static portTickType xNextTaskUnblockTime						= ( portTickType )
 	PRIVILEGED_DATA static char pcStatsString[ 50 ] ;
 	PRIVILEGED_DATA static unsigned long ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
 	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, unsigned long ulTotalRunTime ) PRIVILEGED_FUNCTION;
+	static unsigned portBASE_TYPE prvListRunTimesWithinSingleList( xTaskRunTime *pxTaskRunTimes, unsigned portBASE_TYPE uxArraySize, xList *pxList ) PRIVILEGED_FUNCTION;
 
 #endif
 
@@ -370,6 +371,19 @@ static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TY
 
 #endif
 
+/*
+ * Return the amount of time, in ticks, that will pass before the kernel will
+ * next move a task from the Blocked state to the Running state.
+ *
+ * This function is only used when configUSE_TICKLESS_IDLE is set to 1, to
+ * allow the tick interrupt to be suppressed for the whole of that period.
+ */
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	static portTickType prvGetExpectedIdleTime( void ) PRIVILEGED_FUNCTION;
+
+#endif
+
 
 /*lint +e956 */
 
@@ -1399,6 +1413,70 @@ unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 #endif
 /*----------------------------------------------------------*/
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+	unsigned long ulTaskGetRunTimeCounter( xTaskHandle xTask )
+	{
+	tskTCB *pxTCB;
+	unsigned long ulReturn;
+
+		/* If null is passed in here then the counter of the calling task is
+		being queried. */
+		pxTCB = prvGetTCBFromHandle( xTask );
+
+		taskENTER_CRITICAL();
+		{
+			ulReturn = pxTCB->ulRunTimeCounter;
+		}
+		taskEXIT_CRITICAL();
+
+		return ulReturn;
+	}
+
+#endif
+/*----------------------------------------------------------*/
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+	unsigned portBASE_TYPE uxTaskGetRunTimes( xTaskRunTime *pxTaskRunTimes, unsigned portBASE_TYPE uxArraySize )
+	{
+	unsigned portBASE_TYPE uxQueue, uxTask = 0;
+
+		vTaskSuspendAll();
+		{
+			/* Run through all the lists that could potentially contain a TCB,
+			the same lists vTaskGetRunTimeStats() prints. */
+			uxQueue = uxTopUsedPriority + ( unsigned portBASE_TYPE ) 1U;
+
+			do
+			{
+				uxQueue--;
+				uxTask += prvListRunTimesWithinSingleList( &( pxTaskRunTimes[ uxTask ] ), uxArraySize - uxTask, ( xList * ) &( pxReadyTasksLists[ uxQueue ] ) );
+			}while( uxQueue > ( unsigned short ) tskIDLE_PRIORITY );
+
+			uxTask += prvListRunTimesWithinSingleList( &( pxTaskRunTimes[ uxTask ] ), uxArraySize - uxTask, ( xList * ) pxDelayedTaskList );
+			uxTask += prvListRunTimesWithinSingleList( &( pxTaskRunTimes[ uxTask ] ), uxArraySize - uxTask, ( xList * ) pxOverflowDelayedTaskList );
+
+			#if ( INCLUDE_vTaskDelete == 1 )
+			{
+				uxTask += prvListRunTimesWithinSingleList( &( pxTaskRunTimes[ uxTask ] ), uxArraySize - uxTask, &xTasksWaitingTermination );
+			}
+			#endif
+
+			#if ( INCLUDE_vTaskSuspend == 1 )
+			{
+				uxTask += prvListRunTimesWithinSingleList( &( pxTaskRunTimes[ uxTask ] ), uxArraySize - uxTask, &xSuspendedTaskList );
+			}
+			#endif
+		}
+		xTaskResumeAll();
+
+		return uxTask;
+	}
+
+#endif
+/*----------------------------------------------------------*/
+
 #if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
 
 	xTaskHandle xTaskGetIdleTaskHandle( void )
@@ -1491,6 +1569,51 @@ tskTCB * pxTCB;
 }
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	void vTaskStepTick( portTickType xTicksToJump )
+	{
+		/* Correct the tick count value after a period during which the tick
+		was suppressed.  Note this does *not* call the tick hook function for
+		each stepped tick.  The port layer never asks for more ticks than
+		there are until the next task unblocks, so no delayed task can be
+		missed here. */
+		configASSERT( ( xTickCount + xTicksToJump ) <= xNextTaskUnblockTime );
+		xTickCount += xTicksToJump;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	eSleepModeStatus eTaskConfirmSleepModeStatus( void )
+	{
+	eSleepModeStatus eReturn = eStandardSleep;
+
+		if( listCURRENT_LIST_LENGTH( &xPendingReadyList ) != 0 )
+		{
+			/* A task was made ready while the scheduler was suspended. */
+			eReturn = eAbortSleep;
+		}
+		else if( xMissedYield != pdFALSE )
+		{
+			/* A yield was pended while the scheduler was suspended. */
+			eReturn = eAbortSleep;
+		}
+		else if( uxMissedTicks != ( unsigned portBASE_TYPE ) 0U )
+		{
+			/* A tick interrupt arrived after the expected idle time was
+			calculated, so that time is no longer valid. */
+			eReturn = eAbortSleep;
+		}
+
+		return eReturn;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_APPLICATION_TASK_TAG == 1 )
 
 	void vTaskSetApplicationTaskTag( xTaskHandle xTask, pdTASK_HOOK_CODE pxHookFunction )
@@ -1918,6 +2041,35 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 			vApplicationIdleHook();
 		}
 		#endif
+
+		#if ( configUSE_TICKLESS_IDLE == 1 )
+		{
+		portTickType xExpectedIdleTime;
+
+			/* It is not desirable to suspend then resume the scheduler on
+			each iteration of the idle task.  Therefore, a preliminary test of
+			the expected idle time is performed without the scheduler
+			suspended.  The result here is not necessarily valid. */
+			xExpectedIdleTime = prvGetExpectedIdleTime();
+
+			if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+			{
+				vTaskSuspendAll();
+				{
+					/* Now the scheduler is suspended, the expected idle
+					time can be sampled again, and this time its value can
+					be used. */
+					xExpectedIdleTime = prvGetExpectedIdleTime();
+
+					if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+					{
+						portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime );
+					}
+				}
+				xTaskResumeAll();
+			}
+		}
+		#endif
 	}
 } /*lint !e715 pvParameters is not accessed but all task functions require the same prototype. */
 
@@ -2051,6 +2203,34 @@ unsigned portBASE_TYPE uxPriority;
 }
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+	static portTickType prvGetExpectedIdleTime( void )
+	{
+	portTickType xReturn;
+
+		if( pxCurrentTCB->uxPriority > tskIDLE_PRIORITY )
+		{
+			xReturn = 0;
+		}
+		else if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ tskIDLE_PRIORITY ] ) ) > 1 )
+		{
+			/* There are other idle priority tasks in the Ready state.  If
+			time slicing is used then the very next tick interrupt must be
+			processed. */
+			xReturn = 0;
+		}
+		else
+		{
+			xReturn = xNextTaskUnblockTime - xTickCount;
+		}
+
+		return xReturn;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 static void prvCheckTasksWaitingTermination( void )
 {
 	#if ( INCLUDE_vTaskDelete == 1 )
@@ -2244,6 +2424,33 @@ tskTCB *pxNewTCB;
 		} while( pxNextTCB != pxFirstTCB );
 	}
 
+	static unsigned portBASE_TYPE prvListRunTimesWithinSingleList( xTaskRunTime *pxTaskRunTimes, unsigned portBASE_TYPE uxArraySize, xList *pxList )
+	{
+	volatile tskTCB *pxNextTCB, *pxFirstTCB;
+	unsigned portBASE_TYPE uxTask = 0;
+
+		if( listLIST_IS_EMPTY( pxList ) != pdFALSE )
+		{
+			return 0;
+		}
+
+		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
+		do
+		{
+			listGET_OWNER_OF_NEXT_ENTRY( pxNextTCB, pxList );
+
+			if( uxTask < uxArraySize )
+			{
+				memcpy( ( void * ) pxTaskRunTimes[ uxTask ].pcTaskName, ( const void * ) pxNextTCB->pcTaskName, configMAX_TASK_NAME_LEN );
+				pxTaskRunTimes[ uxTask ].ulRunTimeCounter = pxNextTCB->ulRunTimeCounter;
+				uxTask++;
+			}
+
+		} while( pxNextTCB != pxFirstTCB );
+
+		return uxTask;
+	}
+
 #endif
 /*-----------------------------------------------------------*/
 
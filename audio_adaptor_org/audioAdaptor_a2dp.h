@@ -63,6 +63,13 @@ DESCRIPTION
 #define SBC_BITPOOL_GOOD_QUALITY        40
 /*! [Octet 2] Maximum bitpool for High quality */
 #define SBC_BITPOOL_HIGH_QUALITY        50
+/*! Maximum bitpool with 3 sinks streaming, so the media packets of all of them take
+    no more than 80% of the air over EDR 2-DH5 with 20% resent. Modelled, not measured:
+    the caps come from the airtime model of the sinks scenario in host/sim_main.c.
+    Links without EDR are limited further by their audio quality. */
+#define SBC_BITPOOL_3_SINKS             48
+/*! Maximum bitpool with 4 sinks streaming, from the same model */
+#define SBC_BITPOOL_4_SINKS             34
 
 /*@} */
 
@@ -433,6 +440,28 @@ static const uint8 mp3_caps_source_analogue[] = {
 #endif /* ENABLE_EXTERNAL_ADC */
 
 
+/*! @name SBC rate control
+    The bitpool controller samples the link of each device streaming SBC and
+    steps the bitpool down on a poor sample and back up on a run of good ones.
+*/
+/*@{ */
+/*! Time between samples of a link */
+#define SBC_RATE_SAMPLE_PERIOD_MS     1000
+/*! HCI link quality (0-255) below which a sample is poor */
+#define SBC_RATE_POOR_LINK_QUALITY     215
+/*! RSSI, in dB relative to the golden receive power range, below which a sample is poor */
+#define SBC_RATE_POOR_RSSI             -10
+/*! Percentage of the media sink still holding audio at which a sample is poor */
+#define SBC_RATE_POOR_BACKLOG           50
+/*! Bitpool reduction on a poor sample */
+#define SBC_RATE_STEP_DOWN               6
+/*! Bitpool increase after a run of good samples */
+#define SBC_RATE_STEP_UP                 3
+/*! Number of good samples in a row before the bitpool is increased */
+#define SBC_RATE_GOOD_SAMPLES            3
+/*@} */
+
+
 /* Maximum supported audio quality for the media stream */
 typedef enum
 {
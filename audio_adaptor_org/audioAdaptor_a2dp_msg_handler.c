@@ -66,6 +66,10 @@ static const uint8 sample_rate_index_table_mp3[]  = {1, 0, 2, 4, 3, 5};
 static const uint16 max_bitpool_array[] = {SBC_BITPOOL_LOW_QUALITY, SBC_BITPOOL_MEDIUM_QUALITY, SBC_BITPOOL_GOOD_QUALITY, SBC_BITPOOL_HIGH_QUALITY};
 /* The max bitpools for the different audio qualities under pool link conditions */
 static const uint16 max_bitpool_poor_link_array[] = {SBC_BITPOOL_LOW_QUALITY-10, SBC_BITPOOL_MEDIUM_QUALITY, SBC_BITPOOL_GOOD_QUALITY-15, SBC_BITPOOL_HIGH_QUALITY};
+#ifdef DUAL_STREAM
+/* The max bitpools for the number of sinks with a media channel open, all of them share the air (modelled caps, see audioAdaptor_a2dp.h) */
+static const uint16 multi_stream_bitpool_array[] = {SBC_BITPOOL_HIGH_QUALITY, SBC_BITPOOL_HIGH_QUALITY, SBC_BITPOOL_3_SINKS, SBC_BITPOOL_4_SINKS};
+#endif
 
 
 /****************************************************************************
@@ -185,64 +189,66 @@ NAME
     checkSbcBitpool
 
 DESCRIPTION
-    Check bitpool supported by all A2DP devices during a media channel reopen
-    to make sure a bitpool is chosen that falls within the supported limits.
+    Check the bitpool range being configured for a device when several A2DP
+    devices are connected. The DSP runs one SBC encoder for all the media
+    streams, so every sink is sent the same bitpool and the range is kept
+    to the bitpools the other configured devices also accept. Only the
+    quality cap follows this device's own link.
 
 */
-static void checkSbcBitpool(uint8 *min_bitpool, uint8 *max_bitpool)
+static void checkSbcBitpool(devInstanceTaskData *theInst, uint8 *min_bitpool, uint8 *max_bitpool)
 {
     
 #ifdef DUAL_STREAM    
     devInstanceTaskData *inst;
     uint16 i;
-    uint8 chosen_min_bp = *min_bitpool;
-    uint8 chosen_max_bp = *max_bitpool;    
-    a2dpAudioQuality audio_quality = A2DP_AUDIO_QUALITY_UNKNOWN;
     uint16 number_a2dp_devices = 0;
     
     for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
     {
         inst = the_app->dev_inst[i];
-        if (inst != NULL)
-        {                  
-            if ((inst->sbc_min_bitpool != 0) && (inst->sbc_min_bitpool > chosen_min_bp))
-                chosen_min_bp = inst->sbc_min_bitpool;
-            if ((inst->sbc_max_bitpool != 0) && (inst->sbc_max_bitpool < chosen_max_bp))
-                chosen_max_bp = inst->sbc_max_bitpool;
-            
-            if (inst->a2dp_audio_quality < audio_quality)
-            {
-                audio_quality = inst->a2dp_audio_quality;                
-            }
-            if (inst->a2dp_sig_sink || inst->a2dp_reopen)
+        if ((inst != NULL) && (inst->a2dp_sig_sink || inst->a2dp_reopen))
+        {
+            number_a2dp_devices++;
+            /* the encoder bitpool has to be one every device accepts */
+            if ((inst != theInst) && inst->sbc_max_bitpool)
             {
-                number_a2dp_devices++;
+                if (inst->sbc_min_bitpool > *min_bitpool)
+                    *min_bitpool = inst->sbc_min_bitpool;
+                if (inst->sbc_max_bitpool < *max_bitpool)
+                    *max_bitpool = inst->sbc_max_bitpool;
             }
         }
     }     
     
-    if (number_a2dp_devices == MAX_NUM_DEV_CONNECTIONS)
+    if ((number_a2dp_devices > 1) && (theInst->a2dp_audio_quality != A2DP_AUDIO_QUALITY_UNKNOWN))
     {
-        uint16 temp_max_bitpool = max_bitpool_array[audio_quality];
-        if (temp_max_bitpool < chosen_max_bp)
-            chosen_max_bp = temp_max_bitpool;
+        /* The streams share the radio, so limit this device to the quality its link supports */
+        uint8 temp_max_bitpool = max_bitpool_array[theInst->a2dp_audio_quality];
+        if (temp_max_bitpool < *max_bitpool)
+            *max_bitpool = temp_max_bitpool;
+        if (*min_bitpool > *max_bitpool)
+            *min_bitpool = *max_bitpool;
     }
-    
-    *min_bitpool = chosen_min_bp;
-    *max_bitpool = chosen_max_bp;
 #endif    
     
     DEBUG_A2DP(("    chosen bitpool min[0x%x] max[0x%x]\n",*min_bitpool,*max_bitpool));    
 }
 
 
-static void chooseSbcAudioQuality(devInstanceTaskData *theInst)
+/****************************************************************************
+NAME
+    getSbcBitpools
+
+DESCRIPTION
+    Works out the bitpool to use for SBC streams, and the lower one for poor
+    link conditions, from the audio quality and bitpool range of all links.
+
+*/
+static void getSbcBitpools(devInstanceTaskData *theInst, uint16 *new_bitpool, uint16 *poor_link_bitpool)
 {
-    /* The streams are compatible but may need to adjust bitrate */                
     uint16 min_bitpool;
     uint16 max_bitpool;
-    uint16 new_bitpool;
-    uint16 poor_link_bitpool;
     a2dpAudioQuality quality;
     bool scatternet = areDevicesInScatternet();
     
@@ -259,24 +265,47 @@ static void chooseSbcAudioQuality(devInstanceTaskData *theInst)
     if (quality != A2DP_AUDIO_QUALITY_UNKNOWN)
     {
         /* get the bitpool value for this audio quality level */
-        new_bitpool = max_bitpool_array[quality];
+        *new_bitpool = max_bitpool_array[quality];
         /* get the bitpool value for this audio quality level under poor link conditions */
-        poor_link_bitpool = max_bitpool_poor_link_array[quality];
+        *poor_link_bitpool = max_bitpool_poor_link_array[quality];
     }
     else
     {
         /* the audio quality is unknown so just assume the quality */
-        new_bitpool = max_bitpool_array[A2DP_AUDIO_QUALITY_HIGH];
-        poor_link_bitpool = max_bitpool_poor_link_array[A2DP_AUDIO_QUALITY_HIGH];
+        *new_bitpool = max_bitpool_array[A2DP_AUDIO_QUALITY_HIGH];
+        *poor_link_bitpool = max_bitpool_poor_link_array[A2DP_AUDIO_QUALITY_HIGH];
+    }
+#ifdef DUAL_STREAM
+    {
+        /* leave air for every sink's media packets */
+        uint16 sinks = a2dpSlcIsMediaOpen();
+        if (sinks > 1)
+        {
+            if (*new_bitpool > multi_stream_bitpool_array[sinks - 1])
+                *new_bitpool = multi_stream_bitpool_array[sinks - 1];
+            if (*poor_link_bitpool > multi_stream_bitpool_array[sinks - 1])
+                *poor_link_bitpool = multi_stream_bitpool_array[sinks - 1];
+        }
     }
-    if (new_bitpool < min_bitpool)
-        new_bitpool = min_bitpool;
-    if (new_bitpool > max_bitpool)
-        new_bitpool = max_bitpool;
-    if (poor_link_bitpool < min_bitpool)
-        poor_link_bitpool = min_bitpool;
-    if (poor_link_bitpool > max_bitpool)
-        poor_link_bitpool = max_bitpool;
+#endif
+    if (*new_bitpool < min_bitpool)
+        *new_bitpool = min_bitpool;
+    if (*new_bitpool > max_bitpool)
+        *new_bitpool = max_bitpool;
+    if (*poor_link_bitpool < min_bitpool)
+        *poor_link_bitpool = min_bitpool;
+    if (*poor_link_bitpool > max_bitpool)
+        *poor_link_bitpool = max_bitpool;
+}
+
+
+static void chooseSbcAudioQuality(devInstanceTaskData *theInst)
+{
+    /* The streams are compatible but may need to adjust bitrate */                
+    uint16 new_bitpool;
+    uint16 poor_link_bitpool;
+    
+    getSbcBitpools(theInst, &new_bitpool, &poor_link_bitpool);
     /* send new bitpool to DSP */
     if (new_bitpool != the_app->a2dp_data.codecData.bitpool)
     {
@@ -288,6 +317,66 @@ static void chooseSbcAudioQuality(devInstanceTaskData *theInst)
 }
 
 
+/****************************************************************************
+NAME
+    applySbcRateBitpool
+
+DESCRIPTION
+    The DSP runs a single SBC encoder for all the media streams, so it is
+    given the lowest bitpool the rate controller wants for any streaming link.
+
+*/
+static void applySbcRateBitpool(void)
+{
+    uint16 i;
+    uint16 bitpool = 0;
+    devInstanceTaskData *inst;
+    
+    for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
+    {
+        inst = the_app->dev_inst[i];
+        if ((inst != NULL) && inst->sbc_bitpool && (getA2dpState(inst) == A2dpStateStreaming))
+        {
+            if (!bitpool || (inst->sbc_bitpool < bitpool))
+                bitpool = inst->sbc_bitpool;
+        }
+    }
+    
+    if (bitpool && (bitpool != the_app->a2dp_data.codecData.bitpool))
+    {
+        DEBUG_A2DP(("    SBC rate: set bitpool [%d]\n", bitpool));
+        KalimbaSendMessage(KALIMBA_SET_BITPOOL_MESSAGE, bitpool, 0, 0, 0);
+        the_app->a2dp_data.codecData.bitpool = bitpool;
+    }
+}
+
+
+/****************************************************************************
+NAME
+    startSbcRateControl
+
+DESCRIPTION
+    Starts sampling the link of a device that has started streaming SBC. The
+    controller starts from the bitpool the stream was configured with.
+
+*/
+static void startSbcRateControl(devInstanceTaskData *inst)
+{
+    if (!a2dpSeidIsSbc(inst->a2dp_seid) || !inst->a2dp_media_sink)
+        return;
+    
+    inst->sbc_bitpool = the_app->a2dp_data.codecData.bitpool;
+    inst->sbc_good_samples = 0;
+    inst->sbc_backlog = 0;
+    inst->sbc_rssi = 0;
+    inst->sbc_max_slack = 0;
+    
+    DEBUG_A2DP(("SBC rate: start inst:[0x%x] bitpool [%d]\n", (uint16)inst, inst->sbc_bitpool));
+    
+    MessageCancelAll(&inst->task, APP_SBC_RATE_TIMER);
+    MessageSendLater(&inst->task, APP_SBC_RATE_TIMER, 0, SBC_RATE_SAMPLE_PERIOD_MS);
+}
+
 
 /****************************************************************************
 NAME
@@ -360,6 +449,7 @@ static bool audioDisconnect(devInstanceTaskData *inst, Sink media_sink)
         dualstream_mode_params *dual_mode = (dualstream_mode_params *)PanicUnlessMalloc(sizeof(dualstream_mode_params));
         dual_mode->connect_sink = FALSE; /* Indicate the audio is being disconnected */
         dual_mode->media_sink = media_sink; /* Supply the media sink being disconnected */
+        dual_mode->packet_size = 0;
         AudioSetMode(AUDIO_MODE_CONNECTED, (void*)dual_mode);
                 
         DEBUG_A2DP(("AudioSetMode disconnect_sink:0x%x \n",(uint16)media_sink));
@@ -978,7 +1068,7 @@ static void handleA2DPStartInd(devInstanceTaskData *inst, A2DP_START_IND_T *msg)
                 
                 setA2dpState(inst, A2dpStateStreaming);
 
-                /* For Analogue mode, load the kap file again */
+                /* For Analogue mode, make sure the kap file is running with the right codec */
                 if ((the_app->a2dp_source == SourceAnalog) && !a2dp_streaming)
                 {
                     /* Load the Kap file and let DSP run */
@@ -1003,6 +1093,8 @@ static void handleA2DPStartInd(devInstanceTaskData *inst, A2DP_START_IND_T *msg)
                     }
                 }
                 
+                startSbcRateControl(inst);
+                
                 streamManagerOpenNotify();
             }
             break;
@@ -1048,7 +1140,7 @@ static void handleA2DPStartCfm(devInstanceTaskData *inst, A2DP_START_CFM_T *msg)
                 
                 /* Connect the corresponding plugin and start streaming */
 
-                /* For Analogue mode, load the kap file again */
+                /* For Analogue mode, make sure the kap file is running with the right codec */
                 if((the_app->a2dp_source == SourceAnalog) && !a2dp_streaming)
                 {
                     /* Load the Kap file and let DSP run */
@@ -1072,6 +1164,8 @@ static void handleA2DPStartCfm(devInstanceTaskData *inst, A2DP_START_CFM_T *msg)
                     }
                 }
 
+                startSbcRateControl(inst);
+
                 streamManagerOpenComplete(TRUE);
             }
             else
@@ -1401,7 +1495,7 @@ DESCRIPTION
     based on the remote SEP capabilities;
     
 */
-static bool handleConfigCodec(A2DP_CONFIGURE_CODEC_IND_T *msg)
+static bool handleConfigCodec(devInstanceTaskData *inst, A2DP_CONFIGURE_CODEC_IND_T *msg)
 {
     if (msg->codec_service_caps[3] == AVDTP_MEDIA_CODEC_SBC)
     {
@@ -1482,7 +1576,7 @@ static bool handleConfigCodec(A2DP_CONFIGURE_CODEC_IND_T *msg)
         if (bitpool >= msg->codec_service_caps[6] && bitpool <= msg->codec_service_caps[7])
             msg->codec_service_caps[7] = bitpool;
         
-        checkSbcBitpool(&msg->codec_service_caps[6], &msg->codec_service_caps[7]);
+        checkSbcBitpool(inst, &msg->codec_service_caps[6], &msg->codec_service_caps[7]);
 
         if (msg->codec_service_caps[4] == 0 || msg->codec_service_caps[5] == 0)
             return FALSE;
@@ -1719,7 +1813,7 @@ static void handleA2DPConfigureCodecInd(devInstanceTaskData *inst, A2DP_CONFIGUR
     A2DP *a2dp = ((A2DP_CONFIGURE_CODEC_IND_T *)msg)->a2dp;
 
     /* choose what should be configured */
-    accept = handleConfigCodec((A2DP_CONFIGURE_CODEC_IND_T *)msg);
+    accept = handleConfigCodec(inst, (A2DP_CONFIGURE_CODEC_IND_T *)msg);
 
     A2dpConfigureCodecResponse(a2dp, accept, msg->size_codec_service_caps, msg->codec_service_caps);
 }
@@ -1865,11 +1959,7 @@ static bool areCodecSettingsIdentical(devInstanceTaskData *inst, A2DP_CODEC_SETT
         DEBUG_A2DP(("format %d %d\n",the_app->a2dp_data.codecData.format,msg->codecData.format));
         return FALSE;
     }
-    if (the_app->a2dp_data.codecData.packet_size != msg->codecData.packet_size)
-    {
-        DEBUG_A2DP(("pck size %d %d\n",the_app->a2dp_data.codecData.packet_size,msg->codecData.packet_size));
-        return FALSE;
-    }
+    /* The packet size can differ, each media sink has its own RTP packetiser */
         
     return TRUE;
 }
@@ -1965,7 +2055,9 @@ static void handleA2DPCodecSettingsInd(devInstanceTaskData *theInst, A2DP_CODEC_
                 the same configuration they can both use. */
             if (a2dpSlcIsDifferentMediaOpen(theInst))
             {
-                DEBUG_A2DP(("    a2dp media already open\n"));
+                DEBUG_A2DP(("    a2dp media already open, size[%x]\n",msg->codecData.packet_size));
+                
+                theInst->a2dp_packet_size = msg->codecData.packet_size;
 
                 if (!areCodecSettingsIdentical(theInst, msg))
                 {
@@ -2111,6 +2203,7 @@ static void handleA2DPCodecSettingsInd(devInstanceTaskData *theInst, A2DP_CODEC_
                 /* For mp3, the packet size is always 668 ? */
                 the_app->a2dp_data.codecData.packet_size = 668;
             }
+            theInst->a2dp_packet_size = the_app->a2dp_data.codecData.packet_size;
 
             if (codec_caps != NULL)
                 free (codec_caps);
@@ -2148,6 +2241,119 @@ void a2dpMsgChooseSbcAudioQuality(devInstanceTaskData *theInst)
 {   
     chooseSbcAudioQuality(theInst);
 }
+
+
+/****************************************************************************
+NAME
+    a2dpMsgSbcRateSample
+
+DESCRIPTION
+    Called every SBC_RATE_SAMPLE_PERIOD_MS while a device is streaming SBC.
+    Measures how full the media sink is and asks for the RSSI and link
+    quality of the link, the bitpool is then adjusted once the link quality
+    arrives. Sampling stops when the device is no longer streaming.
+    
+*/
+void a2dpMsgSbcRateSample(devInstanceTaskData *theInst)
+{
+    Sink media_sink = theInst->a2dp_media_sink;
+    uint16 slack;
+    
+    if ((getA2dpState(theInst) != A2dpStateStreaming) || !media_sink || !a2dpSeidIsSbc(theInst->a2dp_seid))
+    {
+        DEBUG_A2DP(("SBC rate: stop inst:[0x%x]\n", (uint16)theInst));
+        theInst->sbc_bitpool = 0;
+        return;
+    }
+    
+    /* The sink is taken to be empty when it has the most slack seen so far,
+       anything less is encoded audio still waiting for the radio */
+    slack = SinkSlack(media_sink);
+    if (slack > theInst->sbc_max_slack)
+        theInst->sbc_max_slack = slack;
+    if (theInst->sbc_max_slack)
+        theInst->sbc_backlog = (uint16)(((uint32)(theInst->sbc_max_slack - slack) * 100) / theInst->sbc_max_slack);
+    
+    ConnectionGetRssi(&the_app->task, media_sink);
+    ConnectionGetLinkQuality(&the_app->task, media_sink);
+    
+    MessageSendLater(&theInst->task, APP_SBC_RATE_TIMER, 0, SBC_RATE_SAMPLE_PERIOD_MS);
+}
+
+
+/****************************************************************************
+NAME
+    a2dpMsgSbcRateRssi
+
+DESCRIPTION
+    Stores the RSSI of the link, it is used with the link quality that follows.
+    
+*/
+void a2dpMsgSbcRateRssi(devInstanceTaskData *theInst, hci_status status, int16 rssi)
+{
+    theInst->sbc_rssi = (status == hci_success) ? rssi : 0;
+}
+
+
+/****************************************************************************
+NAME
+    a2dpMsgSbcRateLinkQuality
+
+DESCRIPTION
+    Completes a sample of the link and steps the bitpool of the device.
+    A poor sample, from a low link quality, a weak signal or audio backing
+    up in the media sink, drops the bitpool straight away. It is only raised
+    again, and in smaller steps, after SBC_RATE_GOOD_SAMPLES good samples in
+    a row so the stream does not hunt on a marginal link.
+    
+*/
+void a2dpMsgSbcRateLinkQuality(devInstanceTaskData *theInst, hci_status status, uint16 link_quality)
+{
+    uint16 rate_max;
+    uint16 rate_min;
+    uint16 bitpool = theInst->sbc_bitpool;
+    bool poor;
+    
+    if (!bitpool || (status != hci_success))
+        return;
+    
+    /* The controller works between the bitpool chosen for the links and the
+       lower of the poor link and low quality bitpools */
+    getSbcBitpools(theInst, &rate_max, &rate_min);
+    if (rate_min > SBC_BITPOOL_LOW_QUALITY)
+        rate_min = SBC_BITPOOL_LOW_QUALITY;
+    if (rate_min < theInst->sbc_min_bitpool)
+        rate_min = theInst->sbc_min_bitpool;
+    if (rate_min > rate_max)
+        rate_min = rate_max;
+    
+    poor = (link_quality < SBC_RATE_POOR_LINK_QUALITY) ||
+           (theInst->sbc_rssi < SBC_RATE_POOR_RSSI) ||
+           (theInst->sbc_backlog >= SBC_RATE_POOR_BACKLOG);
+    
+    if (poor)
+    {
+        theInst->sbc_good_samples = 0;
+        bitpool = (bitpool > rate_min + SBC_RATE_STEP_DOWN) ? bitpool - SBC_RATE_STEP_DOWN : rate_min;
+    }
+    else if (++theInst->sbc_good_samples >= SBC_RATE_GOOD_SAMPLES)
+    {
+        theInst->sbc_good_samples = 0;
+        bitpool += SBC_RATE_STEP_UP;
+    }
+    
+    if (bitpool > rate_max)
+        bitpool = rate_max;
+    if (bitpool < rate_min)
+        bitpool = rate_min;
+    
+    DEBUG_A2DP(("SBC rate: inst:[0x%x] lq[%d] rssi[%d] backlog[%d%%] %s bitpool [%d]->[%d] range [%d-%d]\n",
+                (uint16)theInst, link_quality, theInst->sbc_rssi, theInst->sbc_backlog,
+                poor ? "poor" : "good", theInst->sbc_bitpool, bitpool, rate_min, rate_max));
+    
+    theInst->sbc_bitpool = bitpool;
+    applySbcRateBitpool();
+}
     
 
 /****************************************************************************
@@ -24,6 +24,12 @@ DESCRIPTION
 */
 void a2dpMsgChooseSbcAudioQuality(devInstanceTaskData *theInst);
 
+void a2dpMsgSbcRateSample(devInstanceTaskData *theInst);
+
+void a2dpMsgSbcRateRssi(devInstanceTaskData *theInst, hci_status status, int16 rssi);
+
+void a2dpMsgSbcRateLinkQuality(devInstanceTaskData *theInst, hci_status status, uint16 link_quality);
+
 void a2dpMsgHandleLibMessage(MessageId id, Message message);
 
 void a2dpMsgHandleInstanceMessage(devInstanceTaskData *theInst, MessageId id, Message message);
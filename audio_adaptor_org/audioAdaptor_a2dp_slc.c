@@ -86,9 +86,8 @@ bool a2dpSlcReOpen(devInstanceTaskData *inst)
      
     /* Always try a reopen with SBC, as this must be supported */
 #ifdef DUAL_STREAM    
-    size_seids = 2;
-    seids[0] = SBC_SEID;
-    seids[1] = SBC_DS_SEID;
+    for (size_seids = 0; size_seids < MAX_A2DP_SINKS; size_seids++)
+        seids[size_seids] = SBC_SEID + size_seids;
 #else
     size_seids = 1;
     seids[0] = SBC_SEID;
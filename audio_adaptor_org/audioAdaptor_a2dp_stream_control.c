@@ -26,6 +26,7 @@ DESCRIPTION
 #include <transform.h>
 #include <audio.h>
 #include <codec.h>
+#include <vm.h>
 
 
 /* Compile time switches */
@@ -40,6 +41,19 @@ const char mp3_encoder[]        = "mp3_encoder/mp3_encoder.kap";
 const char faststream_encoder[] = "sbc_encoder/sbc_encoder.kap";
 
 
+/* No codec type has been sent to the kap yet */
+#define CODEC_TYPE_NONE 0xFFFF
+
+/* The kap left running in the DSP and the codec type it was last sent.
+   Every encoder shares sbc_encoder.kap apart from MP3, so a stream or call
+   transition normally only needs the encoder switched by message. */
+static struct
+{
+    FILE_INDEX  kap;
+    uint16      codec_type;
+} s_dsp = { FILE_NONE, CODEC_TYPE_NONE };
+
+
 /****************************************************************************
   MAIN FUNCTIONS
 */
@@ -54,18 +68,21 @@ DESCRIPTION
     
     As the same dsp kap file is used for both USB source and Analogue source, it is 
     better to load the kap file in application instead of plugin library.
+    
+    If the kap file is already running it is kept, and only the codec type is 
+    changed, since reloading blocks the VM and leaves a gap in the audio.
  
 */
 void a2dpStreamStartDsp(bool isA2DPstreaming)
 {    
     uint16 codec_type = CodecSbc;
     FILE_INDEX index  = FILE_NONE;
+#if defined ENABLE_DEBUG && defined ENABLE_DEBUG_A2DP
+    uint32 start      = VmGetClock();
+#endif
     
     DEBUG_A2DP(("a2dpStreamStartDsp %d\n",isA2DPstreaming));
     
-    /* Power off the kalimba first before load the Kap file again */
-    KalimbaPowerOff() ;
-     
     /* This will be changed if one kap file supports both usb and analogue source types */
     if (isA2DPstreaming)
     {
@@ -105,11 +122,33 @@ void a2dpStreamStartDsp(bool isA2DPstreaming)
         index = FileFind(FILE_ROOT, sbc_encoder, sizeof(sbc_encoder)-1);
     }
 
-    /* Load the DSP Kap file */
     if (index == FILE_NONE)
         Panic();
+    
+    if (index == s_dsp.kap)
+    {
+        /* The kap file is still running, it only needs to be told the codec */
+        if ((codec_type != CodecMp3) && (codec_type != s_dsp.codec_type))
+        {
+            if (!KalimbaSendMessage(KALIMBA_CODEC_TYPE_MESSAGE, codec_type,0,0,0))
+            {
+                Panic();
+            }
+            s_dsp.codec_type = codec_type;
+        }
+        DEBUG_A2DP(("DSP warm, codec %u in %lums\n", codec_type, VmGetClock() - start));
+        return;
+    }
+    
+    /* Power off the kalimba first before load the Kap file again */
+    KalimbaPowerOff() ;
+    s_dsp.kap = FILE_NONE;
+    s_dsp.codec_type = CODEC_TYPE_NONE;
+
+    /* Load the DSP Kap file */
     if (!KalimbaLoad(index))
         Panic();    
+    s_dsp.kap = index;
     
     /* Register the Kalimba message */
     MessageKalimbaTask(&the_app->task);
@@ -121,6 +160,7 @@ void a2dpStreamStartDsp(bool isA2DPstreaming)
         {
             Panic();
         }
+        s_dsp.codec_type = codec_type;
     }
 
     /* Connect the USB ports with DSP ports and start DSP*/
@@ -136,6 +176,8 @@ void a2dpStreamStartDsp(bool isA2DPstreaming)
             Panic();
         }
     }
+    
+    DEBUG_A2DP(("DSP loaded, codec %u in %lums\n", codec_type, VmGetClock() - start));
 }
 
 
@@ -146,17 +188,42 @@ NAME
 DESCRIPTION
     To set the dsp to the idle state, we can not power off the dsp
     when we suspend the audio streaming under USB input.
+    
+    For analogue input the kap file is also left running now, so it is set
+    idle the same way until the next stream or call selects an encoder.
  
 */
 void a2dpStreamSetDspIdle(void)
 {
     DEBUG_A2DP(("a2dpStreamSetDspIdle\n"));
-    /* For analogue input, we poweroff DSP instead of setting IDLE mode */
-    if(the_app->a2dp_source == SourceUsb)
+    if ((the_app->a2dp_source == SourceUsb) || (s_dsp.kap != FILE_NONE))
         PanicFalse(KalimbaSendMessage(KALIMBA_ENCODER_SELECT, EncoderNone, 0, 0, 0));
 }
 
 
+/****************************************************************************
+NAME 
+    getMediaPacketSize
+
+DESCRIPTION
+    Returns the RTP packet size negotiated for the media channel of a sink,
+    or the size stored for the first stream if the sink isn't known.
+ 
+*/
+static uint16 getMediaPacketSize(Sink media_sink)
+{
+    uint16 i;
+    
+    for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
+    {
+        devInstanceTaskData *inst = the_app->dev_inst[i];
+        if ((inst != NULL) && (inst->a2dp_media_sink == media_sink) && inst->a2dp_packet_size)
+            return inst->a2dp_packet_size;
+    }
+    return the_app->a2dp_data.codecData.packet_size;
+}
+
+
 /****************************************************************************
 NAME 
     a2dpStreamConnectA2dpAudio
@@ -176,15 +243,16 @@ void a2dpStreamConnectA2dpAudio(Sink media_sink)
     
     if (the_app->active_encoder == EncoderAv)
     {
-        /* This indicates streaming is already active and now a second audio connection has
-           to be routed. Use the AudioSetMode function to start the second audio stream. 
+        /* This indicates streaming is already active and now another audio connection has
+           to be routed. Use the AudioSetMode function to start the new audio stream. 
         */
         dualstream_mode_params *dual_mode = (dualstream_mode_params *)PanicUnlessMalloc(sizeof(dualstream_mode_params));
         dual_mode->connect_sink = TRUE; /* Indicate the audio is being connected */
         dual_mode->media_sink = media_sink; /* Supply the second media sink that is being connected */
+        dual_mode->packet_size = getMediaPacketSize(media_sink);
         AudioSetMode(AUDIO_MODE_CONNECTED, (void*)dual_mode);
 
-        DEBUG_A2DP(("AudioSetMode connect_sink:0x%x \n",(uint16)media_sink));
+        DEBUG_A2DP(("AudioSetMode connect_sink:0x%x size:%d\n",(uint16)media_sink,dual_mode->packet_size));
     }
     else
     {
@@ -201,13 +269,16 @@ void a2dpStreamConnectA2dpAudio(Sink media_sink)
         /* Pass the second media sink as a parameter into the AudioConnect function that the audio plugin
            can recognise. 
         */
+        the_app->a2dp_data.codecData.packet_size = getMediaPacketSize(media_sink_arr[0]);
         if (counter > 1)
         {
             the_app->a2dp_data.codecData.media_sink_b = media_sink_arr[1];
+            the_app->a2dp_data.codecData.packet_size_b = getMediaPacketSize(media_sink_arr[1]);
         }
         else
         {
             the_app->a2dp_data.codecData.media_sink_b = 0;
+            the_app->a2dp_data.codecData.packet_size_b = 0;
         }
         
         /* Connect the audio plugin */
@@ -221,6 +292,17 @@ void a2dpStreamConnectA2dpAudio(Sink media_sink)
                  AUDIO_MODE_CONNECTED, 
                  (source_codec_data_type *) &the_app->a2dp_data.codecData ) ;
         
+        /* The plugin is connected with two sinks, any more are added to it the way a
+           sink is when streaming is already active */
+        for (i = 2; i < counter; i++)
+        {
+            dualstream_mode_params *dual_mode = (dualstream_mode_params *)PanicUnlessMalloc(sizeof(dualstream_mode_params));
+            dual_mode->connect_sink = TRUE;
+            dual_mode->media_sink = media_sink_arr[i];
+            dual_mode->packet_size = getMediaPacketSize(media_sink_arr[i]);
+            AudioSetMode(AUDIO_MODE_CONNECTED, (void*)dual_mode);
+        }
+        
         the_app->active_encoder = EncoderAv;
         
         DEBUG_A2DP(("AudioConnect devices:%d\n",counter));
@@ -326,6 +326,9 @@ static void handleAghfpSlcConnectCfm(const AGHFP_SLC_CONNECT_CFM_T *cfm)
                 inst->aghfp = cfm->aghfp;
                 /* Store sink */
                 inst->aghfp_sink = cfm->rfcomm_sink;
+                /* Remember the HF's channel to skip the service search next time */
+                if (cfm->rfc_channel)
+                    inst->aghfp_rfc_channel = cfm->rfc_channel;
                 /* Update state */
                 setAghfpState(inst, AghfpStateConnected);
 				/* Get the current role */
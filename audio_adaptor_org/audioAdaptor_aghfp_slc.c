@@ -10,6 +10,7 @@ DESCRIPTION
 #include "audioAdaptor_private.h"
 #include "audioAdaptor_aghfp_slc.h"
 #include "audioAdaptor_statemanager.h"
+#include "audioAdaptor_configure.h"
 
 #include <string.h>
 #include <panic.h>
@@ -97,7 +98,9 @@ bool aghfpSlcConnect (devInstanceTaskData *inst)
     
             setAghfpState(inst, AghfpStatePaging);
             the_app->s_connect_attempts = 0;
-            AghfpSlcConnect(inst->aghfp, &inst->bd_addr);
+            /* Skip the service search if the channel is known from the last connection,
+               the library searches anyway if the HF refuses it */
+            AghfpSlcConnectUsingChannel(inst->aghfp, &inst->bd_addr, configureGetRemoteRfcommChannel(&inst->bd_addr));
             
             return TRUE;
         }
@@ -159,6 +159,16 @@ static void handleClDmInquireResult(const CL_DM_INQUIRE_RESULT_T *result)
 {
     mvdAppState app_state = the_app->app_state;
     
+    if ( (app_state != AppStateInquiring) && scanIsInquiryRunning() )
+    {
+        /* An early connect is being made, keep the results in case it fails */
+        if (result->status == inquiry_status_result)
+            scanStoreInquireResult(result);
+        else
+            scanInquiryComplete();
+        return;
+    }
+    
     switch ( app_state )
     {
         case AppStateInquiring:
@@ -170,6 +180,7 @@ static void handleClDmInquireResult(const CL_DM_INQUIRE_RESULT_T *result)
                 break;
                 
             case inquiry_status_ready:
+                scanInquiryComplete();
                 scanProcessNextInquireResult();
                 break;
             }
@@ -491,6 +502,66 @@ static void handleClDmRemoteFeaturesConfirm(const CL_DM_REMOTE_FEATURES_CFM_T *c
 }
 
 
+/****************************************************************************
+NAME
+    findInstFromMediaSink
+
+DESCRIPTION
+    Returns the device instance that owns the A2DP media sink, or NULL.
+
+*/
+static devInstanceTaskData *findInstFromMediaSink(Sink sink)
+{
+    uint16 i;
+    
+    for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
+    {
+        if ((the_app->dev_inst[i] != NULL) && (the_app->dev_inst[i]->a2dp_media_sink == sink))
+            return the_app->dev_inst[i];
+    }
+    return NULL;
+}
+
+
+/****************************************************************************
+NAME
+    handleClDmRssiCfm
+
+DESCRIPTION
+    Passes the RSSI of a streaming link to the SBC rate controller.
+
+*/
+static void handleClDmRssiCfm(const CL_DM_RSSI_CFM_T *cfm)
+{
+    devInstanceTaskData *inst = findInstFromMediaSink(cfm->sink);
+    
+    if (inst != NULL)
+    {
+        /* The RSSI is a signed value in dB from the golden receive power range */
+        a2dpMsgSbcRateRssi(inst, cfm->status, (int8)cfm->rssi);
+    }
+}
+
+
+/****************************************************************************
+NAME
+    handleClDmLinkQualityCfm
+
+DESCRIPTION
+    Passes the link quality of a streaming link to the SBC rate controller.
+
+*/
+static void handleClDmLinkQualityCfm(const CL_DM_LINK_QUALITY_CFM_T *cfm)
+{
+    devInstanceTaskData *inst = findInstFromMediaSink(cfm->sink);
+    
+    if (inst != NULL)
+    {
+        a2dpMsgSbcRateLinkQuality(inst, cfm->status, cfm->link_quality);
+    }
+}
+
+
 /****************************************************************************
   MAIN FUNCTIONS
 */
@@ -536,8 +607,9 @@ void clMsgHandleLibMessage(MessageId id, Message message)
         case CL_DM_ACL_OPENED_IND:
         {
             DEBUG_CL(("CL_DM_ACL_OPENED_IND from: 0x%X 0x%X 0x%lX\n", ((CL_DM_ACL_OPENED_IND_T *)message)->bd_addr.nap, ((CL_DM_ACL_OPENED_IND_T *)message)->bd_addr.uap, ((CL_DM_ACL_OPENED_IND_T *)message)->bd_addr.lap));
-            /* Ignore this message for now */
-            DEBUG_CL((" - ignored\n"));
+            /* The rest of the profiles of a device being connected can now start */
+            if (((CL_DM_ACL_OPENED_IND_T *)message)->status == hci_success)
+                profileSlcAclOpened(&((CL_DM_ACL_OPENED_IND_T *)message)->bd_addr);
             break;
         }    
         case CL_DM_ACL_CLOSED_IND:
@@ -661,6 +733,18 @@ void clMsgHandleLibMessage(MessageId id, Message message)
             handleClDmRemoteFeaturesConfirm((CL_DM_REMOTE_FEATURES_CFM_T *)message);
             return;
         }
+        case CL_DM_RSSI_CFM:
+        {
+            DEBUG_CL(("CL_DM_RSSI_CFM status = %u\n", ((CL_DM_RSSI_CFM_T *)message)->status));
+            handleClDmRssiCfm((CL_DM_RSSI_CFM_T *)message);
+            break;
+        }
+        case CL_DM_LINK_QUALITY_CFM:
+        {
+            DEBUG_CL(("CL_DM_LINK_QUALITY_CFM status = %u\n", ((CL_DM_LINK_QUALITY_CFM_T *)message)->status));
+            handleClDmLinkQualityCfm((CL_DM_LINK_QUALITY_CFM_T *)message);
+            break;
+        }
         default:
         {
             DEBUG_CL(("Unhandled CL message 0x%X\n", (uint16)id));    
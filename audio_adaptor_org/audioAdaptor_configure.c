@@ -28,6 +28,12 @@ DESCRIPTION
 #define DEVICE_PINIDX_BITMASK 0xF
 #define DEVICE_ORDERING_BITPOS  0
 #define DEVICE_ORDERING_BITMASK 0xF
+#define SERVICE_RFCOMM_CHANNEL_BITPOS  0
+#define SERVICE_RFCOMM_CHANNEL_BITMASK 0xFF
+#define DEVICE_INDEX_FREE 0xff
+
+/* Changes to the paired device list are written to PS this long after the last one */
+#define PS_FLUSH_DELAY_MS D_SEC(5)
 
 
 static mvdPsKeyData *s_ps_key_cache;
@@ -47,6 +53,7 @@ DESCRIPTION
 */
 static bool erasePsKey(uint16 key)
 {
+    s_ps_key_cache->ps_writes++;
     if (!PsStore(key, 0, 0))
     {
         return TRUE;
@@ -66,6 +73,7 @@ DESCRIPTION
 */
 static bool writePsKey(uint16 key, const void *buffer, uint16 length)
 {
+    s_ps_key_cache->ps_writes++;
     if (PsStore(key, buffer, length) == length)
     {
         return TRUE;
@@ -120,7 +128,7 @@ DESCRIPTION
     Convert a Bluetooth address from a bdaddr structure into an array of uint16 values.
 
 */
-static void contractBdaddr (bdaddr *bd_addr, uint16 *buffer)
+static void contractBdaddr (const bdaddr *bd_addr, uint16 *buffer)
 {
     *buffer = bd_addr->nap;
     *(buffer+1) = (bd_addr->uap & 0xff) << 8;
@@ -175,6 +183,13 @@ static void cacheLoad (void)
         size = PsRetrieve(PSKEY_REMOTE_DEVICE_LIST, (void *)s_ps_key_cache->remote_device_list.buffer, PS_REMOTE_DEVICE_LIST_MAX_SIZE);
         s_ps_key_cache->remote_device_list.count = size/PS_REMOTE_DEVICE_LIST_ELEMENT_SIZE;
         
+        /* Service records are only trusted if they were stored with this device list */
+        size = PsRetrieve(PSKEY_REMOTE_SERVICE_LIST, (void *)s_ps_key_cache->remote_service_list.buffer, PS_REMOTE_SERVICE_LIST_MAX_SIZE);
+        if (size != s_ps_key_cache->remote_device_list.count*PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE)
+        {
+            memset(s_ps_key_cache->remote_service_list.buffer, 0, sizeof(s_ps_key_cache->remote_service_list.buffer));
+        }
+        
         size = PsRetrieve(PSKEY_HID_SEQUENCE, (void *)s_ps_key_cache->hid_sequence.buffer, PS_HID_SEQUENCE_MAX_SIZE);
         s_ps_key_cache->hid_sequence.count = size;   
         
@@ -189,7 +204,9 @@ NAME
     cacheStore
 
 DESCRIPTION
-    Write PS Key data from memory back into PS.
+    Write the changed PS Key data from memory back into PS. The service records
+    only change when a device is added or its HF moves channel, which is rare
+    once a device has connected once.
 
 */
 static void cacheStore (void)
@@ -199,16 +216,51 @@ static void cacheStore (void)
         cacheCreate();
     }
     
+    MessageCancelAll(&the_app->task, APP_PS_FLUSH_TIMER);
+    
     /* Don't store PIO config, pin code list or locally supported profiles - these are read only */
-    if (s_ps_key_cache->remote_device_list.count)
+    if (!s_ps_key_cache->remote_device_list.count)
     {
-        writePsKey(PSKEY_REMOTE_DEVICE_LIST, (const void *)&s_ps_key_cache->remote_device_list.buffer, s_ps_key_cache->remote_device_list.count*PS_REMOTE_DEVICE_LIST_ELEMENT_SIZE);
+        if (s_ps_key_cache->remote_device_list.dirty)
+        {
+            erasePsKey(PSKEY_REMOTE_DEVICE_LIST);
+            erasePsKey(PSKEY_REMOTE_SERVICE_LIST);
+        }
     }
     else
     {
-        erasePsKey(PSKEY_REMOTE_DEVICE_LIST);
+        if (s_ps_key_cache->remote_device_list.dirty)
+        {
+            writePsKey(PSKEY_REMOTE_DEVICE_LIST, (const void *)&s_ps_key_cache->remote_device_list.buffer, s_ps_key_cache->remote_device_list.count*PS_REMOTE_DEVICE_LIST_ELEMENT_SIZE);
+        }
+        if (s_ps_key_cache->remote_device_list.services_dirty)
+        {
+            writePsKey(PSKEY_REMOTE_SERVICE_LIST, (const void *)&s_ps_key_cache->remote_service_list.buffer, s_ps_key_cache->remote_device_list.count*PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE);
+        }
     }
     
+    s_ps_key_cache->remote_device_list.dirty = FALSE;
+    s_ps_key_cache->remote_device_list.services_dirty = FALSE;
+    s_ps_key_cache->remote_device_list.added = FALSE;
+    
+    DEBUG_CONFIG(("PS paired device list stored, %u PS writes since boot\n", s_ps_key_cache->ps_writes));
+}
+
+
+/****************************************************************************
+NAME
+    cacheStoreLater
+
+DESCRIPTION
+    Write the changed PS Key data back into PS once the changes have settled. A
+    connection changes the paired device list several times, and the writes stall
+    the VM, so they are coalesced into one and made when the adaptor is idle.
+
+*/
+static void cacheStoreLater (void)
+{
+    MessageCancelAll(&the_app->task, APP_PS_FLUSH_TIMER);
+    MessageSendLater(&the_app->task, APP_PS_FLUSH_TIMER, 0, PS_FLUSH_DELAY_MS);
 }
 
 
@@ -329,6 +381,150 @@ static void setDeviceProfiles(uint16 device_idx, mvdProfiles profiles)
 }
 
 
+/****************************************************************************
+NAME
+    getDeviceRfcommChannel
+
+DESCRIPTION
+    Returns the remote HFP/HSP RFCOMM server channel stored for the paired device
+    at the specified index, 0 if it is not known.
+
+*/
+static uint8 getDeviceRfcommChannel(uint16 device_idx)
+{
+    return (uint8)((s_ps_key_cache->remote_service_list.buffer[device_idx*PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE] >> SERVICE_RFCOMM_CHANNEL_BITPOS) & SERVICE_RFCOMM_CHANNEL_BITMASK);
+}
+
+
+/****************************************************************************
+NAME
+    setDeviceRfcommChannel
+
+DESCRIPTION
+    Sets the remote HFP/HSP RFCOMM server channel for the paired device at the
+    specified index.
+
+*/
+static void setDeviceRfcommChannel(uint16 device_idx, uint8 channel)
+{
+    s_ps_key_cache->remote_service_list.buffer[device_idx*PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE] &= ~(SERVICE_RFCOMM_CHANNEL_BITMASK << SERVICE_RFCOMM_CHANNEL_BITPOS);
+    s_ps_key_cache->remote_service_list.buffer[device_idx*PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE] |= ((uint16)channel & SERVICE_RFCOMM_CHANNEL_BITMASK) << SERVICE_RFCOMM_CHANNEL_BITPOS;
+}
+
+
+/****************************************************************************
+NAME
+    hashBdaddr
+
+DESCRIPTION
+    Returns the slot of the paired device index a Bluetooth address starts its search at.
+
+*/
+static uint16 hashBdaddr (const bdaddr *bd_addr)
+{
+    return (uint16)(bd_addr->lap ^ (bd_addr->lap >> 12) ^ bd_addr->uap) & (PS_REMOTE_DEVICE_INDEX_SIZE-1);
+}
+
+
+/****************************************************************************
+NAME
+    isDeviceBdaddr
+
+DESCRIPTION
+    Returns if the paired device at the specified index has the Bluetooth address,
+    given in its packed form, so the address in the list needn't be expanded.
+
+*/
+static bool isDeviceBdaddr (uint16 device_idx, const uint16 *packed)
+{
+    const uint16 *buffer = &s_ps_key_cache->remote_device_list.buffer[(device_idx*DEVICE_DATA_SIZE)+DEVICE_BDADDR_OFFSET];
+    
+    return (buffer[0]==packed[0]) && (buffer[1]==packed[1]) && (buffer[2]==packed[2]);
+}
+
+
+/****************************************************************************
+NAME
+    rebuildDeviceIndex
+
+DESCRIPTION
+    Rebuilds the hash index of the paired device list. Needed when the list is
+    loaded or an entry is given a new Bluetooth address, which is rare.
+
+*/
+static void rebuildDeviceIndex (void)
+{
+    uint16 device_idx;
+    
+    memset(s_ps_key_cache->remote_device_list.index, DEVICE_INDEX_FREE, sizeof(s_ps_key_cache->remote_device_list.index));
+    
+    for (device_idx=0; device_idx<s_ps_key_cache->remote_device_list.count; device_idx++)
+    {
+        bdaddr bd_addr;
+        uint16 slot;
+        
+        getDeviceBdaddr(device_idx, &bd_addr);
+        slot = hashBdaddr(&bd_addr);
+        
+        while (s_ps_key_cache->remote_device_list.index[slot]!=DEVICE_INDEX_FREE)
+        {
+            slot = (slot + 1) & (PS_REMOTE_DEVICE_INDEX_SIZE-1);
+        }
+        s_ps_key_cache->remote_device_list.index[slot] = (uint8)device_idx;
+    }
+}
+
+
+/****************************************************************************
+NAME
+    rebuildDeviceMru
+
+DESCRIPTION
+    Builds the MRU list from the orderings stored with the paired devices. Devices
+    with an ordering that is missing or repeated go to the end, and the orderings
+    are renumbered so each is the position of its device in the MRU list.
+
+*/
+static void rebuildDeviceMru (void)
+{
+    uint8 *mru = s_ps_key_cache->remote_device_list.mru;
+    uint16 count = s_ps_key_cache->remote_device_list.count;
+    uint16 placed = 0;
+    uint16 ordering;
+    uint16 device_idx;
+    uint16 pos;
+    
+    memset(mru, DEVICE_INDEX_FREE, sizeof(s_ps_key_cache->remote_device_list.mru));
+    
+    for (ordering=MIN_DEVICE_ORDERING; ordering<MIN_DEVICE_ORDERING+count; ordering++)
+    {
+        for (device_idx=0; device_idx<count; device_idx++)
+        {
+            if (getDeviceOrdering(device_idx)==ordering)
+            {
+                mru[placed++] = (uint8)device_idx;
+                break;
+            }
+        }
+    }
+    
+    for (device_idx=0; (device_idx<count) && (placed<count); device_idx++)
+    {
+        for (pos=0; (pos<placed) && (mru[pos]!=device_idx); pos++)
+            ;
+        if (pos==placed)
+        {
+            mru[placed++] = (uint8)device_idx;
+        }
+    }
+    
+    for (pos=0; pos<count; pos++)
+    {
+        setDeviceOrdering(mru[pos], MIN_DEVICE_ORDERING + pos);
+    }
+}
+
+
 /****************************************************************************
 NAME
     findDevice
@@ -343,15 +539,25 @@ RETURNS
 */
 static bool findDevice (uint16 *device_idx, const bdaddr *bd_addr)
 {
-    for (*device_idx=0; *device_idx<s_ps_key_cache->remote_device_list.count; (*device_idx)++)
+    uint16 packed[DEVICE_DATA_SIZE-1];
+    uint16 slot = hashBdaddr(bd_addr);
+    uint16 i;
+    
+    contractBdaddr(bd_addr, packed);
+    
+    for (i=0; i<PS_REMOTE_DEVICE_INDEX_SIZE; i++)
     {
-        bdaddr device_bdaddr;
+        *device_idx = s_ps_key_cache->remote_device_list.index[slot];
         
-        getDeviceBdaddr(*device_idx, &device_bdaddr);
-        if ( BdaddrIsSame(bd_addr, &device_bdaddr) )
+        if ( *device_idx==DEVICE_INDEX_FREE )
+        {
+            break;
+        }
+        if ( isDeviceBdaddr(*device_idx, packed) )
         {
             return TRUE;
         }
+        slot = (slot + 1) & (PS_REMOTE_DEVICE_INDEX_SIZE-1);
     }
 
     return FALSE;
@@ -372,12 +578,10 @@ RETURNS
 */
 static bool findLeastRecentDevice (uint16 *device_idx)
 {
-    for (*device_idx=0; *device_idx<s_ps_key_cache->remote_device_list.count; (*device_idx)++)
+    if ( s_ps_key_cache->remote_device_list.count )
     {
-        if ( getDeviceOrdering(*device_idx)==(MIN_DEVICE_ORDERING + s_ps_key_cache->remote_device_list.count-1) )
-        {
-            return TRUE;
-        }
+        *device_idx = s_ps_key_cache->remote_device_list.mru[s_ps_key_cache->remote_device_list.count-1];
+        return TRUE;
     }
     
     return FALSE;
@@ -454,37 +658,38 @@ NAME
 
 DESCRIPTION
     Sets the paired device at the specified index, to be marked as the most recently used device.
+    Only the devices that were more recent than it move down the list.
     
 RETURNS
-    Bool return value if the the device was set to be the most recent successfully.
+    Bool return value if the ordering of the list changed.
 
 */
 static bool setMostRecentDevice (uint16 device_idx)
 {
-    if ( device_idx < s_ps_key_cache->remote_device_list.count )
+    uint8 *mru = s_ps_key_cache->remote_device_list.mru;
+    uint16 pos;
+    
+    if ( device_idx >= s_ps_key_cache->remote_device_list.count )
     {
-        uint16 idx;
-        uint16 device_ordering = getDeviceOrdering(device_idx);
-        
-        for (idx=0; idx<s_ps_key_cache->remote_device_list.count; idx++)
-        {
-            if ( idx!=device_idx )
-            {
-                uint16 ordering = getDeviceOrdering(idx);
-                
-                if ( !device_ordering || (ordering < device_ordering) )
-                {
-                    setDeviceOrdering(idx, ordering+1);
-                }
-            }
-        }
-        
-        setDeviceOrdering(device_idx, MIN_DEVICE_ORDERING);
-
-        return TRUE;
+        return FALSE;
     }
     
-    return FALSE;
+    /* The ordering of a device is its position in the MRU list */
+    pos = getDeviceOrdering(device_idx) - MIN_DEVICE_ORDERING;
+    if ( pos==0 )
+    {
+        return FALSE;
+    }
+    
+    for (; pos>0; pos--)
+    {
+        mru[pos] = mru[pos-1];
+        setDeviceOrdering(mru[pos], MIN_DEVICE_ORDERING + pos);
+    }
+    mru[0] = (uint8)device_idx;
+    setDeviceOrdering(device_idx, MIN_DEVICE_ORDERING);
+    
+    return TRUE;
 }
 
 
@@ -584,12 +789,10 @@ DESCRIPTION
 */
 bool configureFindMostRecentDevice (uint16 *device_idx)
 {
-    for (*device_idx=0; *device_idx < s_ps_key_cache->remote_device_list.count; (*device_idx)++)
+    if ( s_ps_key_cache->remote_device_list.count )
     {
-        if ( getDeviceOrdering(*device_idx)==MIN_DEVICE_ORDERING )
-        {
-            return TRUE;
-        }
+        *device_idx = s_ps_key_cache->remote_device_list.mru[0];
+        return TRUE;
     }
     
     return FALSE;
@@ -660,6 +863,8 @@ DESCRIPTION
 void configureGetConfigCache (void)
 {
     cacheLoad();
+    rebuildDeviceIndex();
+    rebuildDeviceMru();
 }
 
 
@@ -745,8 +950,16 @@ DESCRIPTION
 bool configureResetPairedDeviceListBuffer(void)
 {
     PsStore(PSKEY_REMOTE_DEVICE_LIST, 0, 0);
+    PsStore(PSKEY_REMOTE_SERVICE_LIST, 0, 0);
     memset(s_ps_key_cache->remote_device_list.buffer, 0, PS_REMOTE_DEVICE_LIST_MAX_SIZE);
+    memset(s_ps_key_cache->remote_service_list.buffer, 0, sizeof(s_ps_key_cache->remote_service_list.buffer));
     s_ps_key_cache->remote_device_list.count = 0;
+    s_ps_key_cache->remote_device_list.dirty = FALSE;
+    s_ps_key_cache->remote_device_list.services_dirty = FALSE;
+    s_ps_key_cache->remote_device_list.added = FALSE;
+    s_ps_key_cache->ps_writes += 2;
+    rebuildDeviceIndex();
+    MessageCancelAll(&the_app->task, APP_PS_FLUSH_TIMER);
     
     return TRUE;
 }
@@ -887,26 +1100,13 @@ bool configureGetBdaddrNextRecentDevice (bdaddr *bd_addr)
     
     if ( !BdaddrIsZero(bd_addr) && findDevice(&device_idx, bd_addr) )
     {
-        uint16 device_ordering = getDeviceOrdering(device_idx);
+        uint16 pos = getDeviceOrdering(device_idx) - MIN_DEVICE_ORDERING + 1;
         
-        if ( device_ordering < (MIN_DEVICE_ORDERING + s_ps_key_cache->remote_device_list.count-1) )
+        if ( pos < s_ps_key_cache->remote_device_list.count )
         {
-            uint16 idx;
+            getPairedDevice(s_ps_key_cache->remote_device_list.mru[pos], bd_addr, &pin_idx, &remote_profiles);
             
-            for (idx=0; idx<s_ps_key_cache->remote_device_list.count; idx++)
-            {
-                if ( idx!=device_idx )
-                {
-                    uint16 ordering = getDeviceOrdering(idx);
-                    
-                    if ( ordering == device_ordering+1 )
-                    {
-                        getPairedDevice(idx, bd_addr, &pin_idx, &remote_profiles);
-                        
-                        return TRUE;
-                    }
-                }
-            }
+            return TRUE;
         }
 
         return FALSE;
@@ -1009,10 +1209,54 @@ DESCRIPTION
 void configureClearRecentDeviceList (void)
 {
     s_ps_key_cache->remote_device_list.count = 0;
+    s_ps_key_cache->remote_device_list.dirty = TRUE;
+    rebuildDeviceIndex();
     cacheStore();
 }
 
 
+/****************************************************************************
+NAME
+    configureFlushPairedDeviceList
+
+DESCRIPTION
+    Writes any changes to the paired device list held in memory to PS now.
+    Called before powering off.
+    
+*/
+void configureFlushPairedDeviceList (void)
+{
+    if (s_ps_key_cache->remote_device_list.dirty || s_ps_key_cache->remote_device_list.services_dirty)
+    {
+        cacheStore();
+    }
+}
+
+
+/****************************************************************************
+NAME
+    configureHandlePsFlushTimer
+
+DESCRIPTION
+    The paired device list has stopped changing. Write it to PS unless audio is
+    being sent, when the write is put off until the adaptor is idle. A newly
+    paired device is written anyway, it would be forgotten if power was lost.
+    
+*/
+void configureHandlePsFlushTimer (void)
+{
+    if (!s_ps_key_cache->remote_device_list.added &&
+        ((the_app->app_state == AppStateStreaming) || (the_app->app_state == AppStateInCall)))
+    {
+        cacheStoreLater();
+    }
+    else
+    {
+        configureFlushPairedDeviceList();
+    }
+}
+
+
 /****************************************************************************
 NAME
     configureStoreCurrentPairedDevice
@@ -1024,27 +1268,81 @@ DESCRIPTION
 bool configureStoreCurrentPairedDevice (devInstanceTaskData *inst)
 {
     uint16 device_idx;
+    uint16 info;
+    bool new_device = FALSE;
     
     if ( !findDevice(&device_idx, &inst->bd_addr) )
     {    /* Can't find an existing entry for this bdaddr */
         if (s_ps_key_cache->remote_device_list.count < PS_REMOTE_DEVICE_LIST_MAX_ENTRIES)
-        {    /* Create a new entry */
+        {    /* Create a new entry, the least recent until it is made the most recent below */
             device_idx = s_ps_key_cache->remote_device_list.count;
             s_ps_key_cache->remote_device_list.count++;
+            s_ps_key_cache->remote_device_list.mru[device_idx] = (uint8)device_idx;
+            setDeviceOrdering(device_idx, MIN_DEVICE_ORDERING + device_idx);
         }
         else
         {    /* Overwrite the oldest entry */
             findLeastRecentDevice(&device_idx);
         }
+        /* The services of the device being replaced don't apply */
+        setDeviceRfcommChannel(device_idx, 0);
+        new_device = TRUE;
     }
     
+    info = s_ps_key_cache->remote_device_list.buffer[(device_idx*DEVICE_DATA_SIZE)+DEVICE_INFO_OFFSET];
     setPairedDevice(device_idx, &inst->bd_addr, inst->pin_idx, inst->remote_profiles);
-    setMostRecentDevice(device_idx);
+    if (new_device)
+    {
+        rebuildDeviceIndex();
+        s_ps_key_cache->remote_device_list.dirty = TRUE;
+        s_ps_key_cache->remote_device_list.services_dirty = TRUE;
+        s_ps_key_cache->remote_device_list.added = TRUE;
+    }
     
-    cacheStore();
+    /* Reconnecting the most recent device again leaves the list as it was */
+    if (setMostRecentDevice(device_idx) || (info != s_ps_key_cache->remote_device_list.buffer[(device_idx*DEVICE_DATA_SIZE)+DEVICE_INFO_OFFSET]))
+    {
+        s_ps_key_cache->remote_device_list.dirty = TRUE;
+    }
+    
+    /* Keep the channel the HF was last reached on, an SLC the HF made leaves it unknown */
+    if (inst->aghfp_rfc_channel && (inst->aghfp_rfc_channel != getDeviceRfcommChannel(device_idx)))
+    {
+        DEBUG_CONFIG(("    RFCOMM channel %u stored\n", inst->aghfp_rfc_channel));
+        setDeviceRfcommChannel(device_idx, inst->aghfp_rfc_channel);
+        s_ps_key_cache->remote_device_list.services_dirty = TRUE;
+    }
+    
+    if (s_ps_key_cache->remote_device_list.dirty || s_ps_key_cache->remote_device_list.services_dirty)
+    {
+        cacheStoreLater();
+    }
     
     return TRUE;
 }
+
+
+/****************************************************************************
+NAME
+    configureGetRemoteRfcommChannel
+
+DESCRIPTION
+    Returns the HFP/HSP RFCOMM server channel the paired device was last connected
+    on, so the SLC can be made without a service search. Returns 0 if the device
+    is not paired or the channel is not known.
+    
+*/
+uint8 configureGetRemoteRfcommChannel (const bdaddr *bd_addr)
+{
+    uint16 device_idx;
+    
+    if ( findDevice(&device_idx, bd_addr) )
+    {
+        return getDeviceRfcommChannel(device_idx);
+    }
+    
+    return 0;
+}
     
 
 /****************************************************************************
@@ -36,7 +36,8 @@ enum
     PSKEY_BATTERY_CONFIG        = 13,
     PSKEY_MP3_CODEC_CONFIGURATION          = 14,
     PSKEY_SBC_CODEC_CONFIGURATION          = 15,
-    PSKEY_FASTSTREAM_CODEC_CONFIGURATION   = 16
+    PSKEY_FASTSTREAM_CODEC_CONFIGURATION   = 16,
+    PSKEY_REMOTE_SERVICE_LIST   = 17
 };
 
 
@@ -72,8 +73,14 @@ bool configureGetDeviceInfo (const bdaddr *bd_addr, uint16 *pin_idx, mvdProfiles
 
 void configureClearRecentDeviceList (void);
 
+void configureFlushPairedDeviceList (void);
+
+void configureHandlePsFlushTimer (void);
+
 bool configureStoreCurrentPairedDevice (devInstanceTaskData *inst);
 
+uint8 configureGetRemoteRfcommChannel (const bdaddr *bd_addr);
+
 bool configureIsPinRequested (devInstanceTaskData *inst);
 
 bool configureSetPinAuthorised (bdaddr *bd_addr, bool authorised);
@@ -14,6 +14,7 @@ DESCRIPTION
 #include "audioAdaptor_event_handler.h"
 #include "audioAdaptor_a2dp.h"
 #include "audioAdaptor_cl_msg_handler.h"
+#include "audioAdaptor_trace.h"
 
 #include <stdlib.h>
 #include <bdaddr.h>
@@ -64,16 +65,20 @@ static void devInstanceInit(devInstanceTaskData *theDev)
     
     /* Initialise AGHFP variables */ 
     theDev->audio_sink = 0;
+    theDev->aghfp_rfc_channel = 0;
     
     /* Initialise profile variables */ 
     theDev->remote_profiles = ProfileNone;
     theDev->responding_profiles = ProfileNone;    
+    theDev->connect_start = 0;
     theDev->paired_list_read = FALSE;
     theDev->available_profiles_connected = FALSE;    
     theDev->a2dp_closing = FALSE;
     theDev->a2dp_reopen = FALSE;    
     theDev->sbc_min_bitpool = SBC_BITPOOL_MIN;
     theDev->sbc_max_bitpool = SBC_BITPOOL_HIGH_QUALITY; 
+    theDev->sbc_bitpool = 0;
+    theDev->a2dp_packet_size = 0;
     theDev->role = hci_role_dont_care;
 }
 
@@ -251,6 +256,8 @@ void devInstanceHandleMessage(Task task, MessageId id, Message message)
 {
     devInstanceTaskData *theInst = (devInstanceTaskData *)task;
     
+    TRACE_INSTANCE_MESSAGE(theInst, id);
+    
     /* Route message correctly for this device */ 
     if (A2DP_MESSAGE(id))    
     {
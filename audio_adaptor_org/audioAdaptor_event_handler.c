@@ -13,6 +13,7 @@ DESCRIPTION
 #include "audioAdaptor_aghfp_slc.h"
 #include "audioAdaptor_aghfp_call.h"
 #include "audioAdaptor_a2dp_slc.h"
+#include "audioAdaptor_a2dp_msg_handler.h"
 #include "audioAdaptor_avrcp_slc.h"
 #include "audioAdaptor_events.h"
 #include "audioAdaptor_event_handler.h"
@@ -26,6 +27,7 @@ DESCRIPTION
 #include "audioAdaptor_powermanager.h"
 #include "audioAdaptor_charger.h"
 #include "audioAdaptor_battery.h"
+#include "audioAdaptor_trace.h"
 #include "leds.h"
 
 #include <ps.h>
@@ -961,6 +963,9 @@ static void handleAppPowerOffReq(void)
         the_app->PowerOffIsEnabled     = FALSE;
         the_app->audioAdaptorPoweredOn = FALSE;
         
+        /* Write any paired device changes still held in memory */
+        configureFlushPairedDeviceList();
+        
         /* Make sure all connection activity is stopped */
         profileSlcCheckPoweredOff(NULL);
         
@@ -1149,9 +1154,9 @@ static void handleAppDeviceConnectSecondReq(void)
     bdaddr addr;
             
     /* if no devices connected - connect as previously
-       if 1 device connected - if another devices in paired list then connect to them
+       if fewer than MAX_A2DP_SINKS connected - if another devices in paired list then connect to them
                              - if no other devices then discover new device and connect it
-       if 2 devices connected - do nothing */
+       if MAX_A2DP_SINKS devices connected - do nothing */
     active_connections = 0;
     for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
     {
@@ -1161,6 +1166,9 @@ static void handleAppDeviceConnectSecondReq(void)
                 active_connections++;                
         }
     }
+    if (active_connections >= MAX_NUM_DEV_CONNECTIONS)
+        return;
+    
     switch (active_connections)
     {
         case 0:
@@ -1170,7 +1178,7 @@ static void handleAppDeviceConnectSecondReq(void)
             MessageSend(&the_app->task, APP_DEVICE_CONNECT_REQ, message);
             break;
         }
-        case 1:               
+        default:               
         {
             /* if another device */
             if (configureGetBdaddrNextDisconnectedDevice(&addr))
@@ -1188,10 +1196,6 @@ static void handleAppDeviceConnectSecondReq(void)
             }                
             break;
         }
-        default:
-        {
-            break;
-        }
     }
 #endif        
 }
@@ -1548,6 +1552,8 @@ void kickCommAction (mvdCommAction comm_action)
 
         DEBUG_EVENT(("AppState(%s)\n",s_app_states[the_app->app_state]));
         
+        TRACE_COMM_ACTION(the_app->comm_action, comm_action);
+        
         command_to_process = FALSE;
         
         switch (comm_action)
@@ -1838,6 +1844,12 @@ void eventHandleAppMessage(MessageId id, Message message)
             the_app->app_reconnect_timer_expired = TRUE;
             break;
         }
+        case APP_PS_FLUSH_TIMER:
+        {
+            DEBUG_EVENT(("APP_PS_FLUSH_TIMER\n"));
+            configureHandlePsFlushTimer();
+            break;
+        }
         case APP_HID_SEQUENCE:
         {
             DEBUG_EVENT(("APP_HID_SEQUENCE\n"));
@@ -1928,6 +1940,12 @@ void eventHandleInstanceMessage(devInstanceTaskData *inst, MessageId id, Message
             profileSlcConnectComplete(inst, ((APP_CONNECT_CFM_T *)message)->success);
             break;
         }
+        case APP_SBC_RATE_TIMER:
+        {
+            DEBUG_EVENT(("APP_SBC_RATE_TIMER inst:[0x%x]\n", (uint16)inst));
+            a2dpMsgSbcRateSample(inst);
+            break;
+        }
         default:
         {
             break;
@@ -113,6 +113,36 @@ static const optional_codec_type optionalCodecList[NUM_SOURCE_TYPE][NUM_OPTIONAL
 
 
 
+#ifdef DUAL_STREAM
+/****************************************************************************
+NAME 
+    initMultiStreamSep
+
+DESCRIPTION
+    Returns the Stream End Point config of a codec for the 2nd or a later
+    sink. Sinks after the 2nd get a copy of the 2nd sink's config with the
+    SEID and Kalimba resource ID moved on, so every sink has its own SEPs.
+    The A2DP library keeps the pointer for as long as it runs, so the copy
+    is never freed.
+ 
+*/
+static const sep_config_type *initMultiStreamSep(const sep_config_type *ds_config, uint8 sink)
+{
+    sep_config_type *config;
+    
+    if (sink == 1)
+        return ds_config;
+    
+    config = (sep_config_type *)PanicUnlessMalloc(sizeof(sep_config_type));
+    *config = *ds_config;
+    config->seid += sink - 1;
+    config->resource_id += sink - 1;
+    
+    return config;
+}
+#endif
+
+
 /****************************************************************************
   MAIN FUNCTIONS
 */
@@ -129,6 +159,9 @@ void initA2dp (void)
 {
     uint8 source_codec_enabled;
     uint8 i;
+#ifdef DUAL_STREAM
+    uint8 sink;
+#endif
     
     sep_data_type seps[NUM_SEPS];
     uint8 number_of_seps = 0;
@@ -166,9 +199,12 @@ void initA2dp (void)
         seps[number_of_seps].in_use = FALSE; 
         number_of_seps++;
 #ifdef DUAL_STREAM
-        seps[number_of_seps].sep_config = &sbc_sep_ds_analogue;
-        seps[number_of_seps].in_use = FALSE; 
-        number_of_seps++;
+        for (sink = 1; sink < MAX_A2DP_SINKS; sink++)
+        {
+            seps[number_of_seps].sep_config = initMultiStreamSep(&sbc_sep_ds_analogue, sink);
+            seps[number_of_seps].in_use = FALSE; 
+            number_of_seps++;
+        }
 #endif
     }
     
@@ -191,9 +227,12 @@ void initA2dp (void)
 #ifdef DUAL_STREAM
             if (a2dpSeidIsFaststream(optionalCodecList[the_app->a2dp_source][i].seid))
             {
-                seps[number_of_seps].sep_config = &faststream_sep_ds_analogue;
-                seps[number_of_seps].in_use = FALSE; 
-                number_of_seps++;
+                for (sink = 1; sink < MAX_A2DP_SINKS; sink++)
+                {
+                    seps[number_of_seps].sep_config = initMultiStreamSep(&faststream_sep_ds_analogue, sink);
+                    seps[number_of_seps].in_use = FALSE; 
+                    number_of_seps++;
+                }
             }
 #endif            
         }
@@ -236,6 +275,9 @@ uint16 initSeidConnectPriority(uint8 *seid_list)
 {
     uint16 size_seids = 0;
     uint16 i;
+#ifdef DUAL_STREAM   
+    uint16 sink;
+#endif
     
     for (i = 0; i < NUM_OPTIONAL_CODECS; i++)
     {
@@ -246,8 +288,11 @@ uint16 initSeidConnectPriority(uint8 *seid_list)
 #ifdef DUAL_STREAM   
             if (a2dpSeidIsFaststream(optionalCodecList[the_app->a2dp_source][i].seid))
             {
-                seid_list[size_seids] = FASTSTREAM_DS_SEID;
-                size_seids += 1;
+                for (sink = 1; sink < MAX_A2DP_SINKS; sink++)
+                {
+                    seid_list[size_seids] = FASTSTREAM_SEID + sink;
+                    size_seids += 1;
+                }
             }
 #endif             
         }
@@ -257,8 +302,11 @@ uint16 initSeidConnectPriority(uint8 *seid_list)
     size_seids += 1;
     
 #ifdef DUAL_STREAM   
-    seid_list[size_seids] = SBC_DS_SEID;
-    size_seids += 1;
+    for (sink = 1; sink < MAX_A2DP_SINKS; sink++)
+    {
+        seid_list[size_seids] = SBC_SEID + sink;
+        size_seids += 1;
+    }
 #endif    
 
     return size_seids;
@@ -190,9 +190,16 @@ DESCRIPTION
 #define KALIMBA_CODEC_TYPE_MESSAGE               0x7303
 
 /* ------------------------------------------------------------------------ */
-/* Size of inquiry results buffer */
+/* Size of inquiry results buffer, and of the hash used to find a result from its address */
 
 #define INQUIRY_SCAN_BUFFER_SIZE 10
+#define INQUIRY_SCAN_HASH_SIZE   16
+
+/* ------------------------------------------------------------------------ */
+/* Connect to a device as soon as its EIR shows it has the profiles needed, while
+   the inquiry carries on finding the devices to fall back to */
+
+#define INQUIRY_EARLY_CONNECT
 
 /* ------------------------------------------------------------------------ */
 /* Enable SCO/eSCO packet support */
@@ -207,28 +214,45 @@ DESCRIPTION
 
 #ifdef DUAL_STREAM
 
-    #define MAX_NUM_DEV_CONNECTIONS 2
+    /* The number of A2DP sinks streamed to at once. Each has its own device instance,
+       Stream End Points and Kalimba codec output port, the kap has 2 ports unless it
+       is built with CODEC_OUT_PORTS_4. */
+    #ifndef MAX_A2DP_SINKS
+        #define MAX_A2DP_SINKS      2
+    #endif
+    #if (MAX_A2DP_SINKS < 2) || (MAX_A2DP_SINKS > 4)
+        #error "MAX_A2DP_SINKS must be 2 to 4"
+    #endif
+    /* The sinks past the second are connected to Kalimba ports 4 and 5, which only a kap
+       built with CODEC_OUT_PORTS_4 copies to. Select the "DSP codec output ports" option
+       of both the VM and the sbc_encoder kap projects. */
+    #if (MAX_A2DP_SINKS > 2) && !defined(CODEC_OUT_PORTS_4)
+        #error "MAX_A2DP_SINKS above 2 needs CODEC_OUT_PORTS_4, in this build and in the kap build"
+    #endif
+
+    #define MAX_NUM_DEV_CONNECTIONS MAX_A2DP_SINKS
 
-    #define KALIMBA_DS_RESOURCE_ID  2                  /*!< @brief Resource ID for Kalimba for 2nd set of Stream End Points when using DualStream */
+    #define KALIMBA_DS_RESOURCE_ID  2                  /*!< @brief Resource ID for Kalimba for 2nd set of Stream End Points when using DualStream, the sets for further sinks follow on */
 
-    /* Local stream end point codec IDs */
+    /* Local stream end point codec IDs, the IDs of a codec for the 2nd and later sinks follow on from its first */
     #define SBC_SEID                1                  /*!< @brief Local Stream End Point ID for SBC codec */
     #define SBC_DS_SEID             2                  /*!< @brief Local Stream End Point ID for SBC codec */    
+    #define SBC_LAST_SEID           (SBC_SEID + MAX_A2DP_SINKS - 1)
 
     #ifdef INCLUDE_MP3_ENCODER_PLUGIN
-        #define MP3_SEID                3                  /*!< @brief Local Stream End Point ID for MP3 codec */
-        #define FASTSTREAM_SEID         4                  /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
-        #define FASTSTREAM_DS_SEID      5                  /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
+        #define MP3_SEID                (SBC_LAST_SEID + 1)   /*!< @brief Local Stream End Point ID for MP3 codec */
+        #define FASTSTREAM_SEID         (SBC_LAST_SEID + 2)   /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
     #else
-        #define FASTSTREAM_SEID         3                  /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
-        #define FASTSTREAM_DS_SEID      4                  /*!< @brief Local Stream End Point ID for FASTSTREAM codec */        
+        #define FASTSTREAM_SEID         (SBC_LAST_SEID + 1)   /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
     #endif
+    #define FASTSTREAM_DS_SEID      (FASTSTREAM_SEID + 1)     /*!< @brief Local Stream End Point ID for FASTSTREAM codec */
+    #define FASTSTREAM_LAST_SEID    (FASTSTREAM_SEID + MAX_A2DP_SINKS - 1)
 
-    #define NUM_SEPS              (FASTSTREAM_DS_SEID)  /*!< @brief The total number of SEPs */
-    #define NUM_OPTIONAL_CODECS   (NUM_SEPS-3)
+    #define NUM_SEPS              (FASTSTREAM_LAST_SEID)  /*!< @brief The total number of SEPs */
+    #define NUM_OPTIONAL_CODECS   (NUM_SEPS - 2*MAX_A2DP_SINKS + 1)
     
-    #define a2dpSeidIsSbc(seid)           ((seid == SBC_SEID) || (seid == SBC_DS_SEID))
-    #define a2dpSeidIsFaststream(seid)    ((seid == FASTSTREAM_SEID) || (seid == FASTSTREAM_DS_SEID))
+    #define a2dpSeidIsSbc(seid)           (((seid) >= SBC_SEID) && ((seid) <= SBC_LAST_SEID))
+    #define a2dpSeidIsFaststream(seid)    (((seid) >= FASTSTREAM_SEID) && ((seid) <= FASTSTREAM_LAST_SEID))
 
 #else /* DUAL_STREAM not defined */
 
@@ -376,9 +400,12 @@ typedef struct
 #define PS_PIN_CODE_LIST_MAX_SIZE  4
 #define PS_BATTERY_CONFIG_SIZE     5 
 
-#define PS_REMOTE_DEVICE_LIST_MAX_ENTRIES 5
+#define PS_REMOTE_DEVICE_LIST_MAX_ENTRIES 8      /* As many as the connection library keeps link keys for */
 #define PS_REMOTE_DEVICE_LIST_ELEMENT_SIZE 4
+#define PS_REMOTE_DEVICE_INDEX_SIZE 16           /* Power of 2, at least twice the entries */
 #define PS_REMOTE_DEVICE_LIST_MAX_SIZE (PS_REMOTE_DEVICE_LIST_MAX_ENTRIES * PS_REMOTE_DEVICE_LIST_ELEMENT_SIZE)
+#define PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE 1
+#define PS_REMOTE_SERVICE_LIST_MAX_SIZE (PS_REMOTE_DEVICE_LIST_MAX_ENTRIES * PS_REMOTE_SERVICE_LIST_ELEMENT_SIZE)
 #define PS_HID_CONFIG_SIZE     8
 #define PS_HID_MAPPING_SIZE    (MaxAppEvents)
 #define PS_LED_CONFIG_ELEMENT_SIZE 2
@@ -403,8 +430,18 @@ typedef struct
     {
         uint16 count;
         uint16 buffer[PS_REMOTE_DEVICE_LIST_MAX_SIZE];
+        uint8 index[PS_REMOTE_DEVICE_INDEX_SIZE];       /* Device index by Bluetooth address hash, 0xff if free */
+        uint8 mru[PS_REMOTE_DEVICE_LIST_MAX_ENTRIES];   /* Device indexes, most recently used first */
+        unsigned dirty:1;                               /* Device list changed since it was written to PS */
+        unsigned services_dirty:1;                      /* Service list changed since it was written to PS */
+        unsigned added:1;                               /* A device not yet in PS was added */
     } remote_device_list;
     
+    struct
+    {
+        uint16 buffer[PS_REMOTE_SERVICE_LIST_MAX_SIZE];   /* Same index as remote_device_list */
+    } remote_service_list;
+    
     struct
     {
         uint16 count;
@@ -417,6 +454,8 @@ typedef struct
         uint16 buffer[PS_HID_MAPPING_SIZE];
     } hid_mapping;
     
+    uint16 ps_writes;       /* PS keys written or erased since boot */
+    
 } mvdPsKeyData;
 
 
@@ -454,8 +493,13 @@ typedef struct
 
 typedef struct
 {
-    uint16             read_idx;
-    uint16             write_idx;
+    uint8              count;                               /* Results waiting in the heap */
+    uint8              used;                                /* Slots holding a result, waiting or already loaded */
+    unsigned           running:1;                           /* Inquiry has not yet reported it is ready */
+    uint8              heap[INQUIRY_SCAN_BUFFER_SIZE];      /* Slots of the waiting results, a min-heap on path loss */
+    uint8              pos[INQUIRY_SCAN_BUFFER_SIZE];       /* Heap position of each slot */
+    uint8              hash[INQUIRY_SCAN_HASH_SIZE];        /* First slot of each address hash chain */
+    uint8              next[INQUIRY_SCAN_BUFFER_SIZE];      /* Next slot in the chain */
     bdaddr             buffer[INQUIRY_SCAN_BUFFER_SIZE];
     mvdEirData         eir_data[INQUIRY_SCAN_BUFFER_SIZE];
 } mvdInquiryScanData;
@@ -526,6 +570,7 @@ typedef struct
     unsigned format:8;
     uint16 packet_size;
     Sink media_sink_b;
+    uint16 packet_size_b;       /* RTP packet size for media_sink_b, the MTUs of the two links can differ */
 } source_codec_data_type;
 
 
@@ -533,6 +578,7 @@ typedef struct
 {
     bool connect_sink;
     Sink media_sink;
+    uint16 packet_size;         /* RTP packet size for the media sink being connected */
 } dualstream_mode_params;
 
 
@@ -614,6 +660,7 @@ typedef struct devInstanceData
     Sink            a2dp_media_sink;
     
     uint8           a2dp_seid;    
+    uint8           aghfp_rfc_channel;      /* Remote HFP/HSP server channel learnt this connection, 0 if not */
     
     uint16          start_pin_idx;
     uint16          pin_idx;
@@ -637,12 +684,21 @@ typedef struct devInstanceData
     unsigned        a2dp_reopen_tries:3;
     
     unsigned        a2dp_audio_quality:3;
-    unsigned        a2dp_reopen_codec:3; 
-    unsigned        unused:10;
+    unsigned        a2dp_reopen_codec:4; 
+    unsigned        sbc_good_samples:3;     /* Consecutive good link samples since the bitpool last changed */
+    unsigned        unused:6;
     
     unsigned        sbc_min_bitpool:8; 
     unsigned        sbc_max_bitpool:8;
     
+    unsigned        sbc_bitpool:8;          /* Bitpool the rate controller wants for this link, 0 when not running */
+    unsigned        sbc_backlog:8;          /* Percentage of the media sink holding audio at the last sample */
+    int16           sbc_rssi;               /* RSSI of the link at the last sample */
+    uint16          sbc_max_slack;          /* Most slack seen in the media sink, taken as empty */
+    uint16          a2dp_packet_size;       /* RTP packet size for this link's media channel */
+    
+    uint32          connect_start;          /* VmGetClock when the local device started connecting the profiles */
+    
 } devInstanceTaskData;  
 
 
@@ -723,7 +779,7 @@ typedef struct
     mvdProfiles      supported_profiles:4;        /* Which profiles (aghsp/aghfp/a2dp/avrcp) local device supports */
     
     mvdProfiles      remote_profiles:4;        /* Which profiles (hsp/hfp) remote device supports */
-    mvdProfiles      connecting_profile:4;     /* Profile being connected by local device */
+    mvdProfiles      connecting_profile:4;     /* Profiles being connected by local device */
     unsigned         a2dp_active_seid:8;
 
 } mvdTaskData;
@@ -778,6 +834,8 @@ enum
     APP_CONNECT_A2DP_AUDIO,
     APP_PROCESS_INQUIRE_RESULT,
     APP_CONNECT_CFM,
+    APP_SBC_RATE_TIMER,         /* sample the link of a device streaming SBC and adjust the bitpool */
+    APP_PS_FLUSH_TIMER,         /* write the paired device list to PS if it has changed */
     
     APP_MESSAGE_TOP
 };
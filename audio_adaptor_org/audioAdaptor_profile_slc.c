@@ -24,6 +24,7 @@ DESCRIPTION
 #include <string.h>
 #include <panic.h>
 #include <stdlib.h>
+#include <vm.h>
 
 
 #define MAX_PROFILE_CONNECT_PERIOD_MS  20000
@@ -59,7 +60,7 @@ DESCRIPTION
 */
 static void stopAppProfileConnectTimer (devInstanceTaskData *inst)
 {
-    DEBUG_CONN(("APP_PROFILE_CONNECT_TIME Cancelled during profile %x connection\n", the_app->connecting_profile));
+    DEBUG_CONN(("APP_PROFILE_CONNECT_TIME Cancelled\n"));
     MessageCancelAll(&inst->task, APP_PROFILE_CONNECT_TIMER);
     the_app->connecting_profile = ProfileNone;
 }
@@ -123,6 +124,99 @@ static uint16 getNumberDevicesConnected(void)
 }
 
 
+/****************************************************************************
+NAME
+    connectProfiles
+
+DESCRIPTION
+    Starts the connection of the profiles the remote device supports that have not responded
+    and are not already being connected, in the order AGHFP, A2DP, AVRCP. When concurrent is
+    FALSE only the first profile that can be started is connected. Returns the profiles started.
+    
+*/
+static mvdProfiles connectProfiles (devInstanceTaskData *inst, bool concurrent)
+{
+    mvdProfiles started = ProfileNone;
+    
+    /* Check remote_profiles bit mask for support by remote device */
+    /* Check responding_profiles bit mask for a previous connect attempt - if remote device has initiated connection that will be */
+    /* detected in actual profile connect function */
+    if ( (the_app->supported_profiles & (ProfileAghsp | ProfileAghfp)) && 
+         (inst->remote_profiles & (ProfileAghsp | ProfileAghfp)) && 
+         !(inst->responding_profiles & (ProfileAghsp | ProfileAghfp)) &&
+         !(the_app->connecting_profile & (ProfileAghsp | ProfileAghfp)) )
+    {
+        if (aghfpSlcConnect(inst))
+        {
+            started |= (the_app->supported_profiles & (ProfileAghsp | ProfileAghfp));
+            if (!concurrent)
+                return started;
+        }            
+    }
+    
+    if ( (the_app->supported_profiles & ProfileA2dp) && 
+         (inst->remote_profiles & ProfileA2dp) && 
+         !(inst->responding_profiles & ProfileA2dp) &&
+         !(the_app->connecting_profile & ProfileA2dp) )
+    { 
+        /* start a2dp profile connection */
+        if (a2dpSlcConnect(inst))
+        {
+            started |= ProfileA2dp;
+            if (!concurrent)
+                return started;
+        }                        
+    }
+    
+    if ( (the_app->supported_profiles & ProfileAvrcp) && 
+         (inst->remote_profiles & ProfileAvrcp)  && 
+         !(inst->responding_profiles & ProfileAvrcp) &&
+         !(the_app->connecting_profile & ProfileAvrcp) )
+    {
+        if (avrcpSlcConnect(inst))
+        {
+            started |= ProfileAvrcp;
+        }            
+    }
+    
+    return started;
+}
+
+
+/****************************************************************************
+NAME
+    canConnectConcurrently
+
+DESCRIPTION
+    Returns TRUE if the remaining profiles of a device can be connected at the same time.
+    Connecting all profiles simultaneously can cause IOP issues with a number of existing
+    stereo headsets, and the PIN list can only be tried one connection at a time, so this
+    is only done on the first attempt to an authorised device. Retries keep to one profile
+    at a time.
+    
+*/
+static bool canConnectConcurrently (devInstanceTaskData *inst)
+{
+    return (the_app->connect_attempts == 0) && inst->pin_authorised;
+}
+
+
+/****************************************************************************
+NAME
+    isAclConnected
+
+DESCRIPTION
+    Returns TRUE if a profile of the device is connected, so the ACL is known to be up.
+    
+*/
+static bool isAclConnected (devInstanceTaskData *inst)
+{
+    return (getAghfpState(inst) >= AghfpStateConnected) ||
+           (inst->a2dp_sig_sink != 0) ||
+           (getAvrcpState(inst) == AvrcpStateConnected);
+}
+
+
 /****************************************************************************
 NAME
     appDisconnectCfm
@@ -247,51 +341,19 @@ void profileSlcConnectReq (void)
             }
             
             
-            /* Connecting all profiles simultaneously can cause IOP issues with a number of existing stereo headsets. */
-            /* Check remote_profiles bit mask for support by remote device */
-            /* Check responding_profiles bit mask for a previous connect attempt - if remote device has initiated connection that will be */
-            /* detected in actual profile connect function */
-            if ( (the_app->supported_profiles & (ProfileAghsp | ProfileAghfp)) && 
-                 (inst->remote_profiles & (ProfileAghsp | ProfileAghfp)) && 
-                 !(inst->responding_profiles & (ProfileAghsp | ProfileAghfp)) )
-            {
-                if (aghfpSlcConnect(inst))
-                {
-                    setAppState(AppStateConnecting);
-                    the_app->s_connect_attempts  = 0;
-                    startAppProfileConnectTimer(inst);
-                    the_app->connecting_profile = (the_app->supported_profiles & (ProfileAghsp | ProfileAghfp));
-                    break;
-                }            
-            }
-            
-            if ( (the_app->supported_profiles & ProfileA2dp) && 
-                 (inst->remote_profiles & ProfileA2dp) && 
-                 !(inst->responding_profiles & ProfileA2dp) )
-            { 
-                /* start a2dp profile connection */
-                if (a2dpSlcConnect(inst))
-                {
-                    setAppState(AppStateConnecting);
-                    the_app->s_connect_attempts  = 0;
-                    startAppProfileConnectTimer(inst);
-                    the_app->connecting_profile  = ProfileA2dp;
-                    break;
-                }                        
-            }
+            /* The first profile pages the device, the rest follow together once the ACL is up 
+               (see profileSlcAclOpened). If the ACL is already up they can all start now. */
+            the_app->connecting_profile = ProfileNone;
+            the_app->connecting_profile = connectProfiles(inst, canConnectConcurrently(inst) && isAclConnected(inst));
             
-            if ( (the_app->supported_profiles & ProfileAvrcp) && 
-                 (inst->remote_profiles & ProfileAvrcp)  && 
-                 !(inst->responding_profiles & ProfileAvrcp) )
+            if (the_app->connecting_profile != ProfileNone)
             {
-                if (avrcpSlcConnect(inst))
-                {
-                    setAppState(AppStateConnecting);
-                    the_app->s_connect_attempts  = 0;
-                    startAppProfileConnectTimer(inst);
-                    the_app->connecting_profile  = ProfileAvrcp;
-                    break;
-                }            
+                setAppState(AppStateConnecting);
+                the_app->s_connect_attempts  = 0;
+                startAppProfileConnectTimer(inst);
+                inst->connect_start = VmGetClock();
+                DEBUG_CONN(("    connecting profiles %x\n", the_app->connecting_profile));
+                break;
             }
             
             /* Connection to this device couldn't be initiated */
@@ -471,8 +533,21 @@ void profileSlcConnectCfm (devInstanceTaskData *inst, mvdProfiles profile, bool
 
    DEBUG_CONN(("profileSlcConnectCfm conn'd:%x resp'd:%x all_resp'd:%x\n",connected_profiles, inst->responding_profiles, all_responded));
 
-   /* Stop the profile connection timer */
-   stopAppProfileConnectTimer( inst );    
+   if (profile & (ProfileAghsp | ProfileAghfp))
+   {
+      profile = (ProfileAghsp | ProfileAghfp);
+   }
+   if (the_app->connecting_profile & profile)
+   {
+      /* A profile this device started has finished, the time is from the connect request */
+      the_app->connecting_profile &= ~profile;
+      DEBUG_CONN(("    profile %x %s after %lums, still connecting %x\n", profile, (connected_profiles & profile) ? "connected" : "failed", 
+                  VmGetClock() - inst->connect_start, the_app->connecting_profile));
+   }
+
+   /* Stop the profile connection timer once all the profiles started have finished */
+   if (the_app->connecting_profile == ProfileNone)
+      stopAppProfileConnectTimer( inst );    
 
     if ( connected_profiles==ProfileNone && (all_responded || configureIsPinListExhausted(inst)) ) 
     {    /* All profiles supported by remote device have responded, but none have connected */
@@ -494,10 +569,15 @@ void profileSlcConnectCfm (devInstanceTaskData *inst, mvdProfiles profile, bool
         }
         else
         {
+            DEBUG_CONN(("    all profiles responded after %lums\n", VmGetClock() - inst->connect_start));
             the_app->connect_attempts = 0;
             profileSlcConnectComplete(inst, TRUE);
         }
     }
+    else if (the_app->connecting_profile != ProfileNone)
+    {
+        /* Wait for the other profiles being connected to this device */
+    }
     else        
     {    
         /* change the state to idle if the dongle was connecting */
@@ -518,6 +598,35 @@ void profileSlcConnectCfm (devInstanceTaskData *inst, mvdProfiles profile, bool
 }
 
 
+/****************************************************************************
+NAME
+    profileSlcAclOpened
+
+DESCRIPTION
+    An ACL has opened. If it is to the device being connected, start connecting the
+    rest of its profiles alongside the one that paged it.
+    
+*/
+void profileSlcAclOpened (const bdaddr *bd_addr)
+{
+    devInstanceTaskData *inst;
+    mvdProfiles started;
+    
+    if ((the_app->app_state != AppStateConnecting) || (the_app->connecting_profile == ProfileNone) || !BdaddrIsSame(bd_addr, &the_app->connect_bdaddr))
+        return;
+    
+    inst = devInstanceFindFromBddr(bd_addr, FALSE);
+    
+    if ((inst == NULL) || !canConnectConcurrently(inst))
+        return;
+    
+    started = connectProfiles(inst, TRUE);
+    the_app->connecting_profile |= started;
+    
+    DEBUG_CONN(("profileSlcAclOpened after %lums, connecting profiles %x\n", VmGetClock() - inst->connect_start, the_app->connecting_profile));
+}
+
+
 /****************************************************************************
 NAME
     profileSlcAcceptConnectInd
@@ -20,6 +20,8 @@ void profileSlcCancelConnectionAttempt(devInstanceTaskData *inst);
 
 void profileSlcConnectCfm (devInstanceTaskData *inst, mvdProfiles profile, bool remote_connecting);
 
+void profileSlcAclOpened (const bdaddr *bd_addr);
+
 void profileSlcAcceptConnectInd (devInstanceTaskData *inst);
 
 void profileSlcDisconnectInd (devInstanceTaskData *inst, mvdProfiles profile);
@@ -55,6 +55,9 @@ DESCRIPTION
 #define EIR_MAX_SIZE            (MAX_PACKET_SIZE_DH1)
 #define INQUIRY_TX_DATA_SIZE    (2)
 
+/* End of an inquiry result hash chain, or the heap position of a result already loaded */
+#define INQUIRY_SLOT_NONE       (0xFF)
+
 /* Service search patterns */
 /* DataEl(0x35), Length(0x03), AVDTP(0x19), Headset(0x1108) */
 static const uint8 s_hsp_service_search_pattern[] = {0x35, 0x03, 0x19, 0x11, 0x08};
@@ -240,7 +243,7 @@ static mvdEirData parseEirData(const uint8 size_eir_data, const uint8* eir_data)
         if (*(p+1) == EIR_TYPE_INQUIRY_TX)
         {
             /* Initially set path loss to Inquiry Tx Power*/
-            result.path_loss = *p+2;
+            result.path_loss = (int8)*(p+2);
         }
         else if ((*(p+1) == EIR_TYPE_UUID16_COMPLETE) || (*(p+1) == EIR_TYPE_UUID16_SHORTENED))
         {
@@ -255,6 +258,247 @@ static mvdEirData parseEirData(const uint8 size_eir_data, const uint8* eir_data)
 }
 
 
+/****************************************************************************
+NAME
+    hashBdaddr
+
+DESCRIPTION
+    Returns the hash chain an inquiry result with the Bluetooth address is kept on.
+    
+*/
+static uint16 hashBdaddr (const bdaddr *bd_addr)
+{
+    return (uint16)(bd_addr->lap ^ (bd_addr->lap >> 12) ^ bd_addr->uap) & (INQUIRY_SCAN_HASH_SIZE-1);
+}
+
+
+/****************************************************************************
+NAME
+    findInquireResult
+
+DESCRIPTION
+    Returns the slot holding the inquiry result for the Bluetooth address, or
+    INQUIRY_SLOT_NONE if the device has not been found.
+    
+*/
+static uint8 findInquireResult (const bdaddr *bd_addr)
+{
+    uint8 slot;
+    
+    for ( slot = s_inquiry_scan_data->hash[hashBdaddr(bd_addr)] ; slot != INQUIRY_SLOT_NONE ; slot = s_inquiry_scan_data->next[slot] )
+    {
+        if (BdaddrIsSame(bd_addr, &s_inquiry_scan_data->buffer[slot]))
+            break;
+    }
+    
+    return slot;
+}
+
+
+/****************************************************************************
+NAME
+    unlinkInquireResult
+
+DESCRIPTION
+    Removes the inquiry result in the slot from its hash chain.
+    
+*/
+static void unlinkInquireResult (uint8 slot)
+{
+    uint8 *link = &s_inquiry_scan_data->hash[hashBdaddr(&s_inquiry_scan_data->buffer[slot])];
+    
+    while (*link != slot)
+        link = &s_inquiry_scan_data->next[*link];
+    
+    *link = s_inquiry_scan_data->next[slot];
+}
+
+
+/****************************************************************************
+NAME
+    heapPathLoss
+
+DESCRIPTION
+    Returns the path loss of the inquiry result at a position in the heap.
+    
+*/
+static int16 heapPathLoss (uint8 i)
+{
+    return s_inquiry_scan_data->eir_data[s_inquiry_scan_data->heap[i]].path_loss;
+}
+
+
+/****************************************************************************
+NAME
+    setHeapEntry
+
+DESCRIPTION
+    Puts the inquiry result in the slot at a position in the heap.
+    
+*/
+static void setHeapEntry (uint8 i, uint8 slot)
+{
+    s_inquiry_scan_data->heap[i] = slot;
+    s_inquiry_scan_data->pos[slot] = i;
+}
+
+
+/****************************************************************************
+NAME
+    siftUp
+
+DESCRIPTION
+    Moves the inquiry result at a position in the heap towards the top until
+    no result above it has a higher path loss.
+    
+*/
+static void siftUp (uint8 i)
+{
+    uint8 slot = s_inquiry_scan_data->heap[i];
+    int16 path_loss = s_inquiry_scan_data->eir_data[slot].path_loss;
+    
+    while ((i > 0) && (heapPathLoss((i-1)/2) > path_loss))
+    {
+        setHeapEntry(i, s_inquiry_scan_data->heap[(i-1)/2]);
+        i = (i-1)/2;
+    }
+    
+    setHeapEntry(i, slot);
+}
+
+
+/****************************************************************************
+NAME
+    siftDown
+
+DESCRIPTION
+    Moves the inquiry result at a position in the heap towards the bottom until
+    no result below it has a lower path loss.
+    
+*/
+static void siftDown (uint8 i)
+{
+    uint8 slot = s_inquiry_scan_data->heap[i];
+    int16 path_loss = s_inquiry_scan_data->eir_data[slot].path_loss;
+    uint8 child;
+    
+    while ((child = 2*i + 1) < s_inquiry_scan_data->count)
+    {
+        if (((child + 1) < s_inquiry_scan_data->count) && (heapPathLoss(child + 1) < heapPathLoss(child)))
+            child++;
+        
+        if (heapPathLoss(child) >= path_loss)
+            break;
+        
+        setHeapEntry(i, s_inquiry_scan_data->heap[child]);
+        i = child;
+    }
+    
+    setHeapEntry(i, slot);
+}
+
+
+/****************************************************************************
+NAME
+    removeFromHeap
+
+DESCRIPTION
+    Takes the inquiry result at a position out of the heap and returns its slot.
+    The slot stays on its hash chain so the device is not stored again.
+    
+*/
+static uint8 removeFromHeap (uint8 i)
+{
+    uint8 slot = s_inquiry_scan_data->heap[i];
+    uint8 last;
+    
+    if (i != --s_inquiry_scan_data->count)
+    {
+        /* Fill the gap with the last result and restore the heap order around it */
+        last = s_inquiry_scan_data->heap[s_inquiry_scan_data->count];
+        setHeapEntry(i, last);
+        siftDown(i);
+        siftUp(s_inquiry_scan_data->pos[last]);
+    }
+    
+    s_inquiry_scan_data->pos[slot] = INQUIRY_SLOT_NONE;
+    
+    return slot;
+}
+
+
+/****************************************************************************
+NAME
+    findWorstInquireResult
+
+DESCRIPTION
+    Returns the heap position of the waiting inquiry result with the highest path
+    loss, or INQUIRY_SLOT_NONE if no results are waiting. Only the bottom row of
+    the heap need be checked.
+    
+*/
+static uint8 findWorstInquireResult (void)
+{
+    uint8 worst = INQUIRY_SLOT_NONE;
+    uint8 i;
+    
+    for ( i = s_inquiry_scan_data->count / 2 ; i < s_inquiry_scan_data->count ; i++ )
+    {
+        if ((worst == INQUIRY_SLOT_NONE) || (heapPathLoss(i) > heapPathLoss(worst)))
+            worst = i;
+    }
+    
+    return worst;
+}
+
+
+#ifdef INQUIRY_EARLY_CONNECT
+/****************************************************************************
+NAME
+    isEirProven
+
+DESCRIPTION
+    Returns if the EIR data shows the device supports all of the profiles an SDP
+    search would look for, and that one of them carries audio.
+    
+*/
+static bool isEirProven (const mvdEirData *eir)
+{
+    if (!eir->profiles_complete && (eir->profiles != the_app->supported_profiles))
+        return FALSE;
+    
+    return (eir->profiles & (ProfileAghfp | ProfileAghsp | ProfileA2dp)) ? TRUE : FALSE;
+}
+
+
+/****************************************************************************
+NAME
+    findBestProvenResult
+
+DESCRIPTION
+    Returns the heap position of the waiting inquiry result with the lowest path
+    loss whose EIR data proves its profiles, or INQUIRY_SLOT_NONE if there is none.
+    
+*/
+static uint8 findBestProvenResult (void)
+{
+    uint8 best = INQUIRY_SLOT_NONE;
+    uint8 i;
+    
+    for ( i = 0 ; i < s_inquiry_scan_data->count ; i++ )
+    {
+        if (isEirProven(&s_inquiry_scan_data->eir_data[s_inquiry_scan_data->heap[i]]) && 
+            ((best == INQUIRY_SLOT_NONE) || (heapPathLoss(i) < heapPathLoss(best))))
+        {
+            best = i;
+        }
+    }
+    
+    return best;
+}
+#endif
+
+
 /****************************************************************************
   MAIN FUNCTIONS
 */
@@ -382,8 +626,16 @@ void scanKickInquiryScan (void)
         s_inquiry_scan_data = (mvdInquiryScanData *)malloc( sizeof(mvdInquiryScanData) );
         PanicNull( s_inquiry_scan_data );
     }
-    s_inquiry_scan_data->read_idx = 0;
-    s_inquiry_scan_data->write_idx = 0;
+    else if ( s_inquiry_scan_data->running )
+    {
+        /* Left running by an early connect, the results will come from it */
+        DEBUG_SCAN(("Inquiry already running\n"));
+        return;
+    }
+    s_inquiry_scan_data->count = 0;
+    s_inquiry_scan_data->used = 0;
+    s_inquiry_scan_data->running = TRUE;
+    memset(s_inquiry_scan_data->hash, INQUIRY_SLOT_NONE, sizeof(s_inquiry_scan_data->hash));
     
     ConnectionInquire(&the_app->task, 0x9e8b33, INQUIRY_SCAN_BUFFER_SIZE, 4, (uint32)AV_MAJOR_DEVICE_CLASS);
 }
@@ -419,6 +671,8 @@ void scanStoreInquireResult (const CL_DM_INQUIRE_RESULT_T *prim)
 {
     /* Default EIR values */
     mvdEirData    result;
+    uint8         slot;
+    uint16        hash;
     
     DEBUG_SCAN(("Found device: 0x%X 0x%X 0x%lX\n", (uint16)prim->bd_addr.nap, (uint16)prim->bd_addr.uap, (uint32)prim->bd_addr.lap));
     
@@ -438,63 +692,68 @@ void scanStoreInquireResult (const CL_DM_INQUIRE_RESULT_T *prim)
     
     DEBUG_SCAN(("path loss: %i\n",result.path_loss));
     
-    if ( (s_inquiry_scan_data != NULL) && (s_inquiry_scan_data->write_idx < INQUIRY_SCAN_BUFFER_SIZE) )
+    if ( s_inquiry_scan_data == NULL )
+        return;
+    
+    slot = findInquireResult(&prim->bd_addr);
+    
+    if ( slot != INQUIRY_SLOT_NONE )
     {
-        uint8 j,k;    
+        DEBUG_SCAN(("Device already found\n"));
         
-        /* Start by checking if we have already found this device */
-        for ( k = 0 ; k < s_inquiry_scan_data->write_idx ; k++ )
+        /* Only worth updating if still waiting and we got a lower path loss this time */
+        if ((s_inquiry_scan_data->pos[slot] == INQUIRY_SLOT_NONE) || (result.path_loss >= s_inquiry_scan_data->eir_data[slot].path_loss))
         {
-            /* Found duplicate */
-            if (BdaddrIsSame(&prim->bd_addr, &s_inquiry_scan_data->buffer[k]))
-            {
-                DEBUG_SCAN(("Device already found\n"));
-                
-                /* If we got a lower path loss this time */
-                if (result.path_loss < s_inquiry_scan_data->eir_data[k].path_loss)
-                {
-                    /* Remove the old record and put this one in */
-                    DEBUG_SCAN((" - updating\n"));
-                    s_inquiry_scan_data->write_idx--;
-                    for ( j=k ; j < s_inquiry_scan_data->write_idx ; j++)
-                    {
-                        memcpy(&s_inquiry_scan_data->buffer[j],&s_inquiry_scan_data->buffer[j+1], sizeof(bdaddr));
-                        s_inquiry_scan_data->eir_data[j] = s_inquiry_scan_data->eir_data[j+1];
-                    }
-                    break;
-                }
-                else
-                {
-                    /* No point updating */
-                    DEBUG_SCAN((" - returning\n"));
-                    return;
-                }
-            }
+            DEBUG_SCAN((" - returning\n"));
+            return;
         }
         
-        /* Move up the found devices list */
-        for ( k = k ; k > 0 ; k-- )
+        DEBUG_SCAN((" - updating\n"));
+        s_inquiry_scan_data->eir_data[slot] = result;
+        siftUp(s_inquiry_scan_data->pos[slot]);
+    }
+    else
+    {
+        if ( s_inquiry_scan_data->used < INQUIRY_SCAN_BUFFER_SIZE )
         {
-            /* If next dev up has lower path loss we have found our place */
-            if (s_inquiry_scan_data->eir_data[k-1].path_loss <= result.path_loss)
-                break;
+            slot = s_inquiry_scan_data->used++;
         }
-        
-        DEBUG_SCAN(("Adding device at %d of %d\n",k,s_inquiry_scan_data->write_idx));
-        
-        
-        /* Shuffle down other entries if required */
-        for ( j = s_inquiry_scan_data->write_idx ; j > k ; j-- )
+        else
         {
-            memcpy(&s_inquiry_scan_data->buffer[j],&s_inquiry_scan_data->buffer[j-1], sizeof(bdaddr));
-            s_inquiry_scan_data->eir_data[j] = s_inquiry_scan_data->eir_data[j-1];
+            /* Buffer full, make room by forgetting the waiting device with the highest path loss */
+            uint8 worst = findWorstInquireResult();
+            
+            if ((worst == INQUIRY_SLOT_NONE) || (heapPathLoss(worst) <= result.path_loss))
+            {
+                DEBUG_SCAN(("Buffer full\n"));
+                return;
+            }
+            
+            slot = removeFromHeap(worst);
+            unlinkInquireResult(slot);
         }
         
-        /* Add device at k and increment write index */
-        memcpy(&s_inquiry_scan_data->buffer[k], &prim->bd_addr, sizeof(bdaddr));
-        s_inquiry_scan_data->eir_data[k] = result;
-        s_inquiry_scan_data->write_idx++;
+        DEBUG_SCAN(("Adding device at slot %d, %d waiting\n", slot, s_inquiry_scan_data->count));
+        
+        /* Add device to its hash chain and to the bottom of the heap */
+        s_inquiry_scan_data->buffer[slot] = prim->bd_addr;
+        s_inquiry_scan_data->eir_data[slot] = result;
+        hash = hashBdaddr(&prim->bd_addr);
+        s_inquiry_scan_data->next[slot] = s_inquiry_scan_data->hash[hash];
+        s_inquiry_scan_data->hash[hash] = slot;
+        setHeapEntry(s_inquiry_scan_data->count++, slot);
+        siftUp(s_inquiry_scan_data->pos[slot]);
+    }
+    
+#ifdef INQUIRY_EARLY_CONNECT
+    if ((the_app->app_state == AppStateInquiring) && isEirProven(&result))
+    {
+        /* No need to wait for the inquiry to end, connect to the best proven device found so far */
+        DEBUG_SCAN(("EIR proves profiles - connect early\n"));
+        MessageCancelAll(&the_app->task, APP_PROCESS_INQUIRE_RESULT);
+        MessageSend(&the_app->task, APP_PROCESS_INQUIRE_RESULT, 0);
     }
+#endif
 }
 
 
@@ -503,21 +762,31 @@ NAME
     scanLoadNextInquireResult
 
 DESCRIPTION
-    Retrieves the data associated with the next inquiry result.
+    Retrieves the data associated with the next inquiry result, the one with the
+    lowest path loss. While the inquiry is still running only a device that needs
+    no SDP search is retrieved.
     
 */
 bool scanLoadNextInquireResult (void)
 {
-    if ( (s_inquiry_scan_data != NULL) && (s_inquiry_scan_data->read_idx < s_inquiry_scan_data->write_idx) )
-    {
-        memcpy(&the_app->search_bdaddr, &s_inquiry_scan_data->buffer[s_inquiry_scan_data->read_idx], sizeof(bdaddr));
-        the_app->remote_profiles = s_inquiry_scan_data->eir_data[s_inquiry_scan_data->read_idx].profiles;
-        the_app->remote_profiles_complete = s_inquiry_scan_data->eir_data[s_inquiry_scan_data->read_idx].profiles_complete;
-        s_inquiry_scan_data->read_idx++;
-        return TRUE;
-    }
-
-    return FALSE;
+    uint8 i = 0;
+    uint8 slot;
+    
+    if ( (s_inquiry_scan_data == NULL) || (s_inquiry_scan_data->count == 0) )
+        return FALSE;
+    
+#ifdef INQUIRY_EARLY_CONNECT
+    if ( s_inquiry_scan_data->running && ((i = findBestProvenResult()) == INQUIRY_SLOT_NONE) )
+        return FALSE;
+#endif
+    
+    slot = removeFromHeap(i);
+    
+    the_app->search_bdaddr = s_inquiry_scan_data->buffer[slot];
+    the_app->remote_profiles = s_inquiry_scan_data->eir_data[slot].profiles;
+    the_app->remote_profiles_complete = s_inquiry_scan_data->eir_data[slot].profiles_complete;
+    
+    return TRUE;
 }
 
 
@@ -531,7 +800,36 @@ DESCRIPTION
 */
 bool scanHaveInquireResults (void)
 {
-    return ((s_inquiry_scan_data != NULL) && (s_inquiry_scan_data->read_idx < s_inquiry_scan_data->write_idx)) ? TRUE : FALSE;
+    return ((s_inquiry_scan_data != NULL) && (s_inquiry_scan_data->count != 0)) ? TRUE : FALSE;
+}
+
+
+/****************************************************************************
+NAME
+    scanIsInquiryRunning
+
+DESCRIPTION
+    Returns if an inquiry has been started and has not yet reported it is ready.
+    
+*/
+bool scanIsInquiryRunning (void)
+{
+    return ((s_inquiry_scan_data != NULL) && s_inquiry_scan_data->running) ? TRUE : FALSE;
+}
+
+
+/****************************************************************************
+NAME
+    scanInquiryComplete
+
+DESCRIPTION
+    Notes that the inquiry has reported it is ready.
+    
+*/
+void scanInquiryComplete (void)
+{
+    if ( s_inquiry_scan_data != NULL )
+        s_inquiry_scan_data->running = FALSE;
 }
 
 
@@ -753,11 +1051,15 @@ NAME
     scanStopAppInquiryTimer
 
 DESCRIPTION
-    Stops the timer for inquiry.
+    Stops the timer for inquiry, and any inquiry an early connect left running.
     
 */
 void scanStopAppInquiryTimer (void)
 {
+    /* An early connect may have finished with the inquiry still running */
+    if ( scanIsInquiryRunning() )
+        cancelInquiry();
+    
     MessageCancelAll(&the_app->task, APP_INQUIRY_TIMER);
     the_app->inquiring = FALSE;
     the_app->app_inquiry_timer_expired = FALSE;
@@ -891,6 +1193,10 @@ void scanProcessNextInquireResult (void)
             {    /* Inquiry scan found a remote device, kick off a SDP search on it */
                 scanSdpSearchReq();
             }
+            else if ( scanIsInquiryRunning() )
+            {    /* Nothing to try until the inquiry finds more devices or is ready */
+                DEBUG_SCAN((" - waiting for inquiry\n"));
+            }
             else
             {
                 if ( the_app->app_inquiry_timer_expired )
@@ -34,6 +34,10 @@ bool scanLoadNextInquireResult (void);
 
 bool scanHaveInquireResults (void);
 
+bool scanIsInquiryRunning (void);
+
+void scanInquiryComplete (void);
+
 bool scanRepeatSdpSearch (void);
 
 void scanKickFirstSdpSearch (void);
@@ -10,6 +10,7 @@ Part of Audio-Adaptor-SDK 2009.R1
 
 #include "audioAdaptor_led.h"
 #include "audioAdaptor_statemanager.h"
+#include "audioAdaptor_trace.h"
 
 #include <audio.h>
 #include <bdaddr.h>
@@ -89,6 +90,7 @@ DESCRIPTION
 void setA2dpState(devInstanceTaskData *theInst, mvdA2dpState state)
 {
     DEBUG_STATES(("A2DP STATE old:[%s] new:[%s] inst:[0x%x]\n", s_a2dp_states[theInst->a2dp_state], s_a2dp_states[state],(uint16)theInst));
+    TRACE_STATE(TraceA2dpState, theInst, theInst->a2dp_state, state);
     theInst->a2dp_state = state;
 }
 
@@ -104,6 +106,7 @@ DESCRIPTION
 void setAvrcpState(devInstanceTaskData *theInst, mvdAvrcpState state)
 {
     DEBUG_STATES(("AVRCP STATE old:[%s] new:[%s] inst:[0x%x]\n", s_avrcp_states[theInst->avrcp_state], s_avrcp_states[state],(uint16)theInst));
+    TRACE_STATE(TraceAvrcpState, theInst, theInst->avrcp_state, state);
     theInst->avrcp_state = state;
 }
 
@@ -119,6 +122,7 @@ DESCRIPTION
 void setAghfpState(devInstanceTaskData *theInst, mvdAghfpState state)
 {
     DEBUG_STATES(("AGHFP STATE old:[%s] new:[%s] inst:[0x%x]\n", s_aghfp_states[theInst->aghfp_state], s_aghfp_states[state],(uint16)theInst));
+    TRACE_STATE(TraceAghfpState, theInst, theInst->aghfp_state, state);
     theInst->aghfp_state = state;
 }
 
@@ -137,7 +141,10 @@ void setAppState (mvdAppState state)
     /* Change the LED flash corresponding to the new state      */
     /* Low battery and battcharging state just change LED flash */
     if(state < AppStateLowBattery)
+    {
+        TRACE_APP_STATE(the_app->app_state, state);
         the_app->app_state = state;
+    }
     
     ledPlayPattern(state);
 }
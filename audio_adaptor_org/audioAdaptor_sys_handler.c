@@ -187,7 +187,7 @@ bool sysHandleButtonsMessage(MessageId id, Message message)
         case BUTTON_MODE_FASTSTREAM:
         {
             uint16 i;
-            bool codec_chosen = FALSE;           
+            uint16 sinks_chosen = 0;
             DEBUG(("BUTTON_MODE_FASTSTREAM\n"));
             
             /* check the Faststream codec is enabled */
@@ -213,13 +213,9 @@ bool sysHandleButtonsMessage(MessageId id, Message message)
                             setA2dpState(the_app->dev_inst[i], A2dpStateClosing);
                             A2dpClose(the_app->dev_inst[i]->a2dp);
                             the_app->dev_inst[i]->a2dp_reopen_tries = 0;
-#ifdef DUAL_STREAM                
-                            if (codec_chosen)
-                                the_app->dev_inst[i]->a2dp_reopen_codec = FASTSTREAM_DS_SEID;
-                            else
-#endif                    
-                                the_app->dev_inst[i]->a2dp_reopen_codec = FASTSTREAM_SEID;
-                            codec_chosen = TRUE;
+                            /* each sink reopens on a SEP of its own */
+                            the_app->dev_inst[i]->a2dp_reopen_codec = FASTSTREAM_SEID + sinks_chosen;
+                            sinks_chosen++;
                             MessageSendConditionally(&the_app->dev_inst[i]->task, APP_MEDIA_CHANNEL_REOPEN_REQ, 0, &the_app->dev_inst[i]->a2dp_closing);
                             break;
                         }
@@ -235,7 +231,7 @@ bool sysHandleButtonsMessage(MessageId id, Message message)
         case BUTTON_MODE_SBC:
         {
             uint16 i;
-            bool codec_chosen = FALSE;
+            uint16 sinks_chosen = 0;
             DEBUG(("BUTTON_MODE_SBC\n"));
             
             for (i = 0; i < MAX_NUM_DEV_CONNECTIONS; i++)
@@ -254,13 +250,9 @@ bool sysHandleButtonsMessage(MessageId id, Message message)
                             setA2dpState(the_app->dev_inst[i], A2dpStateClosing);
                             A2dpClose(the_app->dev_inst[i]->a2dp);
                             the_app->dev_inst[i]->a2dp_reopen_tries = 0;
-#ifdef DUAL_STREAM                
-                            if (codec_chosen)
-                                the_app->dev_inst[i]->a2dp_reopen_codec = SBC_DS_SEID;
-                            else
-#endif                    
-                                the_app->dev_inst[i]->a2dp_reopen_codec = SBC_SEID;
-                            codec_chosen = TRUE;
+                            /* each sink reopens on a SEP of its own */
+                            the_app->dev_inst[i]->a2dp_reopen_codec = SBC_SEID + sinks_chosen;
+                            sinks_chosen++;
                             MessageSendConditionally(&the_app->dev_inst[i]->task, APP_MEDIA_CHANNEL_REOPEN_REQ, 0, &the_app->dev_inst[i]->a2dp_closing);
                             break;
                         }
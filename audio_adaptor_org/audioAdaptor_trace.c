@@ -0,0 +1,353 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2009
+Part of Audio-Adaptor-SDK 2009.R1
+
+DESCRIPTION
+    Binary trace of the messages and state changes of the application.
+*/
+
+
+#include "audioAdaptor_private.h"
+#include "audioAdaptor_trace.h"
+
+#ifdef ENABLE_TRACE
+
+#include <message.h>
+#include <sink.h>
+#include <source.h>
+#include <stream.h>
+#include <vm.h>
+#include <string.h>
+
+
+#define TRACE_RECORD_BYTES      (TRACE_RECORD_WORDS * 2)
+
+/* Commands the host sends over the UART */
+#define TRACE_CMD_DUMP          'D'
+#define TRACE_CMD_CLEAR         'C'
+#define TRACE_CMD_STOP          'S'
+#define TRACE_CMD_RUN           'R'
+
+
+typedef struct
+{
+    uint16      next;                   /* Record written next */
+    uint16      count;                  /* Records held, up to TRACE_RING_SIZE */
+    uint16      overwritten;            /* Records lost to the ring wrapping since it was cleared */
+    uint16      dump_left;              /* Records still to be sent by the dump */
+    Sink        dump_sink;
+    Task        dump_sink_task;         /* Task the sink reported to before the dump */
+    unsigned    stopped:1;              /* Recording stopped by the host */
+    unsigned    dumping:1;              /* Recording held while the ring is sent */
+    unsigned    dump_header:1;          /* Header still to be sent by the dump */
+    uint16      records[TRACE_RING_SIZE][TRACE_RECORD_WORDS];
+} mvdTraceData;
+
+
+static void traceHandler (Task task, MessageId id, Message message);
+
+static mvdTraceData s_trace;
+static TaskData s_trace_task = { traceHandler };
+
+
+/****************************************************************************
+  LOCAL FUNCTIONS
+*/
+
+/****************************************************************************
+NAME
+    putWord
+
+DESCRIPTION
+    Writes a word to a stream buffer, low byte first, and returns where the
+    next byte goes.
+
+*/
+static uint8 *putWord (uint8 *dest, uint16 word)
+{
+    *dest++ = (uint8)(word & 0xFF);
+    *dest++ = (uint8)(word >> 8);
+    return dest;
+}
+
+
+/****************************************************************************
+NAME
+    dumpMore
+
+DESCRIPTION
+    Sends as much of the dump as the sink has space for. The rest is sent when
+    the sink reports it has more space.
+
+*/
+static void dumpMore (void)
+{
+    Sink sink = s_trace.dump_sink;
+    uint16 header = s_trace.dump_header ? TRACE_HEADER_BYTES : 0;
+    uint16 slack = SinkSlack(sink);
+    uint16 records;
+    uint16 size;
+    uint16 offset;
+    uint16 idx;
+    uint16 i;
+    uint32 now;
+    uint8 *dest;
+
+    if (slack < header)
+        return;
+
+    records = (slack - header) / TRACE_RECORD_BYTES;
+    if (records > s_trace.dump_left)
+        records = s_trace.dump_left;
+
+    size = header + (records * TRACE_RECORD_BYTES);
+    if (size == 0)
+        return;
+
+    offset = SinkClaim(sink, size);
+    if (offset == 0xFFFF)
+        return;
+
+    dest = SinkMap(sink) + offset;
+
+    if (header)
+    {
+        now = VmGetClock();
+        *dest++ = 'A';
+        *dest++ = 'T';
+        *dest++ = TRACE_VERSION;
+        *dest++ = TRACE_RECORD_BYTES;
+        dest = putWord(dest, s_trace.count);
+        dest = putWord(dest, s_trace.overwritten);
+        dest = putWord(dest, (uint16)(now >> 16));
+        dest = putWord(dest, (uint16)now);
+        s_trace.dump_header = FALSE;
+    }
+
+    for ( ; records ; records--)
+    {
+        /* The ring is held during the dump, so the oldest record left to send is dump_left back from next */
+        idx = (s_trace.next - s_trace.dump_left) & (TRACE_RING_SIZE - 1);
+        for (i = 0; i < TRACE_RECORD_WORDS; i++)
+            dest = putWord(dest, s_trace.records[idx][i]);
+        s_trace.dump_left--;
+    }
+
+    (void) SinkFlush(sink, size);
+
+    if (s_trace.dump_left == 0)
+    {
+        /* Hand the sink back and carry on recording */
+        (void) MessageSinkTask(sink, s_trace.dump_sink_task);
+        s_trace.dumping = FALSE;
+    }
+}
+
+
+/****************************************************************************
+NAME
+    handleUartCommands
+
+DESCRIPTION
+    Acts on the commands the host has sent over the UART.
+
+*/
+static void handleUartCommands (Source source)
+{
+    const uint8 *data;
+    uint16 size;
+    uint16 i;
+
+    while ((size = SourceSize(source)) != 0)
+    {
+        data = SourceMap(source);
+
+        for (i = 0; i < size; i++)
+        {
+            switch (data[i])
+            {
+                case TRACE_CMD_DUMP:
+                {
+                    (void) traceDump(StreamUartSink());
+                    break;
+                }
+                case TRACE_CMD_CLEAR:
+                {
+                    traceClear();
+                    break;
+                }
+                case TRACE_CMD_STOP:
+                {
+                    s_trace.stopped = TRUE;
+                    break;
+                }
+                case TRACE_CMD_RUN:
+                {
+                    s_trace.stopped = FALSE;
+                    break;
+                }
+                default:
+                {
+                    break;
+                }
+            }
+        }
+
+        SourceDrop(source, size);
+    }
+}
+
+
+/****************************************************************************
+NAME
+    traceHandler
+
+DESCRIPTION
+    Handles the stream messages of the UART and of a sink being dumped to.
+
+*/
+static void traceHandler (Task task, MessageId id, Message message)
+{
+    switch (id)
+    {
+        case MESSAGE_MORE_DATA:
+        {
+            handleUartCommands(((MessageMoreData *)message)->source);
+            break;
+        }
+        case MESSAGE_MORE_SPACE:
+        {
+            if (s_trace.dumping && (((MessageMoreSpace *)message)->sink == s_trace.dump_sink))
+                dumpMore();
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+
+/****************************************************************************
+  MAIN FUNCTIONS
+*/
+
+/****************************************************************************
+NAME
+    traceInit
+
+DESCRIPTION
+    Clears the trace and listens for commands on the UART.
+
+*/
+void traceInit (void)
+{
+    memset(&s_trace, 0, sizeof(s_trace));
+
+    /* No UART sink if the UART isn't given to the VM, the ring can still be dumped with traceDump */
+    if (StreamUartSink())
+        (void) MessageSinkTask(StreamUartSink(), &s_trace_task);
+}
+
+
+/****************************************************************************
+NAME
+    traceRecord
+
+DESCRIPTION
+    Adds a record to the trace, overwriting the oldest once the ring is full.
+
+*/
+void traceRecord (mvdTraceType type, uint16 instance, uint16 arg, uint16 value)
+{
+    uint16 *record;
+    uint32 now;
+
+    if (s_trace.stopped || s_trace.dumping)
+        return;
+
+    now = VmGetClock();
+    record = s_trace.records[s_trace.next];
+    record[0] = (uint16)((type << 12) | ((instance & 0xF) << 8) | (arg & 0xFF));
+    record[1] = value;
+    record[2] = (uint16)(now >> 16);
+    record[3] = (uint16)now;
+
+    s_trace.next = (s_trace.next + 1) & (TRACE_RING_SIZE - 1);
+
+    if (s_trace.count < TRACE_RING_SIZE)
+        s_trace.count++;
+    else
+        s_trace.overwritten++;
+}
+
+
+/****************************************************************************
+NAME
+    traceInstance
+
+DESCRIPTION
+    Returns the index of a device instance as it is recorded in the trace.
+
+*/
+uint16 traceInstance (const devInstanceTaskData *inst)
+{
+    uint16 instance;
+
+    for (instance = 0; instance < MAX_NUM_DEV_CONNECTIONS; instance++)
+    {
+        if (the_app->dev_inst[instance] == inst)
+            return instance;
+    }
+
+    return TRACE_NO_INSTANCE;
+}
+
+
+/****************************************************************************
+NAME
+    traceClear
+
+DESCRIPTION
+    Discards all records. Ignored while a dump is being sent.
+
+*/
+void traceClear (void)
+{
+    if (!s_trace.dumping)
+    {
+        s_trace.next = 0;
+        s_trace.count = 0;
+        s_trace.overwritten = 0;
+    }
+}
+
+
+/****************************************************************************
+NAME
+    traceDump
+
+DESCRIPTION
+    Sends the trace to a sink. Recording is held until all of it has been sent,
+    and the sink reports to the trace until then. Returns FALSE if the sink is
+    not valid or a dump is already being sent.
+
+*/
+bool traceDump (Sink sink)
+{
+    if (s_trace.dumping || !SinkIsValid(sink))
+        return FALSE;
+
+    s_trace.dumping = TRUE;
+    s_trace.dump_header = TRUE;
+    s_trace.dump_left = s_trace.count;
+    s_trace.dump_sink = sink;
+    s_trace.dump_sink_task = MessageSinkTask(sink, &s_trace_task);
+
+    dumpMore();
+
+    return TRUE;
+}
+
+#endif /* ENABLE_TRACE */
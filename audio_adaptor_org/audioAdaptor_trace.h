@@ -0,0 +1,98 @@
+/****************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2009
+Part of Audio-Adaptor-SDK 2009.R1
+
+DESCRIPTION
+    Binary trace of the messages and state changes of the application, kept
+    in a RAM ring and dumped on request. Building with ENABLE_TRACE turns it
+    on, otherwise the TRACE_ macros compile to nothing.
+
+    Each record is TRACE_RECORD_WORDS words:
+        [0] type:4 instance:4 arg:8
+        [1] value
+        [2] VmGetClock() high word
+        [3] VmGetClock() low word
+
+    A message record has the message ID as its value. A state change record
+    has the old state as its arg and the new state as its value, and a comm
+    action record the action it replaces and the action kicked. The instance
+    is the index of the device instance in the_app->dev_inst, or
+    TRACE_NO_INSTANCE.
+
+    A dump is a header of TRACE_HEADER_BYTES followed by the records, oldest
+    first, every word sent low byte first:
+        'A' 'T' version record_bytes count:16 overwritten:16 clock:32
+
+    Sending 'D' to the UART dumps the ring back over it, 'C' clears it, 'S'
+    stops recording and 'R' restarts it. traceDump() will send the ring over
+    any other stream, such as an RFCOMM connection. host/trace_decode.c turns
+    a dump into a timeline and the time spent in each state.
+*/
+
+
+#ifndef AUDIOADAPTOR_TRACE_H
+#define AUDIOADAPTOR_TRACE_H
+
+
+#include "audioAdaptor_private.h"
+
+
+#define TRACE_VERSION           1
+#define TRACE_RECORD_WORDS      4
+#define TRACE_HEADER_BYTES      12
+
+#ifndef TRACE_RING_SIZE
+    #define TRACE_RING_SIZE     64      /* Records, must be a power of 2 */
+#endif
+#if (TRACE_RING_SIZE < 2) || (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1))
+    #error "TRACE_RING_SIZE must be a power of 2, the ring index is masked with TRACE_RING_SIZE - 1"
+#endif
+
+#define TRACE_NO_INSTANCE       0xF
+
+
+typedef enum
+{
+    TraceMessage,               /* Message delivered to the application task */
+    TraceInstanceMessage,       /* Message delivered to a device instance */
+    TraceAppState,
+    TraceA2dpState,
+    TraceAvrcpState,
+    TraceAghfpState,
+    TraceCommAction
+} mvdTraceType;
+
+
+#ifdef ENABLE_TRACE
+    #define TRACE_INIT()                        traceInit()
+    #define TRACE_MESSAGE(id)                   traceRecord(TraceMessage, TRACE_NO_INSTANCE, 0, (uint16)(id))
+    #define TRACE_INSTANCE_MESSAGE(inst, id)    traceRecord(TraceInstanceMessage, traceInstance(inst), 0, (uint16)(id))
+    #define TRACE_APP_STATE(old, new)           traceRecord(TraceAppState, TRACE_NO_INSTANCE, (uint16)(old), (uint16)(new))
+    #define TRACE_STATE(type, inst, old, new)   traceRecord((type), traceInstance(inst), (uint16)(old), (uint16)(new))
+    #define TRACE_COMM_ACTION(last, action)     traceRecord(TraceCommAction, TRACE_NO_INSTANCE, (uint16)(last), (uint16)(action))
+#else
+    #define TRACE_INIT()
+    #define TRACE_MESSAGE(id)
+    #define TRACE_INSTANCE_MESSAGE(inst, id)
+    #define TRACE_APP_STATE(old, new)
+    #define TRACE_STATE(type, inst, old, new)
+    #define TRACE_COMM_ACTION(last, action)
+#endif
+
+
+#ifdef ENABLE_TRACE
+
+void traceInit (void);
+
+void traceRecord (mvdTraceType type, uint16 instance, uint16 arg, uint16 value);
+
+uint16 traceInstance (const devInstanceTaskData *inst);
+
+void traceClear (void);
+
+bool traceDump (Sink sink);
+
+#endif
+
+
+#endif /* AUDIOADAPTOR_TRACE_H */
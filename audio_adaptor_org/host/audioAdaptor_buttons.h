@@ -0,0 +1,43 @@
+/*
+    Host build of the header buttonparse generates from
+    audioAdaptor_buttons.button.  The button messages are sent by the
+    scenarios in host/sim_main.c instead of the PIO debounce code.
+*/
+
+#ifndef _AUDIOADAPTOR_BUTTONS_H
+#define _AUDIOADAPTOR_BUTTONS_H
+
+#include <message.h>
+
+/* messages sent to the client */
+enum
+{
+	BUTTON_DEVICE_CONNECT_REQ = 1000 /* base value */,
+	BUTTON_DEVICE_DISCOVER_REQ,
+	BUTTONS_CLEAR_PDL_REQ,
+	BUTTON_PWR_OFF_REQ,
+	BUTTON_PWR_RELEASE,
+	BUTTON_CONNECT_SECOND_DEVICE_REQ,
+#ifdef DEMO_MODE
+	BUTTON_MODE_FASTSTREAM,
+	BUTTON_MODE_SBC,
+	BUTTON_MODE_MP3,
+#endif
+	CHARGER_RAW
+};
+
+typedef struct
+{
+	uint16 chg;
+	uint16 vreg;
+} CHARGER_RAW_T;
+
+typedef struct
+{
+	TaskData task;
+	Task client;
+} PioState;
+
+void pioInit(PioState *state, Task client);
+
+#endif
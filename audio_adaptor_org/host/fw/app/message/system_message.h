@@ -0,0 +1,25 @@
+/*
+    Host build of the firmware system message identifiers.
+*/
+
+#ifndef SYSTEM_MESSAGE_H
+#define SYSTEM_MESSAGE_H
+
+#define SYSTEM_MESSAGE_BASE_         0x8000
+
+#define MESSAGE_FROM_HOST            (SYSTEM_MESSAGE_BASE_ + 0x01)
+#define MESSAGE_MORE_DATA            (SYSTEM_MESSAGE_BASE_ + 0x02)
+#define MESSAGE_MORE_SPACE           (SYSTEM_MESSAGE_BASE_ + 0x03)
+#define MESSAGE_PIO_CHANGED          (SYSTEM_MESSAGE_BASE_ + 0x04)
+#define MESSAGE_FROM_KALIMBA         (SYSTEM_MESSAGE_BASE_ + 0x05)
+#define MESSAGE_ADC_RESULT           (SYSTEM_MESSAGE_BASE_ + 0x06)
+#define MESSAGE_STREAM_DISCONNECT    (SYSTEM_MESSAGE_BASE_ + 0x07)
+#define MESSAGE_ENERGY_CHANGED       (SYSTEM_MESSAGE_BASE_ + 0x08)
+#define MESSAGE_STATUS_CHANGED       (SYSTEM_MESSAGE_BASE_ + 0x09)
+#define MESSAGE_SOURCE_EMPTY         (SYSTEM_MESSAGE_BASE_ + 0x0a)
+#define MESSAGE_FROM_KALIMBA_LONG    (SYSTEM_MESSAGE_BASE_ + 0x0b)
+#define MESSAGE_USB_ENUMERATED       (SYSTEM_MESSAGE_BASE_ + 0x0c)
+#define MESSAGE_USB_SUSPENDED        (SYSTEM_MESSAGE_BASE_ + 0x0d)
+#define MESSAGE_CHARGER_CHANGED      (SYSTEM_MESSAGE_BASE_ + 0x0e)
+
+#endif
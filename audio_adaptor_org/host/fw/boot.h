@@ -0,0 +1,9 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <csrtypes.h>
+
+void BootSetMode(uint16 mode);
+uint16 BootGetMode(void);
+
+#endif
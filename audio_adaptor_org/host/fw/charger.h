@@ -0,0 +1,20 @@
+#ifndef CHARGER_H
+#define CHARGER_H
+
+#include <csrtypes.h>
+
+typedef enum
+{
+    TRICKLE_CHARGE,
+    FAST_CHARGE,
+    DISABLED_ERROR,
+    STANDBY,
+    NO_POWER,
+    CHARGING,
+    NOT_CHARGING
+} charger_status;
+
+charger_status ChargerStatus(void);
+bool ChargerSupressLed0(bool suppress);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef CODEC__H
+#define CODEC__H
+
+#include <csrtypes.h>
+
+#endif
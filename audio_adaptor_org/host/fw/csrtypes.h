@@ -0,0 +1,26 @@
+/*
+    Host build of the BlueCore VM basic types.  The VM word is 16 bits,
+    uint32 is kept at 32 bits on a 64 bit host so library structures and
+    the %lx/%ld debug formats stay as close to the chip as they can.
+*/
+
+#ifndef CSRTYPES_H__
+#define CSRTYPES_H__
+
+typedef unsigned char  uint8;
+typedef unsigned short uint16;
+typedef unsigned int   uint32;
+typedef signed char    int8;
+typedef signed short   int16;
+typedef signed int     int32;
+
+typedef unsigned bool;
+
+#ifndef TRUE
+#define TRUE  1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef FILE_H
+#define FILE_H
+
+#include <csrtypes.h>
+
+typedef uint16 FILE_INDEX;
+
+#define FILE_NONE   ((FILE_INDEX)0)
+#define FILE_ROOT   ((FILE_INDEX)1)
+
+FILE_INDEX FileFind(FILE_INDEX start, const char *name, uint16 length);
+
+#endif
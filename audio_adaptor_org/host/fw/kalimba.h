@@ -0,0 +1,16 @@
+/*
+    Host build of the VM Kalimba API.  A load takes simulated time, see
+    host/sim_stream.c.
+*/
+
+#ifndef KALIMBA_H
+#define KALIMBA_H
+
+#include <csrtypes.h>
+#include <file.h>
+
+bool KalimbaLoad(FILE_INDEX file);
+void KalimbaPowerOff(void);
+bool KalimbaSendMessage(uint16 message, uint16 a, uint16 b, uint16 c, uint16 d);
+
+#endif
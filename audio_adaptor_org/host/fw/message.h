@@ -0,0 +1,44 @@
+/*
+    Host build of the VM message API, provided by host/sim_message.c.
+*/
+
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <message_.h>
+#include <sink_.h>
+#include <source_.h>
+#include <app/message/system_message.h>
+
+#define D_SEC(s)    ((uint32)(s) * 1000)
+#define D_MIN(m)    ((uint32)(m) * 60000)
+#define D_HOUR(h)   ((uint32)(h) * 3600000)
+#define D_INFINITE  ((uint32)-1)
+
+#define MESSAGE_MAKE(N,T) T *N = PanicUnlessNew(T)
+
+typedef struct { Source source; } MessageMoreData;
+typedef struct { Sink sink; } MessageMoreSpace;
+typedef struct { uint16 state; uint16 time; uint16 state2; } MessagePioChanged;
+typedef struct { uint16 id; uint16 data[4]; } MessageFromKalimba;
+typedef struct { Source source; Sink sink; } MessageStreamDisconnect;
+typedef struct { uint16 charger_connected; uint16 vreg_en_high; } MessageChargerChanged;
+
+void MessageSend(Task task, MessageId id, void *message);
+void MessageSendLater(Task task, MessageId id, void *message, uint32 delay);
+void MessageSendConditionally(Task task, MessageId id, void *message, const uint16 *condition);
+uint16 MessageCancelAll(Task task, MessageId id);
+bool MessageCancelFirst(Task task, MessageId id);
+uint16 MessageFlushTask(Task task);
+void MessageLoop(void);
+bool MessageWait(void **message);
+void MessageFree(MessageId id, Message message);
+
+Task MessageKalimbaTask(Task task);
+Task MessageSinkTask(Sink sink, Task task);
+Task MessagePioTask(Task task);
+Task MessageChargerTask(Task task);
+Task MessageHostCommsTask(Task task);
+Task MessageSystemTask(Task task);
+
+#endif
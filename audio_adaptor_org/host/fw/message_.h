@@ -0,0 +1,16 @@
+/*
+    Host build of the VM message types.
+*/
+
+#ifndef MESSAGE__H
+#define MESSAGE__H
+
+#include <csrtypes.h>
+
+typedef uint16 MessageId;
+typedef const void *Message;
+typedef struct TaskData *Task;
+typedef void (*Handler)(Task, MessageId, Message);
+typedef struct TaskData { Handler handler; } TaskData;
+
+#endif
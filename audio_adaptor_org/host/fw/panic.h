@@ -0,0 +1,21 @@
+/*
+    Host build of the VM panic API, a panic ends the simulation.
+*/
+
+#ifndef PANIC_H
+#define PANIC_H
+
+#include <stddef.h>
+#include <csrtypes.h>
+
+void Panic(void);
+void *PanicNull(void *p);
+void *PanicNotNull(void *p);
+bool PanicFalse(bool b);
+uint16 PanicZero(uint16 x);
+uint16 PanicNotZero(uint16 x);
+void *PanicUnlessMalloc(size_t size);
+
+#define PanicUnlessNew(T) ((T *)PanicUnlessMalloc(sizeof(T)))
+
+#endif
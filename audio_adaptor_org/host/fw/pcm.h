@@ -0,0 +1,6 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include <csrtypes.h>
+
+#endif
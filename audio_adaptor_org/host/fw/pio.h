@@ -0,0 +1,16 @@
+#ifndef PIO_H
+#define PIO_H
+
+#include <csrtypes.h>
+
+typedef enum { MIC_BIAS_CURRENT, MIC_BIAS_VOLTAGE } mic_bias_setting;
+
+uint16 PioGet(void);
+uint16 PioSet(uint16 mask, uint16 bits);
+uint16 PioSetDir(uint16 mask, uint16 dir);
+bool PioSetMicBiasHwEnabled(bool enable);
+bool PioSetMicBiasHwVoltage(uint16 voltage);
+bool PioSetMicBiasHwCurrent(uint16 current);
+bool PioSetPsuRegulator(bool enable);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PS_H
+#define PS_H
+
+#include <csrtypes.h>
+
+uint16 PsStore(uint16 key, const void *buff, uint16 words);
+/* A few callers read a byte sized key into a uint8, on the chip that is
+   the low half of the word, so the host copies only that half. */
+uint16 PsRetrieveSized(uint16 key, void *buff, uint16 words, bool bytewise);
+#define PsRetrieve(key, buff, words) \
+    PsRetrieveSized((key), (buff), (words), __builtin_types_compatible_p(__typeof__(buff), uint8 *))
+uint16 PsFullRetrieve(uint16 key, void *buff, uint16 words);
+
+#endif
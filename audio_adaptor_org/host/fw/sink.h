@@ -0,0 +1,21 @@
+/*
+    Host build of the VM sink API, see host/sim_stream.c.
+*/
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <csrtypes.h>
+#include <sink_.h>
+#include <bdaddr_.h>
+
+uint16 SinkSlack(Sink sink);
+uint16 SinkClaim(Sink sink, uint16 extra);
+uint8 *SinkMap(Sink sink);
+bool SinkFlush(Sink sink, uint16 amount);
+bool SinkFlushHeader(Sink sink, uint16 amount, const uint16 *header, uint16 length);
+bool SinkGetBdAddr(Sink sink, bdaddr *addr);
+bool SinkIsValid(Sink sink);
+bool SinkClose(Sink sink);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SINK__H
+#define SINK__H
+
+typedef struct __SINK *Sink;
+
+#endif
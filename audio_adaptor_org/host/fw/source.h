@@ -0,0 +1,18 @@
+/*
+    Host build of the VM source API, see host/sim_stream.c.
+*/
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <csrtypes.h>
+#include <source_.h>
+
+uint16 SourceSize(Source source);
+uint16 SourceBoundary(Source source);
+const uint8 *SourceMap(Source source);
+const void *SourceMapHeader(Source source);
+void SourceDrop(Source source, uint16 amount);
+bool SourceIsValid(Source source);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SOURCE__H
+#define SOURCE__H
+
+typedef struct __SOURCE *Source;
+
+#endif
@@ -0,0 +1,32 @@
+/*
+    Host build of the VM stream API, see host/sim_stream.c.
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <csrtypes.h>
+#include <sink_.h>
+#include <source_.h>
+#include <transform.h>
+#include <usb.h>
+
+typedef struct { uint16 pitch_length; } audio_note;
+
+Transform StreamConnect(Source source, Sink sink);
+bool StreamConnectDispose(Source source);
+void StreamDisconnect(Source source, Sink sink);
+Source StreamSourceFromSink(Sink sink);
+Sink StreamSinkFromSource(Source source);
+Sink StreamKalimbaSink(uint16 port);
+Source StreamKalimbaSource(uint16 port);
+Sink StreamPcmSink(uint16 port);
+Source StreamPcmSource(uint16 port);
+Sink StreamUsbClassSink(UsbInterface intf);
+Source StreamUsbClassSource(UsbInterface intf);
+Sink StreamUsbEndPointSink(EndPoint end_point);
+Source StreamUsbEndPointSource(EndPoint end_point);
+Sink StreamUartSink(void);
+Source StreamUartSource(void);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <csrtypes.h>
+#include <sink_.h>
+#include <source_.h>
+
+typedef struct __TRANSFORM *Transform;
+
+Transform TransformRtpSbcEncode(Source source, Sink sink);
+bool TransformStart(Transform transform);
+bool TransformStop(Transform transform);
+bool TransformDisconnect(Transform transform);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+    Host build of the VM USB API.  There is no USB port on the host, the
+    interfaces are accepted and their streams never carry data.
+*/
+
+#ifndef USB_H
+#define USB_H
+
+#include <csrtypes.h>
+
+typedef enum { usb_interface_error = 0x7fff } UsbInterface;
+
+typedef enum
+{
+    end_point_int_out   = 0x81,
+    end_point_int_out2  = 0x82,
+    end_point_bulk_in   = 0x03,
+    end_point_bulk_out  = 0x84,
+    end_point_iso_in    = 0x05,
+    end_point_iso_out   = 0x86
+} EndPoint;
+
+typedef enum
+{
+    end_point_attr_ctl = 0,
+    end_point_attr_iso = 1,
+    end_point_attr_bulk = 2,
+    end_point_attr_int = 3
+} EndPointAttr;
+
+typedef struct
+{
+    uint8 bInterfaceClass;
+    uint8 bInterfaceSubClass;
+    uint8 bInterfaceProtocol;
+} UsbCodes;
+
+typedef struct
+{
+    const uint8 *extended;
+    uint16       extended_length;
+    EndPoint     bEndpointAddress;
+    EndPointAttr bmAttributes;
+    uint16       wMaxPacketSize;
+    uint8        bInterval;
+    uint8        bRefresh;
+} EndPointInfo;
+
+typedef struct
+{
+    uint8  bmRequestType;
+    uint8  bRequest;
+    uint16 wValue;
+    uint16 wIndex;
+    uint16 wLength;
+} UsbRequest;
+
+typedef struct
+{
+    UsbRequest original_request;
+    bool       success;
+    uint16     data_length;
+} UsbResponse;
+
+UsbInterface UsbAddInterface(const UsbCodes *codes, uint16 desc_type, const uint8 *desc, uint16 desc_size);
+bool UsbAddDescriptor(UsbInterface intf, uint16 desc_type, const uint8 *desc, uint16 desc_size);
+bool UsbAddEndPoints(UsbInterface intf, uint16 num_end_points, const EndPointInfo *end_point_info);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef VM_H
+#define VM_H
+
+#include <csrtypes.h>
+
+uint32 VmGetClock(void);
+
+#endif
@@ -0,0 +1,36 @@
+/*
+    Host build of the header ledparse generates from leds.led.
+*/
+
+#ifndef MULTI_LEDS_H
+#define MULTI_LEDS_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <csrtypes.h>
+
+typedef enum LedPatternTag
+{
+    LEDS_OFF ,
+    RED_ON ,
+    BLUE_ONE_SEC_ON_RPT ,
+    RED_ON_BLUE_ONE_SEC_ON_RPT ,
+    RED_ONE_SEC_ON_RPT ,
+    BLUE_SHORT_ON_RPT ,
+    RED_SHORT_ON_RPT ,
+    RED_ON_BLUE_SHORT_RPT ,
+    BLUE_TWO_FLASHES_RPT ,
+    RED_TWO_FLASHES_RPT ,
+    RED_BLUE_ALT_RPT_FAST ,
+    RED_BLUE_ALT_RPT ,
+    RED_REP_BLUE_ALT_RPT ,
+    RED_BLUE_BOTH_RPT_FAST ,
+    RED_BLUE_BOTH_RPT ,
+    RED_BLUE_BOTH_RPT_THREE ,
+    LEDS_EVENT_POWER_ON
+
+} LedPattern_t ;
+
+bool ledsPlay ( LedPattern_t pNewPattern ) ;
+
+#endif
@@ -0,0 +1,159 @@
+/*
+    Host simulation of the BlueCore VM for the audio adaptor.
+
+    The application sources are built unchanged against the headers in
+    host/fw and the CSR library headers, the firmware traps and the
+    libraries are replaced by:
+
+        sim_message.c   the message scheduler and simulated time
+        sim_ps.c        persistent store held in memory
+        sim_stream.c    Kalimba, streams, the UART, PIO, charger and the
+                        plugins
+        sim_lib.c       connection, A2DP, AGHFP, AVRCP, codec and audio
+                        libraries, answered by the scripted remotes
+        sim_main.c      the scenarios and the latency report
+
+    Time only moves when the scheduler delivers a message that is due
+    later, or when a blocking trap calls sim_busy(), so a run is the
+    same every time and two builds can be compared run to run.  All
+    times are in simulated milliseconds since boot.
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdio.h>
+
+#include <csrtypes.h>
+#include <message.h>
+#include <bdaddr_.h>
+
+/* Modelled costs, in ms.  Radio delays are typical of a BlueCore to a
+   headset at short range, the DSP ones are for a kap loaded from flash. */
+#define SIM_CL_INIT_MS      120     /* connection library and BlueStack start */
+#define SIM_LIB_INIT_MS     10      /* a profile library registering with the CL */
+#define SIM_HCI_MS          2       /* a local HCI command and its event */
+#define SIM_PAGE_MS         640     /* ACL up, R1 page scan */
+#define SIM_PAGE_TIMEOUT_MS 5120
+#define SIM_SDP_MS          60      /* an SDP transaction over an ACL */
+#define SIM_RFCOMM_DM_MS    20      /* an RFCOMM connect to a channel the remote refuses */
+#define SIM_HFP_SLC_MS      400     /* RFCOMM and the AT exchange of the SLC */
+#define SIM_A2DP_OPEN_MS    300     /* discover, get caps, set config, open */
+#define SIM_AVRCP_MS        80
+#define SIM_AVDTP_MS        40      /* start or suspend */
+#define SIM_SCO_MS          120     /* call setup and the eSCO link */
+#define SIM_INQUIRY_SLOT_MS 1280
+#define SIM_KAP_LOAD_MS     150     /* KalimbaLoad blocks the VM */
+#define SIM_KAP_OFF_MS      2
+#define SIM_GOLDEN_LOW      -60     /* dBm, the bottom of the golden receive range */
+#define SIM_UART_BUFFER     128     /* bytes the VM can have waiting in the UART sink */
+#define SIM_UART_DRAIN_MS   2       /* a full UART sink sent at 921600 baud */
+
+/* Events noted by the fakes, kept with their times for the report and
+   used by the scenarios to wait on. */
+typedef enum
+{
+    SIM_EV_NONE,
+    SIM_EV_BOOT,            /* APP_INIT delivered */
+    SIM_EV_READY,           /* APP_INIT_CFM delivered */
+    SIM_EV_INQUIRY,         /* ConnectionInquire */
+    SIM_EV_INQUIRY_RESULT,
+    SIM_EV_SDP,             /* ConnectionSdpOpenSearchRequest */
+    SIM_EV_PAGE,            /* the first page of a connection */
+    SIM_EV_ACL,
+    SIM_EV_HFP,             /* SLC up */
+    SIM_EV_A2DP,            /* signalling and media open */
+    SIM_EV_AVRCP,
+    SIM_EV_CONNECTING,      /* app entered AppStateConnecting */
+    SIM_EV_CONNECTED,       /* app left it with a device connected */
+    SIM_EV_A2DP_START,      /* A2dpStart */
+    SIM_EV_AUDIO_AV,        /* AudioConnect of an A2DP sink */
+    SIM_EV_AUDIO_SCO,       /* AudioConnect of a SCO sink */
+    SIM_EV_AUDIO_OFF,       /* AudioDisconnect */
+    SIM_EV_STREAM_ON,       /* APP_AUDIO_STREAMING_ACTIVE delivered */
+    SIM_EV_STREAM_OFF,      /* APP_AUDIO_STREAMING_INACTIVE delivered */
+    SIM_EV_CALL_ON,         /* APP_VOIP_CALL_ACTIVE delivered */
+    SIM_EV_CALL_OFF,        /* APP_VOIP_CALL_INACTIVE delivered */
+    SIM_EV_LINK_LOSS,
+    SIM_EV_KAP_LOAD,
+    SIM_EV_BITPOOL,         /* KALIMBA_SET_BITPOOL_MESSAGE with a new bitpool */
+    SIM_EV_PANIC,
+    SIM_EV_COUNT
+} sim_event_id;
+
+/* Profiles of a remote, the same bits as the app's mvdProfiles. */
+#define SIM_HSP             0x01
+#define SIM_HFP             0x02
+#define SIM_A2DP            0x04
+#define SIM_AVRCP           0x08
+
+/* A scripted remote device, a headset with some of the profiles. */
+typedef struct sim_remote
+{
+    const char *name;
+    bdaddr addr;
+    uint16 profiles;
+    bool present;           /* answers pages and inquiries */
+    bool eir_uuids;         /* its EIR lists the services, no SDP needed */
+    int16 rssi;             /* dBm */
+    uint8 link_quality;     /* HCI link quality, 255 is no errors */
+    uint8 backlog;          /* percent of its media sink the radio has not sent */
+    uint16 features[4];     /* LMP features, EDR decides the SBC bitpool */
+    uint8 max_bitpool;
+    uint8 hfp_channel;      /* RFCOMM server channel of its HF service */
+    /* link state, kept by sim_lib.c */
+    uint32 acl_at;          /* when the ACL is or will be up, 0 when down */
+    Sink hfp_sink;
+    Sink sig_sink;
+    Sink media_sink;
+    Sink sco_sink;
+    Sink avrcp_sink;
+    Task a2dp_task;
+    Task avrcp_task;
+    uint16 a2dp_id;         /* the addresses stand in for the library instances */
+    uint16 avrcp_id;
+} sim_remote;
+
+#define SIM_MAX_REMOTES     4
+
+/* sim_message.c */
+extern uint32 sim_now;
+extern Task sim_uart_task;  /* given the UART's stream messages by MessageSinkTask */
+extern uint32 sim_end;      /* MessageLoop returns once nothing is due before it */
+extern uint32 sim_delivered;
+void sim_busy(uint32 ms);
+uint16 sim_pending(Task task, MessageId id);
+
+/* sim_ps.c */
+void sim_ps_init(const char *dir, const char *extra);
+void sim_ps_add_device(const sim_remote *remote, bool most_recent);
+void sim_ps_add_service(uint8 hfp_channel);
+extern uint32 sim_ps_writes;
+
+/* sim_stream.c */
+extern uint32 sim_kap_loads;
+extern uint32 sim_dsp_busy_ms;
+extern uint16 sim_bitpool;      /* as the DSP encoder was last told */
+Sink sim_sink_new(const bdaddr *addr);
+void sim_sink_close(Sink sink);
+void sim_uart_send(const char *data);   /* the host sends data to the VM over the UART */
+extern FILE *sim_uart_file;     /* where what the VM sends over the UART goes, if anywhere */
+extern uint32 sim_uart_bytes;
+
+/* sim_lib.c */
+extern sim_remote sim_remotes[SIM_MAX_REMOTES];
+extern uint16 sim_num_remotes;
+sim_remote *sim_remote_add(const char *name, uint32 lap, uint16 profiles);
+void sim_remote_link_loss(sim_remote *remote);
+void sim_remote_passthrough(sim_remote *remote, uint16 opid);
+uint16 sim_remote_backlog(Sink sink);
+extern uint32 sim_sdp_searches; /* service searches, by the app or a library */
+extern uint16 sim_audio_sinks;  /* media sinks the audio plugin is sending to */
+
+/* sim_main.c */
+extern int sim_verbose;
+void sim_log(const char *fmt, ...);
+void sim_event(sim_event_id id);
+void sim_message_delivered(Task task, MessageId id, Message message);
+
+#endif
@@ -0,0 +1,1029 @@
+/*
+ * the connection, A2DP, AGHFP, AVRCP, codec, audio, battery and bdaddr
+ * libraries as the application sees them: each request is answered by
+ * the confirm the library would send, after the time the scripted
+ * remote takes over the air (SIM_*_MS in sim.h). a remote that is not
+ * present lets the page time out, one without a profile refuses it.
+ * remotes never connect in, every connection is made by the adaptor.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <message.h>
+#include <panic.h>
+#include <sink.h>
+#include <connection.h>
+#include <a2dp.h>
+#include <aghfp.h>
+#include <avrcp.h>
+#include <codec.h>
+#include <audio.h>
+#include <battery.h>
+#include <bdaddr.h>
+
+#include "sim.h"
+#include "../audioAdaptor_private.h"
+
+#define MAKE_LIB_MESSAGE(TYPE) TYPE##_T *message = msg_new(sizeof(TYPE##_T))
+
+/* internal messages of the simulated baseband */
+enum{
+    SIM_ACL_UP
+};
+
+typedef struct{
+    sim_remote *remote;
+}SIM_ACL_UP_T;
+
+sim_remote sim_remotes[SIM_MAX_REMOTES];
+uint16 sim_num_remotes;
+uint16 sim_audio_sinks;
+uint32 sim_sdp_searches;
+
+static void baseband_handler(Task task, MessageId id, Message message);
+static TaskData baseband_task = { baseband_handler };
+static Task cl_task;
+static Task aghfp_task;
+static uint16 aghfp_instance;
+static sim_remote *hfp_remote;
+static uint16 codec_instance;
+static uint8 sbc_caps[] = {
+    0x01, 0x00,                     /* media transport */
+    0x07, 0x06, 0x00, 0x00,         /* media codec, audio, SBC */
+    0x21,                           /* 44.1kHz, joint stereo */
+    0x15,                           /* 16 blocks, 8 subbands, loudness */
+    0x02, 0x35                      /* bitpool 2..53 */
+};
+
+#define AGHFP_INSTANCE  ((AGHFP *)&aghfp_instance)
+
+static void *msg_new(size_t size)
+{
+    return memset(PanicUnlessMalloc(size), 0, size);
+}
+
+sim_remote *sim_remote_add(const char *name, uint32 lap, uint16 profiles)
+{
+    sim_remote *r;
+
+    if(sim_num_remotes == SIM_MAX_REMOTES)
+        Panic();
+    r = &sim_remotes[sim_num_remotes++];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->addr.nap = 0x0002;
+    r->addr.uap = 0x5b;
+    r->addr.lap = lap;
+    r->profiles = profiles;
+    r->present = TRUE;
+    r->eir_uuids = TRUE;
+    r->rssi = -50;
+    r->link_quality = 255;
+    r->features[0] = 0xffff;
+    r->features[1] = 0xfe8f;
+    r->features[2] = 0x79fe;
+    r->features[3] = 0x8000;
+    r->max_bitpool = 53;
+    r->hfp_channel = 3;
+    return r;
+}
+
+static sim_remote *remote_from_addr(const bdaddr *addr)
+{
+    uint16 i;
+
+    for(i=0;i<sim_num_remotes;i++)
+        if(BdaddrIsSame(&sim_remotes[i].addr, addr))
+            return &sim_remotes[i];
+    return NULL;
+}
+
+static sim_remote *remote_from_sink(Sink sink)
+{
+    bdaddr addr;
+
+    return SinkGetBdAddr(sink, &addr) ? remote_from_addr(&addr) : NULL;
+}
+
+static sim_remote *remote_from_a2dp(A2DP *a2dp)
+{
+    uint16 i;
+
+    for(i=0;i<sim_num_remotes;i++)
+        if((void *)&sim_remotes[i].a2dp_id == (void *)a2dp)
+            return &sim_remotes[i];
+    return NULL;
+}
+
+static sim_remote *remote_from_avrcp(AVRCP *avrcp)
+{
+    uint16 i;
+
+    for(i=0;i<sim_num_remotes;i++)
+        if((void *)&sim_remotes[i].avrcp_id == (void *)avrcp)
+            return &sim_remotes[i];
+    return NULL;
+}
+
+#define A2DP_INSTANCE(r)    ((A2DP *)&(r)->a2dp_id)
+#define AVRCP_INSTANCE(r)   ((AVRCP *)&(r)->avrcp_id)
+
+/* ms until the ACL to a present remote is up, paging it first */
+static uint32 link_delay(sim_remote *r)
+{
+    if(r->acl_at == 0){
+        MAKE_LIB_MESSAGE(SIM_ACL_UP);
+        message->remote = r;
+        r->acl_at = sim_now + SIM_PAGE_MS;
+        sim_log("page %s", r->name);
+        sim_event(SIM_EV_PAGE);
+        MessageSendLater(&baseband_task, SIM_ACL_UP, message, SIM_PAGE_MS);
+    }
+    return r->acl_at > sim_now ? r->acl_at - sim_now : 0;
+}
+
+/* whether a connection to the profile will succeed, and after how long */
+static bool remote_answers(sim_remote *r, uint16 profile, uint32 *delay)
+{
+    if(r == NULL || !r->present){
+        *delay = SIM_PAGE_TIMEOUT_MS;
+        return FALSE;
+    }
+    *delay = link_delay(r);
+    return (r->profiles & profile) != 0;
+}
+
+static void baseband_handler(Task task, MessageId id, Message message)
+{
+    if(id == SIM_ACL_UP){
+        sim_remote *r = ((const SIM_ACL_UP_T *)message)->remote;
+
+        if(r->acl_at == 0 || r->acl_at > sim_now)
+            return;
+        sim_event(SIM_EV_ACL);
+        if(cl_task){
+            MAKE_LIB_MESSAGE(CL_DM_ACL_OPENED_IND);
+            message->bd_addr = r->addr;
+            message->incoming = FALSE;
+            message->status = hci_success;
+            MessageSend(cl_task, CL_DM_ACL_OPENED_IND, message);
+        }
+    }
+}
+
+/* the remote goes out of range: every link to it drops */
+void sim_remote_link_loss(sim_remote *r)
+{
+    sim_log("link loss %s", r->name);
+    sim_event(SIM_EV_LINK_LOSS);
+    r->present = FALSE;
+    if(r->hfp_sink && aghfp_task){
+        MAKE_LIB_MESSAGE(AGHFP_SLC_DISCONNECT_IND);
+        message->aghfp = AGHFP_INSTANCE;
+        message->status = aghfp_disconnect_link_loss;
+        MessageSend(aghfp_task, AGHFP_SLC_DISCONNECT_IND, message);
+        sim_sink_close(r->hfp_sink);
+        sim_sink_close(r->sco_sink);
+        r->hfp_sink = r->sco_sink = NULL;
+        hfp_remote = NULL;
+    }
+    if(r->sig_sink){
+        if(r->media_sink){
+            MAKE_LIB_MESSAGE(A2DP_CLOSE_IND);
+            message->a2dp = A2DP_INSTANCE(r);
+            message->status = a2dp_disconnect_link_loss;
+            message->media_sink = r->media_sink;
+            MessageSend(r->a2dp_task, A2DP_CLOSE_IND, message);
+            sim_sink_close(r->media_sink);
+            r->media_sink = NULL;
+        }
+        {
+            MAKE_LIB_MESSAGE(A2DP_SIGNALLING_CHANNEL_DISCONNECT_IND);
+            message->a2dp = A2DP_INSTANCE(r);
+            message->sink = r->sig_sink;
+            message->status = a2dp_disconnect_link_loss;
+            MessageSend(r->a2dp_task, A2DP_SIGNALLING_CHANNEL_DISCONNECT_IND, message);
+        }
+        sim_sink_close(r->sig_sink);
+        r->sig_sink = NULL;
+    }
+    if(r->avrcp_sink){
+        MAKE_LIB_MESSAGE(AVRCP_DISCONNECT_IND);
+        message->avrcp = AVRCP_INSTANCE(r);
+        message->status = avrcp_link_loss;
+        message->sink = r->avrcp_sink;
+        MessageSend(r->avrcp_task, AVRCP_DISCONNECT_IND, message);
+        sim_sink_close(r->avrcp_sink);
+        r->avrcp_sink = NULL;
+    }
+    if(r->acl_at){
+        r->acl_at = 0;
+        if(cl_task){
+            MAKE_LIB_MESSAGE(CL_DM_ACL_CLOSED_IND);
+            message->bd_addr = r->addr;
+            message->status = hci_error_conn_timeout;
+            MessageSend(cl_task, CL_DM_ACL_CLOSED_IND, message);
+        }
+    }
+}
+
+/* a button press and release on the remote's AVRCP controller */
+void sim_remote_passthrough(sim_remote *r, uint16 opid)
+{
+    uint16 state;
+
+    if(r->avrcp_sink == NULL)
+        return;
+    for(state=0;state<2;state++){
+        MAKE_LIB_MESSAGE(AVRCP_PASSTHROUGH_IND);
+        message->avrcp = AVRCP_INSTANCE(r);
+        message->sink = r->avrcp_sink;
+        message->subunit_type = subunit_panel;
+        message->opid = (avc_operation_id)opid;
+        message->state = state;
+        MessageSend(r->avrcp_task, AVRCP_PASSTHROUGH_IND, message);
+    }
+}
+
+/* connection library */
+
+void ConnectionInit(Task theAppTask)
+{
+    MAKE_LIB_MESSAGE(CL_INIT_CFM);
+    cl_task = theAppTask;
+    message->status = success;
+    message->version = bluetooth2_1;
+    MessageSendLater(theAppTask, CL_INIT_CFM, message, SIM_CL_INIT_MS);
+}
+
+void ConnectionWriteInquiryMode(Task theAppTask, inquiry_mode mode)
+{
+    MAKE_LIB_MESSAGE(CL_DM_WRITE_INQUIRY_MODE_CFM);
+    message->status = hci_success;
+    MessageSendLater(theAppTask, CL_DM_WRITE_INQUIRY_MODE_CFM, message, SIM_HCI_MS);
+}
+
+void ConnectionReadInquiryTx(Task theAppTask)
+{
+    MAKE_LIB_MESSAGE(CL_DM_READ_INQUIRY_TX_CFM);
+    message->status = hci_success;
+    message->tx_power = 4;
+    MessageSendLater(theAppTask, CL_DM_READ_INQUIRY_TX_CFM, message, SIM_HCI_MS);
+}
+
+void ConnectionReadLocalName(Task theAppTask)
+{
+    static const char name[] = "CSR Audio Adaptor";
+    CL_DM_LOCAL_NAME_COMPLETE_T *message = msg_new(sizeof(CL_DM_LOCAL_NAME_COMPLETE_T) + sizeof(name));
+
+    message->status = hci_success;
+    message->size_local_name = sizeof(name) - 1;
+    memcpy(message->local_name, name, sizeof(name));
+    MessageSendLater(theAppTask, CL_DM_LOCAL_NAME_COMPLETE, message, SIM_HCI_MS);
+}
+
+void ConnectionGetRole(Task theAppTask, Sink sink)
+{
+    MAKE_LIB_MESSAGE(CL_DM_ROLE_CFM);
+    message->sink = sink;
+    message->status = hci_success;
+    message->role = hci_role_master;
+    MessageSendLater(theAppTask, CL_DM_ROLE_CFM, message, SIM_HCI_MS);
+}
+
+void ConnectionSetRole(Task theAppTask, Sink sink, hci_role role)
+{
+    MAKE_LIB_MESSAGE(CL_DM_ROLE_CFM);
+    message->sink = sink;
+    message->status = hci_success;
+    message->role = role;
+    MessageSendLater(theAppTask, CL_DM_ROLE_CFM, message, SIM_SDP_MS);
+}
+
+void ConnectionReadRemoteSuppFeatures(Task theAppTask, Sink sink)
+{
+    sim_remote *r = remote_from_sink(sink);
+    MAKE_LIB_MESSAGE(CL_DM_REMOTE_FEATURES_CFM);
+
+    message->sink = sink;
+    message->status = r ? hci_success : hci_error_no_connection;
+    if(r)
+        memcpy(message->features, r->features, sizeof(message->features));
+    MessageSendLater(theAppTask, CL_DM_REMOTE_FEATURES_CFM, message, SIM_SDP_MS);
+}
+
+/* relative to the golden receive range, as the HCI reports it */
+void ConnectionGetRssi(Task theAppTask, Sink sink)
+{
+    sim_remote *r = remote_from_sink(sink);
+    MAKE_LIB_MESSAGE(CL_DM_RSSI_CFM);
+
+    message->sink = sink;
+    message->status = r ? hci_success : hci_error_no_connection;
+    message->rssi = r && r->rssi < SIM_GOLDEN_LOW ? (uint8)(r->rssi - SIM_GOLDEN_LOW) : 0;
+    MessageSendLater(theAppTask, CL_DM_RSSI_CFM, message, SIM_HCI_MS);
+}
+
+void ConnectionGetLinkQuality(Task theAppTask, Sink sink)
+{
+    sim_remote *r = remote_from_sink(sink);
+    MAKE_LIB_MESSAGE(CL_DM_LINK_QUALITY_CFM);
+
+    message->sink = sink;
+    message->status = r ? hci_success : hci_error_no_connection;
+    message->link_quality = r ? r->link_quality : 0;
+    MessageSendLater(theAppTask, CL_DM_LINK_QUALITY_CFM, message, SIM_HCI_MS);
+}
+
+uint16 sim_remote_backlog(Sink sink)
+{
+    sim_remote *r = remote_from_sink(sink);
+
+    return r && sink == r->media_sink ? r->backlog : 0;
+}
+
+/* 0x03 complete list of 16 bit UUIDs, then the services of the remote */
+static uint8 remote_eir(const sim_remote *r, uint8 *eir)
+{
+    static const struct{ uint16 profile, uuid; } uuids[] = {
+        { SIM_HSP, 0x1108 }, { SIM_HFP, 0x111e }, { SIM_A2DP, 0x110b }, { SIM_AVRCP, 0x110e }
+    };
+    uint8 n = 2, i;
+
+    eir[1] = 0x03;
+    for(i=0;i<sizeof(uuids)/sizeof(uuids[0]);i++){
+        if(r->profiles & uuids[i].profile){
+            eir[n++] = uuids[i].uuid & 0xff;
+            eir[n++] = uuids[i].uuid >> 8;
+        }
+    }
+    eir[0] = n - 1;
+    return n;
+}
+
+/* remotes answer in the order they were added, SIM_INQUIRY_SLOT_MS / 4 apart */
+void ConnectionInquire(Task theAppTask, uint32 inquiry_lap, uint8 max_responses, uint16 timeout, uint32 class_of_device)
+{
+    uint16 i, found = 0;
+    uint8 eir[16];
+
+    sim_event(SIM_EV_INQUIRY);
+    for(i=0;i<sim_num_remotes && found < max_responses;i++){
+        sim_remote *r = &sim_remotes[i];
+        uint8 size = r->eir_uuids ? remote_eir(r, eir) : 0;
+        CL_DM_INQUIRE_RESULT_T *message;
+
+        if(!r->present)
+            continue;
+        message = msg_new(sizeof(CL_DM_INQUIRE_RESULT_T) + size);
+        message->status = inquiry_status_result;
+        message->bd_addr = r->addr;
+        message->dev_class = 0x240404;      /* audio, wearable headset */
+        message->rssi = r->rssi;
+        message->size_eir_data = size;
+        memcpy(message->eir_data, eir, size);
+        found++;
+        MessageSendLater(theAppTask, CL_DM_INQUIRE_RESULT, message, found * SIM_INQUIRY_SLOT_MS / 4);
+    }
+    {
+        MAKE_LIB_MESSAGE(CL_DM_INQUIRE_RESULT);
+        message->status = inquiry_status_ready;
+        MessageSendLater(theAppTask, CL_DM_INQUIRE_RESULT, message, (uint32)timeout * SIM_INQUIRY_SLOT_MS);
+    }
+}
+
+void ConnectionInquireCancel(Task theAppTask)
+{
+    MessageCancelAll(theAppTask, CL_DM_INQUIRE_RESULT);
+    {
+        MAKE_LIB_MESSAGE(CL_DM_INQUIRE_RESULT);
+        message->status = inquiry_status_ready;
+        MessageSendLater(theAppTask, CL_DM_INQUIRE_RESULT, message, SIM_HCI_MS);
+    }
+}
+
+static sim_remote *sdp_remote;
+
+void ConnectionSdpOpenSearchRequest(Task theAppTask, const bdaddr *bd_addr)
+{
+    uint32 delay;
+    MAKE_LIB_MESSAGE(CL_SDP_OPEN_SEARCH_CFM);
+
+    sim_event(SIM_EV_SDP);
+    sdp_remote = remote_from_addr(bd_addr);
+    remote_answers(sdp_remote, 0, &delay);
+    message->status = sdp_remote && sdp_remote->present ? sdp_open_search_ok : sdp_open_search_failed;
+    MessageSendLater(theAppTask, CL_SDP_OPEN_SEARCH_CFM, message, delay + SIM_SDP_MS);
+}
+
+/* the pattern is a sequence of one UUID16: 35 03 19 hi lo */
+void ConnectionSdpServiceSearchRequest(Task theAppTask, const bdaddr *bd_addr, uint16 max_num_recs, uint16 size_search_pattern, const uint8 *search_pattern)
+{
+    static const struct{ uint16 uuid, profile; } services[] = {
+        { 0x1108, SIM_HSP }, { 0x111e, SIM_HFP }, { 0x110d, SIM_A2DP }, { 0x110b, SIM_A2DP }, { 0x110e, SIM_AVRCP }
+    };
+    sim_remote *r = remote_from_addr(bd_addr);
+    uint16 uuid = size_search_pattern >= 5 ? (uint16)(search_pattern[3] << 8 | search_pattern[4]) : 0;
+    bool found = FALSE;
+    uint16 i;
+    CL_SDP_SERVICE_SEARCH_CFM_T *message = msg_new(sizeof(CL_SDP_SERVICE_SEARCH_CFM_T) + 4);
+
+    sim_sdp_searches++;
+
+    for(i=0;r && r->present && i<sizeof(services)/sizeof(services[0]);i++)
+        if(services[i].uuid == uuid && (r->profiles & services[i].profile))
+            found = TRUE;
+    message->bd_addr = *bd_addr;
+    if(found){
+        message->status = sdp_response_success;
+        message->num_records = 1;
+        message->size_records = 4;
+        message->records[0] = 0x00;
+        message->records[1] = 0x01;
+        message->records[2] = 0x00;
+        message->records[3] = (uint8)i;
+    }else{
+        message->status = sdp_no_response_data;
+    }
+    MessageSendLater(theAppTask, CL_SDP_SERVICE_SEARCH_CFM, message, SIM_SDP_MS);
+}
+
+void ConnectionSdpCloseSearchRequest(Task theAppTask)
+{
+    MAKE_LIB_MESSAGE(CL_SDP_CLOSE_SEARCH_CFM);
+    message->status = (sdp_close_status)0;     /* the raw BlueStack result, 0 is success */
+    sdp_remote = NULL;
+    MessageSendLater(theAppTask, CL_SDP_CLOSE_SEARCH_CFM, message, SIM_HCI_MS);
+}
+
+void ConnectionSdpTerminatePrimitiveRequest(Task theAppTask)
+{
+}
+
+void ConnectionEnterDutMode(void)
+{
+    sim_log("device under test mode");
+}
+
+void ConnectionSetLinkPolicy(Sink sink, uint16 size_power_table, lp_power_table const *power_table)
+{
+}
+
+void ConnectionSetLinkSupervisionTimeout(Sink sink, uint16 timeout)
+{
+}
+
+void ConnectionSetRoleSwitchParams(const uint16 *rs_table)
+{
+}
+
+void ConnectionSmAuthoriseResponse(const bdaddr *bd_addr, dm_protocol_id protocol_id, uint32 channel, bool incoming, bool authorised)
+{
+}
+
+void ConnectionSmDeleteAllAuthDevices(uint16 ps_base)
+{
+}
+
+void ConnectionSmDeleteAuthDevice(const bdaddr *bd_addr)
+{
+}
+
+void ConnectionSmEncryptionKeyRefresh(const bdaddr *bd_addr)
+{
+}
+
+void ConnectionSmIoCapabilityResponse(const bdaddr *bd_addr, cl_sm_io_capability io_capability, bool force_mitm, bool bonding, bool oob_data_present, uint8 *oob_hash_c, uint8 *oob_rand_r)
+{
+}
+
+void ConnectionSmPinCodeResponse(const bdaddr *bd_addr, uint16 size_pin_code, const uint8 *pin_code)
+{
+}
+
+void ConnectionSmSecModeConfig(Task theAppTask, cl_sm_wae write_auth_enable, bool debug_keys, bool legacy_auto_pair_missing_key)
+{
+}
+
+void ConnectionSmSetSecurityLevel(dm_protocol_id protocol_id, uint32 channel, dm_ssp_security_level ssp_sec_level, bool outgoing_ok, bool authorised, bool disable_legacy)
+{
+}
+
+void ConnectionSmUserConfirmationResponse(const bdaddr *bd_addr, bool confirm)
+{
+}
+
+void ConnectionWriteClassOfDevice(uint32 cod)
+{
+}
+
+void ConnectionWriteEirData(uint8 fec_required, uint8 size_eir_data, const uint8 *eir_data)
+{
+}
+
+void ConnectionWriteInquiryscanActivity(uint16 interval, uint16 window)
+{
+}
+
+void ConnectionWritePagescanActivity(uint16 interval, uint16 window)
+{
+}
+
+void ConnectionWriteScanEnable(hci_scan_enable mode)
+{
+}
+
+/* A2DP, source role */
+
+static device_sep_list *a2dp_sep_list;
+
+void A2dpInit(Task clientTask, uint16 role, service_record_type *service_records, uint16 size_seps, sep_data_type *seps)
+{
+    MAKE_LIB_MESSAGE(A2DP_INIT_CFM);
+    message->status = a2dp_success;
+    message->sep_list = a2dp_sep_list = (device_sep_list *)&a2dp_sep_list;
+    MessageSendLater(clientTask, A2DP_INIT_CFM, message, SIM_LIB_INIT_MS);
+}
+
+/* the configuration the remote picks stays within the adaptor's SBC caps,
+   which go up to SBC_BITPOOL_HIGH_QUALITY */
+static uint8 configured_bitpool(const sim_remote *r)
+{
+    return r->max_bitpool < 50 ? r->max_bitpool : 50;
+}
+
+/* SBC at 44.1kHz joint stereo, up to the remote's bitpool */
+static void send_codec_settings(sim_remote *r, uint8 seid, uint32 delay)
+{
+    A2DP_CODEC_SETTINGS_IND_T *message = msg_new(sizeof(A2DP_CODEC_SETTINGS_IND_T) + sizeof(sbc_caps));
+
+    message->a2dp = A2DP_INSTANCE(r);
+    message->rate = 44100;
+    message->channel_mode = a2dp_joint_stereo;
+    message->seid = seid;
+    message->codecData.bitpool = configured_bitpool(r);
+    message->codecData.format = 0x7d;
+    message->codecData.packet_size = 668;
+    message->configured_codec_caps_size = sizeof(sbc_caps);
+    memcpy(message->configured_codec_caps, sbc_caps, sizeof(sbc_caps));
+    message->configured_codec_caps[sizeof(sbc_caps) - 1] = configured_bitpool(r);
+    MessageSendLater(r->a2dp_task, A2DP_CODEC_SETTINGS_IND, message, delay);
+}
+
+void A2dpConnectOpen(Task clientTask, const bdaddr *addr, uint16 size_local_seids, uint8 *local_seids, device_sep_list *sep_list)
+{
+    sim_remote *r = remote_from_addr(addr);
+    uint8 seid = size_local_seids ? local_seids[0] : 1;
+    uint32 delay;
+    MAKE_LIB_MESSAGE(A2DP_CONNECT_OPEN_CFM);
+
+    message->seid = seid;
+    if(remote_answers(r, SIM_A2DP, &delay) && r->sig_sink == NULL){
+        delay += SIM_A2DP_OPEN_MS;
+        r->a2dp_task = clientTask;
+        r->sig_sink = sim_sink_new(addr);
+        r->media_sink = sim_sink_new(addr);
+        send_codec_settings(r, seid, delay);
+        message->a2dp = A2DP_INSTANCE(r);
+        message->status = a2dp_success;
+        message->signalling_sink = r->sig_sink;
+        message->media_sink = r->media_sink;
+    }else{
+        message->status = r && r->present ? a2dp_rejected_by_remote_device : a2dp_operation_fail;
+    }
+    MessageSendLater(clientTask, A2DP_CONNECT_OPEN_CFM, message, delay);
+}
+
+void A2dpOpen(A2DP *a2dp, uint16 size_local_seids, uint8 *local_seids)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+    uint8 seid = size_local_seids ? local_seids[0] : 1;
+    MAKE_LIB_MESSAGE(A2DP_OPEN_CFM);
+
+    if(r == NULL){
+        free(message);
+        return;
+    }
+    message->a2dp = a2dp;
+    message->seid = seid;
+    if(r->sig_sink && r->media_sink == NULL){
+        r->media_sink = sim_sink_new(&r->addr);
+        send_codec_settings(r, seid, SIM_A2DP_OPEN_MS);
+        message->status = a2dp_success;
+        message->media_sink = r->media_sink;
+    }else{
+        message->status = a2dp_wrong_state;
+    }
+    MessageSendLater(r->a2dp_task, A2DP_OPEN_CFM, message, SIM_A2DP_OPEN_MS);
+}
+
+void A2dpStart(A2DP *a2dp)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+    MAKE_LIB_MESSAGE(A2DP_START_CFM);
+
+    sim_event(SIM_EV_A2DP_START);
+    if(r == NULL){
+        free(message);
+        return;
+    }
+    message->a2dp = a2dp;
+    message->status = r->media_sink ? a2dp_success : a2dp_no_media_connection;
+    message->media_sink = r->media_sink;
+    MessageSendLater(r->a2dp_task, A2DP_START_CFM, message, SIM_AVDTP_MS);
+}
+
+void A2dpSuspend(A2DP *a2dp)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+    MAKE_LIB_MESSAGE(A2DP_SUSPEND_CFM);
+
+    if(r == NULL){
+        free(message);
+        return;
+    }
+    message->a2dp = a2dp;
+    message->status = r->media_sink ? a2dp_success : a2dp_no_media_connection;
+    message->media_sink = r->media_sink;
+    MessageSendLater(r->a2dp_task, A2DP_SUSPEND_CFM, message, SIM_AVDTP_MS);
+}
+
+void A2dpClose(A2DP *a2dp)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+    MAKE_LIB_MESSAGE(A2DP_CLOSE_CFM);
+
+    if(r == NULL){
+        free(message);
+        return;
+    }
+    message->a2dp = a2dp;
+    message->status = r->media_sink ? a2dp_success : a2dp_no_media_connection;
+    message->media_sink = r->media_sink;
+    sim_sink_close(r->media_sink);
+    r->media_sink = NULL;
+    MessageSendLater(r->a2dp_task, A2DP_CLOSE_CFM, message, SIM_AVDTP_MS);
+}
+
+void A2dpDisconnectAll(A2DP *a2dp)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+
+    if(r == NULL || r->sig_sink == NULL)
+        return;
+    if(r->media_sink){
+        MAKE_LIB_MESSAGE(A2DP_CLOSE_IND);
+        message->a2dp = a2dp;
+        message->status = a2dp_success;
+        message->media_sink = r->media_sink;
+        MessageSendLater(r->a2dp_task, A2DP_CLOSE_IND, message, SIM_AVDTP_MS);
+        sim_sink_close(r->media_sink);
+        r->media_sink = NULL;
+    }
+    {
+        MAKE_LIB_MESSAGE(A2DP_SIGNALLING_CHANNEL_DISCONNECT_IND);
+        message->a2dp = a2dp;
+        message->sink = r->sig_sink;
+        message->status = a2dp_success;
+        MessageSendLater(r->a2dp_task, A2DP_SIGNALLING_CHANNEL_DISCONNECT_IND, message, 2 * SIM_AVDTP_MS);
+    }
+    sim_sink_close(r->sig_sink);
+    r->sig_sink = NULL;
+}
+
+uint8 *A2dpGetCurrentSepConfiguration(A2DP *a2dp, uint16 *size_caps)
+{
+    sim_remote *r = remote_from_a2dp(a2dp);
+    uint8 *caps = PanicUnlessMalloc(sizeof(sbc_caps));
+
+    memcpy(caps, sbc_caps, sizeof(sbc_caps));
+    if(r)
+        caps[sizeof(sbc_caps) - 1] = configured_bitpool(r);
+    *size_caps = sizeof(sbc_caps);
+    return caps;
+}
+
+void A2dpConfigureCodecResponse(A2DP *a2dp, bool accept, uint16 size_codec_service_caps, uint8 *codec_service_caps)
+{
+}
+
+void A2dpConnectSignallingChannelResponse(Task clientTask, A2DP *a2dp, bool accept, uint16 connection_id, device_sep_list *sep_list)
+{
+}
+
+/* AGHFP, one instance for the one HFP link */
+
+void AghfpInit(Task theAppTask, aghfp_profile aghfp_supported_profile, uint16 supported_features)
+{
+    MAKE_LIB_MESSAGE(AGHFP_INIT_CFM);
+    aghfp_task = theAppTask;
+    message->aghfp = AGHFP_INSTANCE;
+    message->status = aghfp_init_success;
+    MessageSendLater(theAppTask, AGHFP_INIT_CFM, message, SIM_LIB_INIT_MS);
+}
+
+/* the library searches for the HF's server channel unless it is given
+   one, and searches anyway if the HF refuses the one given */
+void AghfpSlcConnectUsingChannel(AGHFP *aghfp, const bdaddr *bd_addr, uint8 rfc_channel)
+{
+    sim_remote *r = remote_from_addr(bd_addr);
+    uint32 delay;
+    MAKE_LIB_MESSAGE(AGHFP_SLC_CONNECT_CFM);
+
+    message->aghfp = aghfp;
+    if(remote_answers(r, SIM_HFP, &delay) && hfp_remote == NULL){
+        if(rfc_channel && rfc_channel != r->hfp_channel){
+            sim_log("aghfp channel %u refused", rfc_channel);
+            delay += SIM_RFCOMM_DM_MS;
+            rfc_channel = 0;
+        }
+        if(rfc_channel == 0){
+            sim_sdp_searches++;
+            delay += SIM_SDP_MS;
+        }
+        delay += SIM_HFP_SLC_MS;
+        hfp_remote = r;
+        r->hfp_sink = sim_sink_new(bd_addr);
+        message->status = aghfp_connect_success;
+        message->rfcomm_sink = r->hfp_sink;
+        message->rfc_channel = r->hfp_channel;
+    }else{
+        message->status = r && r->present ? aghfp_connect_sdp_fail : aghfp_connect_timeout;
+    }
+    MessageSendLater(aghfp_task, AGHFP_SLC_CONNECT_CFM, message, delay);
+}
+
+void AghfpSlcConnect(AGHFP *aghfp, const bdaddr *bd_addr)
+{
+    AghfpSlcConnectUsingChannel(aghfp, bd_addr, 0);
+}
+
+void AghfpSlcDisconnect(AGHFP *aghfp)
+{
+    MAKE_LIB_MESSAGE(AGHFP_SLC_DISCONNECT_IND);
+    message->aghfp = aghfp;
+    if(hfp_remote){
+        sim_sink_close(hfp_remote->hfp_sink);
+        sim_sink_close(hfp_remote->sco_sink);
+        hfp_remote->hfp_sink = hfp_remote->sco_sink = NULL;
+        hfp_remote = NULL;
+        message->status = aghfp_disconnect_success;
+    }else{
+        message->status = aghfp_disconnect_no_slc;
+    }
+    MessageSendLater(aghfp_task, AGHFP_SLC_DISCONNECT_IND, message, SIM_SDP_MS);
+}
+
+static Sink sco_open(void)
+{
+    if(hfp_remote == NULL)
+        return NULL;
+    if(hfp_remote->sco_sink == NULL)
+        hfp_remote->sco_sink = sim_sink_new(&hfp_remote->addr);
+    return hfp_remote->sco_sink;
+}
+
+static void sco_close(void)
+{
+    if(hfp_remote && hfp_remote->sco_sink){
+        sim_sink_close(hfp_remote->sco_sink);
+        hfp_remote->sco_sink = NULL;
+    }
+}
+
+static void call_create(AGHFP *aghfp, bool audio)
+{
+    MAKE_LIB_MESSAGE(AGHFP_CALL_MGR_CREATE_CFM);
+    message->aghfp = aghfp;
+    message->status = hfp_remote ? aghfp_call_create_success : aghfp_call_create_failure;
+    message->audio_sink = audio ? sco_open() : NULL;
+    message->rx_bandwidth = message->tx_bandwidth = 8000;
+    MessageSendLater(aghfp_task, AGHFP_CALL_MGR_CREATE_CFM, message, SIM_SCO_MS);
+}
+
+void AghfpCallCreate(AGHFP *aghfp, aghfp_call_type call_type, bool in_band)
+{
+    call_create(aghfp, FALSE);
+}
+
+void AghfpCallCreateAudio(AGHFP *aghfp, aghfp_call_type call_type, bool in_band, sync_pkt_type packet_type, const aghfp_audio_params *audio_params)
+{
+    call_create(aghfp, TRUE);
+}
+
+void AghfpCallTerminate(AGHFP *aghfp, bool keep_sink)
+{
+    MAKE_LIB_MESSAGE(AGHFP_CALL_MGR_TERMINATE_IND);
+    message->aghfp = aghfp;
+    message->status = aghfp_call_terminate_success;
+    message->audio_sink = hfp_remote ? hfp_remote->sco_sink : NULL;
+    if(!keep_sink)
+        sco_close();
+    MessageSendLater(aghfp_task, AGHFP_CALL_MGR_TERMINATE_IND, message, SIM_SCO_MS);
+}
+
+void AghfpAudioConnect(AGHFP *aghfp, sync_pkt_type packet_type, const aghfp_audio_params *audio_params)
+{
+    MAKE_LIB_MESSAGE(AGHFP_AUDIO_CONNECT_CFM);
+    message->aghfp = aghfp;
+    message->audio_sink = sco_open();
+    message->status = message->audio_sink ? aghfp_audio_connect_success : aghfp_audio_connect_failure;
+    message->cl_status = hci_success;
+    message->link_type = sync_link_esco;
+    message->rx_bandwidth = message->tx_bandwidth = 8000;
+    MessageSendLater(aghfp_task, AGHFP_AUDIO_CONNECT_CFM, message, SIM_SCO_MS);
+}
+
+void AghfpAudioConnectResponse(AGHFP *aghfp, bool response, sync_pkt_type packet_type, const aghfp_audio_params *audio_params)
+{
+}
+
+void AghfpAudioDisconnect(AGHFP *aghfp)
+{
+    MAKE_LIB_MESSAGE(AGHFP_AUDIO_DISCONNECT_IND);
+    message->aghfp = aghfp;
+    message->status = aghfp_audio_disconnect_success;
+    sco_close();
+    MessageSendLater(aghfp_task, AGHFP_AUDIO_DISCONNECT_IND, message, SIM_AVDTP_MS);
+}
+
+void AghfpCallAnswer(AGHFP *aghfp)
+{
+}
+
+void AghfpCallRemoteAnswered(AGHFP *aghfp)
+{
+}
+
+void AghfpSendError(AGHFP *aghfp)
+{
+}
+
+void AghfpSendOk(AGHFP *aghfp)
+{
+}
+
+void AghfpSendNetworkOperator(AGHFP *aghfp, uint8 mode, uint16 size_operator, uint8 *operator)
+{
+}
+
+void AghfpSendSubscriberNumbersComplete(AGHFP *aghfp)
+{
+}
+
+void AghfpSetServiceState(AGHFP *aghfp, bool service_state)
+{
+}
+
+void AghfpSlcConnectResponse(AGHFP *aghfp, bool response, const bdaddr *bd_addr)
+{
+}
+
+void AghfpVoiceRecognitionEnable(AGHFP *aghfp, bool enable)
+{
+}
+
+/* AVRCP */
+
+void AvrcpInitLazy(Task clientTask, Task connectionTask, const avrcp_init_params *config)
+{
+    MAKE_LIB_MESSAGE(AVRCP_INIT_CFM);
+    message->status = avrcp_success;
+    MessageSendLater(clientTask, AVRCP_INIT_CFM, message, SIM_LIB_INIT_MS);
+}
+
+void AvrcpConnectLazy(Task clientTask, const bdaddr *bd_addr, const avrcp_init_params *config)
+{
+    sim_remote *r = remote_from_addr(bd_addr);
+    uint32 delay;
+    MAKE_LIB_MESSAGE(AVRCP_CONNECT_CFM);
+
+    if(remote_answers(r, SIM_AVRCP, &delay) && r->avrcp_sink == NULL){
+        delay += SIM_AVRCP_MS;
+        r->avrcp_task = clientTask;
+        r->avrcp_sink = sim_sink_new(bd_addr);
+        message->avrcp = AVRCP_INSTANCE(r);
+        message->status = avrcp_success;
+        message->sink = r->avrcp_sink;
+    }else{
+        message->status = r && r->present ? avrcp_fail : avrcp_timeout;
+    }
+    MessageSendLater(clientTask, AVRCP_CONNECT_CFM, message, delay);
+}
+
+void AvrcpDisconnect(AVRCP *avrcp)
+{
+    sim_remote *r = remote_from_avrcp(avrcp);
+    MAKE_LIB_MESSAGE(AVRCP_DISCONNECT_IND);
+
+    if(r == NULL){
+        free(message);
+        return;
+    }
+    message->avrcp = avrcp;
+    message->status = avrcp_success;
+    message->sink = r->avrcp_sink;
+    sim_sink_close(r->avrcp_sink);
+    r->avrcp_sink = NULL;
+    MessageSendLater(r->avrcp_task, AVRCP_DISCONNECT_IND, message, SIM_AVRCP_MS);
+}
+
+void AvrcpConnectResponseLazy(Task clientTask, AVRCP *avrcp, uint16 connection_id, bool accept, const avrcp_init_params *config)
+{
+}
+
+void AvrcpPassthroughResponse(AVRCP *avrcp, avrcp_response_type response)
+{
+}
+
+void AvrcpSubUnitInfoResponse(AVRCP *avrcp, bool accept, const uint8 *page_data)
+{
+}
+
+void AvrcpUnitInfoResponse(AVRCP *avrcp, bool accept, avc_subunit_type unit_type, uint8 unit, uint32 company_id)
+{
+}
+
+void AvrcpVendorDependentResponse(AVRCP *avrcp, avrcp_response_type response)
+{
+}
+
+/* codec and audio */
+
+void CodecInitCsrInternal(Task appTask)
+{
+    MAKE_LIB_MESSAGE(CODEC_INIT_CFM);
+    message->status = codec_success;
+    message->type_of_codec = codec_csr_internal;
+    message->inputGainRange = 22;
+    message->outputGainRange = 22;
+    message->codecTask = (Task)&codec_instance;
+    MessageSendLater(appTask, CODEC_INIT_CFM, message, SIM_HCI_MS);
+}
+
+void CodecConfigure(Task codecTask, const codec_config_params *config)
+{
+}
+
+void CodecEnable(Task codecTask)
+{
+}
+
+bool AudioConnect(Task audio_plugin, Sink audio_sink, AUDIO_SINK_T sink_type, Task codec_task, uint16 volume, uint32 rate, bool stereo, AUDIO_MODE_T mode, const void *params)
+{
+    sim_log("audio connect %s", sink_type == AUDIO_SINK_AV ? "a2dp" : "sco");
+    /* the SBC plugin starts the encoder with the bitpool the stream was configured with,
+       and packetises it for the sink and media_sink_b */
+    sim_audio_sinks = 1;
+    if(sink_type == AUDIO_SINK_AV && params){
+        sim_bitpool = ((const source_codec_data_type *)params)->bitpool;
+        if(((const source_codec_data_type *)params)->media_sink_b)
+            sim_audio_sinks++;
+    }
+    sim_event(sink_type == AUDIO_SINK_AV ? SIM_EV_AUDIO_AV : SIM_EV_AUDIO_SCO);
+    return TRUE;
+}
+
+void AudioDisconnect(void)
+{
+    sim_log("audio disconnect");
+    sim_audio_sinks = 0;
+    sim_event(SIM_EV_AUDIO_OFF);
+}
+
+/* only used to add and remove the sinks of a stream */
+bool AudioSetMode(AUDIO_MODE_T mode, const void *params)
+{
+    const dualstream_mode_params *dual_mode = params;
+
+    sim_log("audio %s sink", dual_mode->connect_sink ? "add" : "remove");
+    if(dual_mode->connect_sink)
+        sim_audio_sinks++;
+    else if(sim_audio_sinks)
+        sim_audio_sinks--;
+    free((void *)params);
+    return TRUE;
+}
+
+/* the battery is never read, the adaptor runs off USB power */
+void BatteryInit(BatteryState *state, Task client, battery_reading_source source, uint16 period)
+{
+}
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second)
+{
+    return first->nap == second->nap && first->uap == second->uap && first->lap == second->lap;
+}
+
+bool BdaddrIsZero(const bdaddr *in)
+{
+    return !in->nap && !in->uap && !in->lap;
+}
+
+void BdaddrSetZero(bdaddr *out)
+{
+    out->nap = 0;
+    out->uap = 0;
+    out->lap = 0;
+}
@@ -0,0 +1,744 @@
+/*
+ * adaptor_sim - the audio adaptor application on the host
+ *
+ * The application sources run unchanged on a simulated VM (see sim.h)
+ * against scripted remote headsets, from power on through connection,
+ * streaming and calls.  Time is simulated, so the latencies reported
+ * are the same on every run and only move when the application does.
+ *
+ * build on the host : gcc -g -DDEV_PC_1645_ANALOGUE -Dmain=app_main -D_init=app_init -I. -Ifw -I<lib>/a2dp ...
+ *                         -o adaptor_sim ../main.c ../audioAdaptor_*.c sim_*.c
+ *                     with -I<lib>/<library> for every library the application includes,
+ *                     and -DDUAL_STREAM etc. as the firmware is built
+ * usage             : adaptor_sim [-v] [-p psrdir] [-f extra.psr] [-t tracedir] scenario
+ *                     -v              prints the timeline
+ *                     -p psrdir       where the .psr files are, .. by default
+ *                     -f extra.psr    keys applied over them
+ *                     -t tracedir     at the end of each scenario the adaptor is asked
+ *                                     for its trace over the UART, which is written to
+ *                                     tracedir/<scenario>.trc for trace_decode.  needs
+ *                                     a build with -DENABLE_TRACE
+ *                     scenario        reconnect   a paired headset is reconnected at power on
+ *                                     stream      streaming stops, times out and restarts
+ *                                     call        a VoIP call interrupts streaming
+ *                                     discover    an unpaired headset is found and connected
+ *                                     busy        as discover, with nearer devices that are not
+ *                                                 headsets answering the inquiry first
+ *                                     linkloss    the headset goes out of range, comes back and
+ *                                                 is reconnected
+ *                                     cached      reconnect on the HF channel in PS, then after the
+ *                                                 headset has moved it
+ *                                     link        the link degrades while streaming and recovers
+ *                                     sinks       every sink the build allows streams at once,
+ *                                                 then the modelled sinks per bitpool
+ *                                     pdl         a full paired device list, the headset the least
+ *                                                 recent, reconnected while streaming then powered off
+ *                                     evict       a full paired device list, a new headset is found
+ *                                                 and replaces the least recent one
+ *                                     all         each of them in turn
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <connection.h>
+#include <a2dp.h>
+#include <aghfp.h>
+#include <avrcp.h>
+#include <ps.h>
+
+#include "sim.h"
+#include "../audioAdaptor_private.h"
+
+/* the application's main and _init are built as app_main and app_init,
+   the host has its own */
+#undef main
+extern void app_init(void);
+extern int app_main(void);
+
+#define HEADSET_LAP     0x112233
+
+/* the airtime model of the sinks scenario: SBC at 44.1kHz, joint stereo,
+   16 blocks and 8 subbands in the media packets the app configures.  the
+   budget and the resend rate are assumptions, nothing here is measured */
+#define SIM_SBC_FRAME_US        (16.0 * 8 * 1000000 / 44100)
+#define SIM_MEDIA_PACKET        668     /* bytes, as the codec is configured with */
+#define SIM_RTP_HEADER          13      /* RTP and the SBC header */
+#define SIM_L2CAP_HEADER        4
+#define SIM_SLOT_US             625
+#define SIM_AIR_BUDGET          80      /* percent of the air left to A2DP media */
+#define SIM_RESENDS             20      /* percent of baseband packets sent again */
+
+typedef struct{
+    uint32 first;
+    uint32 last;
+    uint32 count;
+}sim_time;
+
+typedef struct{
+    const char *name;
+    void (*run)(void);
+    const char *about;
+}sim_scenario;
+
+static const char * const event_names[SIM_EV_COUNT] = {
+    "-", "boot", "ready", "inquiry", "inquiry result", "sdp", "page", "acl",
+    "hfp", "a2dp", "avrcp", "connecting", "connected", "a2dp start",
+    "audio a2dp", "audio sco", "audio off", "stream on", "stream off",
+    "call on", "call off", "link loss", "kap load", "bitpool", "panic"
+};
+
+int sim_verbose;
+
+static sim_time events[SIM_EV_COUNT];
+static sim_event_id waiting;
+static bool waited;
+static mvdAppState last_state;
+static uint16 connected_insts;
+
+void sim_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if(!sim_verbose)
+        return;
+    va_start(ap, fmt);
+    printf("%8lu  ", (unsigned long)sim_now);
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+}
+
+/* a wait on the event stops the scheduler once the handler returns */
+void sim_event(sim_event_id id)
+{
+    sim_time *t = &events[id];
+
+    if(t->count++ == 0)
+        t->first = sim_now;
+    t->last = sim_now;
+    if(sim_verbose && id != SIM_EV_KAP_LOAD)
+        printf("%8lu  = %s\n", (unsigned long)sim_now, event_names[id]);
+    if(id == waiting){
+        waiting = SIM_EV_NONE;
+        waited = TRUE;
+        sim_end = sim_now;
+    }
+}
+
+/* events the application only shows by what it was sent, or by its state */
+void sim_message_delivered(Task task, MessageId id, Message message)
+{
+    uint16 i;
+
+    switch(id){
+    case APP_INIT:
+        sim_event(SIM_EV_BOOT);
+        break;
+    case APP_INIT_CFM:
+        sim_event(SIM_EV_READY);
+        break;
+    case APP_AUDIO_STREAMING_ACTIVE:
+        sim_event(SIM_EV_STREAM_ON);
+        break;
+    case APP_AUDIO_STREAMING_INACTIVE:
+        sim_event(SIM_EV_STREAM_OFF);
+        break;
+    case APP_VOIP_CALL_ACTIVE:
+        sim_event(SIM_EV_CALL_ON);
+        break;
+    case APP_VOIP_CALL_INACTIVE:
+        sim_event(SIM_EV_CALL_OFF);
+        break;
+    case CL_DM_INQUIRE_RESULT:
+        if(((const CL_DM_INQUIRE_RESULT_T *)message)->status == inquiry_status_result)
+            sim_event(SIM_EV_INQUIRY_RESULT);
+        break;
+    case AGHFP_SLC_CONNECT_CFM:
+        if(((const AGHFP_SLC_CONNECT_CFM_T *)message)->status == aghfp_connect_success)
+            sim_event(SIM_EV_HFP);
+        break;
+    case A2DP_CONNECT_OPEN_CFM:
+        if(((const A2DP_CONNECT_OPEN_CFM_T *)message)->status == a2dp_success)
+            sim_event(SIM_EV_A2DP);
+        break;
+    case AVRCP_CONNECT_CFM:
+        if(((const AVRCP_CONNECT_CFM_T *)message)->status == avrcp_success)
+            sim_event(SIM_EV_AVRCP);
+        break;
+    default:
+        break;
+    }
+    if(the_app->app_state != last_state){
+        sim_log("state %u -> %u", last_state, the_app->app_state);
+        if(the_app->app_state == AppStateConnecting)
+            sim_event(SIM_EV_CONNECTING);
+        last_state = the_app->app_state;
+    }
+    /* profileSlcConnectComplete marks the instance once every profile
+       the remote has has answered, the app state goes idle between them */
+    for(i=0;i<MAX_NUM_DEV_CONNECTIONS;i++){
+        bool connected = the_app->dev_inst[i] && the_app->dev_inst[i]->available_profiles_connected;
+
+        if(connected && !(connected_insts & (1 << i)))
+            sim_event(SIM_EV_CONNECTED);
+        connected_insts = connected ? connected_insts | (1 << i) : connected_insts & ~(1 << i);
+    }
+}
+
+/* runs the application until the event, FALSE when it has not happened
+   within timeout ms */
+static bool run_until(sim_event_id id, uint32 timeout)
+{
+    waiting = id;
+    waited = FALSE;
+    sim_end = sim_now + timeout;
+    if(the_app == NULL)
+        app_main();
+    else
+        MessageLoop();
+    waiting = SIM_EV_NONE;
+    if(!waited){
+        sim_now = sim_end;
+        printf("%8lu  no %s after %lu ms\n", (unsigned long)sim_now, event_names[id], (unsigned long)timeout);
+    }
+    return waited;
+}
+
+static void run_for(uint32 ms)
+{
+    sim_end = sim_now + ms;
+    MessageLoop();
+    sim_now = sim_end;
+}
+
+static void send_app(MessageId id)
+{
+    sim_log("host sends %04x", id);
+    MessageSend(&the_app->task, id, 0);
+}
+
+static void result(const char *name, uint32 from, uint32 to)
+{
+    printf("  %-36s %7lu ms\n", name, (unsigned long)(to - from));
+}
+
+static sim_remote *paired_headset(void)
+{
+    sim_remote *r = sim_remote_add("headset", HEADSET_LAP, SIM_HFP | SIM_A2DP | SIM_AVRCP);
+
+    sim_ps_add_device(r, TRUE);
+    return r;
+}
+
+/* as the connect button, without dropping a device already connected */
+static void send_connect_req(void)
+{
+    APP_DEVICE_CONNECT_REQ_T *message = PanicUnlessMalloc(sizeof(APP_DEVICE_CONNECT_REQ_T));
+
+    message->disconnect_current = FALSE;
+    sim_log("host sends %04x", APP_DEVICE_CONNECT_REQ);
+    MessageSend(&the_app->task, APP_DEVICE_CONNECT_REQ, message);
+}
+
+/* power on, to the first device connected within ms */
+static bool power_on_within(uint32 ms)
+{
+    app_init();
+    if(!run_until(SIM_EV_READY, 5000) || !run_until(SIM_EV_CONNECTED, ms))
+        return FALSE;
+    result("boot to ready", events[SIM_EV_BOOT].first, events[SIM_EV_READY].first);
+    result("ready to connected", events[SIM_EV_READY].first, events[SIM_EV_CONNECTED].first);
+    if(events[SIM_EV_HFP].count)
+        result("  hfp slc", events[SIM_EV_READY].first, events[SIM_EV_HFP].first);
+    if(events[SIM_EV_A2DP].count)
+        result("  a2dp open", events[SIM_EV_READY].first, events[SIM_EV_A2DP].first);
+    if(events[SIM_EV_AVRCP].count)
+        result("  avrcp", events[SIM_EV_READY].first, events[SIM_EV_AVRCP].first);
+    return TRUE;
+}
+
+static bool power_on(void)
+{
+    return power_on_within(60000);
+}
+
+/* the host starts playing as soon as the headset is connected */
+static bool first_stream(void)
+{
+    uint32 start = events[SIM_EV_CONNECTED].first;
+
+    send_app(APP_AUDIO_STREAMING_ACTIVE);
+    if(!run_until(SIM_EV_AUDIO_AV, 30000))
+        return FALSE;
+    result("connected to audio", start, events[SIM_EV_AUDIO_AV].last);
+    result("  a2dp start to audio", events[SIM_EV_A2DP_START].last, events[SIM_EV_AUDIO_AV].last);
+    return TRUE;
+}
+
+static void scenario_reconnect(void)
+{
+    paired_headset();
+    if(power_on())
+        first_stream();
+}
+
+/* the analogue build has no streaming timer, the USB one's is sent in its place */
+static void scenario_stream(void)
+{
+    uint32 t;
+
+    paired_headset();
+    if(!power_on() || !first_stream())
+        return;
+    run_for(10000);
+    t = sim_now;
+    send_app(APP_AUDIO_STREAMING_INACTIVE);
+    run_for(0);
+    if(!sim_pending(&the_app->task, APP_AUDIO_STREAMING_TIMER))
+        MessageSendLater(&the_app->task, APP_AUDIO_STREAMING_TIMER, 0, (uint32)the_app->audio_streaming_timeout * 1000);
+    if(!run_until(SIM_EV_AUDIO_OFF, 60000))
+        return;
+    result("stream inactive to audio off", t, sim_now);
+    run_for(5000);
+    t = sim_now;
+    send_app(APP_AUDIO_STREAMING_ACTIVE);
+    if(!run_until(SIM_EV_AUDIO_AV, 10000))
+        return;
+    result("stream restart", t, sim_now);
+    result("  a2dp start to audio", events[SIM_EV_A2DP_START].last, sim_now);
+}
+
+static void scenario_call(void)
+{
+    uint32 t;
+
+    paired_headset();
+    if(!power_on() || !first_stream())
+        return;
+    run_for(10000);
+    t = sim_now;
+    send_app(APP_VOIP_CALL_ACTIVE);
+    if(!run_until(SIM_EV_AUDIO_SCO, 10000))
+        return;
+    result("call setup, streaming to sco", t, sim_now);
+    run_for(30000);
+    t = sim_now;
+    send_app(APP_VOIP_CALL_INACTIVE);
+    if(!run_until(SIM_EV_AUDIO_AV, 30000))
+        return;
+    result("call end to a2dp audio", t, sim_now);
+}
+
+/* nothing paired, the headset does not list its services in EIR */
+static void scenario_discover(void)
+{
+    sim_remote *r = sim_remote_add("headset", HEADSET_LAP, SIM_HFP | SIM_A2DP | SIM_AVRCP);
+
+    r->eir_uuids = FALSE;
+    if(!power_on())
+        return;
+    result("  inquiry to first result", events[SIM_EV_INQUIRY].first, events[SIM_EV_INQUIRY_RESULT].first);
+    if(events[SIM_EV_SDP].count)
+        result("  ready to sdp", events[SIM_EV_READY].first, events[SIM_EV_SDP].first);
+}
+
+/* nothing paired, three phones nearer than the headset answer the
+   inquiry before it does and leave their services out of EIR, the
+   headset lists its own */
+static void scenario_busy(void)
+{
+    static const char *const names[] = { "phone 1", "phone 2", "phone 3" };
+    uint16 i;
+
+    for(i=0;i<sizeof(names)/sizeof(names[0]);i++){
+        sim_remote *r = sim_remote_add(names[i], HEADSET_LAP + 1 + i, 0);
+
+        r->eir_uuids = FALSE;
+        r->rssi = -40;
+    }
+    sim_remote_add("headset", HEADSET_LAP, SIM_HFP | SIM_A2DP | SIM_AVRCP)->rssi = -65;
+    if(!power_on())
+        return;
+    result("  inquiry to first result", events[SIM_EV_INQUIRY].first, events[SIM_EV_INQUIRY_RESULT].first);
+    if(events[SIM_EV_SDP].count)
+        result("  ready to sdp", events[SIM_EV_READY].first, events[SIM_EV_SDP].first);
+    printf("  %-36s %7lu\n", "pages", (unsigned long)events[SIM_EV_PAGE].count);
+}
+
+/* the adaptor only goes connectable after a link loss, the user has to
+   ask it to connect again once the headset is back */
+static void scenario_linkloss(void)
+{
+    sim_remote *r = paired_headset();
+    uint32 t;
+
+    if(!power_on() || !first_stream())
+        return;
+    run_for(10000);
+    sim_remote_link_loss(r);
+    run_for(2000);
+    r->present = TRUE;
+    t = sim_now;
+    send_connect_req();
+    if(!run_until(SIM_EV_CONNECTED, 60000))
+        return;
+    result("connect request to reconnected", t, sim_now);
+    if(run_until(SIM_EV_AUDIO_AV, 30000))
+        result("connect request to audio", t, sim_now);
+}
+
+/* the headset's HF channel is in PS from the last connection, so the SLC
+   is made without a service search.  then the headset moves its service
+   while out of range, the old channel is refused and the library falls
+   back to the search */
+static void scenario_cached(void)
+{
+    sim_remote *r = paired_headset();
+    uint32 searches, t;
+
+    sim_ps_add_service(r->hfp_channel);
+    if(!power_on() || !first_stream())
+        return;
+    printf("  %-36s %7lu\n", "sdp searches, power on", (unsigned long)sim_sdp_searches);
+    run_for(10000);
+    sim_remote_link_loss(r);
+    run_for(2000);
+    r->present = TRUE;
+    r->hfp_channel++;
+    searches = sim_sdp_searches;
+    t = sim_now;
+    send_connect_req();
+    if(!run_until(SIM_EV_CONNECTED, 60000))
+        return;
+    result("moved channel to reconnected", t, sim_now);
+    result("  hfp slc", t, events[SIM_EV_HFP].last);
+    printf("  %-36s %7lu\n", "sdp searches, reconnect", (unsigned long)(sim_sdp_searches - searches));
+}
+
+/* interference for a while, the SBC bitpool should drop quickly and come
+   back slowly once the link is clean again */
+static void scenario_link(void)
+{
+    sim_remote *r = paired_headset();
+    uint16 start, lowest;
+    uint32 t;
+
+    if(!power_on() || !first_stream())
+        return;
+    run_for(10000);
+    start = lowest = sim_bitpool;
+    printf("  %-36s %7u\n", "bitpool, clean link", start);
+    t = sim_now;
+    r->link_quality = 180;
+    r->rssi = -75;
+    r->backlog = 70;
+    if(!run_until(SIM_EV_BITPOOL, 10000))
+        return;
+    result("interference to first bitpool drop", t, sim_now);
+    while(sim_now - t < 10000){
+        run_for(1000);
+        if(sim_bitpool < lowest)
+            lowest = sim_bitpool;
+    }
+    printf("  %-36s %7u\n", "bitpool, poor link", lowest);
+    t = sim_now;
+    r->link_quality = 255;
+    r->rssi = -50;
+    r->backlog = 0;
+    while(sim_bitpool < start && sim_now - t < 120000)
+        if(!run_until(SIM_EV_BITPOOL, 120000 - (sim_now - t)))
+            return;
+    result("clean link to bitpool restored", t, sim_now);
+    printf("  %-36s %7lu\n", "bitpool changes", (unsigned long)events[SIM_EV_BITPOOL].count);
+}
+
+/* the share of the air, in percent, one sink streaming at bitpool takes
+   with 5 slot baseband packets carrying payload bytes each.  a fixed
+   formula, the simulated baseband has no airtime to measure */
+static double sink_airtime(uint16 bitpool, uint16 payload)
+{
+    uint16 frame = 13 + 2 * bitpool;
+    uint16 frames = (SIM_MEDIA_PACKET - SIM_RTP_HEADER) / frame;
+    uint16 length = SIM_RTP_HEADER + frames * frame + SIM_L2CAP_HEADER;
+    uint16 packets = (length + payload - 1) / payload;
+    double air_us = packets * 6 * SIM_SLOT_US * (100 + SIM_RESENDS) / 100.0;
+
+    return 100 * air_us / (frames * SIM_SBC_FRAME_US);
+}
+
+/* every sink the build can stream to connected and streaming at once, the
+   headset and A2DP speakers as there is only the one AG instance,
+   then how many sinks each bitpool leaves room for on the air, as the
+   airtime model has it */
+static void scenario_sinks(void)
+{
+    static const char * const names[SIM_MAX_REMOTES] = { "headset", "speaker 2", "speaker 3", "speaker 4" };
+    static const uint16 bitpools[] = { 20, 32, 40, 50, 53 };
+    static const struct{ const char *name; uint16 payload; }packets[] = {
+        { "dh5", 339 }, { "2-dh5", 679 }, { "3-dh5", 1021 }
+    };
+    uint16 i, j, n, connected;
+    uint32 t;
+
+    for(i=0;i<MAX_NUM_DEV_CONNECTIONS && i<SIM_MAX_REMOTES;i++)
+        sim_ps_add_device(sim_remote_add(names[i], HEADSET_LAP + i, i ? SIM_A2DP | SIM_AVRCP : SIM_HFP | SIM_A2DP | SIM_AVRCP), i == 0);
+    if(!power_on())
+        return;
+    /* the app suspends the stream to connect another sink and starts it
+       again to them all, so each is asked for once it has settled */
+    t = events[SIM_EV_READY].first;
+    for(connected=1;connected<i;connected++){
+        run_for(2000);
+        send_app(APP_DEVICE_CONNECT_SECOND_REQ);
+        if(!run_until(SIM_EV_CONNECTED, 60000))
+            return;
+    }
+    result("ready to all connected", t, sim_now);
+    t = sim_now;
+    if(!run_until(SIM_EV_AUDIO_AV, 30000))
+        return;
+    result("all connected to audio", t, events[SIM_EV_AUDIO_AV].last);
+    run_for(2000);
+    printf("  %-36s %7u of %u\n", "sinks streaming", sim_audio_sinks, connected);
+    printf("  %-36s %7u\n", "bitpool", sim_bitpool);
+
+    printf("  %-36s", "max sinks at bitpool (modelled)");
+    for(j=0;j<sizeof(packets)/sizeof(packets[0]);j++)
+        printf(" %7s", packets[j].name);
+    printf("\n");
+    for(i=0;i<sizeof(bitpools)/sizeof(bitpools[0]);i++){
+        printf("  %36u", bitpools[i]);
+        for(j=0;j<sizeof(packets)/sizeof(packets[0]);j++){
+            n = (uint16)(SIM_AIR_BUDGET / sink_airtime(bitpools[i], packets[j].payload));
+            printf(" %7u", n);
+        }
+        printf("\n");
+    }
+}
+
+/* the ordering of the headset in the paired device list in PS, 0 if it
+   is not there */
+static uint16 ps_ordering(const sim_remote *r)
+{
+    uint16 words[PS_REMOTE_DEVICE_LIST_MAX_SIZE];
+    uint16 i, n = PsRetrieve(7, words, PS_REMOTE_DEVICE_LIST_MAX_SIZE);
+
+    for(i=0;i+4<=n;i+=4)
+        if(words[0 + i] == r->addr.nap && words[2 + i] == (uint16)(r->addr.lap & 0xffff))
+            return words[3 + i] & 0xf;
+    return 0;
+}
+
+/* the headset paired first and every entry after it more recent, the
+   others are not simulated so they never answer */
+static sim_remote *full_pdl(void)
+{
+    static sim_remote gone[PS_REMOTE_DEVICE_LIST_MAX_ENTRIES - 1];
+    sim_remote *r = paired_headset();
+    uint16 i;
+
+    for(i=0;i<PS_REMOTE_DEVICE_LIST_MAX_ENTRIES - 1;i++){
+        gone[i].addr.nap = 0x0002;
+        gone[i].addr.uap = 0x5b;
+        gone[i].addr.lap = 0x445500 + i;
+        gone[i].profiles = SIM_HFP | SIM_A2DP | SIM_AVRCP;
+        sim_ps_add_device(&gone[i], TRUE);
+    }
+    printf("  %-36s %7u\n", "paired devices", PS_REMOTE_DEVICE_LIST_MAX_ENTRIES);
+    printf("  %-36s %7u\n", "headset ordering, power on", ps_ordering(r));
+    return r;
+}
+
+/* the other paired devices are out of range, power on tries each of them
+   for the connect period before the least recent headset.  the headset
+   then drops and comes back while streaming, which only reorders the list
+   in memory until power off */
+static void scenario_pdl(void)
+{
+    sim_remote *r = full_pdl();
+    uint32 writes;
+    uint16 i;
+
+    if(!power_on_within(PS_REMOTE_DEVICE_LIST_MAX_ENTRIES * 60000UL) || !first_stream())
+        return;
+    for(i=0;i<3;i++){
+        run_for(10000);
+        sim_remote_link_loss(r);
+        run_for(2000);
+        r->present = TRUE;
+        send_connect_req();
+        if(!run_until(SIM_EV_CONNECTED, 60000))
+            return;
+    }
+    run_for(10000);
+    writes = sim_ps_writes;
+    printf("  %-36s %7lu\n", "ps writes, connects while streaming", (unsigned long)writes);
+    /* the first press after boot only arms the power off */
+    send_app(APP_POWEROFF_REQ);
+    send_app(APP_POWEROFF_REQ);
+    run_for(100);
+    printf("  %-36s %7lu\n", "ps writes, power off", (unsigned long)(sim_ps_writes - writes));
+    printf("  %-36s %7u\n", "headset ordering, power off", ps_ordering(r));
+}
+
+/* the list is full and the least recent headset is away.  once power on
+   has tried every paired device the user asks for a new one, which is
+   found by inquiry and takes the least recent entry */
+static void scenario_evict(void)
+{
+    sim_remote *r = full_pdl();
+    sim_remote *n = sim_remote_add("new headset", HEADSET_LAP + 1, SIM_HFP | SIM_A2DP | SIM_AVRCP);
+    APP_DEVICE_DISCOVER_REQ_T *message;
+    uint32 t;
+
+    r->present = FALSE;
+    app_init();
+    if(!run_until(SIM_EV_READY, 5000))
+        return;
+    run_for(PS_REMOTE_DEVICE_LIST_MAX_ENTRIES * 60000UL);
+    if(events[SIM_EV_CONNECTED].count)
+        return;
+    t = sim_now;
+    message = PanicUnlessMalloc(sizeof(APP_DEVICE_DISCOVER_REQ_T));
+    message->disconnect_current = FALSE;
+    sim_log("host sends %04x", APP_DEVICE_DISCOVER_REQ);
+    MessageSend(&the_app->task, APP_DEVICE_DISCOVER_REQ, message);
+    if(!run_until(SIM_EV_CONNECTED, 60000))
+        return;
+    result("discover to connected", t, sim_now);
+    run_for(10000);
+    /* the first press after boot only arms the power off */
+    send_app(APP_POWEROFF_REQ);
+    send_app(APP_POWEROFF_REQ);
+    run_for(100);
+    printf("  %-36s %7u\n", "new headset ordering, power off", ps_ordering(n));
+    printf("  %-36s %7u\n", "headset ordering, power off", ps_ordering(r));
+}
+
+static const sim_scenario scenarios[] = {
+    { "reconnect", scenario_reconnect, "a paired headset is reconnected at power on" },
+    { "stream", scenario_stream, "streaming stops, times out and restarts" },
+    { "call", scenario_call, "a VoIP call interrupts streaming" },
+    { "discover", scenario_discover, "an unpaired headset is found and connected" },
+    { "busy", scenario_busy, "as discover, with nearer devices that are not headsets answering the inquiry first" },
+    { "linkloss", scenario_linkloss, "the headset goes out of range, comes back and is reconnected" },
+    { "cached", scenario_cached, "reconnect on the HF channel in PS, then after the headset has moved it" },
+    { "link", scenario_link, "the link degrades while streaming and recovers" },
+    { "sinks", scenario_sinks, "every sink the build allows streams at once" },
+    { "pdl", scenario_pdl, "a full paired device list, the headset the least recent, reconnected while streaming then powered off" },
+    { "evict", scenario_evict, "a full paired device list, a new headset replaces the least recent one" },
+};
+
+#define NUM_SCENARIOS   (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static void totals(void)
+{
+    printf("  %-36s %7lu\n", "kap loads", (unsigned long)sim_kap_loads);
+    printf("  %-36s %7lu ms\n", "vm blocked by the dsp", (unsigned long)sim_dsp_busy_ms);
+    printf("  %-36s %7lu\n", "ps writes", (unsigned long)sim_ps_writes);
+    printf("  %-36s %7lu\n", "sdp searches", (unsigned long)sim_sdp_searches);
+    printf("  %-36s %7lu\n", "messages delivered", (unsigned long)sim_delivered);
+}
+
+/* the host asks for the trace as trace_decode's user would */
+static void dump_trace(const char *dir, const char *name)
+{
+    char file[256];
+
+    snprintf(file, sizeof(file), "%s/%s.trc", dir, name);
+    if((sim_uart_file = fopen(file, "wb")) == NULL){
+        perror(file);
+        return;
+    }
+    sim_uart_send("D");
+    run_for(1000);
+    fclose(sim_uart_file);
+    sim_uart_file = NULL;
+    if(sim_uart_bytes)
+        printf("  %-36s %7lu bytes\n", "trace dump", (unsigned long)sim_uart_bytes);
+    else{
+        remove(file);
+        printf("  no trace, the build needs -DENABLE_TRACE\n");
+    }
+}
+
+/* each scenario in a process of its own, the application has no reset */
+static int run_scenario(const sim_scenario *s, const char *psr_dir, const char *extra, const char *trace_dir)
+{
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    if((pid = fork()) < 0){
+        perror("fork");
+        return 1;
+    }
+    if(pid == 0){
+        printf("%s: %s\n", s->name, s->about);
+        sim_ps_init(psr_dir, extra);
+        s->run();
+        if(trace_dir)
+            dump_trace(trace_dir, s->name);
+        totals();
+        exit(events[SIM_EV_PANIC].count ? 2 : 0);
+    }
+    if(waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+        return 1;
+    return WEXITSTATUS(status);
+}
+
+static void usage(void)
+{
+    unsigned i;
+
+    fprintf(stderr, "usage: adaptor_sim [-v] [-p psrdir] [-f extra.psr] [-t tracedir] scenario\n");
+    for(i=0;i<NUM_SCENARIOS;i++)
+        fprintf(stderr, "    %-12s%s\n", scenarios[i].name, scenarios[i].about);
+    fprintf(stderr, "    %-12s%s\n", "all", "each of them in turn");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *psr_dir = "..", *extra = NULL, *trace_dir = NULL;
+    unsigned i;
+    int opt, rc = 0;
+    bool found = FALSE;
+
+    while((opt = getopt(argc, argv, "vp:f:t:")) != -1){
+        switch(opt){
+        case 'v':
+            sim_verbose = 1;
+            break;
+        case 'p':
+            psr_dir = optarg;
+            break;
+        case 'f':
+            extra = optarg;
+            break;
+        case 't':
+            trace_dir = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if(optind != argc - 1)
+        usage();
+    for(i=0;i<NUM_SCENARIOS;i++){
+        if(!strcmp(argv[optind], "all") || !strcmp(argv[optind], scenarios[i].name)){
+            found = TRUE;
+            if(i && !strcmp(argv[optind], "all"))
+                printf("\n");
+            rc |= run_scenario(&scenarios[i], psr_dir, extra, trace_dir);
+        }
+    }
+    if(!found)
+        usage();
+    return rc;
+}
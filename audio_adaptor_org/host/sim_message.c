@@ -0,0 +1,250 @@
+/*
+ * the VM message scheduler on simulated time. a message is due at the
+ * time it was sent plus its delay, messages due at the same time go in
+ * the order they were sent, a conditional one waits until its condition
+ * word is 0 as on the chip. the clock jumps to the next message due, so
+ * a run takes no longer than the handlers do.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <message.h>
+#include <panic.h>
+#include <stream.h>
+
+#include "sim.h"
+
+typedef struct sim_msg{
+    struct sim_msg *next;
+    Task task;
+    MessageId id;
+    void *msg;
+    uint32 due;
+    uint32 seq;
+    const uint16 *cond;
+}sim_msg;
+
+#define NEVER   0xffffffffUL
+
+uint32 sim_now;
+uint32 sim_end = NEVER;
+uint32 sim_delivered;
+Task sim_uart_task;
+
+static sim_msg *queue;
+static uint32 next_seq;
+static Task kalimba_task, pio_task, charger_task, host_task, system_task;
+
+/* queue in delivery order, by time and then by the order sent */
+static void enqueue(Task task, MessageId id, void *msg, uint32 delay, const uint16 *cond)
+{
+    sim_msg *m, **p;
+
+    if(task == NULL){
+        free(msg);
+        return;
+    }
+    m = malloc(sizeof(sim_msg));
+    if(m == NULL)
+        Panic();
+    m->task = task;
+    m->id = id;
+    m->msg = msg;
+    m->due = delay == D_INFINITE || delay >= NEVER - sim_now ? NEVER : sim_now + delay;
+    m->seq = next_seq++;
+    m->cond = cond;
+    for(p=&queue;*p && (*p)->due <= m->due;p=&(*p)->next)
+        ;
+    m->next = *p;
+    *p = m;
+}
+
+void MessageSend(Task task, MessageId id, void *message)
+{
+    enqueue(task, id, message, 0, NULL);
+}
+
+void MessageSendLater(Task task, MessageId id, void *message, uint32 delay)
+{
+    enqueue(task, id, message, delay, NULL);
+}
+
+void MessageSendConditionally(Task task, MessageId id, void *message, const uint16 *condition)
+{
+    enqueue(task, id, message, 0, condition);
+}
+
+static uint16 cancel(Task task, MessageId id, bool any_id, bool first)
+{
+    sim_msg *m, **p = &queue;
+    uint16 n = 0;
+
+    while((m = *p) != NULL){
+        if(m->task == task && (any_id || m->id == id)){
+            *p = m->next;
+            free(m->msg);
+            free(m);
+            n++;
+            if(first)
+                break;
+        }else{
+            p = &m->next;
+        }
+    }
+    return n;
+}
+
+uint16 MessageCancelAll(Task task, MessageId id)
+{
+    return cancel(task, id, FALSE, FALSE);
+}
+
+bool MessageCancelFirst(Task task, MessageId id)
+{
+    return cancel(task, id, FALSE, TRUE) != 0;
+}
+
+uint16 MessageFlushTask(Task task)
+{
+    return cancel(task, 0, TRUE, FALSE);
+}
+
+/* messages queued for a task, for the scenarios */
+uint16 sim_pending(Task task, MessageId id)
+{
+    sim_msg *m;
+    uint16 n = 0;
+
+    for(m=queue;m;m=m->next)
+        if(m->task == task && m->id == id)
+            n++;
+    return n;
+}
+
+void MessageFree(MessageId id, Message message)
+{
+    free((void *)message);
+}
+
+/* a trap that keeps the VM busy, nothing is delivered meanwhile */
+void sim_busy(uint32 ms)
+{
+    sim_now += ms;
+}
+
+/* the first message that can go, NULL when nothing can before sim_end */
+static sim_msg **next_message(void)
+{
+    sim_msg **p;
+
+    for(p=&queue;*p;p=&(*p)->next){
+        if((*p)->due == NEVER || (*p)->due > sim_end)
+            return NULL;
+        if((*p)->cond == NULL || *(*p)->cond == 0)
+            return p;
+    }
+    return NULL;
+}
+
+void MessageLoop(void)
+{
+    sim_msg **p, *m;
+
+    while((p = next_message()) != NULL){
+        m = *p;
+        *p = m->next;
+        if(m->due > sim_now)
+            sim_now = m->due;
+        sim_delivered++;
+        m->task->handler(m->task, m->id, m->msg);
+        sim_message_delivered(m->task, m->id, m->msg);
+        free(m->msg);
+        free(m);
+    }
+}
+
+static Task swap(Task *slot, Task task)
+{
+    Task old = *slot;
+
+    *slot = task;
+    return old;
+}
+
+Task MessageKalimbaTask(Task task)
+{
+    return swap(&kalimba_task, task);
+}
+
+Task MessagePioTask(Task task)
+{
+    return swap(&pio_task, task);
+}
+
+Task MessageChargerTask(Task task)
+{
+    return swap(&charger_task, task);
+}
+
+Task MessageHostCommsTask(Task task)
+{
+    return swap(&host_task, task);
+}
+
+Task MessageSystemTask(Task task)
+{
+    return swap(&system_task, task);
+}
+
+/* only the UART carries data on the host, so only it has a task to send to */
+Task MessageSinkTask(Sink sink, Task task)
+{
+    return sink == StreamUartSink() ? swap(&sim_uart_task, task) : NULL;
+}
+
+void Panic(void)
+{
+    sim_event(SIM_EV_PANIC);
+    fprintf(stderr, "%8lu panic\n", (unsigned long)sim_now);
+    exit(2);
+}
+
+void *PanicNull(void *p)
+{
+    if(p == NULL)
+        Panic();
+    return p;
+}
+
+void *PanicNotNull(void *p)
+{
+    if(p != NULL)
+        Panic();
+    return p;
+}
+
+bool PanicFalse(bool b)
+{
+    if(!b)
+        Panic();
+    return b;
+}
+
+uint16 PanicZero(uint16 x)
+{
+    if(x == 0)
+        Panic();
+    return x;
+}
+
+uint16 PanicNotZero(uint16 x)
+{
+    if(x != 0)
+        Panic();
+    return x;
+}
+
+void *PanicUnlessMalloc(size_t size)
+{
+    return PanicNull(malloc(size));
+}
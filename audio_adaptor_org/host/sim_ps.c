@@ -0,0 +1,192 @@
+/*
+ * persistent store in memory. it is loaded from the same .psr files the
+ * chip is programmed with, the user keys PSKEY_USR0.. (&028a..) are the
+ * keys PsStore and PsRetrieve see as 0.., the others are the firmware
+ * keys PsFullRetrieve reads. PsStore only changes the copy in memory,
+ * every scenario starts from the files again.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ps.h>
+
+#include "sim.h"
+
+#define PS_USR_BASE     0x028a
+#define PS_USR_KEYS     50
+#define PS_FULL_KEYS    0x0500
+#define PS_MAX_WORDS    64
+
+typedef struct{
+    uint16 len;                 /* 0 when not set */
+    uint16 words[PS_MAX_WORDS];
+}ps_key;
+
+static ps_key ps_usr[PS_USR_KEYS];
+static ps_key *ps_full[PS_FULL_KEYS];
+
+uint32 sim_ps_writes;
+
+/* EDR capable, used while the .psr files leave &00ef to the firmware */
+static const uint16 default_features[4] = { 0xffff, 0xfe8f, 0x79fe, 0x839b };
+
+static ps_key *full_key(uint16 key, bool create)
+{
+    if(key >= PS_FULL_KEYS)
+        return NULL;
+    if(ps_full[key] == NULL && create)
+        ps_full[key] = calloc(1, sizeof(ps_key));
+    return ps_full[key];
+}
+
+static ps_key *psr_key(uint16 key, bool create)
+{
+    if(key >= PS_USR_BASE && key < PS_USR_BASE + PS_USR_KEYS)
+        return &ps_usr[key - PS_USR_BASE];
+    return full_key(key, create);
+}
+
+/* "&028b = 0000 1234 // comment" sets a key, "&028c -" clears it */
+static int psr_load(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[512], *p, *end;
+    unsigned long key, word;
+    ps_key *k;
+
+    if(f == NULL){
+        perror(name);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), f)){
+        if((p = strstr(line, "//")) != NULL)
+            *p = 0;
+        p = line + strspn(line, " \t");
+        if(*p != '&')
+            continue;
+        key = strtoul(p + 1, &end, 16);
+        p = end + strspn(end, " \t");
+        if((k = psr_key((uint16)key, TRUE)) == NULL)
+            continue;
+        k->len = 0;
+        if(*p != '=')
+            continue;
+        for(p++;;p=end){
+            word = strtoul(p, &end, 16);
+            if(end == p || k->len == PS_MAX_WORDS)
+                break;
+            k->words[k->len++] = (uint16)word;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/* the analogue build, with the profiles of the USB one so the HFP and
+   AVRCP paths run as well */
+void sim_ps_init(const char *dir, const char *extra)
+{
+    char name[256];
+    ps_key *k;
+
+    snprintf(name, sizeof(name), "%s/audio_adaptor_base.psr", dir);
+    if(psr_load(name))
+        exit(1);
+    snprintf(name, sizeof(name), "%s/audio_adaptor_analogue.psr", dir);
+    if(psr_load(name))
+        exit(1);
+    k = &ps_usr[0];
+    k->len = 1;
+    k->words[0] = 0x000e;
+    if(extra && psr_load(extra))
+        exit(1);
+    k = full_key(0x00ef, TRUE);
+    if(k->len == 0){
+        memcpy(k->words, default_features, sizeof(default_features));
+        k->len = 4;
+    }
+    sim_ps_writes = 0;
+}
+
+/* an entry of PSKEY_REMOTE_DEVICE_LIST as configureStoreCurrentPairedDevice
+   writes it, paired with the first PIN, the most recent is ordering 1 */
+void sim_ps_add_device(const sim_remote *remote, bool most_recent)
+{
+    ps_key *k = &ps_usr[7];
+    uint16 *w, i, ordering = 1;
+
+    if(k->len + 4 > PS_MAX_WORDS)
+        return;
+    for(i=0;i<k->len;i+=4){
+        if(most_recent)
+            k->words[i + 3]++;
+        else
+            ordering++;
+    }
+    w = &k->words[k->len];
+    w[0] = remote->addr.nap;
+    w[1] = (uint16)((remote->addr.uap << 8) | ((remote->addr.lap >> 16) & 0xff));
+    w[2] = (uint16)(remote->addr.lap & 0xffff);
+    w[3] = (uint16)((remote->profiles << 12) | (1 << 4) | ordering);
+    k->len += 4;
+}
+
+/* the HF channel of the entry sim_ps_add_device last added, as
+   configureStoreCurrentPairedDevice keeps it in PSKEY_REMOTE_SERVICE_LIST */
+void sim_ps_add_service(uint8 hfp_channel)
+{
+    ps_key *k = &ps_usr[17];
+    uint16 entries = ps_usr[7].len / 4;
+
+    while(k->len < entries)
+        k->words[k->len++] = 0;
+    if(entries)
+        k->words[entries - 1] = hfp_channel;
+}
+
+uint16 PsStore(uint16 key, const void *buff, uint16 words)
+{
+    ps_key *k;
+
+    if(key >= PS_USR_KEYS || words > PS_MAX_WORDS)
+        return 0;
+    k = &ps_usr[key];
+    sim_ps_writes++;
+    if(words)
+        memcpy(k->words, buff, words * sizeof(uint16));
+    k->len = words;
+    /* storing 0 words deletes the key, which the VM reports as done */
+    return words ? words : 1;
+}
+
+/* as on the chip, 0 words asks for the length and a buffer too small
+   for the key reads nothing */
+static uint16 retrieve(const ps_key *k, void *buff, uint16 words, bool bytewise)
+{
+    uint16 i;
+
+    if(k == NULL || k->len == 0)
+        return 0;
+    if(buff == NULL || words == 0)
+        return k->len;
+    if(words < k->len)
+        return 0;
+    for(i=0;i<k->len;i++){
+        if(bytewise)
+            ((uint8 *)buff)[i] = (uint8)k->words[i];
+        else
+            ((uint16 *)buff)[i] = k->words[i];
+    }
+    return k->len;
+}
+
+uint16 PsRetrieveSized(uint16 key, void *buff, uint16 words, bool bytewise)
+{
+    return key < PS_USR_KEYS ? retrieve(&ps_usr[key], buff, words, bytewise) : 0;
+}
+
+uint16 PsFullRetrieve(uint16 key, void *buff, uint16 words)
+{
+    return retrieve(full_key(key, FALSE), buff, words, FALSE);
+}
@@ -0,0 +1,463 @@
+/*
+ * the firmware traps around the audio path: Kalimba, the file system,
+ * streams, sinks and sources, USB, PIO, charger and boot mode, and the
+ * audio plugin tasks. no audio moves on the host, a sink is a handle
+ * that knows the device it goes to, and a kap load costs the VM the
+ * time it blocks for on the chip. the UART is the one stream that
+ * carries data, what the VM sends over it goes to sim_uart_file.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <message.h>
+#include <panic.h>
+#include <kalimba.h>
+#include <file.h>
+#include <stream.h>
+#include <sink.h>
+#include <source.h>
+#include <transform.h>
+#include <usb.h>
+#include <pio.h>
+#include <charger.h>
+#include <boot.h>
+#include <vm.h>
+
+#include <csr_sbc_encoder_plugin.h>
+#include <csr_faststream_source_plugin.h>
+#include <csr_cvsd_usb_no_dsp_plugin.h>
+
+#include "sim.h"
+#include "leds.h"
+#include "audioAdaptor_buttons.h"
+
+#define MAX_FILES       8
+#define MAX_SINKS       64
+#define KALIMBA_PORTS   0x100       /* kalimba and pcm handles start here */
+#define USB_PORTS       0x200
+#define UART_PORT       0x300
+
+uint32 sim_kap_loads;
+uint32 sim_dsp_busy_ms;
+uint16 sim_bitpool;
+
+static char file_names[MAX_FILES][32];
+static uint16 num_files;
+static FILE_INDEX kap_loaded;
+
+static bdaddr sink_addr[MAX_SINKS];
+static bool sink_used[MAX_SINKS];
+static uint8 sink_map[64];
+static uint16 boot_mode;
+
+FILE *sim_uart_file;
+uint32 sim_uart_bytes;
+static uint8 uart_out[SIM_UART_BUFFER];
+static uint16 uart_claimed;
+static uint8 uart_in[64];
+static uint16 uart_in_len;
+
+FILE_INDEX FileFind(FILE_INDEX start, const char *name, uint16 length)
+{
+    uint16 i;
+
+    if(length >= sizeof(file_names[0]))
+        return FILE_NONE;
+    for(i=0;i<num_files;i++)
+        if(strlen(file_names[i]) == length && !memcmp(file_names[i], name, length))
+            return (FILE_INDEX)(FILE_ROOT + 1 + i);
+    if(num_files == MAX_FILES)
+        return FILE_NONE;
+    memcpy(file_names[num_files], name, length);
+    file_names[num_files][length] = 0;
+    return (FILE_INDEX)(FILE_ROOT + 1 + num_files++);
+}
+
+bool KalimbaLoad(FILE_INDEX file)
+{
+    if(file <= FILE_ROOT || file > FILE_ROOT + num_files)
+        return FALSE;
+    sim_log("kalimba load %s", file_names[file - FILE_ROOT - 1]);
+    sim_busy(SIM_KAP_LOAD_MS);
+    sim_dsp_busy_ms += SIM_KAP_LOAD_MS;
+    sim_kap_loads++;
+    kap_loaded = file;
+    sim_event(SIM_EV_KAP_LOAD);
+    return TRUE;
+}
+
+void KalimbaPowerOff(void)
+{
+    if(kap_loaded == FILE_NONE)
+        return;
+    sim_busy(SIM_KAP_OFF_MS);
+    sim_dsp_busy_ms += SIM_KAP_OFF_MS;
+    kap_loaded = FILE_NONE;
+}
+
+/* fails as on the chip while no kap is running */
+bool KalimbaSendMessage(uint16 message, uint16 a, uint16 b, uint16 c, uint16 d)
+{
+    sim_log("kalimba message %04x %u %u %u %u%s", message, a, b, c, d,
+            kap_loaded == FILE_NONE ? " (no kap)" : "");
+    if(kap_loaded == FILE_NONE)
+        return FALSE;
+    /* KALIMBA_SET_BITPOOL_MESSAGE */
+    if(message == 0x7070 && a != sim_bitpool){
+        sim_bitpool = a;
+        sim_event(SIM_EV_BITPOOL);
+    }
+    return TRUE;
+}
+
+/* a sink to a remote device, SinkGetBdAddr finds the device again */
+Sink sim_sink_new(const bdaddr *addr)
+{
+    uint16 i;
+
+    for(i=1;i<MAX_SINKS;i++){
+        if(!sink_used[i]){
+            sink_used[i] = TRUE;
+            sink_addr[i] = *addr;
+            return (Sink)(uintptr_t)i;
+        }
+    }
+    Panic();
+    return NULL;
+}
+
+void sim_sink_close(Sink sink)
+{
+    uintptr_t i = (uintptr_t)sink;
+
+    if(i && i < MAX_SINKS)
+        sink_used[i] = FALSE;
+}
+
+bool SinkGetBdAddr(Sink sink, bdaddr *addr)
+{
+    uintptr_t i = (uintptr_t)sink;
+
+    if(i == 0 || i >= MAX_SINKS || !sink_used[i])
+        return FALSE;
+    *addr = sink_addr[i];
+    return TRUE;
+}
+
+bool SinkIsValid(Sink sink)
+{
+    uintptr_t i = (uintptr_t)sink;
+
+    return i >= KALIMBA_PORTS || (i && i < MAX_SINKS && sink_used[i]);
+}
+
+bool SinkClose(Sink sink)
+{
+    sim_sink_close(sink);
+    return TRUE;
+}
+
+/* nothing drains, the HID reports and USB data only need the space, a
+   media sink is as full as its remote's backlog */
+uint16 SinkSlack(Sink sink)
+{
+    if(sink == StreamUartSink())
+        return SIM_UART_BUFFER - uart_claimed;
+    if(!SinkIsValid(sink))
+        return 0;
+    return (uint16)(sizeof(sink_map) * (100 - sim_remote_backlog(sink)) / 100);
+}
+
+/* the offset of the space claimed, after any claimed and not yet flushed */
+uint16 SinkClaim(Sink sink, uint16 extra)
+{
+    uint16 offset = uart_claimed;
+
+    if(sink != StreamUartSink())
+        return extra <= sizeof(sink_map) ? 0 : 0xffff;
+    if(extra > SIM_UART_BUFFER - uart_claimed)
+        return 0xffff;
+    uart_claimed += extra;
+    return offset;
+}
+
+uint8 *SinkMap(Sink sink)
+{
+    return sink == StreamUartSink() ? uart_out : sink_map;
+}
+
+/* the UART sends at once and says it has space again once it is out */
+bool SinkFlush(Sink sink, uint16 amount)
+{
+    if(sink == StreamUartSink()){
+        if(amount > uart_claimed)
+            return FALSE;
+        if(sim_uart_file)
+            fwrite(uart_out, 1, amount, sim_uart_file);
+        sim_uart_bytes += amount;
+        uart_claimed -= amount;
+        memmove(uart_out, uart_out + amount, uart_claimed);
+        {
+            MessageMoreSpace *message = PanicUnlessMalloc(sizeof(MessageMoreSpace));
+
+            message->sink = sink;
+            MessageSendLater(sim_uart_task, MESSAGE_MORE_SPACE, message, SIM_UART_DRAIN_MS);
+        }
+        return TRUE;
+    }
+    return SinkIsValid(sink);
+}
+
+bool SinkFlushHeader(Sink sink, uint16 amount, const uint16 *header, uint16 length)
+{
+    return SinkIsValid(sink);
+}
+
+uint16 SourceSize(Source source)
+{
+    return source == StreamUartSource() ? uart_in_len : 0;
+}
+
+uint16 SourceBoundary(Source source)
+{
+    return 0;
+}
+
+const uint8 *SourceMap(Source source)
+{
+    return source == StreamUartSource() ? uart_in : sink_map;
+}
+
+const void *SourceMapHeader(Source source)
+{
+    return NULL;
+}
+
+void SourceDrop(Source source, uint16 amount)
+{
+    if(source != StreamUartSource())
+        return;
+    if(amount > uart_in_len)
+        amount = uart_in_len;
+    uart_in_len -= amount;
+    memmove(uart_in, uart_in + amount, uart_in_len);
+}
+
+bool SourceIsValid(Source source)
+{
+    return source != NULL;
+}
+
+Transform StreamConnect(Source source, Sink sink)
+{
+    return source && sink ? (Transform)(uintptr_t)1 : NULL;
+}
+
+bool StreamConnectDispose(Source source)
+{
+    return source != NULL;
+}
+
+void StreamDisconnect(Source source, Sink sink)
+{
+}
+
+Source StreamSourceFromSink(Sink sink)
+{
+    return (Source)sink;
+}
+
+Sink StreamSinkFromSource(Source source)
+{
+    return (Sink)source;
+}
+
+Sink StreamKalimbaSink(uint16 port)
+{
+    return (Sink)(uintptr_t)(KALIMBA_PORTS + port);
+}
+
+Source StreamKalimbaSource(uint16 port)
+{
+    return (Source)(uintptr_t)(KALIMBA_PORTS + port);
+}
+
+Sink StreamPcmSink(uint16 port)
+{
+    return (Sink)(uintptr_t)(KALIMBA_PORTS + 0x80 + port);
+}
+
+Source StreamPcmSource(uint16 port)
+{
+    return (Source)(uintptr_t)(KALIMBA_PORTS + 0x80 + port);
+}
+
+Sink StreamUsbClassSink(UsbInterface intf)
+{
+    return (Sink)(uintptr_t)(USB_PORTS + intf);
+}
+
+Source StreamUsbClassSource(UsbInterface intf)
+{
+    return (Source)(uintptr_t)(USB_PORTS + intf);
+}
+
+Sink StreamUsbEndPointSink(EndPoint end_point)
+{
+    return (Sink)(uintptr_t)(USB_PORTS + 0x80 + end_point);
+}
+
+Source StreamUsbEndPointSource(EndPoint end_point)
+{
+    return (Source)(uintptr_t)(USB_PORTS + 0x80 + end_point);
+}
+
+Transform TransformRtpSbcEncode(Source source, Sink sink)
+{
+    return StreamConnect(source, sink);
+}
+
+bool TransformStart(Transform transform)
+{
+    return transform != NULL;
+}
+
+bool TransformStop(Transform transform)
+{
+    return transform != NULL;
+}
+
+bool TransformDisconnect(Transform transform)
+{
+    return transform != NULL;
+}
+
+UsbInterface UsbAddInterface(const UsbCodes *codes, uint16 desc_type, const uint8 *desc, uint16 desc_size)
+{
+    static uint16 next;
+
+    return (UsbInterface)next++;
+}
+
+bool UsbAddDescriptor(UsbInterface intf, uint16 desc_type, const uint8 *desc, uint16 desc_size)
+{
+    return TRUE;
+}
+
+bool UsbAddEndPoints(UsbInterface intf, uint16 num_end_points, const EndPointInfo *end_point_info)
+{
+    return TRUE;
+}
+
+/* no button held, so the MFB does not ask for DFU at boot */
+uint16 PioGet(void)
+{
+    return 0;
+}
+
+uint16 PioSet(uint16 mask, uint16 bits)
+{
+    return 0;
+}
+
+uint16 PioSetDir(uint16 mask, uint16 dir)
+{
+    return 0;
+}
+
+bool PioSetMicBiasHwEnabled(bool enable)
+{
+    return TRUE;
+}
+
+bool PioSetMicBiasHwVoltage(uint16 voltage)
+{
+    return TRUE;
+}
+
+bool PioSetMicBiasHwCurrent(uint16 current)
+{
+    return TRUE;
+}
+
+bool PioSetPsuRegulator(bool enable)
+{
+    return TRUE;
+}
+
+charger_status ChargerStatus(void)
+{
+    return NOT_CHARGING;
+}
+
+bool ChargerSupressLed0(bool suppress)
+{
+    return TRUE;
+}
+
+void BootSetMode(uint16 mode)
+{
+    boot_mode = mode;
+    sim_log("boot mode %u", mode);
+}
+
+uint16 BootGetMode(void)
+{
+    return boot_mode;
+}
+
+Sink StreamUartSink(void)
+{
+    return (Sink)(uintptr_t)UART_PORT;
+}
+
+Source StreamUartSource(void)
+{
+    return (Source)(uintptr_t)UART_PORT;
+}
+
+void sim_uart_send(const char *data)
+{
+    size_t len = strlen(data);
+
+    if(len > sizeof(uart_in) - uart_in_len)
+        len = sizeof(uart_in) - uart_in_len;
+    memcpy(uart_in + uart_in_len, data, len);
+    uart_in_len += (uint16)len;
+    {
+        MessageMoreData *message = PanicUnlessMalloc(sizeof(MessageMoreData));
+
+        message->source = StreamUartSource();
+        MessageSend(sim_uart_task, MESSAGE_MORE_DATA, message);
+    }
+}
+
+uint32 VmGetClock(void)
+{
+    return sim_now;
+}
+
+/* the plugins are driven by the audio library, which is faked whole */
+static void plugin_handler(Task task, MessageId id, Message message)
+{
+}
+
+const TaskData csr_sbc_encoder_plugin = { plugin_handler };
+const TaskData csr_faststream_source_plugin = { plugin_handler };
+const TaskData csr_cvsd_usb_no_dsp_plugin = { plugin_handler };
+
+bool ledsPlay(LedPattern_t pNewPattern)
+{
+    return TRUE;
+}
+
+static void pio_handler(Task task, MessageId id, Message message)
+{
+}
+
+void pioInit(PioState *state, Task client)
+{
+    state->task.handler = pio_handler;
+    state->client = client;
+}
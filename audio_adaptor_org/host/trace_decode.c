@@ -0,0 +1,376 @@
+/*
+ * trace_decode - the audio adaptor's trace dump as a timeline
+ *
+ * Reads the dump the adaptor sends over the UART when it is sent 'D' (see
+ * audioAdaptor_trace.h), or that adaptor_sim -t writes, and prints each
+ * record with the names of its message, states or comm action.  Then, for
+ * the app state and each state machine of every device instance, how many
+ * times each state was entered and how long was spent in it, which is
+ * where the time of a connect, stream start or call setup goes.
+ *
+ * build on the host : gcc -DDEV_PC_1645_ANALOGUE -I. -Ifw -I<lib>/a2dp ... -o trace_decode trace_decode.c
+ *                     with the same -I<lib>/<library> as adaptor_sim
+ * usage             : trace_decode [-s] dump.trc
+ *                     -s              the time in each state only, no timeline
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <connection.h>
+#include <a2dp.h>
+#include <aghfp.h>
+#include <avrcp.h>
+#include <codec.h>
+#include <battery.h>
+
+#include "../audioAdaptor_private.h"
+#include "../audioAdaptor_trace.h"
+
+#define MAX_RECORDS     4096
+#define MAX_STATES      16
+#define NUM_MACHINES    (1 + 3 * MAX_NUM_DEV_CONNECTIONS)
+
+typedef struct{
+    int value;
+    const char *name;
+}name_t;
+
+#define N(x)    { x, #x }
+
+static const name_t message_names[] = {
+    N(APP_INIT), N(APP_INIT_CFM), N(APP_POWERON_REQ), N(APP_POWEROFF_REQ), N(APP_LIMBO_TIMEOUT),
+    N(APP_RESET_PDL_REQ), N(APP_CHARGER_CONNECTED), N(APP_CHARGER_DISCONNECTED), N(APP_CHARGER_MONITOR),
+    N(APP_CHECK_FOR_LOW_BATT), N(APP_LOW_BATTERY), N(APP_FAST_CHARGE), N(APP_TRICKLE_CHARGE),
+    N(APP_CANCEL_LED_INDICATION), N(APP_OK_BATTERY), N(APP_KICK_COMM_ACTION_REQ), N(APP_REFRESH_ENCRYPTION_REQ),
+    N(APP_DEVICE_CONNECT_REQ), N(APP_DEVICE_DISCOVER_REQ), N(APP_DEVICE_CONNECT_SECOND_REQ), N(APP_ENTER_DFU_MODE),
+    N(APP_VOIP_CALL_INCOMING), N(APP_VOIP_CALL_OUTGOING), N(APP_VOIP_CALL_CANCEL), N(APP_VOIP_CALL_ACTIVE),
+    N(APP_VOIP_CALL_INACTIVE), N(APP_AUDIO_STREAMING_ACTIVE), N(APP_AUDIO_STREAMING_INACTIVE),
+    N(APP_AUDIO_STREAMING_TIMER), N(APP_A2DP_MEDIA_STREAM_HOLDOFF), N(APP_INQUIRY_TIMER), N(APP_CONNECT_TIMER),
+    N(APP_RECONNECT_TIMER), N(APP_PROFILE_CONNECT_TIMER), N(APP_LED_TIMER), N(APP_HID_SEQUENCE),
+    N(APP_INTERNAL_DESTROY_REQ), N(APP_STREAM_CLOSE_COMPLETE), N(APP_INTERNAL_CONNECT_MEDIA_CHANNEL_REQ),
+    N(APP_MEDIA_CHANNEL_REOPEN_REQ), N(APP_CONNECT_A2DP_AUDIO), N(APP_PROCESS_INQUIRE_RESULT), N(APP_CONNECT_CFM),
+    N(APP_SBC_RATE_TIMER), N(APP_PS_FLUSH_TIMER),
+
+    N(CL_INIT_CFM), N(CL_DM_ACL_OPENED_IND), N(CL_DM_ACL_CLOSED_IND), N(CL_DM_INQUIRE_RESULT),
+    N(CL_DM_LINK_QUALITY_CFM), N(CL_DM_LINK_SUPERVISION_TIMEOUT_IND), N(CL_DM_LOCAL_NAME_COMPLETE),
+    N(CL_DM_READ_INQUIRY_TX_CFM), N(CL_DM_REMOTE_FEATURES_CFM), N(CL_DM_ROLE_CFM), N(CL_DM_ROLE_IND),
+    N(CL_DM_RSSI_CFM), N(CL_DM_SNIFF_SUB_RATING_IND), N(CL_DM_WRITE_INQUIRY_MODE_CFM), N(CL_SDP_OPEN_SEARCH_CFM),
+    N(CL_SDP_CLOSE_SEARCH_CFM), N(CL_SDP_SERVICE_SEARCH_CFM), N(CL_SM_AUTHENTICATE_CFM), N(CL_SM_AUTHORISE_IND),
+    N(CL_SM_IO_CAPABILITY_REQ_IND), N(CL_SM_PIN_CODE_IND), N(CL_SM_REMOTE_IO_CAPABILITY_IND),
+    N(CL_SM_SECURITY_LEVEL_CFM), N(CL_SM_SEC_MODE_CONFIG_CFM), N(CL_SM_USER_CONFIRMATION_REQ_IND),
+
+    N(A2DP_INIT_CFM), N(A2DP_SIGNALLING_CHANNEL_CONNECT_IND), N(A2DP_SIGNALLING_CHANNEL_CONNECT_CFM),
+    N(A2DP_SIGNALLING_CHANNEL_DISCONNECT_IND), N(A2DP_OPEN_IND), N(A2DP_OPEN_CFM), N(A2DP_CONNECT_OPEN_CFM),
+    N(A2DP_START_IND), N(A2DP_START_CFM), N(A2DP_SUSPEND_IND), N(A2DP_SUSPEND_CFM), N(A2DP_CLOSE_IND),
+    N(A2DP_CLOSE_CFM), N(A2DP_CODEC_SETTINGS_IND), N(A2DP_CONFIGURE_CODEC_IND), N(A2DP_ENCRYPTION_CHANGE_IND),
+
+    N(AGHFP_INIT_CFM), N(AGHFP_SLC_CONNECT_IND), N(AGHFP_SLC_CONNECT_CFM), N(AGHFP_SLC_DISCONNECT_IND),
+    N(AGHFP_AUDIO_CONNECT_IND), N(AGHFP_AUDIO_CONNECT_CFM), N(AGHFP_AUDIO_DISCONNECT_IND),
+    N(AGHFP_CALL_MGR_CREATE_CFM), N(AGHFP_CALL_MGR_CREATE_ALERTING_REMOTE_IND),
+    N(AGHFP_CALL_MGR_CREATE_WAITING_RESPONSE_IND), N(AGHFP_CALL_MGR_TERMINATE_IND), N(AGHFP_ANSWER_IND),
+    N(AGHFP_CALL_HANG_UP_IND), N(AGHFP_HS_CALL_ANSWER_IND), N(AGHFP_HS_CALL_HANG_UP_IND),
+    N(AGHFP_HS_AUDIO_REQUEST_IND), N(AGHFP_DIAL_IND), N(AGHFP_MEMORY_DIAL_IND), N(AGHFP_LAST_NUMBER_REDIAL_IND),
+    N(AGHFP_SYNC_MICROPHONE_GAIN_IND), N(AGHFP_SYNC_SPEAKER_VOLUME_IND), N(AGHFP_SEND_CALL_INDICATOR_CFM),
+    N(AGHFP_SEND_CALL_SETUP_INDICATOR_CFM), N(AGHFP_SEND_SERVICE_INDICATOR_CFM), N(AGHFP_SEND_RING_ALERT_CFM),
+    N(AGHFP_SET_REMOTE_MICROPHONE_GAIN_CFM), N(AGHFP_SET_REMOTE_SPEAKER_VOLUME_CFM),
+    N(AGHFP_UNRECOGNISED_AT_CMD_IND), N(AGHFP_CSR_SUPPORTED_FEATURES_IND),
+
+    N(AVRCP_INIT_CFM), N(AVRCP_CONNECT_IND), N(AVRCP_CONNECT_CFM), N(AVRCP_DISCONNECT_IND),
+    N(AVRCP_PASSTHROUGH_IND), N(AVRCP_UNITINFO_IND), N(AVRCP_SUBUNITINFO_IND), N(AVRCP_VENDORDEPENDENT_IND),
+
+    N(CODEC_INIT_CFM), N(CODEC_CONFIGURE_CFM), N(BATTERY_READING_MESSAGE),
+
+    N(MESSAGE_MORE_DATA), N(MESSAGE_MORE_SPACE), N(MESSAGE_FROM_KALIMBA), N(MESSAGE_STREAM_DISCONNECT),
+    N(MESSAGE_USB_ENUMERATED), N(MESSAGE_USB_SUSPENDED), N(MESSAGE_CHARGER_CHANGED),
+    { 0, NULL }
+};
+
+/* the class of an ID no name is known for */
+static const name_t message_bases[] = {
+    { APP_MESSAGE_BASE, "APP" }, { CL_MESSAGE_BASE, "CL" }, { A2DP_MESSAGE_BASE, "A2DP" },
+    { AGHFP_MESSAGE_BASE, "AGHFP" }, { AVRCP_MESSAGE_BASE, "AVRCP" }, { CODEC_MESSAGE_BASE, "CODEC" },
+    { SYSTEM_MESSAGE_BASE_, "SYSTEM" },
+    { 0, NULL }
+};
+
+static const name_t app_states[] = {
+    N(AppStateUninitialised), N(AppStateInitialising), N(AppStateIdle), N(AppStateInquiring),
+    N(AppStateSearching), N(AppStateConnecting), N(AppStateStreaming), N(AppStateInCall),
+    N(AppStateEnteringDfu), N(AppStateLowBattery), N(AppStatePoweredOff),
+    { 0, NULL }
+};
+
+static const name_t a2dp_states[] = {
+    N(A2dpStateUninitialised), N(A2dpStateDisconnected), N(A2dpStatePaged), N(A2dpStateConnected),
+    N(A2dpStateOpening), N(A2dpStateOpen), N(A2dpStateDisconnecting), N(A2dpStateStarting),
+    N(A2dpStateStreaming), N(A2dpStateSuspending), N(A2dpStateClosing),
+    { 0, NULL }
+};
+
+static const name_t avrcp_states[] = {
+    N(AvrcpStateUninitialised), N(AvrcpStateDisconnected), N(AvrcpStatePaging), N(AvrcpStatePaged),
+    N(AvrcpStateConnected), N(AvrcpStateDisconnecting),
+    { 0, NULL }
+};
+
+static const name_t aghfp_states[] = {
+    N(AghfpStateUninitialised), N(AghfpStateDisconnected), N(AghfpStatePaging), N(AghfpStatePaged),
+    N(AghfpStateConnected), N(AghfpStateDisconnecting), N(AghfpStateAudioOpening), N(AghfpStateAudioStreaming),
+    N(AghfpStateAudioClosing), N(AghfpStateCallSetup), N(AghfpStateCallActive), N(AghfpStateCallShutdown),
+    { 0, NULL }
+};
+
+static const name_t comm_actions[] = {
+    N(CommActionNone), N(CommActionCall), N(CommActionEndCall), N(CommActionStream), N(CommActionEndStream),
+    N(CommActionConnect), N(CommActionDisconnect), N(CommActionInquire), N(CommActionDiscover),
+    N(CommActionDiscoverWhileConnected),
+    { 0, NULL }
+};
+
+typedef struct{
+    unsigned type, instance, arg, value;
+    unsigned long time;
+}record_t;
+
+/* the time spent in each state of one state machine */
+typedef struct{
+    bool seen;
+    unsigned state;             /* as of the last record */
+    unsigned long since;        /* when it was entered, if known */
+    bool since_known;
+    unsigned entered[MAX_STATES];
+    unsigned long total[MAX_STATES];
+    unsigned long max[MAX_STATES];
+}machine_t;
+
+static record_t records[MAX_RECORDS];
+static machine_t machines[NUM_MACHINES];
+
+static const char *lookup(const name_t *names, int value)
+{
+    for(;names->name;names++)
+        if(names->value == value)
+            return names->name;
+    return NULL;
+}
+
+static const char *message_name(unsigned id)
+{
+    static char buf[32];
+    const name_t *base, *best = NULL;
+    const char *name = lookup(message_names, (int)id);
+
+    if(name)
+        return name;
+    for(base=message_bases;base->name;base++)
+        if(id >= (unsigned)base->value && (best == NULL || base->value > best->value))
+            best = base;
+    if(best && id - best->value < 0x100)
+        snprintf(buf, sizeof(buf), "%s+0x%02x", best->name, id - best->value);
+    else
+        snprintf(buf, sizeof(buf), "0x%04x", id);
+    return buf;
+}
+
+/* a state, or a comm action, with its number if it has no name */
+static const char *state_name(const name_t *names, unsigned value, char *buf, size_t size)
+{
+    const char *name = lookup(names, (int)value);
+
+    if(name)
+        return name;
+    snprintf(buf, size, "%u", value);
+    return buf;
+}
+
+static const name_t *states_of(unsigned type)
+{
+    switch(type){
+    case TraceAppState:     return app_states;
+    case TraceA2dpState:    return a2dp_states;
+    case TraceAvrcpState:   return avrcp_states;
+    case TraceAghfpState:   return aghfp_states;
+    }
+    return NULL;
+}
+
+static const char *machine_name(unsigned type)
+{
+    switch(type){
+    case TraceAppState:     return "app";
+    case TraceA2dpState:    return "a2dp";
+    case TraceAvrcpState:   return "avrcp";
+    case TraceAghfpState:   return "aghfp";
+    }
+    return "?";
+}
+
+/* the app is machine 0, then a2dp, avrcp and aghfp of each instance */
+static machine_t *machine_of(unsigned type, unsigned instance)
+{
+    if(type == TraceAppState)
+        return &machines[0];
+    if(instance >= MAX_NUM_DEV_CONNECTIONS)
+        return NULL;
+    return &machines[1 + instance * 3 + (type - TraceA2dpState)];
+}
+
+static unsigned word(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void print_record(const record_t *r, unsigned long last)
+{
+    char inst[4] = "", old[16], new[16];
+    const name_t *names = states_of(r->type);
+
+    if(r->instance != TRACE_NO_INSTANCE)
+        snprintf(inst, sizeof(inst), "%u", r->instance);
+    printf("%8lu %+7ld  %3s  ", r->time, (long)(r->time - last), inst);
+    switch(r->type){
+    case TraceMessage:
+    case TraceInstanceMessage:
+        printf("msg    %s\n", message_name(r->value));
+        break;
+    case TraceCommAction:
+        printf("comm   %s, was %s\n", state_name(comm_actions, r->value, new, sizeof(new)),
+               state_name(comm_actions, r->arg, old, sizeof(old)));
+        break;
+    default:
+        if(names){
+            printf("%-6s %s -> %s\n", machine_name(r->type), state_name(names, r->arg, old, sizeof(old)),
+                   state_name(names, r->value, new, sizeof(new)));
+        }else{
+            printf("type %u %02x %04x\n", r->type, r->arg, r->value);
+        }
+        break;
+    }
+}
+
+static void note_state(const record_t *r)
+{
+    machine_t *m = machine_of(r->type, r->instance);
+    unsigned long spent;
+
+    if(m == NULL || r->value >= MAX_STATES || r->arg >= MAX_STATES)
+        return;
+    /* only a state seen being entered has a time spent in it */
+    if(m->seen && m->since_known && m->state == r->arg){
+        spent = r->time - m->since;
+        m->total[r->arg] += spent;
+        if(spent > m->max[r->arg])
+            m->max[r->arg] = spent;
+    }
+    m->seen = TRUE;
+    m->state = r->value;
+    m->since = r->time;
+    m->since_known = TRUE;
+    m->entered[r->value]++;
+}
+
+static void print_states(unsigned long now)
+{
+    static const unsigned types[] = { TraceAppState, TraceA2dpState, TraceAvrcpState, TraceAghfpState };
+    unsigned t, i, s;
+    char label[16], buf[16];
+
+    printf("\n%-10s %-28s %7s %9s %9s\n", "time in", "state", "entered", "total ms", "max ms");
+    for(t=0;t<sizeof(types)/sizeof(types[0]);t++){
+        for(i=0;i<(types[t] == TraceAppState ? 1 : MAX_NUM_DEV_CONNECTIONS);i++){
+            machine_t *m = machine_of(types[t], i);
+
+            if(!m->seen)
+                continue;
+            if(types[t] == TraceAppState)
+                snprintf(label, sizeof(label), "%s", machine_name(types[t]));
+            else
+                snprintf(label, sizeof(label), "%s %u", machine_name(types[t]), i);
+            for(s=0;s<MAX_STATES;s++){
+                bool current = s == m->state;
+
+                if(!m->entered[s] && !current)
+                    continue;
+                /* the state it is in at the dump counts up to the dump, marked with a * */
+                printf("%-10s %-28s %7u %9lu %9lu%s\n", label, state_name(states_of(types[t]), s, buf, sizeof(buf)),
+                       m->entered[s], m->total[s] + (current ? now - m->since : 0),
+                       current && now - m->since > m->max[s] ? now - m->since : m->max[s], current ? " *" : "");
+            }
+        }
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: trace_decode [-s] dump.trc\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char header[TRACE_HEADER_BYTES], rec[TRACE_RECORD_WORDS * 2];
+    unsigned count, overwritten, n = 0, i;
+    unsigned long now, last;
+    bool summary = FALSE;
+    FILE *f;
+    int opt;
+
+    while((opt = getopt(argc, argv, "s")) != -1){
+        switch(opt){
+        case 's':
+            summary = TRUE;
+            break;
+        default:
+            usage();
+        }
+    }
+    if(optind != argc - 1)
+        usage();
+    if((f = fopen(argv[optind], "rb")) == NULL){
+        perror(argv[optind]);
+        return 1;
+    }
+    if(fread(header, 1, sizeof(header), f) != sizeof(header) || header[0] != 'A' || header[1] != 'T'){
+        fprintf(stderr, "%s: not an adaptor trace\n", argv[optind]);
+        return 1;
+    }
+    if(header[2] != TRACE_VERSION || header[3] != sizeof(rec)){
+        fprintf(stderr, "%s: trace version %u with %u byte records, expected %u and %u\n",
+                argv[optind], header[2], header[3], TRACE_VERSION, (unsigned)sizeof(rec));
+        return 1;
+    }
+    count = word(header + 4);
+    overwritten = word(header + 6);
+    now = ((unsigned long)word(header + 8) << 16) | word(header + 10);
+    while(n < count && n < MAX_RECORDS && fread(rec, 1, sizeof(rec), f) == sizeof(rec)){
+        unsigned w0 = word(rec);
+
+        records[n].type = w0 >> 12;
+        records[n].instance = (w0 >> 8) & 0xf;
+        records[n].arg = w0 & 0xff;
+        records[n].value = word(rec + 2);
+        records[n].time = ((unsigned long)word(rec + 4) << 16) | word(rec + 6);
+        n++;
+    }
+    fclose(f);
+    printf("%u records", n);
+    if(n < count)
+        printf(" of %u, the dump is cut short", count);
+    printf(", %u overwritten before them, dumped at %lu ms\n", overwritten, now);
+
+    if(!summary)
+        printf("\n%8s %7s  %3s  %s\n", "ms", "+ms", "dev", "event");
+    last = n ? records[0].time : 0;
+    for(i=0;i<n;i++){
+        if(!summary)
+            print_record(&records[i], last);
+        last = records[i].time;
+        if(states_of(records[i].type))
+            note_state(&records[i]);
+    }
+    print_states(now);
+    return 0;
+}
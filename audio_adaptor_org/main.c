@@ -24,6 +24,7 @@ DESCRIPTION
 #include "audioAdaptor_sys_handler.h"
 #include "audioAdaptor_cl_msg_handler.h"
 #include "audioAdaptor_codec_msg_handler.h"
+#include "audioAdaptor_trace.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -70,6 +71,8 @@ DESCRIPTION
 */
 static void messageHandler(Task task, MessageId id, Message message)
 {
+    TRACE_MESSAGE(id);
+    
     if (SYSTEM_MESSAGE(id))
     {
         sysHandleSystemMessage(id, message);
@@ -167,6 +170,9 @@ int main(void)
     the_app->task.handler = messageHandler;
     MessageKalimbaTask(&the_app->task);
     
+    /* Start recording the trace before the first message is sent */
+    TRACE_INIT();
+    
     /* Initialise the features */
     initUserFeatures ();
     